@@ -0,0 +1,104 @@
+/**
+ * \file   AccessTableBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 29 11:02:37 2012
+ *
+ * \brief  ModAccess: AccessTable build time, size and lookup latency.
+ *
+ */
+
+/*
+  Un million de préfixes IPv4 aléatoires (longueurs 8 à 32) et 10000
+  préfixes IPv6 (longueurs 16 à 64), puis des recherches d'adresses
+  aléatoires : les accès au trie sont dépendants, la latence d'une
+  recherche est celle de 3 (IPv4) à 8 (IPv6 /64) lectures hors cache.
+
+    access-table-bench [recherches en millions]
+*/
+
+#include "Bench.h"
+
+#include "AccessTable.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const std::size_t V4Rules   = 1000000;
+const std::size_t V6Rules   = 10000;
+const std::size_t Addresses = 1 << 20;  // puissance de deux
+
+unsigned char randomByte()
+{
+  return static_cast<unsigned char>(std::rand() >> 4);
+}
+
+AccessRule randomRule(bool v4)
+{
+  AccessRule rule;
+
+  std::memset(&rule, 0, sizeof rule);
+  rule.action = std::rand() % 2 ? AccessRule::Allow : AccessRule::Deny;
+  rule.v4     = v4;
+  rule.length = v4 ? 8 + std::rand() % 25 : 16 + std::rand() % 49;
+  for (unsigned byte = 0; byte < (rule.length + 7) / 8; ++byte)
+    rule.bytes[byte] = randomByte();
+  for (unsigned bit = rule.length; bit < (v4 ? 32u : 128u); ++bit)
+    rule.bytes[bit / 8] &= static_cast<unsigned char>(~(0x80 >> (bit % 8)));
+  return rule;
+}
+
+template <typename Lookup>
+void lookups(const char *name, const std::vector<unsigned char> & addresses, std::size_t width,
+             unsigned long count, Lookup lookup)
+{
+  unsigned long denied = 0;
+  const double  start  = bench::now();
+
+  for (unsigned long i = 0; i < count; ++i)
+    denied += lookup(&addresses[(i & (Addresses - 1)) * width]) == AccessRule::Deny;
+  bench::report(name, bench::now() - start, count);
+  bench::keep(denied);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long     count = bench::iterations(argc, argv, 20) * 1000000;
+  std::vector<AccessRule> rules;
+
+  std::srand(1);
+  for (std::size_t i = 0; i < V4Rules; ++i)
+    rules.push_back(randomRule(true));
+  for (std::size_t i = 0; i < V6Rules; ++i)
+    rules.push_back(randomRule(false));
+
+  const double      start = bench::now();
+  const AccessTable table(rules, AccessRule::Allow);
+
+  std::printf("%lu rules built in %.2f s, %.1f MiB\n", static_cast<unsigned long>(table.ruleCount()),
+              bench::now() - start, table.memoryUsage() / 1048576.0);
+
+  std::vector<unsigned char> v4(Addresses * 4);
+  std::vector<unsigned char> v6(Addresses * 16);
+
+  for (std::size_t i = 0; i < v4.size(); ++i)
+    v4[i] = randomByte();
+  // la moitié des adresses IPv6 dans les /16 des règles, pour
+  // descendre dans le trie
+  for (std::size_t i = 0; i < Addresses; ++i)
+    {
+      const AccessRule & rule = rules[V4Rules + std::rand() % V6Rules];
+
+      for (std::size_t byte = 0; byte < 16; ++byte)
+        v6[i * 16 + byte] = i % 2 && byte < 8 ? rule.bytes[byte] : randomByte();
+    }
+
+  lookups("lookupV4 (1M prefixes)", v4, 4, count,
+          [&table](const unsigned char *bytes) { return table.lookupV4(bytes); });
+  lookups("lookupV6 (10k prefixes)", v6, 16, count,
+          [&table](const unsigned char *bytes) { return table.lookupV6(bytes); });
+  return 0;
+}
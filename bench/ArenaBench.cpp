@@ -0,0 +1,221 @@
+/**
+ * \file   ArenaBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 31 15:20:09 2012
+ *
+ * \brief  Allocations per request on a keep-alive connection, with and
+ *         without the reuse of the request and the Arena.
+ *
+ */
+
+/*
+  Une connexion keep-alive reçoit 100 requêtes. Pour chacune :
+
+  - la requête est remplie comme le parseur (add() de 8 champs, l'URI)
+  - la réponse reçoit un statut et 3 champs
+  - un module garde des données de la requête : les segments du chemin
+    et une liste de 16 pointeurs
+
+  fresh : une HttpRequest et une HttpResponse par requête, des
+          std::string et std::vector (avant Arena)
+  reused : clear() de la requête et de la réponse, Arena::reset(), les
+           données du module dans l'arène (ArenaAllocator)
+
+  Les allocations de la première requête de la connexion et des
+  suivantes sont comptées séparément (operator new).
+
+    arena-bench [connexions]
+*/
+
+#include "Bench.h"
+
+#include "bref/Arena.h"
+#include "bref/HttpRequest.h"
+#include "bref/HttpResponse.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned long allocations = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++allocations;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace {
+
+const int RequestsPerConnection = 100;
+
+const char *Fields[][2] = {
+  { "Host", "www.example.com" },
+  { "User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:12.0) Gecko/20100101 Firefox/12.0" },
+  { "Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8" },
+  { "Accept-Language", "fr,fr-fr;q=0.8,en-us;q=0.5,en;q=0.3" },
+  { "Accept-Encoding", "gzip, deflate" },
+  { "Connection", "keep-alive" },
+  { "Referer", "http://www.example.com/index.html" },
+  { "Cookie", "session=0123456789abcdef; lang=fr" },
+};
+
+const std::string Uri = "/static/images/gallery/2012/05/a-long-enough-file-name.png";
+
+void fill(bref::HttpRequest & request, bref::HttpResponse & response)
+{
+  request.setMethod(bref::request_methods::Get);
+  request.setUri(Uri);
+  for (std::size_t i = 0; i < sizeof Fields / sizeof Fields[0]; ++i)
+    request.add(Fields[i][0], std::strlen(Fields[i][0]), Fields[i][1], std::strlen(Fields[i][1]));
+  response.setStatus(bref::status_codes::OK);
+  response.add("Content-Type", 12, "image/png", 9);
+  response.add("Content-Length", 14, "48213", 5);
+  response.add("Last-Modified", 13, "Tue, 29 May 2012 10:00:00 GMT", 29);
+}
+
+/*
+  Les données d'un module, avec l'allocateur standard.
+*/
+std::size_t moduleData(const bref::HttpRequest & request)
+{
+  std::vector<std::string>  segments;
+  std::vector<const void *> pointers;
+  const std::string &       uri = request.getUri();
+  std::size_t               begin = 1;
+
+  for (std::size_t end; (end = uri.find('/', begin)) != std::string::npos; begin = end + 1)
+    segments.push_back(uri.substr(begin, end - begin));
+  segments.push_back(uri.substr(begin));
+  for (int i = 0; i < 16; ++i)
+    pointers.push_back(&request);
+  return segments.size() + pointers.size();
+}
+
+/*
+  Les mêmes données dans l'arène : les segments sont copiés dans
+  l'arène, les vecteurs utilisent ArenaAllocator.
+*/
+std::size_t moduleData(const bref::HttpRequest & request, bref::Arena & arena)
+{
+  typedef std::pair<const char *, std::size_t> Segment;
+
+  std::vector<Segment, bref::ArenaAllocator<Segment> >           segments((bref::ArenaAllocator<Segment>(arena)));
+  std::vector<const void *, bref::ArenaAllocator<const void *> > pointers((bref::ArenaAllocator<const void *>(arena)));
+  const std::string &                                            uri   = request.getUri();
+  std::size_t                                                    begin = 1;
+
+  for (std::size_t end = begin; end <= uri.size(); ++end)
+    {
+      if (end < uri.size() && uri[end] != '/')
+        continue;
+
+      char *copy = static_cast<char *>(arena.allocate(end - begin, 1));
+
+      std::memcpy(copy, uri.data() + begin, end - begin);
+      segments.push_back(Segment(copy, end - begin));
+      begin = end + 1;
+    }
+  for (int i = 0; i < 16; ++i)
+    pointers.push_back(&request);
+  return segments.size() + pointers.size();
+}
+
+struct Result
+{
+  unsigned long first;
+  unsigned long next;
+  double        seconds;
+};
+
+Result fresh(unsigned long connections)
+{
+  Result       result = { 0, 0, 0 };
+  const double start  = bench::now();
+
+  for (unsigned long c = 0; c < connections; ++c)
+    for (int r = 0; r < RequestsPerConnection; ++r)
+      {
+        const unsigned long before = allocations;
+
+        {
+          bref::HttpRequest  request;
+          bref::HttpResponse response;
+
+          fill(request, response);
+          bench::keep(moduleData(request));
+        }
+        (r == 0 ? result.first : result.next) += allocations - before;
+      }
+  result.seconds = bench::now() - start;
+  return result;
+}
+
+Result reused(unsigned long connections)
+{
+  Result       result = { 0, 0, 0 };
+  const double start  = bench::now();
+
+  for (unsigned long c = 0; c < connections; ++c)
+    {
+      // l'état d'une connexion
+      bref::Arena        arena;
+      bref::HttpRequest  request;
+      bref::HttpResponse response;
+
+      for (int r = 0; r < RequestsPerConnection; ++r)
+        {
+          const unsigned long before = allocations;
+
+          fill(request, response);
+          bench::keep(moduleData(request, arena));
+          request.clear();
+          response.clear();
+          arena.reset();
+          (r == 0 ? result.first : result.next) += allocations - before;
+        }
+    }
+  result.seconds = bench::now() - start;
+  return result;
+}
+
+void print(const char *name, const Result & result, unsigned long connections)
+{
+  bench::report(name, result.seconds, connections * RequestsPerConnection);
+  std::printf("%-32s %10.2f allocations (first request)\n", "",
+              static_cast<double>(result.first) / connections);
+  std::printf("%-32s %10.2f allocations / request (next)\n", "",
+              static_cast<double>(result.next) / (connections * (RequestsPerConnection - 1)));
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long connections = bench::iterations(argc, argv, 2000);
+
+  print("fresh", fresh(connections), connections);
+  print("reused", reused(connections), connections);
+  return 0;
+}
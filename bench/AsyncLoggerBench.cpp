@@ -0,0 +1,132 @@
+/**
+ * \file   AsyncLoggerBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 14:10:33 2012
+ *
+ * \brief  AsyncLogger::log() latency with many logging threads.
+ *
+ */
+
+/*
+  Des threads (16 par défaut) loggent Messages messages de 80 octets
+  chacun, la durée de chaque appel à log() est notée. Les lignes vont
+  dans /dev/null.
+
+  - write        référence : un mutex et un write() par message
+  - Block        AsyncLogger, le thread attend quand son ring est plein
+  - DropNewest   AsyncLogger, le message est perdu quand le ring est
+                 plein
+
+    async-logger-bench [threads]
+*/
+
+#include "Bench.h"
+
+#include "bref/AsyncLogger.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int Messages = 100000;
+
+/*
+  Le logger synchrone le plus simple.
+*/
+class WriteLogger : public bref::ILogger
+{
+private:
+  int        fd_;
+  std::mutex mutex_;
+
+public:
+  explicit WriteLogger(int fd)
+    : fd_(fd)
+  { }
+
+  Severity severity() const
+  {
+    return Debug;
+  }
+
+  void setSeverity(Severity)
+  { }
+
+  void log(Severity, const std::string & message)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (::write(fd_, message.data(), message.size()) < 0)
+      return;
+  }
+};
+
+void run(const char *name, bref::ILogger & logger, int threads)
+{
+  const std::string             message(80, 'x');
+  std::vector<bench::Histogram> histograms(threads);
+  std::vector<std::thread>      workers;
+  const double                  start = bench::now();
+
+  for (int t = 0; t < threads; ++t)
+    workers.push_back(std::thread([&, t] {
+          for (int i = 0; i < Messages; ++i)
+            {
+              const double begin = bench::now();
+
+              logger.log(bref::ILogger::Info, message);
+              histograms[t].add(bench::now() - begin);
+            }
+        }));
+
+  bench::Histogram total;
+
+  for (int t = 0; t < threads; ++t)
+    {
+      workers[t].join();
+      total.merge(histograms[t]);
+    }
+  std::printf("%-12s %10.0f messages/s  p50 <= %lu ns  p99 <= %lu ns  p99.9 <= %lu ns  max %.0f ns\n",
+              name, total.count / (bench::now() - start), total.percentile(0.5), total.percentile(0.99),
+              total.percentile(0.999), total.max);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const int threads = static_cast<int>(bench::iterations(argc, argv, 16));
+  const int null    = ::open("/dev/null", O_WRONLY);
+
+  std::printf("%d threads\n", threads);
+  {
+    WriteLogger logger(null);
+
+    run("write", logger, threads);
+  }
+
+  bref::AsyncLogger::Options options;
+
+  options.overflow = bref::AsyncLogger::Block;
+  {
+    bref::AsyncLogger logger(bref::AsyncLogger::FdWriter(null), options);
+
+    run("Block", logger, threads);
+  }
+  options.overflow = bref::AsyncLogger::DropNewest;
+  {
+    bref::AsyncLogger logger(bref::AsyncLogger::FdWriter(null), options);
+
+    run("DropNewest", logger, threads);
+    logger.flush();
+    std::printf("%-12s %10lu dropped\n", "", static_cast<unsigned long>(logger.dropped()));
+  }
+  ::close(null);
+  return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * \file   Bench.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 24 17:20:44 2012
+ *
+ * \brief  Timing helpers of the benchmarks.
+ *
+ */
+
+#ifndef BREF_API_BENCH_BENCH_H_
+#define BREF_API_BENCH_BENCH_H_
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+  Les benchmarks affichent une ligne par mesure :
+
+    <nom>  <ns par opération>  [<Mo/s>]
+
+  Le nombre d'itérations peut être donné en premier argument.
+*/
+namespace bench {
+
+  inline double now()
+  {
+    timespec time;
+
+    ::clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+  }
+
+  inline unsigned long iterations(int argc, char *argv[], unsigned long byDefault)
+  {
+    return argc > 1 ? std::strtoul(argv[1], 0, 10) : byDefault;
+  }
+
+  /*
+    \p bytes traités par opération, 0 si le débit n'a pas de sens.
+  */
+  inline void report(const char *name, double seconds, unsigned long operations, std::size_t bytes = 0)
+  {
+    std::printf("%-32s %10.1f ns", name, seconds * 1e9 / operations);
+    if (bytes)
+      std::printf(" %10.1f MB/s", bytes * static_cast<double>(operations) / seconds / 1e6);
+    std::printf("\n");
+  }
+
+  /*
+    Empêche le compilateur de supprimer un calcul dont le résultat
+    n'est pas utilisé (GCC et Clang).
+  */
+  template <typename T>
+  inline void keep(const T & value)
+  {
+    asm volatile("" : : "g" (value) : "memory");
+  }
+
+  /*
+    Durées en puissances de deux de nanosecondes.
+  */
+  struct Histogram
+  {
+    unsigned long buckets[40];
+    unsigned long count;
+    double        max;
+
+    Histogram()
+      : count(0), max(0)
+    {
+      std::fill(buckets, buckets + 40, 0);
+    }
+
+    void add(double seconds)
+    {
+      const double nanoseconds = seconds * 1e9;
+      int          bucket      = 0;
+
+      while (bucket < 39 && (1ul << bucket) < nanoseconds)
+        ++bucket;
+      ++buckets[bucket];
+      ++count;
+      max = std::max(max, nanoseconds);
+    }
+
+    void merge(const Histogram & other)
+    {
+      for (int i = 0; i < 40; ++i)
+        buckets[i] += other.buckets[i];
+      count += other.count;
+      max = std::max(max, other.max);
+    }
+
+    /*
+      Borne haute du bucket qui contient le percentile \p p.
+    */
+    unsigned long percentile(double p) const
+    {
+      unsigned long seen = 0;
+
+      for (int i = 0; i < 40; ++i)
+        if ((seen += buckets[i]) >= count * p)
+          return 1ul << i;
+      return 1ul << 39;
+    }
+  };
+
+} // ! namespace bench
+
+#endif /* !BREF_API_BENCH_BENCH_H_ */
@@ -0,0 +1,249 @@
+/**
+ * \file   BrefValueBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 31 17:05:44 2012
+ *
+ * \brief  Size and throughput of BrefValue against the previous layout,
+ *         on header maps and configuration trees.
+ *
+ */
+
+/*
+  LegacyValue reprend la disposition de BrefValue avant l'union : tous
+  les membres construits (chaîne, booléen, double, entier, std::map et
+  std::list).
+
+  - header map    une std::map<nom, valeur> de 20 champs chaînes (l'ancien
+                  HttpHeader) : construction, copie et lecture
+  - config tree   N hôtes virtuels de 6 clés : construction, copie et
+                  lecture de chaque clé
+
+  La mémoire allouée (octets demandés à operator new) est comptée.
+
+    bref-value-bench [hôtes]
+*/
+
+#include "Bench.h"
+
+#include "bref/BrefValue.h"
+#include "bref/detail/util/ICaseStringCmp.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <new>
+#include <string>
+
+namespace {
+
+unsigned long allocatedBytes = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  allocatedBytes += size;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+/*
+  Une valeur est une étiquette de type et l'union (une chaîne ou un
+  pointeur), pas plus.
+*/
+typedef char BrefValueIsTagAndUnion[sizeof(bref::BrefValue) <= sizeof(std::string) + sizeof(void *) ? 1 : -1];
+
+namespace {
+
+/*
+  L'ancienne BrefValue, réduite à ce que mesure le bench.
+*/
+class LegacyValue
+{
+public:
+  typedef std::map<std::string, LegacyValue> Array;
+  typedef std::list<LegacyValue>             List;
+
+private:
+  bref::BrefValue::confType type_;
+  std::string               stringValue_;
+  bool                      boolValue_;
+  double                    doubleValue_;
+  int                       intValue_;
+  Array                     arrayValue_;
+  List                      listValue_;
+
+public:
+  LegacyValue()
+    : type_(bref::BrefValue::nullType), stringValue_(), boolValue_(false), doubleValue_(0),
+      intValue_(0), arrayValue_(), listValue_()
+  { }
+
+  explicit LegacyValue(const std::string & value)
+    : type_(bref::BrefValue::stringType), stringValue_(value), boolValue_(false), doubleValue_(0),
+      intValue_(0), arrayValue_(), listValue_()
+  { }
+
+  explicit LegacyValue(int value)
+    : type_(bref::BrefValue::intType), stringValue_(), boolValue_(false), doubleValue_(0),
+      intValue_(value), arrayValue_(), listValue_()
+  { }
+
+  explicit LegacyValue(bool value)
+    : type_(bref::BrefValue::boolType), stringValue_(), boolValue_(value), doubleValue_(0),
+      intValue_(0), arrayValue_(), listValue_()
+  { }
+
+  const std::string & asString() const
+  {
+    return stringValue_;
+  }
+
+  int asInt() const
+  {
+    return intValue_;
+  }
+
+  const Array & asArray() const
+  {
+    return arrayValue_;
+  }
+
+  LegacyValue & operator[](const std::string & key)
+  {
+    type_ = bref::BrefValue::arrayType;
+    return arrayValue_[key];
+  }
+};
+
+const char *HeaderNames[] = {
+  "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding", "Connection",
+  "Referer", "Cookie", "If-Modified-Since", "Cache-Control", "X-Field-10", "X-Field-11",
+  "X-Field-12", "X-Field-13", "X-Field-14", "X-Field-15", "X-Field-16", "X-Field-17",
+  "X-Field-18", "X-Field-19",
+};
+
+const char *HostKeys[] = { "DocumentRoot", "ServerName", "Index", "Port", "Cache", "Timeout" };
+
+std::string hostName(int i)
+{
+  return "host" + std::to_string(i) + ".example.com";
+}
+
+/*
+  Value est BrefValue ou LegacyValue.
+*/
+template <typename Value>
+void headerMap(const char *name, unsigned long rounds)
+{
+  typedef std::map<std::string, Value, bref::util::ICaseStringCmp> Header;
+
+  const std::size_t   count  = sizeof HeaderNames / sizeof HeaderNames[0];
+  const unsigned long before = allocatedBytes;
+  const double        start  = bench::now();
+
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      Header header;
+
+      for (std::size_t i = 0; i < count; ++i)
+        header[HeaderNames[i]] = Value(std::string("value of the field"));
+
+      const Header copy(header);
+      std::size_t  bytes = 0;
+
+      for (typename Header::const_iterator it = copy.begin(); it != copy.end(); ++it)
+        bytes += it->second.asString().size();
+      bench::keep(bytes);
+    }
+  bench::report(name, bench::now() - start, rounds);
+  std::printf("%-32s %10.0f bytes allocated / header\n", "",
+              static_cast<double>(allocatedBytes - before) / rounds);
+}
+
+/*
+  Array est le tableau associatif de Value.
+*/
+template <typename Value, typename Array>
+void configTree(const char *name, int hosts)
+{
+  unsigned long before = allocatedBytes;
+  double        start  = bench::now();
+  Value         config;
+  Value &       virtualHosts = config["VirtualHosts"];
+
+  for (int i = 0; i < hosts; ++i)
+    {
+      Value & host = virtualHosts[hostName(i)];
+
+      host[HostKeys[0]] = Value("/var/www/" + hostName(i));
+      host[HostKeys[1]] = Value(hostName(i));
+      host[HostKeys[2]] = Value(std::string("index.html"));
+      host[HostKeys[3]] = Value(8080);
+      host[HostKeys[4]] = Value(true);
+      host[HostKeys[5]] = Value(30);
+    }
+
+  std::string label = std::string(name) + " build";
+
+  bench::report(label.c_str(), bench::now() - start, hosts);
+  std::printf("%-32s %10.0f bytes allocated / host\n", "",
+              static_cast<double>(allocatedBytes - before) / hosts);
+
+  before = allocatedBytes;
+  start  = bench::now();
+
+  const Value copy(config);
+
+  label = std::string(name) + " copy";
+  bench::report(label.c_str(), bench::now() - start, hosts);
+  std::printf("%-32s %10.0f bytes allocated / host\n", "",
+              static_cast<double>(allocatedBytes - before) / hosts);
+
+  const Array & array = copy.asArray().find("VirtualHosts")->second.asArray();
+  std::size_t   sum   = 0;
+
+  start = bench::now();
+  for (typename Array::const_iterator it = array.begin(); it != array.end(); ++it)
+    {
+      const Array & host = it->second.asArray();
+
+      sum += host.find(HostKeys[0])->second.asString().size();
+      sum += host.find(HostKeys[1])->second.asString().size();
+      sum += host.find(HostKeys[3])->second.asInt();
+      sum += host.find(HostKeys[5])->second.asInt();
+    }
+  label = std::string(name) + " read";
+  bench::report(label.c_str(), bench::now() - start, hosts);
+  bench::keep(sum);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const int hosts = static_cast<int>(bench::iterations(argc, argv, 10000));
+
+  std::printf("sizeof(BrefValue)   %lu\n", static_cast<unsigned long>(sizeof(bref::BrefValue)));
+  std::printf("sizeof(LegacyValue) %lu\n", static_cast<unsigned long>(sizeof(LegacyValue)));
+
+  headerMap<bref::BrefValue>("BrefValue header map", 100000);
+  headerMap<LegacyValue>("LegacyValue header map", 100000);
+  configTree<bref::BrefValue, bref::BrefValueArray>("BrefValue config", hosts);
+  configTree<LegacyValue, LegacyValue::Array>("LegacyValue config", hosts);
+  return 0;
+}
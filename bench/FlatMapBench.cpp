@@ -0,0 +1,168 @@
+/**
+ * \file   FlatMapBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 30 09:52:18 2012
+ *
+ * \brief  Building and searching a FlatMap of 10000 and more keys.
+ *
+ */
+
+/*
+  Construction d'un FlatMap<std::string, int> de N clés :
+
+  - operator[] sorted   clés en ordre croissant (ajout en fin)
+  - operator[] random   ordre aléatoire, quadratique
+  - insert(first,last)  ordre aléatoire, un tri
+  - std::map            ordre aléatoire, pour comparaison
+
+  puis une recherche de chaque clé dans le FlatMap et la std::map, et
+  BrefValueView::toBrefValue() d'une image de configuration : N hôtes
+  virtuels de 4 clés, soit 5 N + 1 noeuds.
+
+  operator[] random n'est mesuré que jusqu'à 100000 clés.
+
+    flat-map-bench [N]
+*/
+
+#include "Bench.h"
+
+#include "bref/BrefValueView.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef bref::util::FlatMap<std::string, int> Map;
+
+const std::size_t QuadraticLimit = 100000;
+
+std::vector<std::string> makeKeys(std::size_t count)
+{
+  std::vector<std::string> keys;
+  char                     key[32];
+
+  for (std::size_t i = 0; i < count; ++i)
+    {
+      std::snprintf(key, sizeof key, "Key%08lu", static_cast<unsigned long>(i));
+      keys.push_back(key);
+    }
+  return keys;
+}
+
+void buildSorted(const std::vector<std::string> & sorted)
+{
+  const double start = bench::now();
+  Map          map;
+
+  for (std::size_t i = 0; i < sorted.size(); ++i)
+    map[sorted[i]] = static_cast<int>(i);
+  bench::report("operator[] sorted", bench::now() - start, sorted.size());
+  bench::keep(map.size());
+}
+
+void buildRandom(const std::vector<std::string> & shuffled)
+{
+  if (shuffled.size() > QuadraticLimit)
+    return;
+
+  const double start = bench::now();
+  Map          map;
+
+  for (std::size_t i = 0; i < shuffled.size(); ++i)
+    map[shuffled[i]] = static_cast<int>(i);
+  bench::report("operator[] random", bench::now() - start, shuffled.size());
+  bench::keep(map.size());
+}
+
+void buildRange(const std::vector<std::string> & shuffled, Map & map)
+{
+  const double                 start = bench::now();
+  std::vector<Map::value_type> values;
+
+  values.reserve(shuffled.size());
+  for (std::size_t i = 0; i < shuffled.size(); ++i)
+    values.push_back(Map::value_type(shuffled[i], static_cast<int>(i)));
+  map.insert(values.begin(), values.end());
+  bench::report("insert(first,last) random", bench::now() - start, shuffled.size());
+}
+
+void buildStdMap(const std::vector<std::string> & shuffled, std::map<std::string, int> & map)
+{
+  const double start = bench::now();
+
+  for (std::size_t i = 0; i < shuffled.size(); ++i)
+    map[shuffled[i]] = static_cast<int>(i);
+  bench::report("std::map random", bench::now() - start, shuffled.size());
+}
+
+template <typename Container>
+void lookup(const char *name, const Container & map, const std::vector<std::string> & shuffled)
+{
+  const double start = bench::now();
+  std::size_t  found = 0;
+
+  for (std::size_t i = 0; i < shuffled.size(); ++i)
+    found += map.count(shuffled[i]);
+  bench::report(name, bench::now() - start, shuffled.size());
+  bench::keep(found);
+}
+
+void configImage(const std::vector<std::string> & shuffled)
+{
+  std::vector<bref::BrefValueArray::value_type> hosts(shuffled.size());
+  bref::BrefValue                               config;
+
+  for (std::size_t i = 0; i < shuffled.size(); ++i)
+    {
+      bref::BrefValue & host = hosts[i].second;
+
+      hosts[i].first       = shuffled[i];
+      host["DocumentRoot"] = bref::BrefValue("/var/www/" + shuffled[i]);
+      host["Port"]         = bref::BrefValue(8080);
+      host["Index"]        = bref::BrefValue(std::string("index.html"));
+      host["Cache"]        = bref::BrefValue(true);
+    }
+  config["VirtualHosts"] = bref::BrefValue(bref::BrefValueArray(std::make_move_iterator(hosts.begin()),
+                                                                std::make_move_iterator(hosts.end())));
+
+  bref::Buffer image;
+
+  bref::BrefValueImage::serialize(config, image);
+
+  const double          start = bench::now();
+  const bref::BrefValue copy  = bref::BrefValueImage::root(&image[0]).toBrefValue();
+
+  bench::report("toBrefValue (per host)", bench::now() - start, shuffled.size());
+  bench::keep(copy.asArray().size());
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const std::size_t        count = bench::iterations(argc, argv, 20000);
+  std::vector<std::string> sorted = makeKeys(count);
+  std::vector<std::string> shuffled(sorted);
+
+  std::srand(1);
+  for (std::size_t i = shuffled.size(); i > 1; --i)
+    shuffled[i - 1].swap(shuffled[std::rand() % i]);
+  std::printf("%lu keys\n", static_cast<unsigned long>(count));
+
+  Map                        map;
+  std::map<std::string, int> stdMap;
+
+  buildSorted(sorted);
+  buildRandom(shuffled);
+  buildRange(shuffled, map);
+  buildStdMap(shuffled, stdMap);
+  lookup("FlatMap::count", map, shuffled);
+  lookup("std::map::count", stdMap, shuffled);
+  configImage(shuffled);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * \file   FunctionBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 11:05:17 2012
+ *
+ * \brief  bref::Function construction, copy and call against
+ *         std::function.
+ *
+ */
+
+/*
+  Pour chaque cible (pointeur de membre lié, petit foncteur, gros
+  foncteur) : construction, copie, appel puis destruction, avec le
+  nombre d'allocations par tour (operator new est compté).
+
+    function-bench [iterations]
+*/
+
+#include "Bench.h"
+
+#include "bref/Function.hpp"
+
+#include <functional>
+#include <new>
+
+namespace {
+
+unsigned long allocations = 0;
+
+struct Car
+{
+  int id;
+
+  int go(int x) { return id + x; }
+};
+
+struct Small
+{
+  int a;
+
+  int operator()(int x) { return a + x; }
+};
+
+struct Big
+{
+  char pad[100];
+  int  a;
+
+  int operator()(int x) { return a - x; }
+};
+
+template <typename Fn, typename Target>
+void run(const char *name, const Target & target, unsigned long iterations)
+{
+  const unsigned long before = allocations;
+  const double        start  = bench::now();
+  long                sum    = 0;
+
+  for (unsigned long i = 0; i < iterations; ++i)
+    {
+      Fn f(target);
+      Fn copy(f);
+
+      sum += copy(static_cast<int>(i));
+    }
+
+  const double elapsed = bench::now() - start;
+
+  bench::keep(sum);
+  bench::report(name, elapsed, iterations);
+  std::printf("%-32s %10.1f allocations\n", "",
+              static_cast<double>(allocations - before) / iterations);
+}
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  ++allocations;
+
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) throw()
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) throw()
+{
+  std::free(p);
+}
+
+int main(int argc, char *argv[])
+{
+  typedef bref::Function<int (int)> BrefFn;
+  typedef std::function<int (int)>  StdFn;
+
+  const unsigned long iterations = bench::iterations(argc, argv, 10 * 1000 * 1000);
+  Car                 car        = { 10 };
+  const Small         small      = { 3 };
+  Big                 big;
+
+  big.a = 50;
+  run<BrefFn>("bref::Function bound member", BrefFn(&car, &Car::go), iterations);
+  run<StdFn>("std::function std::bind", StdFn(std::bind(&Car::go, &car, std::placeholders::_1)), iterations);
+  run<BrefFn>("bref::Function small functor", small, iterations);
+  run<StdFn>("std::function small functor", small, iterations);
+  run<BrefFn>("bref::Function big functor", big, iterations);
+  run<StdFn>("std::function big functor", big, iterations);
+  return 0;
+}
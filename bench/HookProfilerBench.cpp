@@ -0,0 +1,203 @@
+/**
+ * \file   HookProfilerBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 29 17:35:02 2012
+ *
+ * \brief  Cost of HookProfiler per request, enabled and disabled.
+ *
+ */
+
+/*
+  Quatre modules enregistrent chacun un hook post-parsing (dont le
+  handler est appelé une fois) et un hook de contenu (outContent() puis
+  dispose()). Une "requête" appelle les huit hooks et leurs handlers :
+
+  - direct     hooks enregistrés sans le profiler
+  - disabled   enregistrés par le profiler, désactivé
+  - enabled    profiler actif
+
+  Les allocations par requête sont comptées (operator new).
+
+    hook-profiler-bench [requêtes]
+*/
+
+#include "Bench.h"
+
+#include "bref/ConfigSnapshot.h"
+#include "bref/HookProfiler.h"
+#include "bref/HttpRequest.h"
+#include "bref/HttpResponse.h"
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned long allocations = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++allocations;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace {
+
+const int Modules = 4;
+
+struct SetStatus
+{
+  bref::status_codes::Type status;
+
+  void operator()(bref::HttpResponse & response) const
+  {
+    response.setStatus(status);
+  }
+};
+
+class ContentHandler : public bref::Pipeline::IContentRequestHandler
+{
+public:
+  virtual bool inContent(bref::HttpResponse &, const bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual bool outContent(bref::HttpResponse &, bref::Buffer & outBuffer)
+  {
+    bench::keep(outBuffer.size());
+    return true;
+  }
+
+  virtual void dispose()
+  { }
+};
+
+class BenchModule : public bref::AModule
+{
+private:
+  ContentHandler content_;
+
+public:
+  BenchModule(const std::string & name)
+    : AModule(name, "Bench module.", bref::Version(0, 1), bref::Version(0, 4))
+  { }
+
+  virtual void dispose()
+  { }
+
+  virtual void registerHooks(bref::Pipeline & pipeline)
+  {
+    bref::Pipeline::PostParsingHook postParsing(this, &BenchModule::postParsingHook);
+    bref::Pipeline::ContentHook     content(this, &BenchModule::contentHook);
+
+    pipeline.postParsingHooks.push_back(std::make_pair(postParsing, 1.f));
+    pipeline.contentHooks.push_back(std::make_pair(content, 1.f));
+  }
+
+  bref::Pipeline::PostParsingRequestHandler
+  postParsingHook(const bref::Environment &, bref::HttpRequest &, bref::HttpResponse &)
+  {
+    SetStatus handler = { bref::status_codes::OK };
+
+    return bref::Pipeline::PostParsingRequestHandler(handler);
+  }
+
+  bref::Pipeline::IContentRequestHandler *
+  contentHook(const bref::Environment &, const bref::HttpRequest &, bref::HttpResponse &, bref::FdType &)
+  {
+    return &content_;
+  }
+};
+
+void run(const char *name, const bref::Pipeline & pipeline, const bref::Environment & environment,
+         unsigned long requests)
+{
+  typedef std::list<std::pair<bref::Pipeline::PostParsingHook, float> > PostParsingHooks;
+  typedef std::list<std::pair<bref::Pipeline::ContentHook, float> >     ContentHooks;
+
+  bref::HttpRequest   request;
+  bref::HttpResponse  response;
+  bref::Buffer        buffer;
+  const unsigned long before = allocations;
+  const double        start  = bench::now();
+
+  for (unsigned long r = 0; r < requests; ++r)
+    {
+      for (PostParsingHooks::const_iterator it = pipeline.postParsingHooks.begin();
+           it != pipeline.postParsingHooks.end(); ++it)
+        {
+          const bref::Pipeline::PostParsingRequestHandler handler = it->first(environment, request, response);
+
+          if (handler)
+            handler(response);
+        }
+      for (ContentHooks::const_iterator it = pipeline.contentHooks.begin();
+           it != pipeline.contentHooks.end(); ++it)
+        {
+          bref::FdType                            fd      = -1;
+          bref::Pipeline::IContentRequestHandler *handler = it->first(environment, request, response, fd);
+
+          if (handler)
+            {
+              handler->outContent(response, buffer);
+              handler->dispose();
+            }
+        }
+    }
+
+  const double seconds = bench::now() - start;
+
+  bench::report(name, seconds, requests);
+  std::printf("%-32s %10.2f allocations / request\n", "",
+              static_cast<double>(allocations - before) / requests);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long             requests = bench::iterations(argc, argv, 2000000);
+  const bref::ConfigHolder::Pin   snapshot = bref::ConfigSnapshot::create(bref::BrefValue(bref::BrefValueArray()));
+  const bref::Environment::Client client   = bref::Environment::Client();
+  const bref::Environment         environment(snapshot->config, snapshot->helper, 0, client);
+  std::vector<BenchModule *>      modules;
+  bref::Pipeline                  direct;
+  bref::Pipeline                  profiled;
+  bref::HookProfiler              profiler;
+
+  for (int i = 0; i < Modules; ++i)
+    {
+      modules.push_back(new BenchModule("mod_bench" + std::to_string(i)));
+      modules.back()->registerHooks(direct);
+      profiler.registerHooks(*modules.back(), profiled);
+    }
+
+  run("direct", direct, environment, requests);
+  profiler.setEnabled(false);
+  run("disabled", profiled, environment, requests);
+  profiler.setEnabled(true);
+  run("enabled", profiled, environment, requests);
+
+  for (int i = 0; i < Modules; ++i)
+    delete modules[i];
+  return 0;
+}
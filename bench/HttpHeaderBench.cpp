@@ -0,0 +1,214 @@
+/**
+ * \file   HttpHeaderBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 29 15:10:52 2012
+ *
+ * \brief  HttpHeader against the std::map it replaced, on headers of
+ *         10 to 30 fields.
+ *
+ */
+
+/*
+  Pour chaque taille, trois mesures par requête :
+
+  - insert   remplir l'en-tête comme le parseur (add(), en-tête réutilisé
+             par clear() pour HttpHeader ; la map est vidée)
+  - lookup   chercher chaque champ par son nom, plus 5 champs absents
+  - iterate  parcourir les champs et sommer la taille des valeurs
+
+  Pour HttpHeader on mesure aussi la recherche des champs connus par
+  leur header_fields::Type.
+
+    http-header-bench [tours]
+*/
+
+#include "Bench.h"
+
+#include "bref/HttpHeader.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::map<std::string, bref::BrefValue, bref::util::ICaseStringCmp> MapHeader;
+
+struct Field
+{
+  std::string               name;
+  std::string               value;
+  bref::header_fields::Type type;
+};
+
+/*
+  Les champs d'un navigateur d'abord, complétés par des champs
+  inconnus (X-Field-N).
+*/
+std::vector<Field> makeFields(std::size_t count)
+{
+  static const char *browser[][2] = {
+    { "Host", "www.example.com" },
+    { "User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:12.0) Gecko/20100101 Firefox/12.0" },
+    { "Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8" },
+    { "Accept-Language", "fr,fr-fr;q=0.8,en-us;q=0.5,en;q=0.3" },
+    { "Accept-Encoding", "gzip, deflate" },
+    { "Connection", "keep-alive" },
+    { "Referer", "http://www.example.com/index.html" },
+    { "Cookie", "session=0123456789abcdef; lang=fr" },
+    { "If-Modified-Since", "Tue, 29 May 2012 10:00:00 GMT" },
+    { "Cache-Control", "max-age=0" },
+  };
+  std::vector<Field> fields;
+
+  for (std::size_t i = 0; i < count; ++i)
+    {
+      Field field;
+
+      if (i < sizeof browser / sizeof browser[0])
+        {
+          field.name  = browser[i][0];
+          field.value = browser[i][1];
+        }
+      else
+        {
+          field.name  = "X-Field-" + std::to_string(i);
+          field.value = "value " + std::to_string(i);
+        }
+      field.type = bref::header_fields::fromName(field.name.data(), field.name.size());
+      fields.push_back(field);
+    }
+  return fields;
+}
+
+std::vector<std::string> makeMissing()
+{
+  std::vector<std::string> missing;
+
+  for (int i = 0; i < 5; ++i)
+    missing.push_back("X-Missing-" + std::to_string(i));
+  return missing;
+}
+
+void benchHeader(std::size_t count, unsigned long rounds)
+{
+  const std::vector<Field>       fields  = makeFields(count);
+  const std::vector<std::string> missing = makeMissing();
+  bref::HttpHeader               header;
+  std::string                    name;
+  double                         start;
+
+  name = "HttpHeader insert " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      header.clear();
+      for (std::size_t i = 0; i < fields.size(); ++i)
+        header.add(fields[i].name.data(), fields[i].name.size(),
+                   fields[i].value.data(), fields[i].value.size());
+      bench::keep(header.size());
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+
+  name = "HttpHeader lookup " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      std::size_t found = 0;
+
+      for (std::size_t i = 0; i < fields.size(); ++i)
+        found += header.count(fields[i].name);
+      for (std::size_t i = 0; i < missing.size(); ++i)
+        found += header.count(missing[i]);
+      bench::keep(found);
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+
+  name = "HttpHeader lookup type " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      std::size_t found = 0;
+
+      for (std::size_t i = 0; i < fields.size(); ++i)
+        found += header.count(fields[i].type);
+      bench::keep(found);
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+
+  name = "HttpHeader iterate " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      std::size_t bytes = 0;
+
+      for (bref::HttpHeader::const_iterator it = header.begin(); it != header.end(); ++it)
+        bytes += it->second.asString().size();
+      bench::keep(bytes);
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+}
+
+void benchMap(std::size_t count, unsigned long rounds)
+{
+  const std::vector<Field>       fields  = makeFields(count);
+  const std::vector<std::string> missing = makeMissing();
+  MapHeader                      header;
+  std::string                    name;
+  double                         start;
+
+  // comme le parseur avant HttpHeader : un nom et une valeur construits
+  // pour chaque champ
+  name = "std::map insert " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      header.clear();
+      for (std::size_t i = 0; i < fields.size(); ++i)
+        header[std::string(fields[i].name.data(), fields[i].name.size())] =
+          bref::BrefValue(std::string(fields[i].value.data(), fields[i].value.size()));
+      bench::keep(header.size());
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+
+  name = "std::map lookup " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      std::size_t found = 0;
+
+      for (std::size_t i = 0; i < fields.size(); ++i)
+        found += header.count(fields[i].name);
+      for (std::size_t i = 0; i < missing.size(); ++i)
+        found += header.count(missing[i]);
+      bench::keep(found);
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+
+  name = "std::map iterate " + std::to_string(count);
+  start = bench::now();
+  for (unsigned long r = 0; r < rounds; ++r)
+    {
+      std::size_t bytes = 0;
+
+      for (MapHeader::const_iterator it = header.begin(); it != header.end(); ++it)
+        bytes += it->second.asString().size();
+      bench::keep(bytes);
+    }
+  bench::report(name.c_str(), bench::now() - start, rounds);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long rounds = bench::iterations(argc, argv, 200000);
+  const std::size_t   sizes[] = { 10, 20, 30 };
+
+  for (std::size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i)
+    {
+      benchHeader(sizes[i], rounds);
+      benchMap(sizes[i], rounds);
+    }
+  return 0;
+}
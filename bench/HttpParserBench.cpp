@@ -0,0 +1,94 @@
+/**
+ * \file   HttpParserBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 24 17:34:12 2012
+ *
+ * \brief  ModParser HttpParser throughput.
+ *
+ */
+
+/*
+  Une requête de navigateur (11 champs, 552 octets) analysée puis
+  donnée à une HttpRequest :
+
+  - parse                 parse() seul, requête reçue d'un coup
+  - parse, 64 B chunks    parse() rappelé tous les 64 octets
+  - parse + fill, reused  fill() dans une HttpRequest vidée par clear(),
+                          comme bref-epoll-host entre deux requêtes
+  - parse + fill, new     fill() dans une nouvelle HttpRequest
+*/
+
+#include "Bench.h"
+#include "HttpParser.h"
+
+#include <string>
+
+namespace {
+
+const char Request[] =
+  "GET /static/css/main.css?v=3 HTTP/1.1\r\n"
+  "Host: www.example.com\r\n"
+  "Connection: keep-alive\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+  "Chrome/19.0.1084.46 Safari/536.5\r\n"
+  "Accept: text/css,*/*;q=0.1\r\n"
+  "Referer: http://www.example.com/\r\n"
+  "Accept-Encoding: gzip,deflate,sdch\r\n"
+  "Accept-Language: fr-FR,fr;q=0.8,en-US;q=0.6,en;q=0.4\r\n"
+  "Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.3\r\n"
+  "Cookie: session=0123456789abcdef0123456789abcdef; lang=fr; theme=dark\r\n"
+  "If-Modified-Since: Thu, 24 May 2012 10:00:00 GMT\r\n"
+  "Cache-Control: max-age=0\r\n"
+  "\r\n";
+
+const std::size_t Size = sizeof Request - 1;
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long count = bench::iterations(argc, argv, 1000000);
+  HttpParser          parser;
+  bref::HttpRequest   request;
+  double              start;
+
+  start = bench::now();
+  for (unsigned long i = 0; i < count; ++i)
+    {
+      parser.reset();
+      bench::keep(parser.parse(Request, Size));
+    }
+  bench::report("parse", bench::now() - start, count, Size);
+
+  start = bench::now();
+  for (unsigned long i = 0; i < count; ++i)
+    {
+      parser.reset();
+      for (std::size_t size = 64; size < Size + 64; size += 64)
+        bench::keep(parser.parse(Request, size < Size ? size : Size));
+    }
+  bench::report("parse, 64 B chunks", bench::now() - start, count, Size);
+
+  start = bench::now();
+  for (unsigned long i = 0; i < count; ++i)
+    {
+      parser.reset();
+      parser.parse(Request, Size);
+      request.clear();
+      parser.fill(Request, request);
+    }
+  bench::report("parse + fill, reused request", bench::now() - start, count, Size);
+
+  start = bench::now();
+  for (unsigned long i = 0; i < count; ++i)
+    {
+      bref::HttpRequest fresh;
+
+      parser.reset();
+      parser.parse(Request, Size);
+      parser.fill(Request, fresh);
+      bench::keep(fresh.size());
+    }
+  bench::report("parse + fill, new request", bench::now() - start, count, Size);
+  return 0;
+}
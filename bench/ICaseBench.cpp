@@ -0,0 +1,86 @@
+/**
+ * \file   ICaseBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 11:32:40 2012
+ *
+ * \brief  Case-insensitive comparison and hash against std::tolower().
+ *
+ */
+
+/*
+  Comparaison de chaînes égales à la casse près (le pire cas, tout est
+  lu) de la taille d'un nom de champ, d'un User-Agent et d'une longue
+  valeur, et hachage. La référence est la boucle std::tolower() par
+  octet utilisée avant le passage aux blocs.
+
+  Les blocs de 32 octets ne sont utilisés qu'avec -mavx2 :
+
+    cmake -DCMAKE_CXX_FLAGS=-mavx2 ...
+
+    icase-bench [iterations]
+*/
+
+#include "Bench.h"
+
+#include "bref/detail/util/ICaseStringCmp.hpp"
+
+#include <cctype>
+#include <string>
+
+namespace {
+
+int tolowerCompare(const char *a, std::size_t aSize, const char *b, std::size_t bSize)
+{
+  const std::size_t size = std::min(aSize, bSize);
+
+  for (std::size_t i = 0; i < size; ++i)
+    {
+      const int x = std::tolower(static_cast<unsigned char>(a[i]));
+      const int y = std::tolower(static_cast<unsigned char>(b[i]));
+
+      if (x != y)
+        return x - y;
+    }
+  return aSize < bSize ? -1 : aSize > bSize;
+}
+
+void run(const char *text, unsigned long iterations)
+{
+  const std::string a(text);
+  std::string       b(a);
+  char              name[64];
+
+  for (std::size_t i = 0; i < b.size(); ++i)
+    b[i] = std::toupper(static_cast<unsigned char>(b[i]));
+
+  double start = bench::now();
+
+  for (unsigned long i = 0; i < iterations; ++i)
+    bench::keep(tolowerCompare(a.data(), a.size(), b.data(), b.size()));
+  std::snprintf(name, sizeof name, "tolower %zu", a.size());
+  bench::report(name, bench::now() - start, iterations, a.size());
+
+  start = bench::now();
+  for (unsigned long i = 0; i < iterations; ++i)
+    bench::keep(bref::util::icaseCompare(a.data(), a.size(), b.data(), b.size()));
+  std::snprintf(name, sizeof name, "icaseCompare %zu", a.size());
+  bench::report(name, bench::now() - start, iterations, a.size());
+
+  start = bench::now();
+  for (unsigned long i = 0; i < iterations; ++i)
+    bench::keep(bref::util::icaseHash(b.data(), b.size()));
+  std::snprintf(name, sizeof name, "icaseHash %zu", a.size());
+  bench::report(name, bench::now() - start, iterations, a.size());
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long iterations = bench::iterations(argc, argv, 10 * 1000 * 1000);
+
+  run("content-length", iterations);
+  run("mozilla/5.0 (x11; linux x86_64; rv:12.0) gecko/20100101 firefox/12.0", iterations);
+  run(std::string(1024, 'a').append("-ETag").c_str(), iterations / 10);
+  return 0;
+}
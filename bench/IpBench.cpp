@@ -0,0 +1,137 @@
+/**
+ * \file   IpBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 12:02:15 2012
+ *
+ * \brief  IP address parsing and formatting against inet_pton() and
+ *         inet_ntop().
+ *
+ */
+
+/*
+  100000 adresses aléatoires (la moitié des octets à zéro pour que les
+  adresses IPv6 aient des "::"), parcourues en boucle.
+
+    ip-bench [tours]
+*/
+
+#include "Bench.h"
+
+#include "bref/detail/util/IpFormat.hpp"
+
+#include <arpa/inet.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::size_t Addresses = 100000;
+
+typedef std::vector<std::string> Texts;
+
+struct Bytes
+{
+  unsigned char data[16];
+};
+
+template <typename Parse>
+void parse(const char *name, const Texts & texts, unsigned long rounds, Parse parser)
+{
+  unsigned char bytes[16];
+  const double  start = bench::now();
+
+  for (unsigned long r = 0; r < rounds; ++r)
+    for (std::size_t i = 0; i < texts.size(); ++i)
+      {
+        parser(texts[i], bytes);
+        bench::keep(bytes[3]);
+      }
+  bench::report(name, bench::now() - start, rounds * texts.size());
+}
+
+template <typename Format>
+void format(const char *name, const std::vector<Bytes> & addresses, unsigned long rounds, Format formatter)
+{
+  char         text[INET6_ADDRSTRLEN];
+  const double start = bench::now();
+
+  for (unsigned long r = 0; r < rounds; ++r)
+    for (std::size_t i = 0; i < addresses.size(); ++i)
+      {
+        formatter(addresses[i].data, text);
+        bench::keep(text[0]);
+      }
+  bench::report(name, bench::now() - start, rounds * addresses.size());
+}
+
+void parseV4(const std::string & text, unsigned char *bytes)
+{
+  bref::util::parseIPv4(text.data(), text.size(), bytes);
+}
+
+void parseV6(const std::string & text, unsigned char *bytes)
+{
+  bref::util::parseIPv6(text.data(), text.size(), bytes);
+}
+
+void ptonV4(const std::string & text, unsigned char *bytes)
+{
+  ::inet_pton(AF_INET, text.c_str(), bytes);
+}
+
+void ptonV6(const std::string & text, unsigned char *bytes)
+{
+  ::inet_pton(AF_INET6, text.c_str(), bytes);
+}
+
+void formatV4(const unsigned char *bytes, char *text)
+{
+  bref::util::formatIPv4(bytes, text);
+}
+
+void formatV6(const unsigned char *bytes, char *text)
+{
+  bref::util::formatIPv6(bytes, text);
+}
+
+void ntopV4(const unsigned char *bytes, char *text)
+{
+  ::inet_ntop(AF_INET, bytes, text, INET6_ADDRSTRLEN);
+}
+
+void ntopV6(const unsigned char *bytes, char *text)
+{
+  ::inet_ntop(AF_INET6, bytes, text, INET6_ADDRSTRLEN);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long rounds = bench::iterations(argc, argv, 20);
+  std::vector<Bytes>  addresses(Addresses);
+  Texts               v4;
+  Texts               v6;
+
+  std::srand(1);
+  for (std::size_t i = 0; i < Addresses; ++i)
+    {
+      char text[INET6_ADDRSTRLEN];
+
+      for (int j = 0; j < 16; ++j)
+        addresses[i].data[j] = std::rand() % 2 ? 0 : std::rand();
+      v4.push_back(std::string(text, bref::util::formatIPv4(addresses[i].data, text)));
+      v6.push_back(std::string(text, bref::util::formatIPv6(addresses[i].data, text)));
+    }
+
+  parse("parseIPv4", v4, rounds, parseV4);
+  parse("inet_pton AF_INET", v4, rounds, ptonV4);
+  parse("parseIPv6", v6, rounds, parseV6);
+  parse("inet_pton AF_INET6", v6, rounds, ptonV6);
+  format("formatIPv4", addresses, rounds, formatV4);
+  format("inet_ntop AF_INET", addresses, rounds, ntopV4);
+  format("formatIPv6", addresses, rounds, formatV6);
+  format("inet_ntop AF_INET6", addresses, rounds, ntopV6);
+  return 0;
+}
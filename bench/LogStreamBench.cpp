@@ -0,0 +1,249 @@
+/**
+ * \file   LogStreamBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri Jun  1 10:42:18 2012
+ *
+ * \brief  Cost of a log site, debug on and debug off, with LogStream and
+ *         with the previous std::stringstream macros.
+ *
+ */
+
+/*
+  Un site de log typique d'un serveur :
+
+    LOG_DEBUG(logger) << "GET " << uri << " from " << host << ':' << port
+                      << " status " << status << " in " << ms << " ms";
+
+  - stringstream    LEGACY_LOG, les macros d'avant LogStream : un
+                    std::stringstream par message et log(sev, ss.str())
+  - LogStream       LOG_DEBUG, le message va à logBuffer()
+  - LogStream, log  LOG_DEBUG avec un logger qui ne redéfinit que log()
+                    (l'implémentation par défaut de logBuffer())
+  - IpAddress       LOG_DEBUG, l'adresse est écrite par toChars() au lieu
+                    d'une chaîne formatée à l'avance
+
+  debug on : le logger est au niveau Debug, le message est formaté.
+  debug off : le logger est au niveau Info, seul le test du niveau est
+  payé.
+
+  Les allocations (operator new) sont comptées par site.
+
+    log-stream-bench [messages]
+*/
+
+#include "Bench.h"
+
+#include "bref/IpAddress.h"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace {
+
+unsigned long allocations = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++allocations;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+/*
+  Le ScopedLogger et la macro LOG() d'avant LogStream.
+*/
+#define LEGACY_LOG(logger, sev)                                         \
+  if ((sev) < (logger)->severity())                                     \
+    { }                                                                 \
+  else                                                                  \
+    LegacyScopedLogger((logger), (sev)).log()
+
+#define LEGACY_LOG_DEBUG(logger) LEGACY_LOG(logger, bref::ILogger::Debug)
+
+namespace {
+
+class LegacyScopedLogger : bref::util::NonCopyable
+{
+private:
+  std::stringstream        ss_;
+  bref::ILogger           *logger_;
+  bref::ILogger::Severity  severity_;
+
+public:
+  LegacyScopedLogger(bref::ILogger *logger, bref::ILogger::Severity severity)
+    : logger_(logger)
+    , severity_(severity)
+  { }
+
+  ~LegacyScopedLogger()
+  {
+    logger_->log(severity_, ss_.str());
+  }
+
+  std::ostream & log()
+  {
+    return ss_;
+  }
+};
+
+/*
+  Le message est jeté, seule sa taille est gardée.
+*/
+class NullLogger : public bref::ILogger
+{
+private:
+  Severity    severity_;
+  std::size_t bytes_;
+
+public:
+  explicit NullLogger(Severity severity)
+    : severity_(severity)
+    , bytes_(0)
+  { }
+
+  Severity severity() const
+  {
+    return severity_;
+  }
+
+  void setSeverity(Severity severity)
+  {
+    severity_ = severity;
+  }
+
+  void log(Severity, const std::string & message)
+  {
+    bytes_ += message.size();
+  }
+
+  std::size_t bytes() const
+  {
+    return bytes_;
+  }
+};
+
+/*
+  Comme AsyncLogger, reçoit directement le buffer de LogStream.
+*/
+class BufferLogger : public NullLogger
+{
+private:
+  std::size_t bytes_;
+
+public:
+  explicit BufferLogger(Severity severity)
+    : NullLogger(severity)
+    , bytes_(0)
+  { }
+
+  void logBuffer(Severity, const char *message, std::size_t size)
+  {
+    bench::keep(message[0]);
+    bytes_ += size;
+  }
+
+  std::size_t bytes() const
+  {
+    return bytes_;
+  }
+};
+
+const std::string Uri  = "/static/images/gallery/2012/05/photo.png";
+const std::string Host = "192.168.1.42";
+
+/*
+  Les sites de log : le numéro du message change les valeurs, comme dans
+  un serveur. Ils ne sont pas inlinés, sinon le compilateur traite
+  différemment les deux macros quand le debug est désactivé (le
+  ScopedLogger est plus gros avec LogStream).
+*/
+__attribute__((noinline)) void legacySite(bref::ILogger *logger, unsigned long i)
+{
+  LEGACY_LOG_DEBUG(logger) << "GET " << Uri << " from " << Host << ':' << 40000 + i % 20000
+                           << " status " << 200 << " in " << (i % 1000) / 7.0 << " ms";
+}
+
+__attribute__((noinline)) void site(bref::ILogger *logger, unsigned long i)
+{
+  LOG_DEBUG(logger) << "GET " << Uri << " from " << Host << ':' << 40000 + i % 20000
+                    << " status " << 200 << " in " << (i % 1000) / 7.0 << " ms";
+}
+
+__attribute__((noinline)) void addressSite(bref::ILogger *logger, const bref::IpAddress & address, unsigned long i)
+{
+  LOG_DEBUG(logger) << "GET " << Uri << " from " << address << ':' << 40000 + i % 20000
+                    << " status " << 200 << " in " << (i % 1000) / 7.0 << " ms";
+}
+
+enum Site { Legacy, Stream, Address };
+
+void run(const char *name, Site which, bref::ILogger & logger, unsigned long messages)
+{
+  bref::IpAddress address;
+
+  bref::IpAddress::parse(Host, address);
+
+  const unsigned long before = allocations;
+  const double        start  = bench::now();
+
+  for (unsigned long i = 0; i < messages; ++i)
+    switch (which)
+      {
+      case Legacy:  legacySite(&logger, i); break;
+      case Stream:  site(&logger, i); break;
+      case Address: addressSite(&logger, address, i); break;
+      }
+  bench::report(name, bench::now() - start, messages);
+  std::printf("%-32s %10.2f allocations / site\n", "",
+              static_cast<double>(allocations - before) / messages);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long messages = bench::iterations(argc, argv, 1000000);
+
+  {
+    NullLogger   legacy(bref::ILogger::Debug);
+    NullLogger   string(bref::ILogger::Debug);
+    BufferLogger buffer(bref::ILogger::Debug);
+    BufferLogger address(bref::ILogger::Debug);
+
+    std::printf("debug on\n");
+    run("stringstream", Legacy, legacy, messages);
+    run("LogStream", Stream, buffer, messages);
+    run("LogStream, log()", Stream, string, messages);
+    run("LogStream, IpAddress", Address, address, messages);
+    bench::keep(legacy.bytes() + string.bytes() + buffer.bytes() + address.bytes());
+  }
+  {
+    NullLogger legacy(bref::ILogger::Info);
+    NullLogger stream(bref::ILogger::Info);
+
+    std::printf("debug off\n");
+    run("stringstream", Legacy, legacy, messages);
+    run("LogStream", Stream, stream, messages);
+  }
+  return 0;
+}
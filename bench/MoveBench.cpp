@@ -0,0 +1,278 @@
+/**
+ * \file   MoveBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 31 10:14:26 2012
+ *
+ * \brief  Copies of handlers and allocations per request, with and
+ *         without the C++11 move operations.
+ *
+ */
+
+/*
+  Le même source est compilé deux fois : move-bench (C++11) et
+  move-bench-cxx03 (BREF_NO_CXX11, les copies d'avant les opérations de
+  déplacement).
+
+  Une "requête" passe par un PipelineExecutor :
+
+  - postParsing()          2 hooks, handlers retournés par valeur
+  - transformHandlers()    2 handlers Buffer et un handler BufferChain
+                           poussés dans un TransformChain, appliqué au
+                           corps
+  - preSendHandlers()      le handler de plus haute priorité
+  - passage à un worker    la requête, la réponse et un handler de fin
+                           passent par une file (comme ModFastCGI ou
+                           Resolver)
+
+  Les copies et déplacements des cibles des handlers sont comptés, ainsi
+  que les allocations (operator new).
+
+    move-bench [requêtes]
+*/
+
+#include "Bench.h"
+
+#include "bref/IConfHelper.h"
+#include "bref/HttpRequest.h"
+#include "bref/HttpResponse.h"
+#include "bref/PipelineExecutor.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <string>
+
+namespace {
+
+unsigned long allocations = 0;
+unsigned long copies      = 0;
+unsigned long moves       = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++allocations;
+  return p;
+}
+
+void operator delete(void *p) BREF_NOEXCEPT
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) BREF_NOEXCEPT
+{
+  std::free(p);
+}
+
+namespace {
+
+/*
+  La cible d'un handler : ses copies et déplacements sont comptés. La
+  copie est noexcept pour être rangée dans Function sans allocation.
+*/
+class Counted
+{
+private:
+  char id_;
+
+public:
+  explicit Counted(char id)
+    : id_(id)
+  { }
+
+  Counted(const Counted & other) BREF_NOEXCEPT
+    : id_(other.id_)
+  {
+    ++copies;
+  }
+
+#ifdef BREF_CXX11
+  Counted(Counted && other) noexcept
+    : id_(other.id_)
+  {
+    ++moves;
+  }
+#endif  // BREF_CXX11
+
+  Counted & operator=(const Counted & other) BREF_NOEXCEPT
+  {
+    id_ = other.id_;
+    ++copies;
+    return *this;
+  }
+
+  void operator()(bref::HttpResponse &) const
+  {
+    bench::keep(id_);
+  }
+
+  void operator()(bref::HttpResponse &, const bref::Buffer & in, bref::Buffer & out) const
+  {
+    out = in;
+    out.push_back(id_);
+  }
+
+  void operator()(bref::HttpResponse &, bref::BufferChain & chunk) const
+  {
+    chunk.trimBack(1);
+  }
+
+  // les hooks retournent un handler ayant la même cible
+  template <typename Handler>
+  Handler make() const
+  {
+    return Handler(*this);
+  }
+};
+
+struct PostParsingHook
+{
+  Counted target;
+
+  bref::Pipeline::PostParsingRequestHandler
+  operator()(const bref::Environment &, bref::HttpRequest &, bref::HttpResponse &) const
+  {
+    return target.make<bref::Pipeline::PostParsingRequestHandler>();
+  }
+};
+
+template <typename Handler>
+struct BodyHook
+{
+  Counted target;
+
+  Handler operator()(const bref::Environment &, const bref::HttpRequest &, bref::HttpResponse &) const
+  {
+    return target.make<Handler>();
+  }
+};
+
+/*
+  ConfigSnapshot demande C++11, les hooks ne lisent pas la
+  configuration.
+*/
+class NullConfHelper : public bref::IConfHelper
+{
+private:
+  bref::BrefValue null_;
+
+public:
+  virtual const bref::BrefValue & findValue(std::string const &) const
+  {
+    return null_;
+  }
+
+  virtual const bref::BrefValue & findValue(std::string const &, bref::HttpRequest const &) const
+  {
+    return null_;
+  }
+};
+
+/*
+  Ce qu'un serveur donne à un worker.
+*/
+struct Job
+{
+  bref::HttpRequest                         request;
+  bref::HttpResponse                        response;
+  bref::Pipeline::PostParsingRequestHandler done;
+};
+
+void fillRequest(bref::HttpRequest & request)
+{
+  request.setMethod(bref::request_methods::Get);
+  request.setUri("/static/images/a-long-enough-file-name-for-the-heap.png");
+  request["Host"]            = bref::BrefValue("www.example.com");
+  request["User-Agent"]      = bref::BrefValue("Mozilla/5.0 (X11; Linux x86_64; rv:12.0) Gecko/20100101");
+  request["Accept"]          = bref::BrefValue("text/html,application/xhtml+xml,application/xml;q=0.9");
+  request["Accept-Encoding"] = bref::BrefValue("gzip, deflate");
+  request["Connection"]      = bref::BrefValue("keep-alive");
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  typedef bref::Pipeline P;
+
+  const unsigned long             requests = bench::iterations(argc, argv, 200000);
+  const bref::ServerConfig        config;
+  const NullConfHelper            helper;
+  const bref::Environment::Client client = bref::Environment::Client();
+  const bref::Environment         environment(config, helper, 0, client);
+  bref::Pipeline                  pipeline;
+
+  {
+    PostParsingHook                           first   = { Counted('a') };
+    PostParsingHook                           second  = { Counted('b') };
+    BodyHook<P::TransformRequestHandler>      gzip    = { Counted('c') };
+    BodyHook<P::TransformRequestHandler>      footer  = { Counted('d') };
+    BodyHook<P::TransformChainRequestHandler> trim    = { Counted('e') };
+    BodyHook<P::PreSendRequestHandler>        preSend = { Counted('f') };
+
+    pipeline.postParsingHooks.push_back(std::make_pair(P::PostParsingHook(first), 2.f));
+    pipeline.postParsingHooks.push_back(std::make_pair(P::PostParsingHook(second), 1.f));
+    pipeline.transformHooks.push_back(std::make_pair(P::TransformHook(gzip), 2.f));
+    pipeline.transformHooks.push_back(std::make_pair(P::TransformHook(footer), 1.f));
+    pipeline.transformChainHooks.push_back(std::make_pair(P::TransformChainHook(trim), 0.f));
+    pipeline.preSendHooks.push_back(std::make_pair(P::PreSendHook(preSend), 1.f));
+  }
+
+  const bref::PipelineExecutor           executor(pipeline);
+  bref::PipelineExecutor::TransformChain transform;
+  bref::PipelineExecutor::PreSendChain   preSendChain;
+  std::deque<Job>                        queue;
+  bref::Buffer                           body(512, 'x');
+  bref::Buffer                           data;
+  bref::Buffer                           scratch;
+  const unsigned long                    beforeAllocations = allocations;
+  const unsigned long                    beforeCopies      = copies;
+  const unsigned long                    beforeMoves       = moves;
+  const double                           start             = bench::now();
+
+  for (unsigned long r = 0; r < requests; ++r)
+    {
+      Job job;
+
+      fillRequest(job.request);
+      executor.postParsing(environment, job.request, job.response);
+
+      executor.transformHandlers(environment, job.request, job.response, transform);
+      data = body;
+      transform(job.response, data, scratch);
+
+      executor.preSendHandlers(environment, job.request, job.response, preSendChain);
+      preSendChain(job.response, data, scratch);
+
+      job.done = Counted('g').make<P::PostParsingRequestHandler>();
+      queue.push_back(BREF_MOVE(job));
+
+      Job taken(BREF_MOVE(queue.front()));
+
+      queue.pop_front();
+      taken.done(taken.response);
+      bench::keep(data.size() + taken.request.size());
+    }
+
+  const double seconds = bench::now() - start;
+
+#ifdef BREF_CXX11
+  bench::report("request (C++11)", seconds, requests);
+#else
+  bench::report("request (BREF_NO_CXX11)", seconds, requests);
+#endif
+  std::printf("%-32s %10.2f copies / request\n", "",
+              static_cast<double>(copies - beforeCopies) / requests);
+  std::printf("%-32s %10.2f moves / request\n", "",
+              static_cast<double>(moves - beforeMoves) / requests);
+  std::printf("%-32s %10.2f allocations / request\n", "",
+              static_cast<double>(allocations - beforeAllocations) / requests);
+  return 0;
+}
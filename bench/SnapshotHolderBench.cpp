@@ -0,0 +1,119 @@
+/**
+ * \file   SnapshotHolderBench.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 11:40:19 2012
+ *
+ * \brief  ConfigHolder::load() latency while the configuration is
+ *         reloaded.
+ *
+ */
+
+/*
+  Des workers font load(), une recherche de clé et la libération du
+  Pin en boucle, chacun note la durée de chaque tour. Trois phases
+  d'une seconde :
+
+  - idle         pas de rechargement
+  - reload 1 ms  un snapshot (200 clés) publié toutes les millisecondes
+  - reload loop  publications sans pause
+
+  Un rechargement qui bloquerait les workers se verrait sur le débit et
+  sur les percentiles hauts.
+
+    snapshot-holder-bench [workers]
+*/
+
+#include "Bench.h"
+
+#include "bref/ConfigSnapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int    Keys          = 200;
+const double PhaseDuration = 1.0;       // secondes
+
+bref::BrefValue makeConfig(int generation)
+{
+  bref::BrefValue config = bref::BrefValue(bref::BrefValueArray());
+
+  for (int i = 0; i < Keys; ++i)
+    config["Key" + std::to_string(i)] = bref::BrefValue(generation + i);
+  return config;
+}
+
+void phase(const char *name, bref::ConfigHolder & configs, int workers, double reloadPeriod)
+{
+  const bref::KeyHandle         key = configs.load()->helper.internKey("Key100");
+  std::atomic<bool>             stop(false);
+  std::vector<bench::Histogram> histograms(workers);
+  std::vector<std::thread>      threads;
+  unsigned long                 reloads = 0;
+
+  for (int i = 0; i < workers; ++i)
+    threads.push_back(std::thread([&, i] {
+          bench::Histogram & histogram = histograms[i];
+          long               sum       = 0;
+
+          while (! stop.load(std::memory_order_relaxed))
+            {
+              const double start = bench::now();
+
+              {
+                const bref::ConfigHolder::Pin config = configs.load();
+
+                sum += config->helper.findValue(key).asInt();
+              }
+              histogram.add(bench::now() - start);
+            }
+          bench::keep(sum);
+        }));
+
+  const double start = bench::now();
+
+  while (bench::now() - start < PhaseDuration)
+    {
+      if (reloadPeriod < 0)
+        {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+          continue;
+        }
+      // le snapshot est construit hors du verrou, comme sur SIGHUP
+      configs.publish(bref::ConfigSnapshot::create(makeConfig(++reloads), *configs.load()));
+      if (reloadPeriod > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long>(reloadPeriod * 1e6)));
+    }
+  stop = true;
+
+  const double     elapsed = bench::now() - start;
+  bench::Histogram total;
+
+  for (int i = 0; i < workers; ++i)
+    {
+      threads[i].join();
+      total.merge(histograms[i]);
+    }
+  std::printf("%-12s %6lu reloads %10.0f loads/s  p50 <= %lu ns  p99 <= %lu ns  p99.9 <= %lu ns  max %.0f ns\n",
+              name, reloads, total.count / elapsed, total.percentile(0.5), total.percentile(0.99),
+              total.percentile(0.999), total.max);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  const int          workers = static_cast<int>(bench::iterations(argc, argv,
+                                                                  std::max(2u, std::thread::hardware_concurrency())));
+  bref::ConfigHolder configs(bref::ConfigSnapshot::create(makeConfig(0)));
+
+  std::printf("%d workers\n", workers);
+  phase("idle", configs, workers, -1);
+  phase("reload 1 ms", configs, workers, 0.001);
+  phase("reload loop", configs, workers, 0);
+  return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * \file   LoadClient.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 15:48:31 2012
+ *
+ * \brief  Keep-alive HTTP load generator.
+ *
+ */
+
+/*
+  Ouvre des connexions keep-alive sur 127.0.0.1 et y envoie des GET, une
+  requête en cours par connexion. Les réponses sont découpées avec leur
+  Content-Length, qui est donc obligatoire.
+
+    load-client <port> <connexions> <secondes> [chemin]
+
+  Affiche :
+
+    <requêtes> requests, <requêtes par seconde> req/s
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now()
+{
+  timespec time;
+
+  ::clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/*
+  Taille de la première réponse complète de \p data, 0 si elle n'est pas
+  encore arrivée.
+*/
+std::size_t responseSize(const std::string & data)
+{
+  const std::size_t end = data.find("\r\n\r\n");
+
+  if (end == std::string::npos)
+    return 0;
+
+  const std::size_t length = data.find("Content-Length:");
+
+  if (length == std::string::npos || length > end)
+    {
+      std::fprintf(stderr, "response without Content-Length\n");
+      std::exit(1);
+    }
+
+  const std::size_t size = end + 4 + std::strtoul(data.c_str() + length + 15, 0, 10);
+
+  return size <= data.size() ? size : 0;
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 4)
+    {
+      std::fprintf(stderr, "usage: %s port connections seconds [path]\n", argv[0]);
+      return 2;
+    }
+
+  const int                port        = std::atoi(argv[1]);
+  const int                connections = std::atoi(argv[2]);
+  const double             duration    = std::atof(argv[3]);
+  const std::string        request     = std::string("GET ") + (argc > 4 ? argv[4] : "/")
+    + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  const int                epoll       = ::epoll_create1(0);
+  std::vector<int>         sockets;
+  std::vector<std::string> pending(connections);
+
+  for (int i = 0; i < connections; ++i)
+    {
+      const int   fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      const int   on = 1;
+      sockaddr_in address;
+      epoll_event event;
+
+      std::memset(&address, 0, sizeof address);
+      address.sin_family      = AF_INET;
+      address.sin_port        = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0)
+        {
+          std::perror("connect");
+          return 1;
+        }
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+      event.events   = EPOLLIN;
+      event.data.u32 = i;
+      ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+      sockets.push_back(fd);
+      if (::write(fd, request.data(), request.size()) < 0)
+        return 1;
+    }
+
+  unsigned long requests = 0;
+  const double  start    = now();
+  char          buffer[64 * 1024];
+  epoll_event   events[256];
+
+  for (;;)
+    {
+      const int count = ::epoll_wait(epoll, events, 256, 1000);
+
+      for (int k = 0; k < count; ++k)
+        {
+          const int     i    = events[k].data.u32;
+          const ssize_t size = ::read(sockets[i], buffer, sizeof buffer);
+
+          if (size <= 0)
+            {
+              std::fprintf(stderr, "connection closed by the server\n");
+              return 1;
+            }
+          pending[i].append(buffer, size);
+          for (std::size_t response; (response = responseSize(pending[i])) != 0; )
+            {
+              pending[i].erase(0, response);
+              ++requests;
+              if (::write(sockets[i], request.data(), request.size()) < 0)
+                return 1;
+            }
+        }
+
+      const double elapsed = now() - start;
+
+      if (elapsed >= duration)
+        {
+          std::printf("%lu requests, %.0f req/s\n", requests, requests / elapsed);
+          return 0;
+        }
+    }
+}
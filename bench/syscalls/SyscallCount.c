@@ -0,0 +1,121 @@
+/**
+ * \file   SyscallCount.c
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 15:20:08 2012
+ *
+ * \brief  Counts the I/O system calls of a server, with LD_PRELOAD.
+ *
+ */
+
+/*
+  Compte les appels aux fonctions de la libc qui font les entrées/sorties
+  de bref-epoll-host et de ModUring. Les compteurs sont écrits à la fin
+  du processus dans le fichier $SYSCALL_COUNT, sur stderr s'il n'est pas
+  défini :
+
+    read 1200 recv 0 send 1200 sendfile 0 epoll_wait 30 epoll_ctl 128 io_uring_enter 0
+
+  Les appels faits directement par le noyau pour io_uring ne passent pas
+  par la libc : seul io_uring_enter() est compté.
+*/
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static unsigned long readCount;
+static unsigned long recvCount;
+static unsigned long sendCount;
+static unsigned long sendfileCount;
+static unsigned long epollWaitCount;
+static unsigned long epollCtlCount;
+static unsigned long enterCount;
+
+#define COUNT(counter) __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED)
+
+/* la fonction de la libc que \p name remplace */
+#define REAL(name)                                      \
+  static __typeof__(name) *real;                        \
+  if (! real)                                           \
+    real = (__typeof__(name) *) dlsym(RTLD_NEXT, #name)
+
+ssize_t read(int fd, void *buffer, size_t size)
+{
+  REAL(read);
+  COUNT(readCount);
+  return real(fd, buffer, size);
+}
+
+ssize_t recv(int fd, void *buffer, size_t size, int flags)
+{
+  REAL(recv);
+  COUNT(recvCount);
+  return real(fd, buffer, size, flags);
+}
+
+ssize_t send(int fd, const void *buffer, size_t size, int flags)
+{
+  REAL(send);
+  COUNT(sendCount);
+  return real(fd, buffer, size, flags);
+}
+
+ssize_t sendfile(int out, int in, off_t *offset, size_t count)
+{
+  REAL(sendfile);
+  COUNT(sendfileCount);
+  return real(out, in, offset, count);
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxEvents, int timeout)
+{
+  REAL(epoll_wait);
+  COUNT(epollWaitCount);
+  return real(epfd, events, maxEvents, timeout);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+  REAL(epoll_ctl);
+  COUNT(epollCtlCount);
+  return real(epfd, op, fd, event);
+}
+
+/* ModUring appelle io_uring_enter() par syscall(), sans liburing */
+long syscall(long number, ...)
+{
+  va_list arguments;
+  long    a[6];
+  int     i;
+
+  REAL(syscall);
+  va_start(arguments, number);
+  for (i = 0; i < 6; ++i)
+    a[i] = va_arg(arguments, long);
+  va_end(arguments);
+  if (number == __NR_io_uring_enter)
+    COUNT(enterCount);
+  return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+__attribute__((destructor))
+static void report(void)
+{
+  const char *path = getenv("SYSCALL_COUNT");
+  FILE       *out  = path ? fopen(path, "w") : stderr;
+
+  if (! out)
+    return;
+  fprintf(out, "read %lu recv %lu send %lu sendfile %lu epoll_wait %lu epoll_ctl %lu io_uring_enter %lu\n",
+          readCount, recvCount, sendCount, sendfileCount, epollWaitCount, epollCtlCount, enterCount);
+  if (out != stderr)
+    fclose(out);
+}
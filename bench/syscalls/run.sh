@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Débit et appels système par requête de bref-epoll-host.
+#
+#   run.sh <build> <bref-epoll-host> <connexions> <secondes> module.so [module.so ...]
+#
+# <build> est le répertoire de build de bench/ (libsyscall-count.so et
+# load-client). L'hôte tourne avec un seul thread sur le port 8095.
+#
+# Exemple, chemin epoll puis ModUring :
+#
+#   run.sh _build ../tools/_build/bref-epoll-host 64 5 libmod_parser.so libmod_hello.so
+#   run.sh _build ../tools/_build/bref-epoll-host 64 5 libmod_parser.so libmod_uring.so libmod_hello.so
+
+if [ $# -lt 5 ]; then
+    echo "usage: $0 build bref-epoll-host connections seconds module.so..." >&2
+    exit 2
+fi
+
+build=$1
+host=$2
+connections=$3
+seconds=$4
+shift 4
+
+count=$(mktemp)
+
+SYSCALL_COUNT=$count LD_PRELOAD=$build/libsyscall-count.so \
+    "$host" -D Port=8095 -D Threads=1 "$@" 2>/dev/null &
+pid=$!
+sleep 0.5
+
+result=$("$build/load-client" 8095 "$connections" "$seconds")
+
+kill -TERM $pid
+wait $pid
+
+# "N requests, R req/s" puis les compteurs, divisés par N
+requests=${result%% *}
+echo "$result"
+awk -v requests="$requests" '{
+    for (i = 1; i < NF; i += 2)
+        printf "%-16s %8.2f per request\n", $i, $(i + 1) / requests
+}' "$count"
+rm -f "$count"
@@ -0,0 +1,235 @@
+/**
+ * \file   AccessTable.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 16 09:41:27 2012
+ *
+ * \brief  AccessRule and AccessTable definitions.
+ *
+ */
+
+#include "AccessTable.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+/*
+  Les règles sont insérées de la plus courte à la plus longue, une
+  règle plus précise écrase ainsi les entrées des règles qui la
+  contiennent. À longueur égale l'ordre du fichier est conservé, la
+  dernière règle l'emporte.
+*/
+bool shorterPrefix(const AccessRule & a, const AccessRule & b)
+{
+  return a.length < b.length;
+}
+
+/*
+  Vrai si le préfixe IPv6 d'une règle contient toutes les adresses
+  IPv4-mapped (::ffff:0:0/96) : ::/0 par exemple.
+*/
+bool containsV4Mapped(const AccessRule & rule)
+{
+  static const unsigned char mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+  if (rule.v4 || rule.length > 96)
+    return false;
+  for (unsigned bit = 0; bit < rule.length; ++bit)
+    {
+      const unsigned char mask = static_cast<unsigned char>(0x80 >> (bit % 8));
+
+      if ((rule.bytes[bit / 8] & mask) != (mapped[bit / 8] & mask))
+        return false;
+    }
+  return true;
+}
+
+} // ! unnamed namespace
+
+bool AccessRule::parse(const std::string & text, AccessRule & rule, std::string & error)
+{
+  std::istringstream stream(text);
+  std::string        action;
+  std::string        prefix;
+  std::string        garbage;
+
+  if (! (stream >> action >> prefix) || (stream >> garbage))
+    {
+      error = "expected \"allow|deny <address>[/<length>]\": \"" + text + "\"";
+      return false;
+    }
+
+  if (action == "allow")
+    rule.action = Allow;
+  else if (action == "deny")
+    rule.action = Deny;
+  else
+    {
+      error = "unknown action \"" + action + "\"";
+      return false;
+    }
+
+  const std::string::size_type slash   = prefix.find('/');
+  const std::string            address = prefix.substr(0, slash);
+
+  std::memset(rule.bytes, 0, sizeof rule.bytes);
+  if (bref::util::parseIPv4(address.data(), address.size(), rule.bytes))
+    rule.v4 = true;
+  else if (bref::util::parseIPv6(address.data(), address.size(), rule.bytes))
+    rule.v4 = false;
+  else
+    {
+      error = "invalid address \"" + address + "\"";
+      return false;
+    }
+
+  const unsigned maxLength = rule.v4 ? 32 : 128;
+
+  rule.length = maxLength;
+  if (slash != std::string::npos)
+    {
+      const std::string length = prefix.substr(slash + 1);
+      char             *end    = 0;
+      const long        value  = std::strtol(length.c_str(), &end, 10);
+
+      if (length.empty() || *end != '\0' || value < 0 || value > static_cast<long>(maxLength))
+        {
+          error = "invalid prefix length \"" + length + "\"";
+          return false;
+        }
+      rule.length = static_cast<unsigned>(value);
+    }
+
+  // 10.1.2.3/8 est équivalent à 10.0.0.0/8
+  for (unsigned bit = rule.length; bit < maxLength; ++bit)
+    rule.bytes[bit / 8] &= static_cast<unsigned char>(~(0x80 >> (bit % 8)));
+
+  // les adresses IPv4-mapped sont cherchées dans la table IPv4 :
+  // ::ffff:10.0.0.0/104 devient 10.0.0.0/8
+  if (! rule.v4 && rule.length >= 96 && bref::util::isV4Mapped(rule.bytes))
+    {
+      std::memmove(rule.bytes, rule.bytes + 12, 4);
+      std::memset(rule.bytes + 4, 0, sizeof rule.bytes - 4);
+      rule.v4      = true;
+      rule.length -= 96;
+    }
+  return true;
+}
+
+AccessTable::AccessTable(const std::vector<AccessRule> & rules, AccessRule::Action defaultAction)
+  : v4_(RootSize, AccessRule::NoMatch)
+  , v6_(RootSize, AccessRule::NoMatch)
+  , ruleCount_(rules.size())
+  , defaultAction_(defaultAction)
+{
+  std::vector<AccessRule> sorted;
+
+  // une règle IPv6 plus courte que /96 qui contient ::ffff:0:0/96
+  // s'applique aussi à toutes les adresses IPv4 : elle est doublée
+  // d'une règle 0.0.0.0/0, à sa place dans l'ordre du fichier
+  sorted.reserve(rules.size());
+  for (std::vector<AccessRule>::const_iterator it = rules.begin(); it != rules.end(); ++it)
+    {
+      sorted.push_back(*it);
+      if (containsV4Mapped(*it))
+        {
+          AccessRule all = *it;
+
+          std::memset(all.bytes, 0, sizeof all.bytes);
+          all.v4     = true;
+          all.length = 0;
+          sorted.push_back(all);
+        }
+    }
+
+  std::stable_sort(sorted.begin(), sorted.end(), &shorterPrefix);
+  for (std::vector<AccessRule>::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
+    insert(it->v4 ? v4_ : v6_, *it);
+}
+
+/*
+  Le noeud racine couvre 16 bits, les suivants 8 bits. Une règle qui
+  se termine dans un noeud remplit la plage d'entrées qu'elle couvre ;
+  sinon on descend dans le noeud fils, créé si besoin avec la valeur de
+  l'entrée qu'il remplace (le "leaf pushing").
+*/
+void AccessTable::insert(std::vector<uint32_t> & table, const AccessRule & rule)
+{
+  std::size_t base     = 0;
+  unsigned    consumed = 0;
+  unsigned    stride   = 16;
+  unsigned    byte     = 2;
+  std::size_t index    = (rule.bytes[0] << 8) | rule.bytes[1];
+
+  while (rule.length > consumed + stride)
+    {
+      uint32_t entry = table[base + index];
+
+      if (! (entry & ChildFlag))
+        {
+          const std::size_t child = table.size();
+
+          table.resize(child + NodeSize, entry);
+          entry = ChildFlag | static_cast<uint32_t>(child);
+          table[base + index] = entry;
+        }
+      base      = entry & ~ChildFlag;
+      consumed += stride;
+      stride    = 8;
+      index     = rule.bytes[byte++];
+    }
+
+  // les règles plus longues, qui auraient créé des fils dans cette
+  // plage, ne sont pas encore insérées
+  const std::size_t span  = std::size_t(1) << (consumed + stride - rule.length);
+  const std::size_t first = index & ~(span - 1);
+
+  std::fill(table.begin() + base + first, table.begin() + base + first + span,
+            static_cast<uint32_t>(rule.action));
+}
+
+AccessRule::Action AccessTable::find(const std::vector<uint32_t> & table, const unsigned char *bytes)
+{
+  uint32_t entry = table[(bytes[0] << 8) | bytes[1]];
+
+  for (const unsigned char *byte = bytes + 2; entry & ChildFlag; ++byte)
+    entry = table[(entry & ~ChildFlag) + *byte];
+  return static_cast<AccessRule::Action>(entry);
+}
+
+AccessRule::Action AccessTable::lookupV4(const unsigned char *bytes) const
+{
+  const AccessRule::Action action = find(v4_, bytes);
+
+  return action == AccessRule::NoMatch ? defaultAction_ : action;
+}
+
+AccessRule::Action AccessTable::lookupV6(const unsigned char *bytes) const
+{
+  if (bref::util::isV4Mapped(bytes))
+    return lookupV4(bytes + 12);
+
+  const AccessRule::Action action = find(v6_, bytes);
+
+  return action == AccessRule::NoMatch ? defaultAction_ : action;
+}
+
+AccessRule::Action AccessTable::lookup(const bref::IpAddress & address) const
+{
+  if (address.isV4())
+    return lookupV4(address.getV4().bytes);
+  return lookupV6(address.getV6().bytes);
+}
+
+std::size_t AccessTable::ruleCount() const
+{
+  return ruleCount_;
+}
+
+std::size_t AccessTable::memoryUsage() const
+{
+  return (v4_.size() + v6_.size()) * sizeof(uint32_t);
+}
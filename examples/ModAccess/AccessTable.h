@@ -0,0 +1,102 @@
+/**
+ * \file   AccessTable.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 16 09:41:27 2012
+ *
+ * \brief  AccessRule and AccessTable declarations.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODACCESS_ACCESSTABLE_H_
+#define BREF_API_EXAMPLES_MODACCESS_ACCESSTABLE_H_
+
+#include "bref/IpAddress.h"
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+  Une règle "allow" ou "deny" sur un préfixe CIDR :
+
+    deny  10.0.0.0/8
+    allow 10.1.0.0/16
+    deny  2001:db8::/32
+    allow 192.168.1.12
+
+  Sans longueur de préfixe, la règle porte sur une seule adresse. Une
+  règle IPv4-mapped (::ffff:10.0.0.0/104) est convertie en règle IPv4
+  (10.0.0.0/8).
+*/
+struct AccessRule
+{
+  enum Action
+    {
+      NoMatch,
+      Allow,
+      Deny
+    };
+
+  Action        action;
+  bool          v4;
+  unsigned char bytes[16];  // ordre réseau, 4 octets utilisés en IPv4
+  unsigned      length;     // longueur du préfixe en bits
+
+  /*
+    Analyse une règle, retourne false et remplit error si elle est
+    invalide.
+  */
+  static bool parse(const std::string & text, AccessRule & rule, std::string & error);
+};
+
+/*
+  Table des règles compilée en un trie multi-bits (à la DIR-24-8) :
+  le premier niveau est indexé par les 16 premiers bits de l'adresse,
+  les suivants par un octet. Les règles sont "poussées" jusqu'aux
+  feuilles à la construction, une recherche est donc une suite
+  d'accès à un tableau sans comparaison de préfixe : au plus 3 accès
+  en IPv4, 15 en IPv6.
+
+  Chaque entrée est une action (AccessRule::Action) ou l'indice d'un
+  noeud fils marqué par ChildFlag. Les tables IPv4 et IPv6 sont
+  séparées, une adresse IPv6 "IPv4-mapped" (::ffff:a.b.c.d) est
+  cherchée dans la table IPv4 ; une règle IPv6 qui contient tout
+  ::ffff:0:0/96 (::/0 par exemple) est donc aussi insérée dans la
+  table IPv4, comme une règle /0.
+
+  La table n'est plus modifiée une fois construite, elle est partagée
+  entre les threads sans verrou.
+*/
+class AccessTable
+{
+public:
+  AccessTable(const std::vector<AccessRule> & rules, AccessRule::Action defaultAction);
+
+  /*
+    L'action de la règle du plus long préfixe contenant l'adresse,
+    l'action par défaut si aucune règle ne la contient.
+  */
+  AccessRule::Action lookup(const bref::IpAddress & address) const;
+  AccessRule::Action lookupV4(const unsigned char *bytes) const;
+  AccessRule::Action lookupV6(const unsigned char *bytes) const;
+
+  std::size_t ruleCount() const;
+  std::size_t memoryUsage() const;
+
+private:
+  static const uint32_t     ChildFlag = 0x80000000u;
+  static const std::size_t  RootSize  = 1 << 16;
+  static const std::size_t  NodeSize  = 1 << 8;
+
+  std::vector<uint32_t> v4_;
+  std::vector<uint32_t> v6_;
+  std::size_t           ruleCount_;
+  AccessRule::Action    defaultAction_;
+
+  static void insert(std::vector<uint32_t> & table, const AccessRule & rule);
+  static AccessRule::Action find(const std::vector<uint32_t> & table, const unsigned char *bytes);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODACCESS_ACCESSTABLE_H_ */
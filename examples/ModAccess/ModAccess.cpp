@@ -0,0 +1,245 @@
+/**
+ * \file   ModAccess.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 16 09:38:12 2012
+ *
+ * \brief  ModAccess definition.
+ *
+ */
+
+#include "ModAccess.h"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/BrefDLL.h"
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <utility>
+
+const float       ModAccess::ModulePriority = 1.f; // Refuser avant les autres modules
+
+extern "C" BREF_DLL
+bref::AModule *loadModule(bref::ILogger *logger,
+                          const bref::ServerConfig &,
+                          const bref::IConfHelper & confHelper)
+{
+  LOG_INFO(logger) << "Load module mod_access";
+  return new ModAccess(logger, confHelper);
+}
+
+namespace {
+
+/*
+  Réponse à une connexion refusée, le serveur ferme ensuite la socket.
+*/
+bool refuseConnection(bref::HttpResponse & response, const bref::Environment & /* environment */)
+{
+  response.setVersion(bref::Version(1, 1));
+  response.setStatus(bref::status_codes::Forbidden);
+  response.setReason("Forbidden");
+  return false;
+}
+
+} // ! unnamed namespace
+
+ModAccess::ModAccess(bref::ILogger *logger, const bref::IConfHelper & confHelper)
+  : AModule("mod_access", "Contrôle d'accès par adresse IP.", bref::Version(0, 1), bref::Version(0, 4))
+  , logger_(logger)
+  , configRules_()
+  , configValid_(true)
+  , defaultAction_(AccessRule::Allow)
+  , rulesFile_(confHelper.findValue("AccessRulesFile").asString())
+  , reloadInterval_(5)
+  , tables_(std::make_shared<const AccessTable>(std::vector<AccessRule>(), AccessRule::Deny))
+  , fileState_()
+  , stopping_(false)
+{
+  const bref::BrefValue & defaultAction = confHelper.findValue("AccessDefault");
+
+  if (defaultAction.asString() == "deny")
+    defaultAction_ = AccessRule::Deny;
+  else if (! defaultAction.isNull() && defaultAction.asString() != "allow")
+    {
+      // une faute de frappe ne doit pas ouvrir l'accès
+      LOG_ERROR(logger_) << "mod_access: AccessDefault: expected \"allow\" or \"deny\": \""
+                         << defaultAction.asString() << "\", connections without a matching rule are refused";
+      defaultAction_ = AccessRule::Deny;
+    }
+  if (confHelper.findValue("AccessReloadInterval").asInt() > 0)
+    reloadInterval_ = confHelper.findValue("AccessReloadInterval").asInt();
+
+  const bref::BrefValueList & rules = confHelper.findValue("AccessRules").asList();
+
+  for (bref::BrefValueList::const_iterator it = rules.begin(); it != rules.end(); ++it)
+    {
+      AccessRule  rule;
+      std::string error;
+
+      if (AccessRule::parse(it->asString(), rule, error))
+        configRules_.push_back(rule);
+      else
+        {
+          LOG_ERROR(logger_) << "mod_access: AccessRules: " << error;
+          configValid_ = false;
+        }
+    }
+
+  // comme pour le fichier, une règle invalide refuse la table : la
+  // table initiale, qui refuse tout, est conservée
+  if (! configValid_)
+    {
+      LOG_ERROR(logger_) << "mod_access: invalid AccessRules, all connections are refused";
+      return;
+    }
+  if (! reload())
+    LOG_ERROR(logger_) << "mod_access: invalid rules, all connections are refused until "
+                       << rulesFile_ << " is fixed";
+  if (! rulesFile_.empty())
+    watcher_ = std::thread(&ModAccess::watch, this);
+}
+
+ModAccess::~ModAccess()
+{
+  if (watcher_.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        stopping_ = true;
+      }
+      wakeUp_.notify_one();
+      watcher_.join();
+    }
+}
+
+void ModAccess::dispose()
+{
+  delete this;
+}
+
+/*
+  Le hook ne dépend pas de la connexion, il est enregistré une seule
+  fois.
+*/
+void ModAccess::registerHooks(bref::Pipeline & pipeline)
+{
+  bref::Pipeline::ConnectionHook hook(this, &ModAccess::connectionHook);
+
+  pipeline.connectionHooks.push_back(std::make_pair(hook, ModAccess::ModulePriority));
+}
+
+/*
+  Une connexion autorisée n'a pas besoin de handler : on retourne un
+  handler vide, sans allocation.
+*/
+bref::Pipeline::ConnectionRequestHandler
+ModAccess::connectionHook(const bref::Environment & environment)
+{
+  const TableHolder::Pin table = tables_.load();
+
+  if (table->lookup(environment.client.Ip) != AccessRule::Deny)
+    return bref::Pipeline::ConnectionRequestHandler();
+
+  LOG_DEBUG(environment.logger) << "mod_access: connection refused from " << environment.client.Ip;
+  return bref::Pipeline::ConnectionRequestHandler(&refuseConnection);
+}
+
+/*
+  Une ligne par règle, les lignes vides et celles commençant par '#'
+  sont ignorées.
+*/
+bool ModAccess::readRules(const std::string & file, std::vector<AccessRule> & rules) const
+{
+  std::ifstream stream(file.c_str());
+  std::string   line;
+  unsigned      lineNumber = 0;
+  bool          valid      = true;
+
+  if (! stream)
+    {
+      LOG_ERROR(logger_) << "mod_access: can't open " << file;
+      return false;
+    }
+  while (std::getline(stream, line))
+    {
+      ++lineNumber;
+
+      const std::string::size_type first = line.find_first_not_of(" \t\r");
+
+      if (first == std::string::npos || line[first] == '#')
+        continue;
+
+      AccessRule  rule;
+      std::string error;
+
+      if (AccessRule::parse(line, rule, error))
+        rules.push_back(rule);
+      else
+        {
+          LOG_ERROR(logger_) << "mod_access: " << file << ":" << lineNumber << ": " << error;
+          valid = false;
+        }
+    }
+  return valid;
+}
+
+/*
+  Un fichier absent donne un état nul.
+*/
+ModAccess::FileState ModAccess::fileState(const std::string & file)
+{
+  struct stat info;
+  FileState   state = FileState();
+
+  if (::stat(file.c_str(), &info) == 0)
+    {
+      state.seconds     = info.st_mtim.tv_sec;
+      state.nanoseconds = info.st_mtim.tv_nsec;
+      state.size        = info.st_size;
+      state.inode       = info.st_ino;
+    }
+  return state;
+}
+
+bool ModAccess::reload()
+{
+  std::vector<AccessRule> rules(configRules_);
+
+  if (! configValid_)
+    return false;
+
+  if (! rulesFile_.empty())
+    {
+      fileState_ = fileState(rulesFile_);
+      if (! readRules(rulesFile_, rules))
+        return false;
+    }
+
+  // la compilation se fait hors de tout verrou, seule la publication
+  // échange un pointeur
+  std::shared_ptr<const AccessTable> table = std::make_shared<const AccessTable>(rules, defaultAction_);
+
+  tables_.publish(table);
+  LOG_INFO(logger_) << "mod_access: " << table->ruleCount() << " rules loaded ("
+                    << table->memoryUsage() / 1024 << " KiB)";
+  return true;
+}
+
+/*
+  Thread de surveillance du fichier de règles.
+*/
+void ModAccess::watch()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (! wakeUp_.wait_for(lock, std::chrono::seconds(reloadInterval_), [this] { return stopping_; }))
+    {
+      if (fileState(rulesFile_) == fileState_)
+        continue;
+      lock.unlock();
+      reload();
+      lock.lock();
+    }
+}
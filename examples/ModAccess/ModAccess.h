@@ -0,0 +1,104 @@
+/**
+ * \file   ModAccess.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 16 09:38:12 2012
+ *
+ * \brief  ModAccess class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODACCESS_MODACCESS_H_
+#define BREF_API_EXAMPLES_MODACCESS_MODACCESS_H_
+
+#include "bref/AModule.h"
+#include "bref/IConfHelper.h"
+#include "bref/ILogger.h"
+#include "bref/SnapshotHolder.h"
+
+#include "AccessTable.h"
+
+#include <sys/types.h>
+
+#include <ctime>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+  Contrôle d'accès par adresse IP, sur les connectionHooks.
+
+  Les règles sont lues dans la configuration (clé "AccessRules") et
+  dans un fichier optionnel (clé "AccessRulesFile"), surveillé par un
+  thread qui recompile la table lorsqu'il est modifié. Une règle
+  invalide ne doit pas ouvrir l'accès : une erreur dans "AccessRules"
+  refuse toutes les connexions. La nouvelle
+  table est publiée dans un SnapshotHolder : les connexions en cours
+  gardent l'ancienne, l'acceptation des connexions n'attend jamais la
+  recompilation.
+*/
+class ModAccess : public bref::AModule
+{
+private:
+  static const float       ModulePriority;
+
+  typedef bref::SnapshotHolder<AccessTable> TableHolder;
+
+  /*
+    Ce qui identifie une version du fichier de règles : la date à la
+    nanoseconde, la taille et l'inode (un fichier remplacé par
+    rename()).
+  */
+  struct FileState
+  {
+    std::time_t seconds;
+    long        nanoseconds;
+    off_t       size;
+    ino_t       inode;
+
+    bool operator==(const FileState & other) const
+    {
+      return seconds == other.seconds && nanoseconds == other.nanoseconds
+        && size == other.size && inode == other.inode;
+    }
+  };
+
+  bref::ILogger            *logger_;
+  std::vector<AccessRule>   configRules_;
+  bool                      configValid_;
+  AccessRule::Action        defaultAction_;
+  std::string               rulesFile_;
+  unsigned                  reloadInterval_;
+  TableHolder               tables_;
+  FileState                 fileState_;
+
+  std::mutex                mutex_;
+  std::condition_variable   wakeUp_;
+  bool                      stopping_;
+  std::thread               watcher_;
+
+  static FileState fileState(const std::string & file);
+
+  bool readRules(const std::string & file, std::vector<AccessRule> & rules) const;
+  void watch();
+
+public:
+  ModAccess(bref::ILogger *logger, const bref::IConfHelper & confHelper);
+  virtual ~ModAccess();
+  virtual void dispose();
+  virtual void registerHooks(bref::Pipeline & pipeline);
+
+  /*
+    Recompile la table avec les règles de la configuration et celles du
+    fichier. En cas d'erreur dans le fichier la table courante est
+    conservée ; avant le premier chargement réussi, c'est une table
+    qui refuse toutes les connexions.
+  */
+  bool reload();
+
+  bref::Pipeline::ConnectionRequestHandler connectionHook(const bref::Environment & environment);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODACCESS_MODACCESS_H_ */
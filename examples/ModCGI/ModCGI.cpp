@@ -28,6 +28,10 @@ ModCGIGenerator(const bref::Environment &  env,
                 bref::HttpResponse &       response,
                 bref::FdType &             fd);
 
+// Clé de configuration internée au chargement du module (voir `loadModule`), la
+// recherche de la valeur est ensuite directe pour chaque requête.
+static bref::KeyHandle DocumentRootKey("DocumentRoot");
+
 // == Initialisation du module ==
 
 // **Pour savoir comment implémenter un module avec l'API Bref, regardez le code
@@ -182,7 +186,7 @@ ModCGIGenerator(const bref::Environment &  env,
         // On récupère le répertoire de base du serveur / virtualhost. Cette fonction
         // [findValue](http://bref.github.com/documentation-api.html#confhelper)
         // retourne la valeur la plus pertinente en fonction de la requête.
-        std::string DocumentRoot = env.serverConfigHelper.findValue("DocumentRoot", req).asString();
+        std::string DocumentRoot = env.serverConfigHelper.findValue(DocumentRootKey, req).asString();
         // Le chemin absolu du script : DocumentRoot + URI,
         // par exemple : "/var/www" + "/script.rb" = /var/www/script.rb
         std::string script = DocumentRoot + req.getUri();
@@ -215,8 +219,9 @@ ModCGIGenerator(const bref::Environment &  env,
 extern "C" BREF_DLL
 bref::AModule *loadModule(bref::ILogger *logger,
                           const bref::ServerConfig &,
-                          const bref::IConfHelper &)
+                          const bref::IConfHelper & confHelper)
 {
     LOG_INFO(logger) << "Load CGI module";
+    DocumentRootKey = confHelper.internKey("DocumentRoot");
     return new ModCGI();
 }
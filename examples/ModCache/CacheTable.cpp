@@ -0,0 +1,229 @@
+/**
+ * \file   CacheTable.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 10:31:12 2012
+ *
+ * \brief  CacheTable definition.
+ *
+ */
+
+#include "CacheTable.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+const std::size_t NodeOverhead = 256;  // noeud, entrée de l'index, en-tête
+const std::size_t AverageSize  = 4096; // pour dimensionner les FrequencySketch
+
+std::size_t chargeOf(const std::string & path, std::size_t bodySize)
+{
+  return bodySize + 2 * path.size() + NodeOverhead;
+}
+
+std::size_t chargeOf(const CacheEntry & entry)
+{
+  return chargeOf(entry.path, entry.body.size());
+}
+
+} // ! unnamed namespace
+
+CacheTable::Shard::Shard(std::size_t counters)
+  : mutex()
+  , index()
+  , sketch(counters)
+{
+  std::fill(sizes, sizes + SegmentCount, 0);
+}
+
+CacheTable::CacheTable(std::size_t capacity)
+  : windowCapacity_(0)
+  , protectedCapacity_(0)
+  , mainCapacity_(0)
+  , shards_()
+  , generation_(0)
+{
+  const std::size_t shardCapacity = capacity / ShardCount;
+
+  windowCapacity_    = std::max<std::size_t>(shardCapacity / 100, 1);
+  mainCapacity_      = shardCapacity - std::min(windowCapacity_, shardCapacity);
+  protectedCapacity_ = mainCapacity_ / 10 * 8;
+  for (unsigned i = 0; i < ShardCount; ++i)
+    shards_.push_back(std::unique_ptr<Shard>(new Shard(shardCapacity / AverageSize)));
+}
+
+/*
+  Les bits de poids fort choisissent la part, ceux de poids faible
+  restent aux seaux de l'index.
+*/
+CacheTable::Shard & CacheTable::shard(uint64_t hash)
+{
+  return *shards_[(hash * 0x9e3779b97f4a7c15ull) >> 60];
+}
+
+/*
+  Déplace \p node en tête (le plus récent) de \p segment, sans
+  allocation.
+*/
+void CacheTable::move(Shard & shard, NodeList::iterator node, Segment segment)
+{
+  shard.sizes[node->segment] -= node->charge;
+  shard.lists[segment].splice(shard.lists[segment].begin(), shard.lists[node->segment], node);
+  node->segment = segment;
+  shard.sizes[segment] += node->charge;
+}
+
+void CacheTable::evict(Shard & shard, NodeList::iterator node)
+{
+  shard.index.erase(node->entry->path);
+  shard.sizes[node->segment] -= node->charge;
+  shard.lists[node->segment].erase(node);
+}
+
+/*
+  \p candidate vient de sortir de la fenêtre, en tête de probation.
+  Tant que la partie principale déborde, il est comparé à la victime
+  (la moins récente de probation, sinon de protected) : le moins
+  demandé des deux sort.
+*/
+void CacheTable::admit(Shard & shard, NodeList::iterator candidate)
+{
+  while (shard.sizes[Probation] + shard.sizes[Protected] > mainCapacity_)
+    {
+      NodeList::iterator victim;
+
+      if (candidate != --shard.lists[Probation].end())
+        victim = --shard.lists[Probation].end();
+      else if (! shard.lists[Protected].empty())
+        victim = --shard.lists[Protected].end();
+      else
+        {
+          evict(shard, candidate);
+          return;
+        }
+      if (shard.sketch.frequency(candidate->hash) <= shard.sketch.frequency(victim->hash))
+        {
+          evict(shard, candidate);
+          return;
+        }
+      evict(shard, victim);
+    }
+}
+
+CacheTable::EntryPtr CacheTable::find(const std::string & path)
+{
+  const uint64_t              hash  = std::hash<std::string>()(path);
+  Shard &                     part  = shard(hash);
+  std::lock_guard<std::mutex> lock(part.mutex);
+
+  part.sketch.increment(hash);
+
+  const std::unordered_map<std::string, NodeList::iterator>::iterator it = part.index.find(path);
+
+  if (it == part.index.end())
+    return EntryPtr();
+
+  const NodeList::iterator node = it->second;
+
+  if (node->segment == Probation)
+    {
+      move(part, node, Protected);
+      while (part.sizes[Protected] > protectedCapacity_)
+        move(part, --part.lists[Protected].end(), Probation);
+    }
+  else
+    move(part, node, node->segment);
+  return node->entry;
+}
+
+uint64_t CacheTable::generation() const
+{
+  return generation_.load();
+}
+
+bool CacheTable::insert(const EntryPtr & entry, uint64_t generation)
+{
+  const uint64_t              hash   = std::hash<std::string>()(entry->path);
+  const std::size_t           charge = chargeOf(*entry);
+  Shard &                     part   = shard(hash);
+  std::lock_guard<std::mutex> lock(part.mutex);
+
+  // l'invalidation incrémente generation_ avant de prendre le verrou
+  // de la part : sous ce verrou, une lecture antérieure est détectée
+  if (generation != generation_.load() || charge > mainCapacity_)
+    return false;
+
+  const std::unordered_map<std::string, NodeList::iterator>::iterator it = part.index.find(entry->path);
+
+  if (it != part.index.end())
+    evict(part, it->second);
+
+  const Node node = { entry, hash, charge, Window };
+
+  part.lists[Window].push_front(node);
+  part.sizes[Window] += charge;
+  part.index[entry->path] = part.lists[Window].begin();
+  while (part.sizes[Window] > windowCapacity_)
+    {
+      const NodeList::iterator candidate = --part.lists[Window].end();
+
+      move(part, candidate, Probation);
+      admit(part, candidate);
+    }
+  // plus grande que la fenêtre, l'entrée a pu être refusée aussitôt
+  return part.index.find(entry->path) != part.index.end();
+}
+
+/*
+  Le même choix qu'admit() pour une entrée qui sortirait aussitôt de
+  la fenêtre, avant de lire le fichier.
+*/
+bool CacheTable::admissible(const std::string & path, std::size_t bodySize)
+{
+  const uint64_t              hash   = std::hash<std::string>()(path);
+  const std::size_t           charge = chargeOf(path, bodySize);
+  Shard &                     part   = shard(hash);
+  std::lock_guard<std::mutex> lock(part.mutex);
+
+  if (charge > mainCapacity_)
+    return false;
+  if (charge <= windowCapacity_
+      || part.sizes[Probation] + part.sizes[Protected] + charge <= mainCapacity_)
+    return true;
+
+  const NodeList & victims = part.lists[Probation].empty() ? part.lists[Protected] : part.lists[Probation];
+
+  return ! victims.empty() && part.sketch.frequency(hash) > part.sketch.frequency(victims.back().hash);
+}
+
+void CacheTable::erase(const std::string & path)
+{
+  const uint64_t hash = std::hash<std::string>()(path);
+  Shard &        part = shard(hash);
+
+  ++generation_;
+
+  std::lock_guard<std::mutex> lock(part.mutex);
+
+  const std::unordered_map<std::string, NodeList::iterator>::iterator it = part.index.find(path);
+
+  if (it != part.index.end())
+    evict(part, it->second);
+}
+
+void CacheTable::clear()
+{
+  ++generation_;
+  for (std::vector<std::unique_ptr<Shard> >::iterator it = shards_.begin(); it != shards_.end(); ++it)
+    {
+      std::lock_guard<std::mutex> lock((*it)->mutex);
+
+      (*it)->index.clear();
+      for (unsigned segment = 0; segment < SegmentCount; ++segment)
+        {
+          (*it)->lists[segment].clear();
+          (*it)->sizes[segment] = 0;
+        }
+    }
+}
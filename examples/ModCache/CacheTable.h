@@ -0,0 +1,138 @@
+/**
+ * \file   CacheTable.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 10:31:12 2012
+ *
+ * \brief  CacheEntry and CacheTable declarations.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODCACHE_CACHETABLE_H_
+#define BREF_API_EXAMPLES_MODCACHE_CACHETABLE_H_
+
+#include "FrequencySketch.h"
+
+#include "bref/BrefValue.h"
+#include "bref/Buffer.h"
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+  Une réponse en cache : le corps et les valeurs des champs de
+  l'en-tête, prêtes à être copiées dans la réponse.
+*/
+struct CacheEntry
+{
+  std::string     path;           // clé : chemin du fichier
+  bref::Buffer    body;
+  bref::BrefValue contentType;
+  bref::BrefValue contentLength;
+  bref::BrefValue etag;
+};
+
+/*
+  Table des réponses, bornée en octets, répartie en ShardCount parts
+  qui ont chacune leur verrou : deux requêtes ne se bloquent que si
+  leurs clés tombent dans la même part.
+
+  L'éviction suit W-TinyLFU, dans chaque part : une nouvelle entrée
+  entre dans une fenêtre LRU (1 % de la capacité). L'entrée qui sort de
+  la fenêtre n'entre dans la partie principale que si elle est plus
+  demandée que la victime qu'elle remplacerait, d'après un
+  FrequencySketch. La partie principale est une SLRU : une entrée
+  relue passe de "probation" à "protected" (80 %). Un fichier lu une
+  seule fois ne chasse donc pas les fichiers souvent demandés.
+
+  generation() change à chaque invalidation : une entrée lue avant une
+  invalidation n'est pas insérée (voir insert()).
+*/
+class CacheTable : bref::util::NonCopyable
+{
+public:
+  typedef std::shared_ptr<const CacheEntry> EntryPtr;
+
+  static const unsigned ShardCount = 16;
+
+private:
+  enum Segment
+    {
+      Window,
+      Probation,
+      Protected,
+      SegmentCount
+    };
+
+  struct Node
+  {
+    EntryPtr    entry;
+    uint64_t    hash;
+    std::size_t charge;
+    Segment     segment;
+  };
+
+  typedef std::list<Node> NodeList;
+
+  struct Shard
+  {
+    std::mutex                                      mutex;
+    std::unordered_map<std::string, NodeList::iterator> index;
+    NodeList                                        lists[SegmentCount];
+    std::size_t                                     sizes[SegmentCount];
+    FrequencySketch                                 sketch;
+
+    explicit Shard(std::size_t counters);
+  };
+
+  std::size_t                          windowCapacity_;
+  std::size_t                          protectedCapacity_;
+  std::size_t                          mainCapacity_;
+  std::vector<std::unique_ptr<Shard> > shards_;
+  std::atomic<uint64_t>                generation_;
+
+  Shard & shard(uint64_t hash);
+  void move(Shard & shard, NodeList::iterator node, Segment segment);
+  void evict(Shard & shard, NodeList::iterator node);
+  void admit(Shard & shard, NodeList::iterator candidate);
+
+public:
+  /*
+    \p capacity est la taille totale en octets, corps, clés et
+    structures comprises.
+  */
+  explicit CacheTable(std::size_t capacity);
+
+  /*
+    Cherche \p path et compte l'accès, y compris si l'entrée est
+    absente. Retourne un pointeur nul si l'entrée n'est pas en cache.
+  */
+  EntryPtr find(const std::string & path);
+
+  uint64_t generation() const;
+
+  /*
+    Insère \p entry, lue alors que generation() valait \p generation.
+    Retourne false si une invalidation a eu lieu depuis, si l'entrée
+    est trop grande, ou si W-TinyLFU l'a refusée.
+  */
+  bool insert(const EntryPtr & entry, uint64_t generation);
+
+  /*
+    Indique si un corps de \p bodySize octets pour \p path serait
+    gardé par insert(), pour ne pas lire un fichier qui serait refusé.
+  */
+  bool admissible(const std::string & path, std::size_t bodySize);
+
+  void erase(const std::string & path);
+  void clear();
+};
+
+#endif /* !BREF_API_EXAMPLES_MODCACHE_CACHETABLE_H_ */
@@ -0,0 +1,106 @@
+/**
+ * \file   FrequencySketch.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 10:02:37 2012
+ *
+ * \brief  FrequencySketch definition.
+ *
+ */
+
+#include "FrequencySketch.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint64_t Seeds[4] =
+  {
+    0xc3a5c85c97cb3127ull,
+    0xb492b66fbe98f273ull,
+    0x9ae16a3b2f90404full,
+    0xcbf29ce484222325ull
+  };
+
+/*
+  Mélange des bits (finaliseur de MurmurHash3) : une clé donne quatre
+  positions indépendantes.
+*/
+uint64_t mix(uint64_t value)
+{
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdull;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ull;
+  value ^= value >> 33;
+  return value;
+}
+
+} // ! unnamed namespace
+
+FrequencySketch::FrequencySketch(std::size_t counters)
+  : table_()
+  , mask_(0)
+  , additions_(0)
+  , sampleSize_(0)
+{
+  std::size_t words = 8;
+
+  // 16 compteurs par mot, 4 par clé
+  while (words * 4 < counters)
+    words *= 2;
+  table_.resize(words);
+  mask_       = words - 1;
+  sampleSize_ = 10 * words * 4;
+}
+
+/*
+  La ligne row utilise les compteurs 4 * row à 4 * row + 3 du mot
+  choisi.
+*/
+std::size_t FrequencySketch::slot(uint64_t hash, unsigned row, unsigned & shift) const
+{
+  const uint64_t value = mix(hash + Seeds[row]);
+
+  shift = ((row << 2) | static_cast<unsigned>((value >> 32) & 3)) << 2;
+  return static_cast<std::size_t>(value) & mask_;
+}
+
+void FrequencySketch::increment(uint64_t hash)
+{
+  bool added = false;
+
+  for (unsigned row = 0; row < 4; ++row)
+    {
+      unsigned          shift;
+      const std::size_t index = slot(hash, row, shift);
+
+      if (((table_[index] >> shift) & 0xf) != 0xf)
+        {
+          table_[index] += static_cast<uint64_t>(1) << shift;
+          added = true;
+        }
+    }
+  if (added && ++additions_ == sampleSize_)
+    reset();
+}
+
+unsigned FrequencySketch::frequency(uint64_t hash) const
+{
+  unsigned result = 0xf;
+
+  for (unsigned row = 0; row < 4; ++row)
+    {
+      unsigned          shift;
+      const std::size_t index = slot(hash, row, shift);
+
+      result = std::min(result, static_cast<unsigned>((table_[index] >> shift) & 0xf));
+    }
+  return result;
+}
+
+void FrequencySketch::reset()
+{
+  for (std::vector<uint64_t>::iterator it = table_.begin(); it != table_.end(); ++it)
+    *it = (*it >> 1) & 0x7777777777777777ull;
+  additions_ /= 2;
+}
@@ -0,0 +1,51 @@
+/**
+ * \file   FrequencySketch.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 10:02:37 2012
+ *
+ * \brief  FrequencySketch class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODCACHE_FREQUENCYSKETCH_H_
+#define BREF_API_EXAMPLES_MODCACHE_FREQUENCYSKETCH_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+/*
+  Fréquence approchée des accès récents (count-min sketch), pour
+  l'admission TinyLFU.
+
+  Quatre compteurs de 4 bits par clé, un par ligne, rangés dans le
+  même mot de 64 bits pour une ligne donnée : une mise à jour touche au
+  plus quatre mots. La fréquence est le plus petit des quatre
+  compteurs. Après 10 incréments par compteur en moyenne, tous les
+  compteurs sont divisés par deux : les clés qui ne sont plus
+  demandées perdent leur historique.
+*/
+class FrequencySketch
+{
+private:
+  std::vector<uint64_t> table_;
+  std::size_t           mask_;
+  std::size_t           additions_;
+  std::size_t           sampleSize_;
+
+  std::size_t slot(uint64_t hash, unsigned row, unsigned & shift) const;
+  void reset();
+
+public:
+  /*
+    \p counters est le nombre de clés suivies, arrondi à une puissance
+    de deux.
+  */
+  explicit FrequencySketch(std::size_t counters);
+
+  void increment(uint64_t hash);
+  unsigned frequency(uint64_t hash) const;
+};
+
+#endif /* !BREF_API_EXAMPLES_MODCACHE_FREQUENCYSKETCH_H_ */
@@ -0,0 +1,435 @@
+/**
+ * \file   ModCache.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 11:14:50 2012
+ *
+ * \brief  ModCache definition.
+ *
+ */
+
+#include "ModCache.h"
+#include "StaticFile.h"
+#include "bref/detail/util/ContentLength.hpp"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/BrefDLL.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+const float       ModCache::ModulePriority = 0.5f; // Avant ModStatic, après les modules qui génèrent du contenu
+
+extern "C" BREF_DLL
+bref::AModule *loadModule(bref::ILogger *logger,
+                          const bref::ServerConfig &,
+                          const bref::IConfHelper & confHelper)
+{
+  LOG_INFO(logger) << "Load module mod_cache";
+  return new ModCache(logger, confHelper);
+}
+
+namespace {
+
+const std::size_t DefaultCacheSize = 64;        // Mio
+const std::size_t DefaultFileSize  = 1024;      // Kio
+const std::size_t ChunkSize        = 256 * 1024; // octets par appel à outContent()
+const std::size_t PoolSize         = 64;        // handlers gardés par thread
+
+const uint32_t    WatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO
+  | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF;
+
+// chemin de la requête en cours, la mémoire est réutilisée
+thread_local std::string requestPath;
+
+/*
+  ETag fort, calculé sur le contenu (FNV-1a 64 bits) : il ne change
+  pas si le fichier est réécrit à l'identique.
+*/
+std::string contentTag(const bref::Buffer & body)
+{
+  static const char hex[] = "0123456789abcdef";
+  uint64_t          hash  = 0xcbf29ce484222325ull;
+  std::string       tag(18, '"');
+
+  for (bref::Buffer::const_iterator it = body.begin(); it != body.end(); ++it)
+    {
+      hash ^= static_cast<unsigned char>(*it);
+      hash *= 0x100000001b3ull;
+    }
+  for (int i = 16; i > 0; --i, hash >>= 4)
+    tag[i] = hex[hash & 0xf];
+  return tag;
+}
+
+/*
+  If-None-Match : "*" ou une liste d'ETags, comparés sans le préfixe
+  "W/" (comparaison faible, RFC 7232).
+*/
+bool matchesTag(const std::string & header, const std::string & tag)
+{
+  std::string::size_type position = 0;
+
+  while (position < header.size())
+    {
+      std::string::size_type end = header.find(',', position);
+
+      if (end == std::string::npos)
+        end = header.size();
+      while (position < end && (header[position] == ' ' || header[position] == '\t'))
+        ++position;
+
+      std::string::size_type last = end;
+
+      while (last > position && (header[last - 1] == ' ' || header[last - 1] == '\t'))
+        --last;
+      if (last - position == 1 && header[position] == '*')
+        return true;
+      if (last - position > 2 && header.compare(position, 2, "W/") == 0)
+        position += 2;
+      if (header.compare(position, last - position, tag) == 0)
+        return true;
+      position = end + 1;
+    }
+  return false;
+}
+
+} // ! unnamed namespace
+
+ModCache::ModCache(bref::ILogger *logger, const bref::IConfHelper & confHelper)
+  : AModule("mod_cache", "Cache en mémoire des fichiers statiques.", bref::Version(0, 1), bref::Version(0, 4))
+  , logger_(logger)
+  , rootKey_(confHelper.internKey("StaticRoot"))
+  , indexKey_(confHelper.internKey("StaticIndex"))
+  , maxFileSize_(DefaultFileSize * 1024)
+  , table_((confHelper.findValue("CacheSize").asInt() > 0
+            ? confHelper.findValue("CacheSize").asInt() : DefaultCacheSize) * 1024 * 1024)
+  , inotify_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+  , wakeUp_(::eventfd(0, EFD_CLOEXEC))
+  , mutex_()
+  , directories_()
+  , watches_()
+  , watcher_()
+{
+  if (confHelper.findValue("CacheFileSize").asInt() > 0)
+    maxFileSize_ = confHelper.findValue("CacheFileSize").asInt() * 1024;
+
+  if (inotify_ == -1 || wakeUp_ == -1)
+    {
+      LOG_ERROR(logger_) << "mod_cache: " << std::strerror(errno)
+                         << ", the files can't be watched and are not cached";
+      return;
+    }
+  watcher_ = std::thread(&ModCache::watch, this);
+}
+
+ModCache::~ModCache()
+{
+  if (watcher_.joinable())
+    {
+      const uint64_t one = 1;
+
+      if (::write(wakeUp_, &one, sizeof one) != sizeof one)
+        {
+          LOG_ERROR(logger_) << "mod_cache: can't stop the watcher: " << std::strerror(errno);
+        }
+      watcher_.join();
+    }
+  if (inotify_ != -1)
+    ::close(inotify_);
+  if (wakeUp_ != -1)
+    ::close(wakeUp_);
+}
+
+void ModCache::dispose()
+{
+  delete this;
+}
+
+/*
+  Sans inotify une entrée ne pourrait pas être invalidée : le module
+  n'enregistre aucun hook et ModStatic sert les fichiers.
+*/
+void ModCache::registerHooks(bref::Pipeline & pipeline)
+{
+  if (! watcher_.joinable())
+    return;
+
+  bref::Pipeline::ContentHook content(this, &ModCache::contentHook);
+
+  pipeline.contentHooks.push_back(std::make_pair(content, ModCache::ModulePriority));
+}
+
+/*
+  La clé est le chemin du fichier, racine du virtual host comprise :
+  deux virtual hosts ont des entrées distinctes, et un évènement
+  inotify donne directement la clé à invalider. Un fichier qui n'est
+  pas en cache et ne peut pas y entrer (trop grand, répertoire sans
+  '/' final, ...) est laissé à ModStatic.
+*/
+bref::Pipeline::IContentRequestHandler *
+ModCache::contentHook(const bref::Environment & environment,
+                      const bref::HttpRequest & request,
+                      bref::HttpResponse &      response,
+                      bref::FdType &            /* fd */)
+{
+  const bref::request_methods::Type method = request.getMethod();
+
+  if (method != bref::request_methods::Get && method != bref::request_methods::Head)
+    return 0;
+
+  const std::string & root     = environment.serverConfigHelper.findValue(rootKey_, request).asString();
+  std::size_t         rootSize = root.size();
+
+  if (root.empty() || ! static_file::decodePath(request.getUri(), requestPath))
+    return 0;
+  while (rootSize && root[rootSize - 1] == '/')
+    --rootSize;
+  requestPath.insert(0, root, 0, rootSize);
+  if (requestPath[requestPath.size() - 1] == '/')
+    {
+      const std::string & index = environment.serverConfigHelper.findValue(indexKey_, request).asString();
+
+      requestPath.append(index.empty() ? "index.html" : index);
+    }
+
+  CacheTable::EntryPtr entry = table_.find(requestPath);
+
+  if (! entry && ! (entry = load(requestPath)))
+    return 0;
+
+  const bref::HttpHeader::const_iterator noneMatch = request.find(bref::header_fields::IfNoneMatch);
+  const bool                             modified  = noneMatch == request.end()
+    || ! matchesTag(noneMatch->second.asString(), entry->etag.asString());
+
+  response.setVersion(bref::Version(1, 1));
+  if (modified)
+    {
+      response.setStatus(bref::status_codes::OK);
+      response.setReason("OK");
+      response[bref::header_fields::ContentType]   = entry->contentType;
+      response[bref::header_fields::ContentLength] = entry->contentLength;
+    }
+  else
+    {
+      response.setStatus(bref::status_codes::NotModified);
+      response.setReason("Not Modified");
+    }
+  response[bref::header_fields::ETag] = entry->etag;
+  return ModCacheRequestHandler::create(entry, modified);
+}
+
+/*
+  Le répertoire est surveillé avant la lecture du fichier : une
+  modification pendant la lecture est vue, et generation() empêche
+  l'insertion de l'entrée lue.
+*/
+bool ModCache::watchDirectory(const std::string & directory)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (watches_.count(directory))
+    return true;
+
+  const int watch = ::inotify_add_watch(inotify_, directory.empty() ? "/" : directory.c_str(), WatchMask);
+
+  if (watch == -1)
+    {
+      LOG_DEBUG(logger_) << "mod_cache: can't watch " << directory << ": " << std::strerror(errno);
+      return false;
+    }
+
+  // le même répertoire sous un autre nom (lien symbolique) : les
+  // évènements ne donneraient pas la bonne clé
+  const std::unordered_map<int, std::string>::const_iterator known = directories_.find(watch);
+
+  if (known != directories_.end())
+    return false;
+  directories_[watch]  = directory;
+  watches_[directory] = watch;
+  return true;
+}
+
+CacheTable::EntryPtr ModCache::load(const std::string & path)
+{
+  const uint64_t generation = table_.generation();
+
+  if (! watchDirectory(path.substr(0, path.rfind('/'))))
+    return CacheTable::EntryPtr();
+
+  const int   fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+  struct stat info;
+
+  if (fd == -1)
+    return CacheTable::EntryPtr();
+  if (::fstat(fd, &info) != 0 || ! S_ISREG(info.st_mode)
+      || static_cast<uint64_t>(info.st_size) > maxFileSize_
+      || ! table_.admissible(path, info.st_size))
+    {
+      ::close(fd);
+      return CacheTable::EntryPtr();
+    }
+
+  std::shared_ptr<CacheEntry> entry = std::make_shared<CacheEntry>();
+  std::size_t                 size  = 0;
+
+  entry->path = path;
+  entry->body.resize(info.st_size);
+  while (size < entry->body.size())
+    {
+      const ssize_t count = ::pread(fd, &entry->body[size], entry->body.size() - size, size);
+
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0)
+        break;
+      size += count;
+    }
+  ::close(fd);
+  if (size != entry->body.size())
+    return CacheTable::EntryPtr();
+
+  entry->contentType   = bref::BrefValue(static_file::contentType(path));
+  entry->contentLength = bref::util::lengthValue(size);
+  entry->etag          = bref::BrefValue(contentTag(entry->body));
+  // refusée : ModStatic sert le fichier avec sendfile()
+  if (! table_.insert(entry, generation))
+    return CacheTable::EntryPtr();
+  return entry;
+}
+
+/*
+  Thread de surveillance : un évènement sur un fichier retire son
+  entrée. Un évènement sur un répertoire surveillé lui-même, ou la
+  perte d'évènements (IN_Q_OVERFLOW), vide le cache.
+*/
+void ModCache::watch()
+{
+  union
+  {
+    inotify_event event;
+    char          bytes[16 * 1024];
+  }             buffer;
+  pollfd        events[2] = { { inotify_, POLLIN, 0 }, { wakeUp_, POLLIN, 0 } };
+  std::string   path;
+
+  for (;;)
+    {
+      if (::poll(events, 2, -1) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          LOG_ERROR(logger_) << "mod_cache: poll: " << std::strerror(errno);
+          break;
+        }
+      if (events[1].revents)
+        break;
+
+      const ssize_t count = ::read(inotify_, buffer.bytes, sizeof buffer.bytes);
+
+      for (ssize_t offset = 0; offset < count; )
+        {
+          const inotify_event & event = *reinterpret_cast<const inotify_event *>(buffer.bytes + offset);
+
+          offset += sizeof event + event.len;
+          if (event.mask & IN_Q_OVERFLOW)
+            {
+              table_.clear();
+              continue;
+            }
+
+          std::unique_lock<std::mutex>                         lock(mutex_);
+          const std::unordered_map<int, std::string>::iterator directory = directories_.find(event.wd);
+
+          if (directory == directories_.end())
+            continue;
+          if (event.mask & IN_IGNORED)
+            {
+              watches_.erase(directory->second);
+              directories_.erase(directory);
+              lock.unlock();
+              table_.clear();
+            }
+          else if (event.len)
+            {
+              path.assign(directory->second).append("/").append(event.name);
+              lock.unlock();
+              table_.erase(path);
+            }
+          else
+            {
+              lock.unlock();
+              table_.clear();
+            }
+        }
+    }
+}
+
+thread_local ModCacheRequestHandler::Pool ModCacheRequestHandler::pool_;
+
+ModCacheRequestHandler::Pool::~Pool()
+{
+  for (std::vector<ModCacheRequestHandler *>::iterator it = handlers.begin(); it != handlers.end(); ++it)
+    delete *it;
+}
+
+ModCacheRequestHandler::ModCacheRequestHandler()
+  : entry_()
+  , offset_(0)
+{ }
+
+ModCacheRequestHandler::~ModCacheRequestHandler()
+{ }
+
+ModCacheRequestHandler *ModCacheRequestHandler::create(const CacheTable::EntryPtr & entry, bool withBody)
+{
+  ModCacheRequestHandler *handler;
+
+  if (pool_.handlers.empty())
+    handler = new ModCacheRequestHandler();
+  else
+    {
+      handler = pool_.handlers.back();
+      pool_.handlers.pop_back();
+    }
+  handler->entry_  = entry;
+  handler->offset_ = withBody ? 0 : entry->body.size();
+  return handler;
+}
+
+bool ModCacheRequestHandler::inContent(bref::HttpResponse & /* response */,
+                                       const bref::Buffer & /* inBuffer */)
+{
+  return true;
+}
+
+bool ModCacheRequestHandler::outContent(bref::HttpResponse & /* response */,
+                                        bref::Buffer &       outBuffer)
+{
+  const bref::Buffer & body = entry_->body;
+  const std::size_t    size = std::min(body.size() - offset_, ChunkSize);
+
+  outBuffer.insert(outBuffer.end(), body.begin() + offset_, body.begin() + offset_ + size);
+  offset_ += size;
+  return offset_ == body.size();
+}
+
+/*
+  Le handler peut être libéré par un autre thread que celui qui l'a
+  créé : il rejoint alors la réserve de ce thread.
+*/
+void ModCacheRequestHandler::dispose()
+{
+  entry_.reset();
+  if (pool_.handlers.size() < PoolSize)
+    pool_.handlers.push_back(this);
+  else
+    delete this;
+}
@@ -0,0 +1,107 @@
+/**
+ * \file   ModCache.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 11:14:50 2012
+ *
+ * \brief  ModCache class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODCACHE_MODCACHE_H_
+#define BREF_API_EXAMPLES_MODCACHE_MODCACHE_H_
+
+#include "bref/AModule.h"
+#include "bref/IConfHelper.h"
+#include "bref/ILogger.h"
+
+#include "CacheTable.h"
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+  Cache en mémoire des petits fichiers statiques sous StaticRoot, sur
+  les contentHooks, devant ModStatic.
+
+  Une réponse en cache est servie sans appel système ni allocation :
+  les valeurs des champs sont copiées dans la réponse (dont le serveur
+  réutilise la mémoire d'une requête à l'autre), le corps est copié
+  dans le buffer de sortie et les handlers sont recyclés par thread.
+  If-None-Match est comparé à l'ETag de l'entrée, calculé sur le
+  contenu, et donne une 304.
+
+  Les répertoires des fichiers en cache sont surveillés avec inotify :
+  un fichier modifié, déplacé ou supprimé sort du cache.
+*/
+class ModCache : public bref::AModule
+{
+private:
+  static const float                   ModulePriority;
+
+  bref::ILogger                       *logger_;
+  bref::KeyHandle                      rootKey_;
+  bref::KeyHandle                      indexKey_;
+  std::size_t                          maxFileSize_;
+  CacheTable                           table_;
+
+  int                                  inotify_;
+  int                                  wakeUp_;
+  std::mutex                           mutex_;
+  std::unordered_map<int, std::string> directories_;   // répertoire de chaque watch
+  std::unordered_map<std::string, int> watches_;
+  std::thread                          watcher_;
+
+  bool watchDirectory(const std::string & directory);
+  CacheTable::EntryPtr load(const std::string & path);
+  void watch();
+
+public:
+  ModCache(bref::ILogger *logger, const bref::IConfHelper & confHelper);
+  virtual ~ModCache();
+  virtual void dispose();
+  virtual void registerHooks(bref::Pipeline & pipeline);
+
+  bref::Pipeline::IContentRequestHandler *contentHook(const bref::Environment & environment,
+                                                      const bref::HttpRequest & request,
+                                                      bref::HttpResponse &      response,
+                                                      bref::FdType &            fd);
+};
+
+/*
+  Handler d'une réponse en cache. Les handlers libérés par dispose()
+  sont gardés par le thread pour les requêtes suivantes.
+*/
+class ModCacheRequestHandler : public bref::Pipeline::IContentRequestHandler
+{
+private:
+  struct Pool
+  {
+    std::vector<ModCacheRequestHandler *> handlers;
+
+    ~Pool();
+  };
+
+  static thread_local Pool pool_;
+
+  CacheTable::EntryPtr     entry_;
+  std::size_t              offset_;
+
+  ModCacheRequestHandler();
+  virtual ~ModCacheRequestHandler();
+
+public:
+  /*
+    Handler qui envoie le corps de \p entry, ou aucun corps si
+    \p withBody est false (304).
+  */
+  static ModCacheRequestHandler *create(const CacheTable::EntryPtr & entry, bool withBody);
+
+  virtual bool inContent(bref::HttpResponse & response, const bref::Buffer & inBuffer);
+  virtual bool outContent(bref::HttpResponse & response, bref::Buffer & outBuffer);
+  virtual void dispose();
+};
+
+#endif /* !BREF_API_EXAMPLES_MODCACHE_MODCACHE_H_ */
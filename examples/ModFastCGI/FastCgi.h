@@ -0,0 +1,90 @@
+/**
+ * \file   FastCgi.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 22 09:12:40 2012
+ *
+ * \brief  FastCGI protocol constants and record encoding.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODFASTCGI_FASTCGI_H_
+#define BREF_API_EXAMPLES_MODFASTCGI_FASTCGI_H_
+
+#include "bref/Buffer.h"
+
+#include <cstddef>
+
+/*
+  Protocole FastCGI 1.0, rôle Responder uniquement.
+  Voir http://www.fastcgi.com/devkit/doc/fcgi-spec.html
+*/
+namespace fastcgi {
+
+  const unsigned char Version1        = 1;
+  const std::size_t   HeaderSize      = 8;
+  const std::size_t   MaxContentSize  = 65535;
+
+  enum RecordType
+    {
+      BeginRequest    = 1,
+      AbortRequest    = 2,
+      EndRequest      = 3,
+      Params          = 4,
+      Stdin           = 5,
+      Stdout          = 6,
+      Stderr          = 7
+    };
+
+  const unsigned char Responder       = 1;  // rôle, octet de poids faible
+  const unsigned char KeepConnection  = 1;  // flags de BeginRequest
+  const unsigned char RequestComplete = 0;  // protocolStatus de EndRequest
+
+  /*
+    En-tête d'un record de \p size octets suivis de \p padding octets
+    de bourrage.
+  */
+  inline void writeHeader(unsigned char *out, RecordType type, unsigned requestId,
+                          std::size_t size, std::size_t padding)
+  {
+    out[0] = Version1;
+    out[1] = static_cast<unsigned char>(type);
+    out[2] = static_cast<unsigned char>(requestId >> 8);
+    out[3] = static_cast<unsigned char>(requestId);
+    out[4] = static_cast<unsigned char>(size >> 8);
+    out[5] = static_cast<unsigned char>(size);
+    out[6] = static_cast<unsigned char>(padding);
+    out[7] = 0;
+  }
+
+  /*
+    Longueur d'un nom ou d'une valeur : 1 octet jusqu'à 127, 4 octets
+    au-delà.
+  */
+  inline void appendLength(bref::Buffer & out, std::size_t length)
+  {
+    if (length < 128)
+      out.push_back(static_cast<char>(length));
+    else
+      {
+        out.push_back(static_cast<char>(((length >> 24) & 0x7f) | 0x80));
+        out.push_back(static_cast<char>(length >> 16));
+        out.push_back(static_cast<char>(length >> 8));
+        out.push_back(static_cast<char>(length));
+      }
+  }
+
+  /*
+    Ajoute une paire nom-valeur au contenu d'un record Params.
+  */
+  inline void appendPair(bref::Buffer & out, const char *name, std::size_t nameSize,
+                         const char *value, std::size_t valueSize)
+  {
+    appendLength(out, nameSize);
+    appendLength(out, valueSize);
+    out.insert(out.end(), name, name + nameSize);
+    out.insert(out.end(), value, value + valueSize);
+  }
+
+} // ! namespace fastcgi
+
+#endif /* !BREF_API_EXAMPLES_MODFASTCGI_FASTCGI_H_ */
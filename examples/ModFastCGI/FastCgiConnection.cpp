@@ -0,0 +1,577 @@
+/**
+ * \file   FastCgiConnection.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 22 09:40:18 2012
+ *
+ * \brief  FastCgiConnection and FastCgiPool definitions.
+ *
+ */
+
+#include "FastCgiConnection.h"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/util/ICaseStringCmp.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const unsigned    RequestId     = 1;           // une requête à la fois par connexion
+const std::size_t ReadSize      = 64 * 1024;   // octets lus par appel à outContent()
+const std::size_t MaxHeaderSize = 64 * 1024;   // en-tête CGI de la réponse
+
+const char        Padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+bool isField(const std::string & line, std::size_t size, const char *name)
+{
+  const std::size_t nameSize = std::strlen(name);
+
+  return size == nameSize && bref::util::icaseEqual(line.data(), name, size);
+}
+
+bool watch(int events, int operation, int socket, uint32_t mask)
+{
+  epoll_event event;
+
+  std::memset(&event, 0, sizeof event);
+  event.events = mask;
+  return ::epoll_ctl(events, operation, socket, &event) == 0;
+}
+
+} // ! unnamed namespace
+
+FastCgiConnection::FastCgiConnection(FastCgiPool & pool, int socket, int events)
+  : pool_(pool)
+  , socket_(socket)
+  , events_(events)
+  , logger_(0)
+  , params_()
+  , output_()
+  , outputOffset_(0)
+  , writeWatched_(false)
+  , input_()
+  , inputOffset_(0)
+  , header_()
+  , headerDone_(false)
+  , stdinClosed_(false)
+  , ended_(true)
+  , reusable_(true)
+{
+  input_.reserve(2 * ReadSize);
+}
+
+FastCgiConnection::~FastCgiConnection()
+{
+  ::close(events_);
+  ::close(socket_);
+}
+
+int FastCgiConnection::fd() const
+{
+  return events_;
+}
+
+bool FastCgiConnection::reusable() const
+{
+  // une réponse donnée avant la fin de Stdin laisse des records que le
+  // worker lirait avec la requête suivante
+  if (! ended_ || ! reusable_ || ! stdinClosed_ || outputOffset_ != output_.size()
+      || inputOffset_ != input_.size())
+    return false;
+
+  // le worker a fermé la connexion (0) ou envoyé des données hors
+  // requête : elle ne peut pas resservir
+  char          byte;
+  const ssize_t count = ::recv(socket_, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+
+  return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+bref::Buffer & FastCgiConnection::params()
+{
+  return params_;
+}
+
+bool FastCgiConnection::start(bref::ILogger *logger, bool withBody)
+{
+  logger_      = logger;
+  input_.clear();
+  inputOffset_ = 0;
+  header_.clear();
+  headerDone_  = false;
+  stdinClosed_ = ! withBody;
+  ended_       = false;
+  reusable_    = true;
+  output_.clear();
+  outputOffset_ = 0;
+  if (! watchWritable(false))
+    return false;
+
+  if (params_.size() > fastcgi::MaxContentSize)
+    {
+      unsigned char begin[fastcgi::HeaderSize + 8] = { 0 };
+      iovec         vector                        = { begin, sizeof begin };
+
+      fastcgi::writeHeader(begin, fastcgi::BeginRequest, RequestId, 8, 0);
+      begin[fastcgi::HeaderSize + 1] = fastcgi::Responder;
+      begin[fastcgi::HeaderSize + 2] = fastcgi::KeepConnection;
+      return send(&vector, 1)
+        && sendRecord(fastcgi::Params, &params_[0], params_.size())
+        && sendRecord(fastcgi::Params, 0, 0)
+        && (withBody || sendRecord(fastcgi::Stdin, 0, 0));
+    }
+
+  // BeginRequest, Params, Params vide et Stdin vide en un seul envoi
+  unsigned char records[4 * fastcgi::HeaderSize + 8] = { 0 };
+  unsigned char *params    = records + fastcgi::HeaderSize + 8;
+  unsigned char *end       = params + fastcgi::HeaderSize;
+  const std::size_t padding = (8 - params_.size() % 8) % 8;
+
+  fastcgi::writeHeader(records, fastcgi::BeginRequest, RequestId, 8, 0);
+  records[fastcgi::HeaderSize + 1] = fastcgi::Responder;
+  records[fastcgi::HeaderSize + 2] = fastcgi::KeepConnection;
+  fastcgi::writeHeader(params, fastcgi::Params, RequestId, params_.size(), padding);
+  fastcgi::writeHeader(end, fastcgi::Params, RequestId, 0, 0);
+  fastcgi::writeHeader(end + fastcgi::HeaderSize, fastcgi::Stdin, RequestId, 0, 0);
+
+  iovec vectors[4] =
+    {
+      { records, fastcgi::HeaderSize + 8 + fastcgi::HeaderSize },
+      { params_.empty() ? 0 : &params_[0], params_.size() },
+      { const_cast<char *>(Padding), padding },
+      { end, withBody ? fastcgi::HeaderSize : 2 * fastcgi::HeaderSize }
+    };
+
+  return send(vectors, 4);
+}
+
+/*
+  Un record par tranche de MaxContentSize octets, en-tête, contenu et
+  bourrage envoyés ensemble.
+*/
+bool FastCgiConnection::sendRecord(fastcgi::RecordType type, const char *data, std::size_t size)
+{
+  std::size_t offset = 0;
+
+  do
+    {
+      const std::size_t length  = std::min(size - offset, fastcgi::MaxContentSize);
+      const std::size_t padding = (8 - length % 8) % 8;
+      unsigned char     header[fastcgi::HeaderSize];
+      iovec             vectors[3] =
+        {
+          { header, sizeof header },
+          { const_cast<char *>(data) + offset, length },
+          { const_cast<char *>(Padding), padding }
+        };
+
+      fastcgi::writeHeader(header, type, RequestId, length, padding);
+      if (! send(vectors, 3))
+        return false;
+      offset += length;
+    }
+  while (offset < size);
+  return true;
+}
+
+/*
+  Un seul sendmsg(), sans attendre : ce que la socket n'accepte pas est
+  ajouté à output_, envoyé par flush() quand le worker a lu. Derrière
+  des records en attente les nouveaux sont ajoutés directement, pour
+  garder l'ordre.
+*/
+bool FastCgiConnection::send(iovec *vectors, std::size_t count)
+{
+  if (outputOffset_ == output_.size())
+    {
+      msghdr  message;
+      ssize_t sent;
+
+      std::memset(&message, 0, sizeof message);
+      message.msg_iov    = vectors;
+      message.msg_iovlen = count;
+      do
+        sent = ::sendmsg(socket_, &message, MSG_NOSIGNAL);
+      while (sent < 0 && errno == EINTR);
+      if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        return false;
+      while (sent > 0 && count && static_cast<std::size_t>(sent) >= vectors->iov_len)
+        {
+          sent -= vectors->iov_len;
+          ++vectors;
+          --count;
+        }
+      if (count && sent > 0)
+        {
+          vectors->iov_base = static_cast<char *>(vectors->iov_base) + sent;
+          vectors->iov_len -= sent;
+        }
+      if (! count)
+        return true;
+    }
+  for (; count; ++vectors, --count)
+    {
+      const char *data = static_cast<const char *>(vectors->iov_base);
+
+      output_.insert(output_.end(), data, data + vectors->iov_len);
+    }
+  return flush();
+}
+
+/*
+  Envoie les records en attente. Si le worker ne les lit pas, sa
+  réponse est lue : un worker qui écrit avant de lire tout Stdin
+  attendrait sinon qu'on le lise, pendant qu'on attend qu'il lise.
+  La socket est surveillée en écriture tant qu'il reste des records.
+*/
+bool FastCgiConnection::flush()
+{
+  while (outputOffset_ < output_.size())
+    {
+      const ssize_t sent = ::send(socket_, &output_[outputOffset_], output_.size() - outputOffset_,
+                                  MSG_NOSIGNAL);
+
+      if (sent < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return false;
+
+          bool eof;
+
+          receive(eof);
+          return watchWritable(true);
+        }
+      outputOffset_ += sent;
+    }
+  output_.clear();
+  outputOffset_ = 0;
+  return watchWritable(false);
+}
+
+bool FastCgiConnection::watchWritable(bool writable)
+{
+  if (writable == writeWatched_)
+    return true;
+  writeWatched_ = writable;
+  return watch(events_, EPOLL_CTL_MOD, socket_, writable ? EPOLLIN | EPOLLOUT : EPOLLIN);
+}
+
+/*
+  Une lecture, ajoutée aux records en attente. La partie déjà traitée
+  est retirée avant, la capacité du buffer est conservée.
+*/
+bool FastCgiConnection::receive(bool & eof)
+{
+  if (inputOffset_ == input_.size())
+    {
+      input_.clear();
+      inputOffset_ = 0;
+    }
+  else if (inputOffset_ >= ReadSize)
+    {
+      input_.erase(input_.begin(), input_.begin() + inputOffset_);
+      inputOffset_ = 0;
+    }
+
+  const std::size_t size = input_.size();
+  ssize_t           count;
+
+  input_.resize(size + ReadSize);
+  do
+    count = ::read(socket_, &input_[size], ReadSize);
+  while (count < 0 && errno == EINTR);
+  input_.resize(size + (count > 0 ? count : 0));
+  eof = count == 0;
+  return count >= 0 || errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void FastCgiConnection::readRecords(bref::HttpResponse & response, bref::Buffer & outBuffer)
+{
+  while (! ended_ && input_.size() - inputOffset_ >= fastcgi::HeaderSize)
+    {
+      const unsigned char *record  = reinterpret_cast<const unsigned char *>(&input_[inputOffset_]);
+      const std::size_t    length  = (record[4] << 8) | record[5];
+      const std::size_t    total   = fastcgi::HeaderSize + length + record[6];
+      const char          *content = &input_[inputOffset_ + fastcgi::HeaderSize];
+
+      if (input_.size() - inputOffset_ < total)
+        break;
+      if (((record[2] << 8) | record[3]) == RequestId)
+        switch (record[1])
+          {
+          case fastcgi::Stdout:
+            if (headerDone_)
+              outBuffer.insert(outBuffer.end(), content, content + length);
+            else
+              readHeader(response, content, length, outBuffer);
+            break;
+
+          case fastcgi::Stderr:
+            if (length)
+              {
+                LOG_ERROR(logger_) << "mod_fastcgi: " << std::string(content, length);
+              }
+            break;
+
+          case fastcgi::EndRequest:
+            ended_     = true;
+            reusable_ &= length >= 5 && static_cast<unsigned char>(content[4]) == fastcgi::RequestComplete;
+            if (! headerDone_)
+              fail(response);
+            break;
+          }
+      inputOffset_ += total;
+    }
+}
+
+/*
+  L'en-tête CGI (Status, Location, champs de la réponse) est gardé
+  jusqu'à la ligne vide, la suite est le début du corps.
+*/
+void FastCgiConnection::readHeader(bref::HttpResponse & response, const char *data, std::size_t size,
+                                   bref::Buffer & outBuffer)
+{
+  const std::size_t searchFrom = header_.size() < 3 ? 0 : header_.size() - 3;
+
+  header_.append(data, size);
+
+  std::size_t end       = header_.find("\r\n\r\n", searchFrom);
+  std::size_t separator = 4;
+
+  if (end == std::string::npos)
+    {
+      end       = header_.find("\n\n", searchFrom);
+      separator = 2;
+    }
+  if (end == std::string::npos)
+    {
+      if (header_.size() > MaxHeaderSize)
+        fail(response);
+      return;
+    }
+  parseHeader(response, end);
+  headerDone_ = true;
+  outBuffer.insert(outBuffer.end(), header_.begin() + end + separator, header_.end());
+}
+
+void FastCgiConnection::parseHeader(bref::HttpResponse & response, std::size_t size)
+{
+  bool        status   = false;
+  bool        location = false;
+  std::size_t position = 0;
+
+  response.setVersion(bref::Version(1, 1));
+  while (position < size)
+    {
+      std::size_t end = header_.find('\n', position);
+
+      if (end == std::string::npos || end > size)
+        end = size;
+
+      const std::size_t colon = header_.find(':', position);
+      std::size_t       last  = end;
+
+      if (last > position && header_[last - 1] == '\r')
+        --last;
+      if (colon < last)
+        {
+          std::size_t value = colon + 1;
+
+          while (value < last && (header_[value] == ' ' || header_[value] == '\t'))
+            ++value;
+
+          const std::string name(header_, position, colon - position);
+
+          if (isField(name, name.size(), "Status"))
+            {
+              const int code = std::atoi(header_.c_str() + value);
+
+              if (code >= 100 && code < 600)
+                {
+                  const std::size_t reason = header_.find(' ', value);
+
+                  status = true;
+                  response.setStatus(static_cast<bref::status_codes::Type>(code));
+                  response.setReason(reason < last ? header_.substr(reason + 1, last - reason - 1) : "");
+                }
+            }
+          else
+            {
+              location |= isField(name, name.size(), "Location");
+              response[name] = bref::BrefValue(header_.substr(value, last - value));
+            }
+        }
+      position = end + 1;
+    }
+  if (! status)
+    {
+      response.setStatus(location ? bref::status_codes::Found : bref::status_codes::OK);
+      response.setReason(location ? "Found" : "OK");
+    }
+}
+
+/*
+  Réponse invalide ou worker injoignable : 502 si l'en-tête n'a pas
+  encore été donné, la connexion est fermée au lieu d'être réutilisée.
+*/
+void FastCgiConnection::fail(bref::HttpResponse & response)
+{
+  reusable_ = false;
+  if (! headerDone_)
+    {
+      headerDone_ = true;
+      response.setVersion(bref::Version(1, 1));
+      response.setStatus(bref::status_codes::BadGateway);
+      response.setReason("Bad Gateway");
+    }
+  // la socket devient lisible (fin de fichier) : le serveur rappelle
+  // outContent(), qui termine la réponse
+  ::shutdown(socket_, SHUT_RDWR);
+}
+
+bool FastCgiConnection::inContent(bref::HttpResponse & response, const bref::Buffer & inBuffer)
+{
+  if (stdinClosed_ || ended_)
+    return true;
+  if (inBuffer.empty())
+    stdinClosed_ = true;
+  if (! sendRecord(fastcgi::Stdin, inBuffer.empty() ? 0 : &inBuffer[0], inBuffer.size()))
+    {
+      LOG_ERROR(logger_) << "mod_fastcgi: " << pool_.path() << ": " << std::strerror(errno);
+      stdinClosed_ = true;
+      fail(response);
+    }
+  return stdinClosed_;
+}
+
+bool FastCgiConnection::outContent(bref::HttpResponse & response, bref::Buffer & outBuffer)
+{
+  bool eof = false;
+
+  if (! flush())
+    {
+      // le worker ne lit plus Stdin (il a pu répondre puis fermer) : la
+      // réponse déjà reçue est lue quand même
+      output_.clear();
+      outputOffset_ = 0;
+      reusable_     = false;
+      watchWritable(false);
+    }
+  if (! receive(eof))
+    {
+      LOG_ERROR(logger_) << "mod_fastcgi: " << pool_.path() << ": " << std::strerror(errno);
+      fail(response);
+      return true;
+    }
+  readRecords(response, outBuffer);
+  if (ended_)
+    return true;
+  if (eof)
+    {
+      // fermeture avant EndRequest : le corps déjà envoyé est tronqué
+      if (reusable_)
+        {
+          LOG_ERROR(logger_) << "mod_fastcgi: " << pool_.path() << ": connection closed by the worker";
+        }
+      fail(response);
+      return true;
+    }
+  return false;
+}
+
+void FastCgiConnection::dispose()
+{
+  pool_.release(this);
+}
+
+FastCgiPool::FastCgiPool(const std::string & path, std::size_t maxIdle)
+  : path_(path)
+  , maxIdle_(maxIdle)
+  , mutex_()
+  , idle_()
+{
+  idle_.reserve(maxIdle);
+}
+
+FastCgiPool::~FastCgiPool()
+{
+  for (std::vector<FastCgiConnection *>::iterator it = idle_.begin(); it != idle_.end(); ++it)
+    delete *it;
+}
+
+const std::string & FastCgiPool::path() const
+{
+  return path_;
+}
+
+FastCgiConnection *FastCgiPool::acquire(bool & reused, std::string & error)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    reused = ! idle_.empty();
+    if (reused)
+      {
+        FastCgiConnection *connection = idle_.back();
+
+        idle_.pop_back();
+        return connection;
+      }
+  }
+
+  sockaddr_un address;
+
+  std::memset(&address, 0, sizeof address);
+  address.sun_family = AF_UNIX;
+  if (path_.size() >= sizeof address.sun_path)
+    {
+      error = "socket path too long";
+      return 0;
+    }
+  std::memcpy(address.sun_path, path_.c_str(), path_.size());
+
+  // connect() bloquant : sur une socket Unix il n'attend que si la file
+  // d'attente du worker est pleine
+  const int fd     = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int       events = -1;
+
+  if (fd == -1
+      || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) == -1
+      || ::fcntl(fd, F_SETFL, O_NONBLOCK) == -1
+      || (events = ::epoll_create1(EPOLL_CLOEXEC)) == -1
+      || ! watch(events, EPOLL_CTL_ADD, fd, EPOLLIN))
+    {
+      error = std::strerror(errno);
+      if (events != -1)
+        ::close(events);
+      if (fd != -1)
+        ::close(fd);
+      return 0;
+    }
+  return new FastCgiConnection(*this, fd, events);
+}
+
+void FastCgiPool::release(FastCgiConnection *connection)
+{
+  if (connection->reusable())
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (idle_.size() < maxIdle_)
+        {
+          idle_.push_back(connection);
+          return;
+        }
+    }
+  delete connection;
+}
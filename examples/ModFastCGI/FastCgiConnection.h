@@ -0,0 +1,140 @@
+/**
+ * \file   FastCgiConnection.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 22 09:40:18 2012
+ *
+ * \brief  FastCgiConnection and FastCgiPool declarations.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODFASTCGI_FASTCGICONNECTION_H_
+#define BREF_API_EXAMPLES_MODFASTCGI_FASTCGICONNECTION_H_
+
+#include "FastCgi.h"
+
+#include "bref/ILogger.h"
+#include "bref/Pipeline.h"
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <sys/uio.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+class FastCgiPool;
+
+/*
+  Une connexion persistante à un worker FastCGI, qui sert aussi de
+  handler à la requête en cours : une requête à la fois par connexion,
+  puis la connexion retourne dans le FastCgiPool (FCGI_KEEP_CONN).
+
+  Rien n'attend la socket : les records Stdin que le worker ne lit pas
+  encore sont gardés dans output_, et la réponse est lue pendant ce
+  temps (le worker peut répondre avant de lire tout le corps). Le fd
+  donné au serveur est un epoll qui surveille la socket : lisible
+  quand le worker a écrit, ou quand la socket accepte à nouveau des
+  données s'il reste des records à envoyer. outContent() envoie la
+  suite puis lit une fois ce qui est disponible et découpe les
+  records.
+
+  Les buffers appartiennent à la connexion et sont réutilisés d'une
+  requête à l'autre : le corps ne demande aucune allocation par
+  morceau.
+*/
+class FastCgiConnection : public bref::Pipeline::IContentRequestHandler
+{
+private:
+  FastCgiPool          &pool_;
+  int                   socket_;
+  int                   events_;        // epoll de la socket, donné au serveur
+  bref::ILogger        *logger_;
+  bref::Buffer          params_;
+  bref::Buffer          output_;        // records pas encore envoyés, à partir de outputOffset_
+  std::size_t           outputOffset_;
+  bool                  writeWatched_;
+  bref::Buffer          input_;         // records reçus, à partir de inputOffset_
+  std::size_t           inputOffset_;
+  std::string           header_;        // en-tête CGI de la réponse
+  bool                  headerDone_;
+  bool                  stdinClosed_;
+  bool                  ended_;
+  bool                  reusable_;
+
+  bool sendRecord(fastcgi::RecordType type, const char *data, std::size_t size);
+  bool send(iovec *vectors, std::size_t count);
+  bool flush();
+  bool watchWritable(bool writable);
+  bool receive(bool & eof);
+  void readRecords(bref::HttpResponse & response, bref::Buffer & outBuffer);
+  void readHeader(bref::HttpResponse & response, const char *data, std::size_t size,
+                  bref::Buffer & outBuffer);
+  void parseHeader(bref::HttpResponse & response, std::size_t size);
+  void fail(bref::HttpResponse & response);
+
+public:
+  FastCgiConnection(FastCgiPool & pool, int socket, int events);
+  virtual ~FastCgiConnection();
+
+  /*
+    Le fd à donner au serveur.
+  */
+  int fd() const;
+
+  /*
+    La connexion peut servir une nouvelle requête : la requête
+    précédente est terminée et le worker n'a pas fermé la socket.
+  */
+  bool reusable() const;
+
+  /*
+    Les paramètres (variables CGI) de la prochaine requête, au format
+    des records Params (voir fastcgi::appendPair()).
+  */
+  bref::Buffer & params();
+
+  /*
+    Envoie BeginRequest et les paramètres, en un seul appel système
+    lorsqu'ils tiennent dans un record. Sans corps (\p withBody false)
+    le record Stdin vide suit. Retourne false si la socket est fermée.
+  */
+  bool start(bref::ILogger *logger, bool withBody);
+
+  virtual bool inContent(bref::HttpResponse & response, const bref::Buffer & inBuffer);
+  virtual bool outContent(bref::HttpResponse & response, bref::Buffer & outBuffer);
+  virtual void dispose();
+};
+
+/*
+  Connexions inactives vers un worker (socket Unix), partagées par les
+  threads du serveur.
+*/
+class FastCgiPool : bref::util::NonCopyable
+{
+private:
+  std::string                       path_;
+  std::size_t                       maxIdle_;
+  std::mutex                        mutex_;
+  std::vector<FastCgiConnection *>  idle_;
+
+public:
+  FastCgiPool(const std::string & path, std::size_t maxIdle);
+  ~FastCgiPool();
+
+  const std::string & path() const;
+
+  /*
+    Une connexion inactive si possible (\p reused vaut alors true),
+    sinon une nouvelle connexion. Retourne 0 et remplit \p error si la
+    connexion échoue.
+  */
+  FastCgiConnection *acquire(bool & reused, std::string & error);
+
+  /*
+    Rend une connexion après une requête, elle est fermée si elle ne
+    peut pas être réutilisée ou si la réserve est pleine.
+  */
+  void release(FastCgiConnection *connection);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODFASTCGI_FASTCGICONNECTION_H_ */
@@ -0,0 +1,270 @@
+/**
+ * \file   ModFastCGI.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 22 10:31:07 2012
+ *
+ * \brief  ModFastCGI definition.
+ *
+ */
+
+#include "ModFastCGI.h"
+#include "StaticFile.h"
+#include "bref/AccessRecord.h"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/BrefDLL.h"
+#include "bref/detail/util/ICaseStringCmp.hpp"
+#include "bref/detail/util/IntFormat.hpp"
+
+#include <errno.h>
+
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+const float       ModFastCGI::ModulePriority = 1.f; // Avant ModCache et ModStatic, qui serviraient le source des scripts
+
+extern "C" BREF_DLL
+bref::AModule *loadModule(bref::ILogger *logger,
+                          const bref::ServerConfig &,
+                          const bref::IConfHelper & confHelper)
+{
+  LOG_INFO(logger) << "Load module mod_fastcgi";
+  return new ModFastCGI(logger, confHelper);
+}
+
+namespace {
+
+const char *const DefaultExtension   = ".php";
+const int         DefaultConnections = 16;        // connexions inactives gardées
+
+// chemin de la requête en cours et nom des variables HTTP_*, la
+// mémoire est réutilisée
+thread_local std::string requestPath;
+thread_local std::string variable;
+
+/*
+  Réponse sans corps, donnée lorsque le worker ne peut pas être joint :
+  les modules suivants ne doivent pas servir le script comme un
+  fichier statique.
+*/
+struct BadGatewayHandler : public bref::Pipeline::IContentRequestHandler
+{
+  virtual bool inContent(bref::HttpResponse &, const bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual bool outContent(bref::HttpResponse &, bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual void dispose()
+  { }
+};
+
+BadGatewayHandler badGateway;
+
+void appendParam(bref::Buffer & out, const char *name, const char *value, std::size_t size)
+{
+  fastcgi::appendPair(out, name, std::strlen(name), value, size);
+}
+
+void appendParam(bref::Buffer & out, const char *name, const std::string & value)
+{
+  appendParam(out, name, value.data(), value.size());
+}
+
+void appendParam(bref::Buffer & out, const char *name, const bref::BrefValue & value)
+{
+  if (value.isInt())
+    {
+      char              digits[bref::util::MaxDecimalSize];
+      const std::size_t size = bref::util::formatDecimal(value.asInt(), digits);
+
+      appendParam(out, name, digits, size);
+    }
+  else
+    appendParam(out, name, value.asString());
+}
+
+/*
+  Une requête a un corps si elle donne un Content-Length non nul ou
+  un Transfer-Encoding.
+*/
+bool hasBody(const bref::HttpRequest & request)
+{
+  const bref::HttpHeader::const_iterator length = request.find(bref::header_fields::ContentLength);
+
+  if (request.count(bref::header_fields::TransferEncoding))
+    return true;
+  if (length == request.end())
+    return false;
+  if (length->second.isInt())
+    return length->second.asInt() > 0;
+  return length->second.asString().find_first_not_of("0 \t") != std::string::npos;
+}
+
+} // ! unnamed namespace
+
+ModFastCGI::ModFastCGI(bref::ILogger *logger, const bref::IConfHelper & confHelper)
+  : AModule("mod_fastcgi", "Scripts exécutés par un worker FastCGI.", bref::Version(0, 1), bref::Version(0, 4))
+  , logger_(logger)
+  , rootKey_(confHelper.internKey("DocumentRoot"))
+  , extension_(confHelper.findValue("FastCGIExtension").asString())
+  , pool_(0)
+{
+  const std::string & socket      = confHelper.findValue("FastCGISocket").asString();
+  const int           connections = confHelper.findValue("FastCGIConnections").asInt();
+
+  if (extension_.empty())
+    extension_ = DefaultExtension;
+  if (socket.empty())
+    {
+      LOG_ERROR(logger_) << "mod_fastcgi: no FastCGISocket, the scripts are not executed";
+      return;
+    }
+  pool_ = new FastCgiPool(socket, connections > 0 ? connections : DefaultConnections);
+}
+
+ModFastCGI::~ModFastCGI()
+{
+  delete pool_;
+}
+
+void ModFastCGI::dispose()
+{
+  delete this;
+}
+
+void ModFastCGI::registerHooks(bref::Pipeline & pipeline)
+{
+  if (! pool_)
+    return;
+
+  bref::Pipeline::ContentHook content(this, &ModFastCGI::contentHook);
+
+  pipeline.contentHooks.push_back(std::make_pair(content, ModFastCGI::ModulePriority));
+}
+
+/*
+  Variables CGI de la requête (RFC 3875), plus SCRIPT_FILENAME et
+  REQUEST_URI attendus par php-fpm. Les champs de l'en-tête sont
+  donnés en HTTP_*, sauf Proxy (httpoxy) et ceux qui ont déjà leur
+  variable.
+*/
+void ModFastCGI::buildParams(const bref::Environment & environment, const bref::HttpRequest & request,
+                             const std::string & root, const std::string & path, bref::Buffer & params) const
+{
+  const std::string &    uri   = request.getUri();
+  const std::size_t      query = uri.find('?');
+  char                   address[bref::IpAddress::MaxStringSize];
+  char                   port[bref::util::MaxDecimalSize];
+  const bref::Version &  version = request.getVersion();
+  const char             protocol[] = { 'H', 'T', 'T', 'P', '/',
+                                        static_cast<char>('0' + version.Major % 10), '.',
+                                        static_cast<char>('0' + version.Minor % 10) };
+
+  params.clear();
+  appendParam(params, "GATEWAY_INTERFACE", "CGI/1.1", 7);
+  appendParam(params, "SERVER_SOFTWARE", "bref", 4);
+  appendParam(params, "SERVER_PROTOCOL", protocol, sizeof protocol);
+  appendParam(params, "REQUEST_METHOD", bref::AccessRecord::methodName(request.getMethod()),
+              std::strlen(bref::AccessRecord::methodName(request.getMethod())));
+  appendParam(params, "REQUEST_URI", uri);
+  appendParam(params, "SCRIPT_NAME", path.data() + root.size(), path.size() - root.size());
+  appendParam(params, "SCRIPT_FILENAME", path);
+  appendParam(params, "DOCUMENT_ROOT", root);
+  appendParam(params, "QUERY_STRING", query == std::string::npos ? "" : uri.c_str() + query + 1,
+              query == std::string::npos ? 0 : uri.size() - query - 1);
+  appendParam(params, "REMOTE_ADDR", address, environment.client.Ip.toChars(address));
+  appendParam(params, "REMOTE_PORT", port,
+              bref::util::formatUnsigned(static_cast<unsigned short>(environment.client.Port), port));
+
+  for (bref::HttpHeader::const_iterator it = request.begin(); it != request.end(); ++it)
+    {
+      const bref::header_fields::Type field = request.field(it);
+
+      if (field == bref::header_fields::ContentLength)
+        appendParam(params, "CONTENT_LENGTH", it->second);
+      else if (field == bref::header_fields::ContentType)
+        appendParam(params, "CONTENT_TYPE", it->second);
+      else if (field == bref::header_fields::Host)
+        {
+          const std::string & host  = it->second.asString();
+          std::size_t         colon = host.rfind(':');
+
+          if (colon == std::string::npos || host.find(']', colon) != std::string::npos)
+            colon = host.size();
+          appendParam(params, "SERVER_NAME", host.data(), colon);
+          appendParam(params, "SERVER_PORT", colon < host.size() ? host.c_str() + colon + 1 : "80",
+                      colon < host.size() ? host.size() - colon - 1 : 2);
+        }
+      if (field == bref::header_fields::ContentLength || field == bref::header_fields::ContentType
+          || (it->first.size() == 5 && bref::util::icaseEqual(it->first.data(), "Proxy", 5)))
+        continue;
+
+      variable.assign("HTTP_");
+      for (std::string::const_iterator c = it->first.begin(); c != it->first.end(); ++c)
+        variable.push_back(*c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(*c))));
+      appendParam(params, variable.c_str(), it->second);
+    }
+}
+
+/*
+  Les requêtes dont le chemin se termine par l'extension des scripts
+  sont données au worker. Une connexion réutilisée peut avoir été
+  fermée par le worker depuis la requête précédente (redémarrage,
+  limite de requêtes) : l'envoi échoue et une autre connexion est
+  essayée.
+*/
+bref::Pipeline::IContentRequestHandler *
+ModFastCGI::contentHook(const bref::Environment & environment,
+                        const bref::HttpRequest & request,
+                        bref::HttpResponse &      response,
+                        bref::FdType &            fd)
+{
+  const std::string & root     = environment.serverConfigHelper.findValue(rootKey_, request).asString();
+  std::size_t         rootSize = root.size();
+
+  if (root.empty())
+    return 0;
+  if (! static_file::decodePath(request.getUri(), requestPath))
+    {
+      response.setStatus(bref::status_codes::BadRequest);
+      return 0;
+    }
+  if (requestPath.size() < extension_.size()
+      || requestPath.compare(requestPath.size() - extension_.size(), extension_.size(), extension_) != 0)
+    return 0;
+  while (rootSize && root[rootSize - 1] == '/')
+    --rootSize;
+  requestPath.insert(0, root, 0, rootSize);
+
+  const std::string documentRoot(root, 0, rootSize);
+  const bool        withBody = hasBody(request);
+  bool              reused   = true;
+  std::string       error;
+
+  while (reused)
+    {
+      FastCgiConnection *connection = pool_->acquire(reused, error);
+
+      if (! connection)
+        break;
+      buildParams(environment, request, documentRoot, requestPath, connection->params());
+      if (connection->start(environment.logger, withBody))
+        {
+          fd = connection->fd();
+          return connection;
+        }
+      error = std::strerror(errno);
+      delete connection;
+    }
+
+  LOG_ERROR(environment.logger) << "mod_fastcgi: " << pool_->path() << ": " << error;
+  response.setVersion(bref::Version(1, 1));
+  response.setStatus(bref::status_codes::BadGateway);
+  response.setReason("Bad Gateway");
+  return &badGateway;
+}
@@ -0,0 +1,56 @@
+/**
+ * \file   ModFastCGI.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 22 10:31:07 2012
+ *
+ * \brief  ModFastCGI class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODFASTCGI_MODFASTCGI_H_
+#define BREF_API_EXAMPLES_MODFASTCGI_MODFASTCGI_H_
+
+#include "bref/AModule.h"
+#include "bref/IConfHelper.h"
+#include "bref/ILogger.h"
+
+#include "FastCgiConnection.h"
+
+#include <string>
+
+/*
+  Scripts exécutés par un worker FastCGI (php-fpm, ...) joint par une
+  socket Unix, sur les contentHooks.
+
+  Contrairement à ModCGI, aucun processus n'est créé par requête : les
+  connexions au worker sont persistantes et gardées dans un
+  FastCgiPool. Le corps de la requête est envoyé en records Stdin par
+  inContent() et la réponse lue par outContent(), sans jamais attendre
+  le worker : le serveur surveille le fd de la connexion.
+*/
+class ModFastCGI : public bref::AModule
+{
+private:
+  static const float       ModulePriority;
+
+  bref::ILogger           *logger_;
+  bref::KeyHandle          rootKey_;
+  std::string              extension_;
+  FastCgiPool             *pool_;
+
+  void buildParams(const bref::Environment & environment, const bref::HttpRequest & request,
+                   const std::string & root, const std::string & path, bref::Buffer & params) const;
+
+public:
+  ModFastCGI(bref::ILogger *logger, const bref::IConfHelper & confHelper);
+  virtual ~ModFastCGI();
+  virtual void dispose();
+  virtual void registerHooks(bref::Pipeline & pipeline);
+
+  bref::Pipeline::IContentRequestHandler *contentHook(const bref::Environment & environment,
+                                                      const bref::HttpRequest & request,
+                                                      bref::HttpResponse &      response,
+                                                      bref::FdType &            fd);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODFASTCGI_MODFASTCGI_H_ */
@@ -0,0 +1,299 @@
+/**
+ * \file   ModFastCGITest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 23 15:40:02 2012
+ *
+ * \brief  ModFastCGI test against the stand-in responder.
+ *
+ */
+
+/*
+  Lance fastcgi-responder et appelle le module comme le fait
+  bref-epoll-host : le corps est donné à inContent() sans attendre,
+  puis outContent() est appelé quand le fd du handler est prêt.
+
+    fastcgi-test <fastcgi-responder> <socket>
+
+  Un appel qui attendrait le worker dans inContent() ou outContent()
+  ferait échouer le test : le fd n'est attendu que TestTimeout
+  millisecondes.
+*/
+
+#include "ModFastCGI.h"
+
+#include "bref/AsyncLogger.h"
+#include "bref/ConfigSnapshot.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const int         TestTimeout = 5000;           // millisecondes
+const std::size_t ChunkSize   = 16 * 1024;      // morceaux du corps donnés à inContent()
+const std::size_t LargeSize   = 8 * 1024 * 1024;
+
+int failures = 0;
+
+#define CHECK(condition)                                                \
+  do                                                                    \
+    {                                                                   \
+      if (! (condition))                                                \
+        {                                                               \
+          std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+          ++failures;                                                   \
+        }                                                               \
+    }                                                                   \
+  while (0)
+
+/*
+  Le worker, démarré et arrêté par le test.
+*/
+class Worker
+{
+private:
+  const char *program_;
+  const char *socket_;
+  pid_t       pid_;
+
+public:
+  Worker(const char *program, const char *socket)
+    : program_(program)
+    , socket_(socket)
+    , pid_(-1)
+  { }
+
+  ~Worker()
+  {
+    stop();
+  }
+
+  bool start()
+  {
+    pid_ = ::fork();
+    if (pid_ == 0)
+      {
+        ::execl(program_, program_, socket_, static_cast<char *>(0));
+        std::perror(program_);
+        ::_exit(127);
+      }
+    if (pid_ == -1)
+      return false;
+
+    // attend que la socket accepte les connexions
+    sockaddr_un address;
+
+    std::memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_, sizeof address.sun_path - 1);
+    for (int i = 0; i < TestTimeout / 10; ++i)
+      {
+        const int fd        = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        const int connected = ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address);
+
+        ::close(fd);
+        if (connected == 0)
+          return true;
+        ::usleep(10 * 1000);
+      }
+    return false;
+  }
+
+  void stop()
+  {
+    if (pid_ <= 0)
+      return;
+    ::kill(pid_, SIGTERM);
+    ::waitpid(pid_, 0, 0);
+    pid_ = -1;
+  }
+};
+
+struct Exchange
+{
+  bref::HttpResponse response;
+  std::string        body;
+  bool               completed;
+};
+
+/*
+  Une requête, servie comme par un serveur.
+*/
+void run(bref::Pipeline::ContentHook & hook, const bref::Environment & environment,
+         const char *uri, const std::string & body, Exchange & exchange)
+{
+  bref::HttpRequest request;
+  bref::FdType      fd = -1;
+  bref::Buffer      chunk;
+
+  request.setMethod(body.empty() ? bref::request_methods::Get : bref::request_methods::Post);
+  request.setUri(uri);
+  request.setVersion(bref::Version(1, 1));
+  if (! body.empty())
+    request[bref::header_fields::ContentLength] = bref::BrefValue(std::to_string(body.size()));
+  exchange.response  = bref::HttpResponse();
+  exchange.completed = false;
+  exchange.body.clear();
+
+  bref::Pipeline::IContentRequestHandler *handler = hook(environment, request, exchange.response, fd);
+
+  if (! handler)
+    return;
+
+  bool inFinished = false;
+
+  for (std::size_t offset = 0; offset < body.size() && ! inFinished; offset += ChunkSize)
+    {
+      chunk.assign(body.begin() + offset, body.begin() + std::min(body.size(), offset + ChunkSize));
+      inFinished = handler->inContent(exchange.response, chunk);
+    }
+  if (! inFinished)
+    {
+      chunk.clear();
+      handler->inContent(exchange.response, chunk);
+    }
+
+  for (;;)
+    {
+      pollfd ready = { fd, POLLIN, 0 };
+
+      if (fd != -1 && ::poll(&ready, 1, TestTimeout) != 1)
+        {
+          std::fprintf(stderr, "%s: no event from the handler\n", uri);
+          break;
+        }
+      chunk.clear();
+
+      const bool finished = handler->outContent(exchange.response, chunk);
+
+      exchange.body.append(chunk.begin(), chunk.end());
+      if (finished)
+        {
+          exchange.completed = true;
+          break;
+        }
+    }
+  handler->dispose();
+}
+
+std::string field(const bref::HttpResponse & response, const char *name)
+{
+  const bref::HttpHeader::const_iterator it = response.find(name);
+
+  return it == response.end() ? "" : it->second.asString();
+}
+
+bool endsWith(const std::string & text, const std::string & end)
+{
+  return text.size() >= end.size() && text.compare(text.size() - end.size(), end.size(), end) == 0;
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc != 3)
+    {
+      std::fprintf(stderr, "usage: %s fastcgi-responder socket\n", argv[0]);
+      return 2;
+    }
+  ::signal(SIGPIPE, SIG_IGN);
+
+  Worker worker(argv[1], argv[2]);
+
+  if (! worker.start())
+    {
+      std::fprintf(stderr, "%s: the responder does not accept connections\n", argv[2]);
+      return 1;
+    }
+
+  bref::BrefValue config = bref::BrefValue(bref::BrefValueArray());
+
+  config["DocumentRoot"]       = bref::BrefValue(std::string("/var/www"));
+  config["FastCGISocket"]      = bref::BrefValue(std::string(argv[2]));
+  config["FastCGIConnections"] = bref::BrefValue(4);
+
+  const bref::ConfigHolder::Pin snapshot = bref::ConfigSnapshot::create(config);
+  bref::AsyncLogger             logger(bref::AsyncLogger::FdWriter(2), bref::AsyncLogger::Options(),
+                                       bref::ILogger::Info);
+  const bref::Environment::Client client = { bref::IpAddress("127.0.0.1"), 4242, -1 };
+  const bref::Environment       environment(snapshot->config, snapshot->helper, &logger, client);
+  ModFastCGI                    module(&logger, snapshot->helper);
+  bref::Pipeline                pipeline;
+  Exchange                      exchange;
+  std::string                   large(LargeSize, 0);
+
+  for (std::size_t i = 0; i < large.size(); ++i)
+    large[i] = static_cast<char>('a' + i % 26);
+  module.registerHooks(pipeline);
+  CHECK(pipeline.contentHooks.size() == 1);
+  if (pipeline.contentHooks.empty())
+    return 1;
+
+  bref::Pipeline::ContentHook & hook = pipeline.contentHooks.front().first;
+
+  // GET, deux fois : la seconde requête reprend la connexion gardée
+  for (int i = 0; i < 2; ++i)
+    {
+      run(hook, environment, "/hello.php", "", exchange);
+      CHECK(exchange.completed);
+      CHECK(exchange.response.getStatus() == bref::status_codes::OK);
+      CHECK(exchange.body == "hello world\n");
+    }
+
+  // un fichier qui n'est pas un script est laissé aux autres modules
+  bref::HttpRequest  request;
+  bref::HttpResponse response;
+  bref::FdType       fd = -1;
+
+  request.setUri("/index.html");
+  CHECK(hook(environment, request, response, fd) == 0);
+
+  // POST plus grand que les buffers des sockets, renvoyé par le worker
+  run(hook, environment, "/echo.php?a=1", large, exchange);
+  CHECK(exchange.completed);
+  CHECK(exchange.response.getStatus() == bref::status_codes::OK);
+  CHECK(field(exchange.response, "X-Body-Size") == std::to_string(LargeSize));
+  CHECK(exchange.body.find("QUERY_STRING=a=1\n") != std::string::npos);
+  CHECK(exchange.body.find("REQUEST_METHOD=POST\n") != std::string::npos);
+  CHECK(endsWith(exchange.body, "--\n" + large));
+
+  // le worker répond avant de lire le corps : la réponse doit être lue
+  // pendant l'envoi de Stdin
+  run(hook, environment, "/early.php", large, exchange);
+  CHECK(exchange.completed);
+  CHECK(exchange.response.getStatus() == bref::status_codes::OK);
+  CHECK(endsWith(exchange.body, "\nX-Body-Size: " + std::to_string(LargeSize)));
+
+  run(hook, environment, "/crash.php", "", exchange);
+  CHECK(exchange.completed);
+  CHECK(exchange.response.getStatus() == bref::status_codes::BadGateway);
+
+  // redémarrage du worker : les connexions gardées sont fermées, la
+  // requête suivante passe sur une nouvelle connexion
+  run(hook, environment, "/hello.php", "", exchange);
+  worker.stop();
+  CHECK(worker.start());
+  run(hook, environment, "/hello.php", "", exchange);
+  CHECK(exchange.completed);
+  CHECK(exchange.response.getStatus() == bref::status_codes::OK);
+  CHECK(exchange.body == "hello world\n");
+
+  // worker arrêté : 502
+  worker.stop();
+  run(hook, environment, "/hello.php", "", exchange);
+  CHECK(exchange.response.getStatus() == bref::status_codes::BadGateway);
+
+  logger.flush();
+  if (failures)
+    std::fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
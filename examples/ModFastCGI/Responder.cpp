@@ -0,0 +1,271 @@
+/**
+ * \file   Responder.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 23 14:12:45 2012
+ *
+ * \brief  Stand-in FastCGI responder used by the ModFastCGI test.
+ *
+ */
+
+/*
+  Worker FastCGI de test, à la place de php-fpm : un thread par
+  connexion, une requête à la fois, FCGI_KEEP_CONN respecté.
+
+    fastcgi-responder <socket> [requêtes par connexion]
+
+  Scripts servis (SCRIPT_NAME) :
+
+  - /hello.php   "hello world"
+  - /echo.php    les variables puis le corps reçus, X-Body-Size donne
+                 la taille du corps
+  - /early.php   EarlySize octets écrits avant de lire le corps, puis
+                 X-Body-Size en fin de réponse
+  - /crash.php   ferme la connexion sans répondre
+  - autre        500
+*/
+
+#include "FastCgi.h"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::size_t EarlySize = 4 * 1024 * 1024;
+
+bool readAll(int fd, char *data, std::size_t size)
+{
+  while (size)
+    {
+      const ssize_t count = ::read(fd, data, size);
+
+      if (count <= 0)
+        return false;
+      data += count;
+      size -= count;
+    }
+  return true;
+}
+
+bool writeAll(int fd, const std::string & data)
+{
+  std::size_t offset = 0;
+
+  while (offset < data.size())
+    {
+      const ssize_t count = ::send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+
+      if (count <= 0)
+        return false;
+      offset += count;
+    }
+  return true;
+}
+
+struct Record
+{
+  int               type;
+  unsigned char     flags;      // flags de BeginRequest
+  std::vector<char> content;
+};
+
+bool readRecord(int fd, Record & record)
+{
+  unsigned char header[fastcgi::HeaderSize];
+
+  if (! readAll(fd, reinterpret_cast<char *>(header), sizeof header))
+    return false;
+  record.type = header[1];
+  record.content.resize(((header[4] << 8) | header[5]) + header[6]);
+  if (! record.content.empty() && ! readAll(fd, &record.content[0], record.content.size()))
+    return false;
+  record.content.resize((header[4] << 8) | header[5]);
+  record.flags = record.type == fastcgi::BeginRequest && record.content.size() > 2 ? record.content[2] : 0;
+  return true;
+}
+
+void appendRecord(std::string & out, fastcgi::RecordType type, const char *data, std::size_t size)
+{
+  std::size_t offset = 0;
+
+  do
+    {
+      const std::size_t length = std::min(size - offset, fastcgi::MaxContentSize);
+      unsigned char     header[fastcgi::HeaderSize];
+
+      fastcgi::writeHeader(header, type, 1, length, 0);
+      out.append(reinterpret_cast<char *>(header), sizeof header);
+      out.append(data + offset, length);
+      offset += length;
+    }
+  while (offset < size);
+}
+
+std::size_t pairLength(const std::string & params, std::size_t & i)
+{
+  const unsigned char first = static_cast<unsigned char>(params[i]);
+
+  if (first < 128)
+    {
+      ++i;
+      return first;
+    }
+
+  const std::size_t length = ((first & 0x7f) << 24) | (static_cast<unsigned char>(params[i + 1]) << 16)
+    | (static_cast<unsigned char>(params[i + 2]) << 8) | static_cast<unsigned char>(params[i + 3]);
+
+  i += 4;
+  return length;
+}
+
+/*
+  Lit les records Stdin jusqu'au record vide.
+*/
+bool readStdin(int fd, std::string & body)
+{
+  Record record;
+
+  while (readRecord(fd, record))
+    {
+      if (record.type != fastcgi::Stdin)
+        continue;
+      if (record.content.empty())
+        return true;
+      body.append(&record.content[0], record.content.size());
+    }
+  return false;
+}
+
+bool serveRequest(int fd, int & served, int maxRequests)
+{
+  Record      record;
+  bool        keep      = false;
+  bool        paramsEnd = false;
+  std::string params;
+  std::string script;
+  std::string variables;
+
+  while (! paramsEnd)
+    {
+      if (! readRecord(fd, record))
+        return false;
+      if (record.type == fastcgi::BeginRequest)
+        keep = record.flags & fastcgi::KeepConnection;
+      else if (record.type == fastcgi::Params)
+        {
+          if (record.content.empty())
+            paramsEnd = true;
+          else
+            params.append(&record.content[0], record.content.size());
+        }
+    }
+
+  for (std::size_t i = 0; i < params.size(); )
+    {
+      const std::size_t nameSize  = pairLength(params, i);
+      const std::size_t valueSize = pairLength(params, i);
+      const std::string name(params, i, nameSize);
+      const std::string value(params, i + nameSize, valueSize);
+
+      i += nameSize + valueSize;
+      variables += name + "=" + value + "\n";
+      if (name == "SCRIPT_NAME")
+        script = value;
+    }
+
+  std::string body;
+  std::string output;
+
+  if (script == "/crash.php")
+    return false;
+  if (script == "/early.php")
+    {
+      // la réponse part avant la lecture du corps : le serveur doit la
+      // lire pendant qu'il envoie Stdin
+      output = "Content-Type: application/octet-stream\r\n\r\n" + std::string(EarlySize, 'e');
+
+      std::string out;
+
+      appendRecord(out, fastcgi::Stdout, output.data(), output.size());
+      if (! writeAll(fd, out) || ! readStdin(fd, body))
+        return false;
+      output = "\nX-Body-Size: " + std::to_string(body.size());
+    }
+  else
+    {
+      if (! readStdin(fd, body))
+        return false;
+      if (script == "/hello.php")
+        output = "Content-Type: text/plain\r\n\r\nhello world\n";
+      else if (script == "/echo.php")
+        output = std::string("Content-Type: text/plain\r\nX-Body-Size: ") + std::to_string(body.size()) + "\r\n\r\n"
+          + variables + "--\n" + body;
+      else
+        output = "Status: 500 Unknown Script\r\n\r\n" + script + "\n";
+    }
+
+  std::string         out;
+  const unsigned char end[8] = { 0, 0, 0, 0, fastcgi::RequestComplete, 0, 0, 0 };
+
+  appendRecord(out, fastcgi::Stdout, output.data(), output.size());
+  appendRecord(out, fastcgi::Stdout, 0, 0);
+  appendRecord(out, fastcgi::EndRequest, reinterpret_cast<const char *>(end), sizeof end);
+  if (! writeAll(fd, out))
+    return false;
+  ++served;
+  return keep && (! maxRequests || served < maxRequests);
+}
+
+void serve(int fd, int maxRequests)
+{
+  int served = 0;
+
+  while (serveRequest(fd, served, maxRequests))
+    continue;
+  ::close(fd);
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      std::fprintf(stderr, "usage: %s socket [requests per connection]\n", argv[0]);
+      return 2;
+    }
+
+  const int   maxRequests = argc > 2 ? std::atoi(argv[2]) : 0;
+  sockaddr_un address;
+  const int   listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  std::memset(&address, 0, sizeof address);
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, argv[1], sizeof address.sun_path - 1);
+  ::unlink(argv[1]);
+  ::signal(SIGPIPE, SIG_IGN);
+  if (listener == -1
+      || ::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof address) == -1
+      || ::listen(listener, 128) == -1)
+    {
+      std::perror(argv[1]);
+      return 1;
+    }
+  for (;;)
+    {
+      const int connection = ::accept4(listener, 0, 0, SOCK_CLOEXEC);
+
+      if (connection != -1)
+        std::thread(serve, connection, maxRequests).detach();
+    }
+}
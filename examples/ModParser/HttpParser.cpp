@@ -0,0 +1,346 @@
+/**
+ * \file   HttpParser.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May  5 14:21:09 2012
+ *
+ * \brief  HttpParser class definition.
+ *
+ */
+
+#include "HttpParser.h"
+#include "bref/detail/util/ICaseStringCmp.hpp"
+
+#include <stdint.h>
+
+#include <cstring>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define MOD_PARSER_SSE2 1
+# include <emmintrin.h>
+#endif
+
+namespace {
+
+/*
+  Recherche de l'octet \p c dans [begin, end), 16 octets à la fois avec
+  SSE2. Retourne end si l'octet n'est pas trouvé.
+*/
+const char *findByte(const char *begin, const char *end, char c)
+{
+#ifdef MOD_PARSER_SSE2
+  const __m128i needle = _mm_set1_epi8(c);
+
+  for (; begin + 16 <= end; begin += 16)
+    {
+      const __m128i  bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+      const uint32_t mask  = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle)));
+
+      if (mask)
+        return begin + bref::util::detail::firstBitSet(mask);
+    }
+#endif  // MOD_PARSER_SSE2
+  for (; begin != end; ++begin)
+    if (*begin == c)
+      return begin;
+  return end;
+}
+
+bool isWhitespace(char c)
+{
+  return c == ' ' || c == '\t';
+}
+
+bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+/*
+  Les méthodes sont sensibles à la casse (RFC2616, section 5.1.1).
+*/
+bref::request_methods::Type methodFromName(const char *name, std::size_t size)
+{
+  struct Method
+  {
+    const char                  *name;
+    std::size_t                  size;
+    bref::request_methods::Type  type;
+  };
+
+  static const Method methods[] = {
+    { "GET",     3, bref::request_methods::Get },
+    { "POST",    4, bref::request_methods::Post },
+    { "HEAD",    4, bref::request_methods::Head },
+    { "PUT",     3, bref::request_methods::Put },
+    { "DELETE",  6, bref::request_methods::Delete },
+    { "OPTIONS", 7, bref::request_methods::Options },
+    { "TRACE",   5, bref::request_methods::Trace },
+    { "CONNECT", 7, bref::request_methods::Connect }
+  };
+
+  for (std::size_t i = 0; i < sizeof methods / sizeof *methods; ++i)
+    if (methods[i].size == size && ! std::memcmp(methods[i].name, name, size))
+      return methods[i].type;
+  return bref::request_methods::UndefinedRequestMethod;
+}
+
+/*
+  tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+          "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+  (RFC7230, section 3.2.6), les octets >= 128 n'en sont pas.
+*/
+const unsigned char TokenChars[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0
+};
+
+/*
+  Sans sortie anticipée : les noms sont courts et presque toujours
+  valides, la boucle n'a pas de branche à prédire.
+*/
+bool isToken(const char *begin, const char *end)
+{
+  unsigned char valid = 1;
+
+  for (; begin != end; ++begin)
+    valid &= TokenChars[static_cast<unsigned char>(*begin)];
+  return valid;
+}
+
+/*
+  Recherche du premier caractère de contrôle autre que HTAB dans
+  [begin, end), 16 octets à la fois avec SSE2 : la fin de la ligne, ou
+  un octet interdit dans l'en-tête (RFC7230, section 3.2, un '\r'
+  isolé ne doit pas passer dans une valeur). Retourne end si aucun
+  n'est trouvé.
+*/
+const char *findControl(const char *begin, const char *end)
+{
+#ifdef MOD_PARSER_SSE2
+  const __m128i below = _mm_set1_epi8(0x1f);
+  const __m128i tab   = _mm_set1_epi8('\t');
+  const __m128i del   = _mm_set1_epi8(0x7f);
+
+  for (; begin + 16 <= end; begin += 16)
+    {
+      const __m128i  bytes   = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+      // c <= 0x1f en non signé : min(c, 0x1f) == c
+      const __m128i  control = _mm_cmpeq_epi8(_mm_min_epu8(bytes, below), bytes);
+      const __m128i  found   = _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(bytes, tab), control),
+                                            _mm_cmpeq_epi8(bytes, del));
+      const uint32_t mask    = static_cast<uint32_t>(_mm_movemask_epi8(found));
+
+      if (mask)
+        return begin + bref::util::detail::firstBitSet(mask);
+    }
+#endif  // MOD_PARSER_SSE2
+  for (; begin != end; ++begin)
+    {
+      const unsigned char c = static_cast<unsigned char>(*begin);
+
+      if ((c < 0x20 && c != '\t') || c == 0x7f)
+        return begin;
+    }
+  return end;
+}
+
+} // ! unnamed namespace
+
+HttpParser::HttpParser()
+{
+  reset();
+}
+
+void HttpParser::reset()
+{
+  state_      = RequestLine;
+  lineBegin_  = 0;
+  scanned_    = 0;
+  method_     = bref::request_methods::UndefinedRequestMethod;
+  uri_.begin  = 0;
+  uri_.size   = 0;
+  version_    = bref::Version();
+  fieldCount_ = 0;
+  error_      = bref::status_codes::UndefinedStatusCode;
+}
+
+HttpParser::Result HttpParser::fail(bref::status_codes::Type status)
+{
+  error_ = status;
+  return Error;
+}
+
+HttpParser::Result HttpParser::parse(const char *data, std::size_t size)
+{
+  if (error_ != bref::status_codes::UndefinedStatusCode)
+    return Error;
+
+  // Le buffer est plus petit que lors du dernier appel, ce n'est plus
+  // la même requête.
+  if (size < scanned_)
+    reset();
+
+  for (;;)
+    {
+      const char *end     = data + size;
+      const char *newline = findControl(data + scanned_, end);
+
+      // Seuls "\r\n" et '\n' terminent une ligne, un autre caractère
+      // de contrôle est refusé. Un '\r' en fin de buffer attend l'octet
+      // suivant.
+      if (newline != end && *newline == '\r' && newline + 1 != end && newline[1] == '\n')
+        ++newline;
+      else if (newline != end && *newline != '\n' && (*newline != '\r' || newline + 1 != end))
+        return fail(bref::status_codes::BadRequest);
+
+      if (newline == end || *newline == '\r')
+        {
+          scanned_ = newline - data;
+          if (size > MaxHeaderSize)
+            return fail(state_ == RequestLine
+                        ? bref::status_codes::RequestURITooLarge
+                        : bref::status_codes::RequestEntityTooLarge);
+          return Incomplete;
+        }
+
+      // La ligne courante est [lineBegin_, lineEnd), sans le "\r\n".
+      std::size_t lineEnd = newline - data;
+
+      scanned_ = lineEnd + 1;
+      if (lineEnd > lineBegin_ && data[lineEnd - 1] == '\r')
+        --lineEnd;
+
+      Result result = Incomplete;
+
+      if (state_ == RequestLine)
+        {
+          // Les lignes vides avant la requête sont ignorées
+          // (RFC2616, section 4.1).
+          if (lineEnd != lineBegin_)
+            result = parseRequestLine(data, lineBegin_, lineEnd);
+        }
+      else if (lineEnd == lineBegin_)
+        return Complete;
+      else
+        result = parseHeaderLine(data, lineBegin_, lineEnd);
+
+      if (result == Error)
+        return Error;
+      if (scanned_ > MaxHeaderSize)
+        return fail(bref::status_codes::RequestEntityTooLarge);
+      lineBegin_ = scanned_;
+    }
+}
+
+/*
+  Request-Line = Method SP Request-URI SP HTTP-Version CRLF
+*/
+HttpParser::Result HttpParser::parseRequestLine(const char *data, std::size_t begin, std::size_t end)
+{
+  const char *line       = data + begin;
+  const char *lineEnd    = data + end;
+  const char *methodEnd  = findByte(line, lineEnd, ' ');
+
+  if (methodEnd == lineEnd)
+    return fail(bref::status_codes::BadRequest);
+
+  const char *uri    = methodEnd + 1;
+  const char *uriEnd = findByte(uri, lineEnd, ' ');
+
+  if (uriEnd == lineEnd || uriEnd == uri)
+    return fail(bref::status_codes::BadRequest);
+
+  const char *version = uriEnd + 1;
+
+  if (lineEnd - version != 8 || std::memcmp(version, "HTTP/", 5) ||
+      ! isDigit(version[5]) || version[6] != '.' || ! isDigit(version[7]))
+    return fail(bref::status_codes::BadRequest);
+
+  version_ = bref::Version(version[5] - '0', version[7] - '0');
+  if (version_.Major != 1)
+    return fail(bref::status_codes::HTTPVersionNotSupported);
+
+  method_ = methodFromName(line, methodEnd - line);
+  if (method_ == bref::request_methods::UndefinedRequestMethod)
+    return fail(bref::status_codes::NotImplemented);
+
+  uri_.begin = uri - data;
+  uri_.size  = uriEnd - uri;
+  state_     = HeaderLines;
+  return Incomplete;
+}
+
+/*
+  message-header = field-name ":" [ field-value ]
+*/
+HttpParser::Result HttpParser::parseHeaderLine(const char *data, std::size_t begin, std::size_t end)
+{
+  const char *line    = data + begin;
+  const char *lineEnd = data + end;
+
+  // Les en-têtes sur plusieurs lignes ne sont pas supportés, un
+  // serveur peut les refuser (RFC7230, section 3.2.4).
+  if (isWhitespace(*line))
+    return fail(bref::status_codes::BadRequest);
+
+  const char *colon = findByte(line, lineEnd, ':');
+
+  // field-name = token, sans espace avant le ':' (RFC7230, section
+  // 3.2.4)
+  if (colon == lineEnd || colon == line || ! isToken(line, colon))
+    return fail(bref::status_codes::BadRequest);
+
+  if (fieldCount_ == MaxHeaderFields)
+    return fail(bref::status_codes::RequestEntityTooLarge);
+
+  const char *value    = colon + 1;
+  const char *valueEnd = lineEnd;
+
+  while (value != valueEnd && isWhitespace(*value))
+    ++value;
+  while (valueEnd != value && isWhitespace(valueEnd[-1]))
+    --valueEnd;
+
+  Field & field = fields_[fieldCount_++];
+
+  field.name.begin  = begin;
+  field.name.size   = colon - line;
+  field.value.begin = value - data;
+  field.value.size  = valueEnd - value;
+  return Incomplete;
+}
+
+void HttpParser::fill(const char *data, bref::HttpRequest & request) const
+{
+  request.setMethod(method_);
+  request.setUri(std::string(data + uri_.begin, uri_.size));
+  request.setVersion(version_);
+  request.reserve(request.size() + fieldCount_);
+
+  // Les champs présents plusieurs fois sont fusionnés par add(), les
+  // noms et valeurs sont copiés dans les champs gardés par clear() :
+  // pas de chaîne temporaire par champ.
+  for (std::size_t i = 0; i < fieldCount_; ++i)
+    {
+      const Field & field = fields_[i];
+
+      request.add(data + field.name.begin, field.name.size, data + field.value.begin, field.value.size);
+    }
+}
+
+std::size_t HttpParser::consumed() const
+{
+  return scanned_;
+}
+
+bref::status_codes::Type HttpParser::error() const
+{
+  return error_;
+}
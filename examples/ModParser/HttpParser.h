@@ -0,0 +1,108 @@
+/**
+ * \file   HttpParser.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May  5 14:21:09 2012
+ *
+ * \brief  HttpParser class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODPARSER_HTTPPARSER_H_
+#define BREF_API_EXAMPLES_MODPARSER_HTTPPARSER_H_
+
+#include "bref/HttpConstants.h"
+#include "bref/HttpRequest.h"
+#include "bref/Version.h"
+
+#include <cstddef>
+
+/*
+  Parser incrémental d'en-tête de requête HTTP/1.1.
+
+  Le parser est appelé avec les données reçues depuis le début de la
+  requête, à chaque nouvel appel le buffer contient les mêmes données
+  suivies des nouvelles. L'analyse reprend à la position atteinte lors
+  de l'appel précédent.
+
+  Aucune allocation n'est faite pendant l'analyse, les éléments de la
+  requête sont mémorisés sous forme d'offsets dans le buffer. La
+  HttpRequest est remplie avec fill() une fois l'en-tête complet.
+*/
+class HttpParser
+{
+public:
+  enum Result
+    {
+      Incomplete,
+      Complete,
+      Error
+    };
+
+  static const std::size_t MaxHeaderFields = 64;
+  static const std::size_t MaxHeaderSize   = 16 * 1024;
+
+private:
+  enum State
+    {
+      RequestLine,
+      HeaderLines
+    };
+
+  struct Span
+  {
+    std::size_t begin;
+    std::size_t size;
+  };
+
+  struct Field
+  {
+    Span name;
+    Span value;
+  };
+
+  State                         state_;
+  std::size_t                   lineBegin_;
+  std::size_t                   scanned_;
+  bref::request_methods::Type   method_;
+  Span                          uri_;
+  bref::Version                 version_;
+  Field                         fields_[MaxHeaderFields];
+  std::size_t                   fieldCount_;
+  bref::status_codes::Type      error_;
+
+  Result fail(bref::status_codes::Type status);
+  Result parseRequestLine(const char *data, std::size_t begin, std::size_t end);
+  Result parseHeaderLine(const char *data, std::size_t begin, std::size_t end);
+
+public:
+  HttpParser();
+
+  /*
+    Prépare le parser pour une nouvelle requête.
+  */
+  void reset();
+
+  /*
+    Analyse les \p size premiers octets de \p data.
+
+    Retourne Incomplete tant que la ligne vide terminant l'en-tête n'a
+    pas été reçue. En cas d'Error, error() contient le code de statut à
+    retourner au client.
+  */
+  Result parse(const char *data, std::size_t size);
+
+  /*
+    Remplit \p request avec l'en-tête analysé, \p data doit être le
+    buffer donné au dernier appel de parse() qui a retourné Complete.
+  */
+  void fill(const char *data, bref::HttpRequest & request) const;
+
+  /*
+    Nombre d'octets de l'en-tête, ligne vide incluse.
+  */
+  std::size_t consumed() const;
+
+  bref::status_codes::Type error() const;
+};
+
+#endif /* !BREF_API_EXAMPLES_MODPARSER_HTTPPARSER_H_ */
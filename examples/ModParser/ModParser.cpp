@@ -0,0 +1,104 @@
+/**
+ * \file   ModParser.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May  5 14:18:42 2012
+ *
+ * \brief  ModParser definition.
+ *
+ */
+
+#include "ModParser.h"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/BrefDLL.h"
+
+#include <utility>
+
+const float       ModParser::ModulePriority = 0.5f;
+
+extern "C" BREF_DLL
+bref::AModule *loadModule(bref::ILogger *logger,
+                          const bref::ServerConfig &,
+                          const bref::IConfHelper &)
+{
+  LOG_INFO(logger) << "Load module mod_parser";
+  return new ModParser();
+}
+
+ModParser::ModParser()
+  : AModule("mod_parser", "Parser HTTP/1.1 incrémental.", bref::Version(0, 1), bref::Version(0, 4))
+{ }
+
+ModParser::~ModParser()
+{ }
+
+void ModParser::dispose()
+{
+  delete this;
+}
+
+/*
+  Le parser a besoin de conserver son état entre deux réceptions sur
+  la même connexion, les hooks sont donc enregistrés par session.
+*/
+bref::IDisposable *ModParser::registerSessionHooks(bref::Pipeline & pipeline)
+{
+  ModParserSession          *session = new ModParserSession();
+  bref::Pipeline::ParsingHook hook(session, &ModParserSession::parsingHook);
+
+  pipeline.parsingHooks.push_back(std::make_pair(hook, ModParser::ModulePriority));
+  return session;
+}
+
+ModParserSession::ModParserSession()
+  : parser_()
+{ }
+
+ModParserSession::~ModParserSession()
+{ }
+
+void ModParserSession::dispose()
+{
+  delete this;
+}
+
+bref::Pipeline::ParsingRequestHandler
+ModParserSession::parsingHook(const bref::Environment & /* environment */)
+{
+  return bref::Pipeline::ParsingRequestHandler(this, &ModParserSession::parse);
+}
+
+/*
+  Le serveur rappelle le handler avec le même buffer complété par les
+  nouvelles données, tant que buff.begin() est retourné.
+*/
+bref::Buffer::const_iterator ModParserSession::parse(bref::HttpResponse & response,
+                                                     const bref::Buffer & buff,
+                                                     bref::HttpRequest &  request)
+{
+  const char *data = buff.empty() ? 0 : &buff[0];
+
+  switch (parser_.parse(data, buff.size()))
+    {
+    case HttpParser::Incomplete:
+      return buff.begin();
+
+    case HttpParser::Complete:
+      {
+        const std::size_t consumed = parser_.consumed();
+
+        parser_.fill(data, request);
+        parser_.reset();
+        return buff.begin() + consumed;
+      }
+
+    case HttpParser::Error:
+      break;
+    }
+
+  // Requête invalide, la connexion ne peut plus être analysée : tout
+  // le buffer est consommé et le statut d'erreur est positionné.
+  response.setVersion(bref::Version(1, 1));
+  response.setStatus(parser_.error());
+  parser_.reset();
+  return buff.end();
+}
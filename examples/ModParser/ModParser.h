@@ -0,0 +1,50 @@
+/**
+ * \file   ModParser.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May  5 14:18:42 2012
+ *
+ * \brief  ModParser class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODPARSER_MODPARSER_H_
+#define BREF_API_EXAMPLES_MODPARSER_MODPARSER_H_
+
+#include "bref/AModule.h"
+#include "bref/IDisposable.h"
+
+#include "HttpParser.h"
+
+class ModParser : public bref::AModule
+{
+private:
+  static const float       ModulePriority;
+
+public:
+  ModParser();
+  virtual ~ModParser();
+  virtual void dispose();
+  virtual bref::IDisposable *registerSessionHooks(bref::Pipeline & pipeline);
+};
+
+/*
+  Parser d'une connexion, l'état de l'analyse est conservé entre deux
+  réceptions.
+*/
+class ModParserSession : public bref::IDisposable
+{
+private:
+  HttpParser  parser_;
+
+public:
+  ModParserSession();
+  virtual ~ModParserSession();
+  virtual void dispose();
+
+  bref::Pipeline::ParsingRequestHandler parsingHook(const bref::Environment & environment);
+  bref::Buffer::const_iterator parse(bref::HttpResponse & response,
+                                     const bref::Buffer & buff,
+                                     bref::HttpRequest &  request);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODPARSER_MODPARSER_H_ */
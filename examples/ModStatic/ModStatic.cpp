@@ -0,0 +1,192 @@
+/**
+ * \file   ModStatic.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun May 20 10:14:08 2012
+ *
+ * \brief  ModStatic definition.
+ *
+ */
+
+#include "ModStatic.h"
+#include "StaticFile.h"
+#include "bref/detail/util/ContentLength.hpp"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/BrefDLL.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+const float       ModStatic::ModulePriority = 0.f; // Après les modules qui génèrent du contenu
+
+extern "C" BREF_DLL
+bref::AModule *loadModule(bref::ILogger *logger,
+                          const bref::ServerConfig &,
+                          const bref::IConfHelper & confHelper)
+{
+  LOG_INFO(logger) << "Load module mod_static";
+  return new ModStatic(logger, confHelper);
+}
+
+namespace {
+
+const std::size_t ReadSize = 64 * 1024; // octets par appel à outContent()
+
+} // ! unnamed namespace
+
+ModStatic::ModStatic(bref::ILogger *logger, const bref::IConfHelper & confHelper)
+  : AModule("mod_static", "Fichiers statiques, envoyés sans copie.", bref::Version(0, 1), bref::Version(0, 4))
+  , logger_(logger)
+  , rootKey_(confHelper.internKey("StaticRoot"))
+  , indexKey_(confHelper.internKey("StaticIndex"))
+{ }
+
+ModStatic::~ModStatic()
+{ }
+
+void ModStatic::dispose()
+{
+  delete this;
+}
+
+void ModStatic::registerHooks(bref::Pipeline & pipeline)
+{
+  bref::Pipeline::ContentHook content(this, &ModStatic::contentHook);
+
+  pipeline.contentHooks.push_back(std::make_pair(content, ModStatic::ModulePriority));
+}
+
+/*
+  Ouvre le fichier de la requête. Une requête qui ne désigne pas un
+  fichier régulier lisible est laissée aux autres modules (404 par
+  défaut), sauf un accès refusé (403) ou un chemin invalide (400).
+*/
+bref::Pipeline::IContentRequestHandler *
+ModStatic::contentHook(const bref::Environment & environment,
+                       const bref::HttpRequest & request,
+                       bref::HttpResponse &      response,
+                       bref::FdType &            /* fd */)
+{
+  const bref::request_methods::Type method = request.getMethod();
+
+  if (method != bref::request_methods::Get && method != bref::request_methods::Head)
+    return 0;
+
+  const std::string & root = environment.serverConfigHelper.findValue(rootKey_, request).asString();
+  std::string         path;
+
+  if (root.empty())
+    return 0;
+  if (! static_file::decodePath(request.getUri(), path))
+    {
+      response.setStatus(bref::status_codes::BadRequest);
+      return 0;
+    }
+  path.insert(0, root);
+
+  // O_NONBLOCK : l'ouverture d'une FIFO ne bloque pas le thread, elle
+  // est refusée par le fstat()
+  int         fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+  struct stat info;
+
+  if (fd != -1 && ::fstat(fd, &info) == 0 && S_ISDIR(info.st_mode))
+    {
+      const std::string & configIndex = environment.serverConfigHelper.findValue(indexKey_, request).asString();
+      const std::string   index       = configIndex.empty() ? "index.html" : configIndex;
+      const int           file        = ::openat(fd, index.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+
+      ::close(fd);
+      fd   = file;
+      path = index;
+    }
+  if (fd == -1)
+    {
+      if (errno == EACCES)
+        response.setStatus(bref::status_codes::Forbidden);
+      else if (errno != ENOENT && errno != ENOTDIR)
+        {
+          LOG_ERROR(environment.logger) << "mod_static: can't open " << path << ": " << std::strerror(errno);
+        }
+      return 0;
+    }
+  if (::fstat(fd, &info) != 0 || ! S_ISREG(info.st_mode))
+    {
+      ::close(fd);
+      return 0;
+    }
+
+  response.setVersion(bref::Version(1, 1));
+  response.setStatus(bref::status_codes::OK);
+  response.setReason("OK");
+  response[bref::header_fields::ContentType]   = bref::BrefValue(static_file::contentType(path));
+  response[bref::header_fields::ContentLength] = bref::util::lengthValue(info.st_size);
+  return new ModStaticRequestHandler(fd, info.st_size);
+}
+
+ModStaticRequestHandler::ModStaticRequestHandler(int fd, uint64_t size)
+  : fd_(fd)
+  , size_(size)
+  , offset_(0)
+{ }
+
+ModStaticRequestHandler::~ModStaticRequestHandler()
+{
+  ::close(fd_);
+}
+
+bool ModStaticRequestHandler::inContent(bref::HttpResponse & /* response */,
+                                        const bref::Buffer & /* inBuffer */)
+{
+  // le corps d'une requête GET n'est pas utilisé
+  return true;
+}
+
+/*
+  Pour un serveur qui n'appelle pas outFile() : le fichier est lu par
+  morceaux de ReadSize octets.
+*/
+bool ModStaticRequestHandler::outContent(bref::HttpResponse & /* response */,
+                                         bref::Buffer &       outBuffer)
+{
+  const std::size_t size = static_cast<std::size_t>(std::min<uint64_t>(size_ - offset_, ReadSize));
+
+  if (! size)
+    return true;
+  outBuffer.resize(size);
+
+  ssize_t count;
+
+  do
+    count = ::pread(fd_, &outBuffer[0], size, offset_);
+  while (count < 0 && errno == EINTR);
+
+  // un fichier raccourci pendant l'envoi termine le corps plus tôt
+  if (count <= 0)
+    {
+      outBuffer.clear();
+      return true;
+    }
+  outBuffer.resize(count);
+  offset_ += count;
+  return offset_ == size_;
+}
+
+bool ModStaticRequestHandler::outFile(bref::HttpResponse & /* response */,
+                                      bref::FileRange &    range)
+{
+  range.fd     = fd_;
+  range.offset = 0;
+  range.length = size_;
+  return true;
+}
+
+void ModStaticRequestHandler::dispose()
+{
+  delete this;
+}
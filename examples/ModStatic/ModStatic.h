@@ -0,0 +1,67 @@
+/**
+ * \file   ModStatic.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun May 20 10:14:08 2012
+ *
+ * \brief  ModStatic class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODSTATIC_MODSTATIC_H_
+#define BREF_API_EXAMPLES_MODSTATIC_MODSTATIC_H_
+
+#include "bref/AModule.h"
+#include "bref/IConfHelper.h"
+#include "bref/ILogger.h"
+
+#include <stdint.h>
+
+/*
+  Fichiers statiques sous le répertoire StaticRoot, sur les
+  contentHooks.
+
+  Le handler donne le fichier ouvert au serveur avec outFile() : un
+  serveur qui sait envoyer un fichier (sendfile(), ...) le fait sans
+  copie. Sinon le fichier est lu par outContent().
+*/
+class ModStatic : public bref::AModule
+{
+private:
+  static const float       ModulePriority;
+
+  bref::ILogger           *logger_;
+  bref::KeyHandle          rootKey_;
+  bref::KeyHandle          indexKey_;
+
+public:
+  ModStatic(bref::ILogger *logger, const bref::IConfHelper & confHelper);
+  virtual ~ModStatic();
+  virtual void dispose();
+  virtual void registerHooks(bref::Pipeline & pipeline);
+
+  bref::Pipeline::IContentRequestHandler *contentHook(const bref::Environment & environment,
+                                                      const bref::HttpRequest & request,
+                                                      bref::HttpResponse &      response,
+                                                      bref::FdType &            fd);
+};
+
+/*
+  Handler d'une requête, propriétaire du fichier ouvert.
+*/
+class ModStaticRequestHandler : public bref::Pipeline::IContentRequestHandler
+{
+private:
+  int             fd_;
+  uint64_t        size_;
+  uint64_t        offset_;
+
+public:
+  ModStaticRequestHandler(int fd, uint64_t size);
+  virtual ~ModStaticRequestHandler();
+  virtual bool inContent(bref::HttpResponse & response, const bref::Buffer & inBuffer);
+  virtual bool outContent(bref::HttpResponse & response, bref::Buffer & outBuffer);
+  virtual bool outFile(bref::HttpResponse & response, bref::FileRange & range);
+  virtual void dispose();
+};
+
+#endif /* !BREF_API_EXAMPLES_MODSTATIC_MODSTATIC_H_ */
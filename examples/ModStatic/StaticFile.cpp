@@ -0,0 +1,109 @@
+/**
+ * \file   StaticFile.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 09:26:51 2012
+ *
+ * \brief  static_file definitions.
+ *
+ */
+
+#include "StaticFile.h"
+#include "bref/detail/util/ICaseStringCmp.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct ContentType
+{
+  const char *extension;
+  const char *type;
+};
+
+const ContentType ContentTypes[] =
+  {
+    { "css",  "text/css" },
+    { "gif",  "image/gif" },
+    { "htm",  "text/html" },
+    { "html", "text/html" },
+    { "ico",  "image/x-icon" },
+    { "jpeg", "image/jpeg" },
+    { "jpg",  "image/jpeg" },
+    { "js",   "application/javascript" },
+    { "json", "application/json" },
+    { "pdf",  "application/pdf" },
+    { "png",  "image/png" },
+    { "svg",  "image/svg+xml" },
+    { "txt",  "text/plain" },
+    { "xml",  "application/xml" }
+  };
+
+int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+} // ! unnamed namespace
+
+namespace static_file {
+
+const char *contentType(const std::string & path)
+{
+  const std::string::size_type dot   = path.rfind('.');
+  const std::string::size_type slash = path.rfind('/');
+
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    {
+      const char        *extension = path.c_str() + dot + 1;
+      const std::size_t  size      = path.size() - dot - 1;
+
+      for (std::size_t i = 0; i < sizeof ContentTypes / sizeof *ContentTypes; ++i)
+        if (std::strlen(ContentTypes[i].extension) == size
+            && bref::util::icaseEqual(extension, ContentTypes[i].extension, size))
+          return ContentTypes[i].type;
+    }
+  return "application/octet-stream";
+}
+
+bool decodePath(const std::string & uri, std::string & path)
+{
+  const std::string::size_type end = std::min(uri.find('?'), uri.find('#'));
+
+  if (uri.empty() || uri[0] != '/')
+    return false;
+  path.clear();
+  for (std::string::size_type i = 0; i < end && i < uri.size(); ++i)
+    {
+      char c = uri[i];
+
+      if (c == '%')
+        {
+          const int high = i + 2 < uri.size() ? hexValue(uri[i + 1]) : -1;
+          const int low  = high >= 0 ? hexValue(uri[i + 2]) : -1;
+
+          if (low < 0)
+            return false;
+          c  = static_cast<char>(high * 16 + low);
+          i += 2;
+        }
+      if (c == '\0')
+        return false;
+      if (c != '/' || path.empty() || path[path.size() - 1] != '/')
+        path += c;
+    }
+
+  // "/.." en fin de chemin ou suivi d'un '/'
+  for (std::string::size_type pos = path.find("/.."); pos != std::string::npos; pos = path.find("/..", pos + 1))
+    if (pos + 3 == path.size() || path[pos + 3] == '/')
+      return false;
+  return true;
+}
+
+} // ! namespace static_file
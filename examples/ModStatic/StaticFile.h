@@ -0,0 +1,38 @@
+/**
+ * \file   StaticFile.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 21 09:26:51 2012
+ *
+ * \brief  static_file declarations.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODSTATIC_STATICFILE_H_
+#define BREF_API_EXAMPLES_MODSTATIC_STATICFILE_H_
+
+#include <string>
+
+/*
+  Fonctions communes aux modules qui servent des fichiers sous
+  StaticRoot (ModStatic, ModCache).
+*/
+namespace static_file {
+
+  /*
+    Type MIME d'après l'extension de \p path,
+    "application/octet-stream" par défaut.
+  */
+  const char *contentType(const std::string & path);
+
+  /*
+    Chemin de l'URI, sans la query string, décodé et sans '/'
+    consécutifs : deux URI du même fichier donnent le même chemin.
+    Retourne false si
+    le chemin ne peut pas désigner un fichier sous la racine (encodage
+    invalide, octet nul, segment "..").
+  */
+  bool decodePath(const std::string & uri, std::string & path);
+
+} // ! namespace static_file
+
+#endif /* !BREF_API_EXAMPLES_MODSTATIC_STATICFILE_H_ */
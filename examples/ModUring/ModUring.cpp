@@ -0,0 +1,256 @@
+/**
+ * \file   ModUring.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 19 10:02:51 2012
+ *
+ * \brief  ModUring definition.
+ *
+ */
+
+#include "ModUring.h"
+#include "bref/ScopedLogger.h"
+#include "bref/detail/BrefDLL.h"
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cerrno>
+#include <string>
+#include <utility>
+
+const float       ModUring::ModulePriority = 0.f; // Une couche TLS passe avant
+
+extern "C" BREF_DLL
+bref::AModule *loadModule(bref::ILogger *logger,
+                          const bref::ServerConfig &,
+                          const bref::IConfHelper &)
+{
+  LOG_INFO(logger) << "Load module mod_uring";
+  return new ModUring(logger);
+}
+
+namespace {
+
+/*
+  L'io_uring du thread courant. owner identifie l'instance du module,
+  un module rechargé ne réutilise pas les pointeurs de l'ancien.
+*/
+struct ThreadIo
+{
+  unsigned  owner;
+  UringIo  *io;
+};
+
+thread_local ThreadIo      current = { 0, 0 };
+std::atomic<unsigned>      instanceCount(0);
+
+/*
+  Lecture sans io_uring, pour un thread dont l'io_uring n'a pas pu être
+  créé (voir ModUringSession::plainSend() pour l'envoi).
+*/
+bool plainReceive(bref::SocketType socket, bref::Buffer & buffer)
+{
+  const std::size_t size = buffer.size();
+
+  buffer.resize(size + UringIo::ReceiveSize);
+  for (;;)
+    {
+      const ssize_t count = ::recv(socket, &buffer[size], UringIo::ReceiveSize, 0);
+
+      buffer.resize(size + (count > 0 ? count : 0));
+      if (count > 0)
+        return true;
+      if (count < 0 && errno == EINTR)
+        continue;
+      return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+} // ! unnamed namespace
+
+ModUring::ModUring(bref::ILogger *logger)
+  : AModule("mod_uring", "Réception et envoi avec io_uring.", bref::Version(0, 1), bref::Version(0, 4))
+  , logger_(logger)
+  , id_(++instanceCount)
+  , mutex_()
+  , rings_()
+  , available_(false)
+{
+  // l'io_uring de test n'est pas gardé : un io_uring SINGLE_ISSUER
+  // appartient au thread qui l'a utilisé
+  UringIo     probe;
+  std::string error;
+
+  available_ = probe.open(error);
+  if (! available_)
+    {
+      LOG_ERROR(logger_) << "mod_uring: io_uring is not available (" << error
+                         << "), the server keeps its own reads and writes";
+    }
+}
+
+ModUring::~ModUring()
+{ }
+
+void ModUring::dispose()
+{
+  delete this;
+}
+
+/*
+  Les handlers sont enregistrés par connexion : la session sait quand
+  la connexion est fermée.
+
+  L'envoi peut laisser une partie des données au noyau (false avec
+  errno à EAGAIN) : le handler n'est enregistré que si le serveur le
+  prévoit (Pipeline::deferredSend), sinon le serveur garde ses
+  écritures.
+*/
+bref::IDisposable *ModUring::registerSessionHooks(bref::Pipeline & pipeline)
+{
+  if (! available_)
+    return 0;
+
+  ModUringSession              *session = new ModUringSession(this);
+  bref::Pipeline::OnReceiveHook receive(session, &ModUringSession::receiveHook);
+
+  pipeline.onReceiveHooks.push_back(std::make_pair(receive, ModUring::ModulePriority));
+  if (pipeline.deferredSend)
+    {
+      bref::Pipeline::OnSendHook send(session, &ModUringSession::sendHook);
+
+      pipeline.onSendHooks.push_back(std::make_pair(send, ModUring::ModulePriority));
+    }
+  return session;
+}
+
+UringIo *ModUring::threadIo()
+{
+  if (current.owner == id_)
+    return current.io;
+
+  std::unique_ptr<UringIo> io(new UringIo());
+  std::string              error;
+
+  current.owner = id_;
+  current.io    = 0;
+  if (! io->open(error))
+    {
+      LOG_ERROR(logger_) << "mod_uring: " << error << ", this thread uses plain reads and writes";
+      return 0;
+    }
+  current.io = io.get();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  rings_.push_back(BREF_MOVE(io));
+  return current.io;
+}
+
+ModUringSession::ModUringSession(ModUring *module)
+  : module_(module)
+  , io_(0)
+  , sender_(0)
+  , drained_(false)
+  , pending_()
+  , pendingOffset_(0)
+{ }
+
+ModUringSession::~ModUringSession()
+{ }
+
+void ModUringSession::dispose()
+{
+  if (io_)
+    io_->closeSender(sender_);
+  delete this;
+}
+
+/*
+  L'io_uring est pris au premier appel d'un handler, dans le thread de
+  la connexion.
+*/
+UringIo *ModUringSession::io()
+{
+  if (! io_ && (io_ = module_->threadIo()))
+    sender_ = io_->openSender();
+  return io_;
+}
+
+bref::Pipeline::OnReceiveRequestHandler
+ModUringSession::receiveHook(const bref::Environment & /* environment */)
+{
+  return bref::Pipeline::OnReceiveRequestHandler(this, &ModUringSession::receive);
+}
+
+bref::Pipeline::OnSendRequestHandler
+ModUringSession::sendHook(const bref::Environment & /* environment */)
+{
+  return bref::Pipeline::OnSendRequestHandler(this, &ModUringSession::send);
+}
+
+bool ModUringSession::receive(bref::SocketType socket, bref::Buffer & buffer)
+{
+  if (drained_)
+    {
+      drained_ = false;
+      return true;
+    }
+
+  UringIo *io = this->io();
+
+  if (! io)
+    return plainReceive(socket, buffer);
+
+  const std::size_t size    = buffer.size();
+  bool              drained = false;
+
+  if (! io->receive(socket, buffer, drained))
+    return false;
+  drained_ = drained && buffer.size() > size;
+  return true;
+}
+
+bool ModUringSession::send(bref::SocketType socket, const bref::Buffer & buffer)
+{
+  UringIo *io = this->io();
+
+  return io ? io->send(sender_, socket, buffer) : plainSend(socket, buffer);
+}
+
+/*
+  Le reste qui n'a pas pu partir est copié et gardé par la session, le
+  serveur rappelle send() quand la socket redevient disponible.
+*/
+bool ModUringSession::plainSend(bref::SocketType socket, const bref::Buffer & buffer)
+{
+  const bool        resume = pendingOffset_ < pending_.size();
+  const char       *data   = resume ? &pending_[pendingOffset_] : (buffer.empty() ? 0 : &buffer[0]);
+  const std::size_t size   = resume ? pending_.size() - pendingOffset_ : buffer.size();
+  std::size_t       offset = 0;
+
+  while (offset < size)
+    {
+      const ssize_t sent = ::send(socket, data + offset, size - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+      if (sent >= 0)
+        offset += sent;
+      else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      else if (errno != EINTR)
+        return false;
+    }
+  if (resume)
+    pendingOffset_ += offset;
+  else if (offset < size)
+    {
+      pending_.assign(data + offset, data + size);
+      pendingOffset_ = 0;
+    }
+  if (pendingOffset_ < pending_.size())
+    {
+      errno = EAGAIN;
+      return false;
+    }
+  return true;
+}
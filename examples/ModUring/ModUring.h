@@ -0,0 +1,99 @@
+/**
+ * \file   ModUring.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 19 10:02:51 2012
+ *
+ * \brief  ModUring class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODURING_MODURING_H_
+#define BREF_API_EXAMPLES_MODURING_MODURING_H_
+
+#include "bref/AModule.h"
+#include "bref/ILogger.h"
+
+#include "UringIo.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+  Réception et envoi sur les sockets clientes avec io_uring, sur les
+  onReceiveHooks et les onSendHooks.
+
+  Les handlers sont enregistrés par connexion (registerSessionHooks()),
+  chaque thread du serveur a son io_uring (voir UringIo), créé au
+  premier appel d'un handler dans ce thread. Sans io_uring, le module
+  n'enregistre aucun hook et le serveur garde ses propres lectures et
+  écritures ; sans Pipeline::deferredSend, il garde ses écritures.
+*/
+class ModUring : public bref::AModule
+{
+private:
+  static const float                     ModulePriority;
+
+  bref::ILogger                         *logger_;
+  const unsigned                         id_;
+  std::mutex                             mutex_;
+  std::vector<std::unique_ptr<UringIo> > rings_;
+  bool                                   available_;
+
+public:
+  ModUring(bref::ILogger *logger);
+  virtual ~ModUring();
+  virtual void dispose();
+  virtual bref::IDisposable *registerSessionHooks(bref::Pipeline & pipeline);
+
+  /*
+    L'io_uring du thread appelant, 0 s'il ne peut pas être créé.
+  */
+  UringIo *threadIo();
+};
+
+/*
+  Les handlers d'une connexion. La session est libérée par le serveur
+  à la fermeture de la connexion, avant celle de la socket : les envois
+  encore en cours sont annulés.
+
+  Sans io_uring dans le thread, les lectures et écritures sont faites
+  directement, avec le même contrat (pas d'attente de la socket).
+*/
+class ModUringSession : public bref::IDisposable
+{
+private:
+  ModUring     *module_;
+  UringIo      *io_;
+  unsigned      sender_;
+  bool          drained_;
+  bref::Buffer  pending_;       // reste à envoyer sans io_uring
+  std::size_t   pendingOffset_;
+
+  UringIo *io();
+  bool plainSend(bref::SocketType socket, const bref::Buffer & buffer);
+
+  virtual ~ModUringSession();
+
+public:
+  ModUringSession(ModUring *module);
+  virtual void dispose();
+
+  bref::Pipeline::OnReceiveRequestHandler receiveHook(const bref::Environment & environment);
+  bref::Pipeline::OnSendRequestHandler sendHook(const bref::Environment & environment);
+
+  /*
+    Le serveur rappelle le handler de réception tant qu'il ajoute des
+    données ; après un appel qui a vidé la socket, l'appel suivant
+    retourne sans appel système.
+  */
+  bool receive(bref::SocketType socket, bref::Buffer & buffer);
+
+  /*
+    Voir UringIo::send() : false avec errno à EAGAIN lorsqu'une partie
+    de l'envoi attend que la socket se vide.
+  */
+  bool send(bref::SocketType socket, const bref::Buffer & buffer);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODURING_MODURING_H_ */
@@ -0,0 +1,207 @@
+/**
+ * \file   Ring.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 19 10:12:44 2012
+ *
+ * \brief  Ring definition.
+ *
+ */
+
+#include "Ring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+/*
+  Flags de io_uring_setup() qui ne changent que les performances : ils
+  sont retirés si le noyau les refuse.
+*/
+const unsigned OptionalSetupFlags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN
+  | IORING_SETUP_TASKRUN_FLAG | IORING_SETUP_SINGLE_ISSUER;
+
+void *offset(void *base, unsigned bytes)
+{
+  return static_cast<char *>(base) + bytes;
+}
+
+unsigned loadAcquire(const unsigned *value)
+{
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+} // ! unnamed namespace
+
+Ring::Ring()
+  : fd_(-1)
+  , sqRing_(MAP_FAILED)
+  , sqRingSize_(0)
+  , cqRing_(MAP_FAILED)
+  , cqRingSize_(0)
+  , sqes_(0)
+  , sqesSize_(0)
+  , sqHead_(0)
+  , sqTail_(0)
+  , sqFlags_(0)
+  , sqMask_(0)
+  , sqEntries_(0)
+  , sqLocalTail_(0)
+  , cqHead_(0)
+  , cqTail_(0)
+  , cqMask_(0)
+  , cqes_(0)
+{ }
+
+Ring::~Ring()
+{
+  if (fd_ != -1)
+    ::close(fd_);
+  if (sqes_)
+    ::munmap(sqes_, sqesSize_);
+  if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    ::munmap(cqRing_, cqRingSize_);
+  if (sqRing_ != MAP_FAILED)
+    ::munmap(sqRing_, sqRingSize_);
+}
+
+bool Ring::open(unsigned entries, unsigned flags, std::string & error)
+{
+  io_uring_params params;
+
+  std::memset(&params, 0, sizeof params);
+  params.flags = flags;
+  fd_ = ::syscall(__NR_io_uring_setup, entries, &params);
+  if (fd_ < 0 && errno == EINVAL && (flags & OptionalSetupFlags))
+    {
+      std::memset(&params, 0, sizeof params);
+      params.flags = flags & ~OptionalSetupFlags;
+      fd_ = ::syscall(__NR_io_uring_setup, entries, &params);
+    }
+  if (fd_ < 0)
+    {
+      error = std::string("io_uring_setup: ") + std::strerror(errno);
+      fd_   = -1;
+      return false;
+    }
+
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+  sqRing_ = ::mmap(0, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED)
+    {
+      error = std::string("mmap: ") + std::strerror(errno);
+      return false;
+    }
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    cqRing_ = sqRing_;
+  else
+    {
+      cqRing_ = ::mmap(0, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cqRing_ == MAP_FAILED)
+        {
+          error = std::string("mmap: ") + std::strerror(errno);
+          return false;
+        }
+    }
+  sqesSize_ = params.sq_entries * sizeof (io_uring_sqe);
+
+  void *sqes = ::mmap(0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+
+  if (sqes == MAP_FAILED)
+    {
+      error = std::string("mmap: ") + std::strerror(errno);
+      return false;
+    }
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+  sqHead_    = static_cast<unsigned *>(offset(sqRing_, params.sq_off.head));
+  sqTail_    = static_cast<unsigned *>(offset(sqRing_, params.sq_off.tail));
+  sqFlags_   = static_cast<unsigned *>(offset(sqRing_, params.sq_off.flags));
+  sqMask_    = *static_cast<unsigned *>(offset(sqRing_, params.sq_off.ring_mask));
+  sqEntries_ = params.sq_entries;
+  cqHead_    = static_cast<unsigned *>(offset(cqRing_, params.cq_off.head));
+  cqTail_    = static_cast<unsigned *>(offset(cqRing_, params.cq_off.tail));
+  cqMask_    = *static_cast<unsigned *>(offset(cqRing_, params.cq_off.ring_mask));
+  cqes_      = static_cast<io_uring_cqe *>(offset(cqRing_, params.cq_off.cqes));
+
+  // le tableau d'indirection reste l'identité, les SQE sont utilisées
+  // dans l'ordre
+  unsigned *array = static_cast<unsigned *>(offset(sqRing_, params.sq_off.array));
+
+  for (unsigned i = 0; i < sqEntries_; ++i)
+    array[i] = i;
+  sqLocalTail_ = *sqTail_;
+  return true;
+}
+
+int Ring::enter(unsigned submitCount, unsigned waitCount, unsigned flags)
+{
+  for (;;)
+    {
+      const int result = ::syscall(__NR_io_uring_enter, fd_, submitCount, waitCount, flags, 0, 0);
+
+      if (result >= 0)
+        return result;
+      if (errno != EINTR)
+        return -errno;
+    }
+}
+
+io_uring_sqe *Ring::sqe()
+{
+  if (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_)
+    {
+      submit();
+      if (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_)
+        return 0;
+    }
+
+  io_uring_sqe *sqe = &sqes_[sqLocalTail_ & sqMask_];
+
+  ++sqLocalTail_;
+  std::memset(sqe, 0, sizeof *sqe);
+  return sqe;
+}
+
+int Ring::submit(unsigned waitCount)
+{
+  __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+  const unsigned submitCount = sqLocalTail_ - loadAcquire(sqHead_);
+
+  if (! submitCount && ! waitCount)
+    return 0;
+  return enter(submitCount, waitCount, waitCount ? IORING_ENTER_GETEVENTS : 0);
+}
+
+io_uring_cqe *Ring::peek()
+{
+  unsigned head = *cqHead_;
+
+  if (head == loadAcquire(cqTail_))
+    {
+      // avec COOP_TASKRUN, les complétions différées sont postées lors
+      // du prochain passage dans le noyau
+      if (! (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN)
+          || enter(0, 0, IORING_ENTER_GETEVENTS) < 0)
+        return 0;
+      head = *cqHead_;
+      if (head == loadAcquire(cqTail_))
+        return 0;
+    }
+  return &cqes_[head & cqMask_];
+}
+
+void Ring::advance()
+{
+  __atomic_store_n(cqHead_, *cqHead_ + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,83 @@
+/**
+ * \file   Ring.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 19 10:12:44 2012
+ *
+ * \brief  Ring class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODURING_RING_H_
+#define BREF_API_EXAMPLES_MODURING_RING_H_
+
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <string>
+
+/*
+  Une instance io_uring, utilisée par un seul thread.
+
+  Les appels système (io_uring_setup, io_uring_enter) sont faits
+  directement, sans liburing. Les SQE préparées par sqe() sont publiées
+  et soumises ensemble par submit(), en un seul io_uring_enter.
+*/
+class Ring : bref::util::NonCopyable
+{
+private:
+  int                   fd_;
+  void                 *sqRing_;
+  std::size_t           sqRingSize_;
+  void                 *cqRing_;
+  std::size_t           cqRingSize_;
+  io_uring_sqe         *sqes_;
+  std::size_t           sqesSize_;
+
+  unsigned             *sqHead_;
+  unsigned             *sqTail_;
+  unsigned             *sqFlags_;
+  unsigned              sqMask_;
+  unsigned              sqEntries_;
+  unsigned              sqLocalTail_;   // SQE préparées, pas encore publiées
+
+  unsigned             *cqHead_;
+  unsigned             *cqTail_;
+  unsigned              cqMask_;
+  io_uring_cqe         *cqes_;
+
+  int enter(unsigned submitCount, unsigned waitCount, unsigned flags);
+
+public:
+  Ring();
+  ~Ring();
+
+  /*
+    Crée l'instance avec \p entries SQE. \p flags sont les flags de
+    io_uring_setup() (IORING_SETUP_*) ; ceux qui ne changent que les
+    performances sont retirés si le noyau les refuse.
+  */
+  bool open(unsigned entries, unsigned flags, std::string & error);
+
+  /*
+    Retourne une SQE vide, soumet les SQE en attente si la file est
+    pleine. Retourne 0 si la soumission échoue.
+  */
+  io_uring_sqe *sqe();
+
+  /*
+    Soumet les SQE préparées et attend au moins \p waitCount CQE.
+    Retourne le nombre de SQE soumises ou -errno.
+  */
+  int submit(unsigned waitCount = 0);
+
+  /*
+    Retourne la prochaine CQE sans appel système, ou 0 si la file est
+    vide. advance() la libère.
+  */
+  io_uring_cqe *peek();
+  void advance();
+};
+
+#endif /* !BREF_API_EXAMPLES_MODURING_RING_H_ */
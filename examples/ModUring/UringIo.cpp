@@ -0,0 +1,378 @@
+/**
+ * \file   UringIo.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 19 11:03:26 2012
+ *
+ * \brief  UringIo definition.
+ *
+ */
+
+#include "UringIo.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+// les buffers rendus au noyau et les SQE d'un envoi tiennent toujours
+// dans la file : sqe() ne soumet jamais une opération à moitié préparée
+static_assert(UringIo::ReceiveCount + 2 <= UringIo::RingEntries,
+              "the submission queue is too small");
+
+namespace {
+
+const unsigned short ReceiveGroup = 0;
+const unsigned short InlineSend   = 1;         // envoi fait pendant la soumission
+const std::size_t    PendingKept  = 1024 * 1024; // capacité gardée par un émetteur libéré
+const int            NotSent      = INT_MIN;
+
+uint64_t address(const void *pointer)
+{
+  return reinterpret_cast<uintptr_t>(pointer);
+}
+
+} // ! unnamed namespace
+
+UringIo::UringIo()
+  : ring_()
+  , multishot_(true)
+  , receiveBuffers_(ReceiveCount * ReceiveSize)
+  , consumed_()
+  , senders_()
+  , freeSenders_()
+{
+  consumed_.reserve(ReceiveCount);
+}
+
+/*
+  user_data : l'opération dans l'octet de poids faible, un indice de
+  buffer sur les 16 bits suivants, l'émetteur (ou un nombre de
+  buffers) sur les 32 bits de poids fort.
+*/
+uint64_t UringIo::tag(Operation operation, unsigned value, unsigned short index)
+{
+  return (static_cast<uint64_t>(value) << 32) | (static_cast<uint64_t>(index) << 8) | operation;
+}
+
+bool UringIo::open(std::string & error)
+{
+  if (! ring_.open(RingEntries, IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN
+                   | IORING_SETUP_TASKRUN_FLAG | IORING_SETUP_SINGLE_ISSUER, error))
+    return false;
+
+  for (unsigned short i = 0; i < ReceiveCount; ++i)
+    consumed_.push_back(i);
+  if (! provideBuffers() || ring_.submit() < 0)
+    {
+      error = "can't provide the receive buffers";
+      return false;
+    }
+
+  // PROVIDE_BUFFERS est exécuté pendant la soumission, une CQE n'est
+  // postée qu'en cas d'échec
+  if (io_uring_cqe *cqe = ring_.peek())
+    {
+      error = std::string("IORING_OP_PROVIDE_BUFFERS: ") + std::strerror(-cqe->res);
+      return false;
+    }
+  return true;
+}
+
+/*
+  Les buffers consommés sont rendus par plages d'indices consécutifs,
+  une SQE par plage. Les SQE partent avec la prochaine soumission, avant
+  la réception suivante.
+*/
+bool UringIo::provideBuffers()
+{
+  std::sort(consumed_.begin(), consumed_.end());
+
+  std::size_t first = 0;
+
+  while (first < consumed_.size())
+    {
+      std::size_t last = first + 1;
+
+      while (last < consumed_.size() && consumed_[last] == consumed_[last - 1] + 1)
+        ++last;
+
+      io_uring_sqe *sqe = ring_.sqe();
+
+      if (! sqe)
+        return false;
+      sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+      sqe->fd        = last - first;
+      sqe->addr      = address(&receiveBuffers_[consumed_[first] * ReceiveSize]);
+      sqe->len       = ReceiveSize;
+      sqe->off       = consumed_[first];
+      sqe->buf_group = ReceiveGroup;
+      sqe->flags     = IOSQE_CQE_SKIP_SUCCESS;
+      sqe->user_data = tag(Provide, last - first, consumed_[first]);
+      first = last;
+    }
+  consumed_.clear();
+  return true;
+}
+
+void UringIo::complete(const io_uring_cqe & cqe, ReceiveState *receive, int *sent)
+{
+  const Operation      operation = static_cast<Operation>(cqe.user_data & 0xff);
+  const unsigned short index     = static_cast<unsigned short>(cqe.user_data >> 8);
+  const unsigned       value     = static_cast<unsigned>(cqe.user_data >> 32);
+
+  switch (operation)
+    {
+    case Receive:
+      if (cqe.flags & IORING_CQE_F_BUFFER)
+        {
+          const unsigned short buffer = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+          const char          *data   = &receiveBuffers_[buffer * ReceiveSize];
+
+          if (cqe.res > 0)
+            receive->buffer->insert(receive->buffer->end(), data, data + cqe.res);
+          consumed_.push_back(buffer);
+        }
+      if (cqe.res == 0)
+        receive->eof = true;
+      else if (cqe.res == -EAGAIN)
+        receive->drained = true;
+      else if (cqe.res < 0 && cqe.res != -ENOBUFS)
+        receive->error = -cqe.res;
+      if (! (cqe.flags & IORING_CQE_F_MORE))
+        receive->finished = true;
+      break;
+
+    case Send:
+      if (index == InlineSend)
+        *sent = cqe.res;
+      else
+        {
+          Sender & sender = senders_[value];
+
+          sender.inFlight = false;
+          if (cqe.res < 0 && cqe.res != -ECANCELED)
+            sender.error = -cqe.res;
+          else if (cqe.res >= 0 && static_cast<std::size_t>(cqe.res) != sender.pending.size())
+            sender.error = EPIPE;
+          if (sender.closed)
+            release(value);
+        }
+      break;
+
+    case Provide:
+      for (unsigned i = 0; i < value; ++i)
+        consumed_.push_back(index + i);
+      break;
+
+    case Cancel:
+      // l'envoi était déjà terminé ou en cours d'exécution, sa CQE
+      // arrive de toute façon
+      break;
+    }
+}
+
+/*
+  Traite les complétions déjà postées, sans appel système.
+*/
+void UringIo::reap()
+{
+  while (io_uring_cqe *cqe = ring_.peek())
+    {
+      complete(*cqe, 0, 0);
+      ring_.advance();
+    }
+}
+
+void UringIo::release(unsigned sender)
+{
+  Sender & state = senders_[sender];
+
+  state.pending.clear();
+  if (state.pending.capacity() > PendingKept)
+    std::vector<char>().swap(state.pending);
+  state.closed = false;
+  state.error  = 0;
+  freeSenders_.push_back(sender);
+}
+
+bool UringIo::receive(int socket, bref::Buffer & buffer, bool & drained)
+{
+  const std::size_t initialSize = buffer.size();
+  ReceiveState      state       = { &buffer, false, false, false, 0 };
+  io_uring_sqe     *sqe         = ring_.sqe();
+
+  if (! sqe)
+    return false;
+  sqe->opcode    = IORING_OP_RECV;
+  sqe->fd        = socket;
+  sqe->flags     = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = ReceiveGroup;
+  sqe->ioprio    = multishot_ ? IORING_RECV_MULTISHOT : 0;
+  sqe->msg_flags = MSG_DONTWAIT;
+  sqe->user_data = tag(Receive, 0, 0);
+
+  // avec MSG_DONTWAIT la réception est faite pendant la soumission :
+  // les CQE sont là au retour de io_uring_enter
+  if (ring_.submit(1) < 0)
+    return false;
+  while (! state.finished)
+    {
+      io_uring_cqe *cqe = ring_.peek();
+
+      if (! cqe)
+        {
+          if (ring_.submit(1) < 0)
+            return false;
+          continue;
+        }
+      complete(*cqe, &state, 0);
+      ring_.advance();
+    }
+  if (! provideBuffers())
+    return false;
+
+  // un noyau sans réception multishot refuse la SQE
+  if (state.error == EINVAL && multishot_ && buffer.size() == initialSize)
+    {
+      multishot_ = false;
+      return receive(socket, buffer, drained);
+    }
+
+  drained = state.drained;
+  if (state.error)
+    return false;
+  return ! state.eof || buffer.size() > initialSize;
+}
+
+unsigned UringIo::openSender()
+{
+  if (! freeSenders_.empty())
+    {
+      const unsigned sender = freeSenders_.back();
+
+      freeSenders_.pop_back();
+      return sender;
+    }
+
+  const Sender sender = { std::vector<char>(), false, false, 0 };
+
+  senders_.push_back(sender);
+  return senders_.size() - 1;
+}
+
+/*
+  L'envoi en cours garde une référence sur la socket : sans
+  l'annulation, un client qui ne lit plus garderait la connexion
+  ouverte après sa fermeture par le serveur. L'émetteur est libéré à
+  la CQE de l'envoi annulé.
+*/
+void UringIo::closeSender(unsigned sender)
+{
+  Sender & state = senders_[sender];
+
+  state.closed = true;
+  if (! state.inFlight)
+    {
+      release(sender);
+      return;
+    }
+
+  io_uring_sqe *sqe = ring_.sqe();
+
+  if (! sqe)
+    return;
+  sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+  sqe->addr      = tag(Send, sender, 0);
+  sqe->flags     = IOSQE_CQE_SKIP_SUCCESS;
+  sqe->user_data = tag(Cancel, sender, 0);
+  ring_.submit();
+}
+
+/*
+  L'envoi commence pendant la soumission, depuis le buffer de
+  l'appelant (MSG_DONTWAIT). Seul le reste, si la socket est pleine,
+  est copié et laissé au noyau : la socket ne porte jamais plus d'un
+  envoi en cours, l'ordre des octets est gardé sans attendre.
+*/
+bool UringIo::send(unsigned sender, int socket, const bref::Buffer & buffer)
+{
+  Sender & state = senders_[sender];
+
+  reap();
+  if (state.error)
+    {
+      errno = state.error;
+      return false;
+    }
+  if (state.inFlight)
+    {
+      errno = EAGAIN;
+      return false;
+    }
+  if (buffer.empty())
+    return true;
+
+  io_uring_sqe *sqe  = ring_.sqe();
+  int           sent = NotSent;
+
+  if (! sqe)
+    return false;
+  sqe->opcode    = IORING_OP_SEND;
+  sqe->fd        = socket;
+  sqe->addr      = address(&buffer[0]);
+  sqe->len       = buffer.size();
+  sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+  sqe->user_data = tag(Send, sender, InlineSend);
+  if (ring_.submit(1) < 0)
+    return false;
+  while (sent == NotSent)
+    {
+      io_uring_cqe *cqe = ring_.peek();
+
+      if (! cqe)
+        {
+          if (ring_.submit(1) < 0)
+            return false;
+          continue;
+        }
+      complete(*cqe, 0, &sent);
+      ring_.advance();
+    }
+
+  if (sent == -EAGAIN)
+    sent = 0;
+  if (sent < 0)
+    {
+      errno = -sent;
+      return false;
+    }
+  if (static_cast<std::size_t>(sent) == buffer.size())
+    return true;
+
+  state.pending.assign(buffer.begin() + sent, buffer.end());
+  if (! (sqe = ring_.sqe()))
+    return false;
+  sqe->opcode    = IORING_OP_SEND;
+  sqe->fd        = socket;
+  sqe->addr      = address(&state.pending[0]);
+  sqe->len       = state.pending.size();
+  sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+  sqe->user_data = tag(Send, sender, 0);
+  state.inFlight = true;
+  if (ring_.submit() < 0)
+    return false;
+
+  // la socket a pu se vider entre les deux soumissions
+  reap();
+  if (state.error)
+    {
+      errno = state.error;
+      return false;
+    }
+  if (! state.inFlight)
+    return true;
+  errno = EAGAIN;
+  return false;
+}
@@ -0,0 +1,129 @@
+/**
+ * \file   UringIo.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 19 11:03:26 2012
+ *
+ * \brief  UringIo class declaration.
+ *
+ */
+
+#ifndef BREF_API_EXAMPLES_MODURING_URINGIO_H_
+#define BREF_API_EXAMPLES_MODURING_URINGIO_H_
+
+#include "Ring.h"
+
+#include "bref/Buffer.h"
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/*
+  Lectures et écritures des sockets d'un thread, avec un io_uring.
+
+  - Réception : une SQE IORING_OP_RECV multishot avec MSG_DONTWAIT lit
+    tout ce qui est disponible dans des buffers fournis au noyau
+    (IORING_OP_PROVIDE_BUFFERS), puis se termine sur EAGAIN : un seul
+    io_uring_enter vide la socket. Les buffers consommés sont rendus au
+    noyau avec la soumission suivante, quelle que soit la connexion.
+  - Envoi : une SQE IORING_OP_SEND avec MSG_DONTWAIT envoie ce que la
+    socket accepte pendant la soumission, depuis le buffer de l'appelant.
+    Le reste est copié dans le buffer de l'émetteur et confié au noyau
+    (MSG_WAITALL), qui le termine quand la socket se vide ; l'appelant
+    est prévenu que l'envoi est en cours (voir send()).
+
+  Les envois en cours appartiennent à un émetteur (un par connexion),
+  pas à une socket : le serveur peut fermer la socket et réutiliser son
+  numéro, closeSender() annule les envois de l'ancienne connexion.
+*/
+class UringIo : bref::util::NonCopyable
+{
+public:
+  static const unsigned RingEntries  = 256;
+  static const unsigned ReceiveCount = 64;
+  static const unsigned ReceiveSize  = 16 * 1024;
+
+private:
+  enum Operation
+    {
+      Receive,
+      Send,
+      Provide,
+      Cancel
+    };
+
+  struct ReceiveState
+  {
+    bref::Buffer *buffer;
+    bool          finished;
+    bool          drained;
+    bool          eof;
+    int           error;
+  };
+
+  /*
+    Un émetteur, libéré quand sa connexion est fermée et que son envoi
+    en cours est terminé ou annulé.
+  */
+  struct Sender
+  {
+    std::vector<char> pending;          // reste confié au noyau
+    bool              inFlight;
+    bool              closed;
+    int               error;
+  };
+
+  Ring                          ring_;
+  bool                          multishot_;
+  std::vector<char>             receiveBuffers_;
+  std::vector<unsigned short>   consumed_;      // à rendre au noyau
+  std::vector<Sender>           senders_;
+  std::vector<unsigned>         freeSenders_;
+
+  static uint64_t tag(Operation operation, unsigned value, unsigned short index);
+
+  bool provideBuffers();
+  void complete(const io_uring_cqe & cqe, ReceiveState *receive, int *sent);
+  void reap();
+  void release(unsigned sender);
+
+public:
+  UringIo();
+
+  bool open(std::string & error);
+
+  /*
+    Ajoute à \p buffer les données disponibles sur \p socket. \p drained
+    indique que la socket a été vidée (EAGAIN). Retourne false sur une
+    erreur, ou si le client a fermé la connexion et qu'il n'y a plus de
+    données.
+  */
+  bool receive(int socket, bref::Buffer & buffer, bool & drained);
+
+  /*
+    Réserve un émetteur pour une connexion.
+  */
+  unsigned openSender();
+
+  /*
+    Libère l'émetteur d'une connexion fermée, son envoi en cours est
+    annulé (IORING_OP_ASYNC_CANCEL). À appeler avant la fermeture de la
+    socket.
+  */
+  void closeSender(unsigned sender);
+
+  /*
+    Envoie \p buffer sur \p socket, sans jamais attendre la socket.
+
+    Retourne true si tout est parti. Retourne false avec errno à EAGAIN
+    si une partie est encore en cours d'envoi : \p buffer a été pris en
+    entier, send() doit être rappelé avec un buffer vide quand la socket
+    redevient disponible, jusqu'à ce qu'il retourne true. Retourne false
+    avec un autre errno sur une erreur.
+  */
+  bool send(unsigned sender, int socket, const bref::Buffer & buffer);
+};
+
+#endif /* !BREF_API_EXAMPLES_MODURING_URINGIO_H_ */
@@ -0,0 +1,279 @@
+/**
+ * \file   AccessRecord.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 11 18:20:37 2012
+ *
+ * \brief  AccessRecord and AccessLogHeader definitions.
+ *
+ */
+
+#ifndef BREF_API_ACCESSRECORD_H_
+#define BREF_API_ACCESSRECORD_H_
+
+#include "HttpConstants.h"
+#include "IpAddress.h"
+#include "Version.h"
+#include "detail/util/IntFormat.hpp"
+#include "detail/util/IpFormat.hpp"
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace bref {
+
+/**
+ * \brief The access log entry of a request, a binary record of 64
+ *        bytes.
+ *
+ * The server fills a record once the response is sent and gives it to
+ * ILogger::logAccess(). Nothing is formatted on the worker thread, a
+ * logger like MappedAccessLog copies the record as is and the text is
+ * produced offline (see tools/AccessLogDecoder).
+ *
+ * Example:
+\code
+bref::AccessRecord record;
+
+record.time          = requestStart;
+record.status        = response.getStatus();
+record.bytesReceived = received;
+record.bytesSent     = sent;
+record.stageTimes[bref::AccessRecord::TotalStage] = elapsed;
+record.setClient(environment.client.Ip, environment.client.Port);
+record.setRequest(request.getMethod(), request.getVersion());
+environment.logger->logAccess(record);
+\endcode
+ *
+ * The layout is fixed: the fields have an explicit size, are aligned
+ * on their size and stored in the byte order of the host (see
+ * AccessLogHeader::byteOrder).
+ *
+ * \sa ILogger::logAccess(), MappedAccessLog
+ */
+struct AccessRecord
+{
+  /**
+   * \brief The stages of a request timed in stageTimes.
+   */
+  enum Stage
+    {
+      ReceiveStage,     /**< from the first byte received to the parsed request */
+      ProcessStage,     /**< the content and transform hooks */
+      SendStage,        /**< from the first byte sent to the last one */
+      TotalStage,       /**< from the first byte received to the last one sent */
+      StageCount        /**< Number of values in the enumeration */
+    };
+
+  /**
+   * \brief Value of \c commit once the record is completely written.
+   */
+  static const uint8_t Committed = 0xa5;
+
+  /**
+   * \brief Maximum size of a record formatted by toChars().
+   */
+  static const std::size_t MaxStringSize = 256;
+
+  uint64_t      time;                   /**< start of the request, in microseconds since the Epoch (UTC) */
+  uint64_t      bytesReceived;          /**< size of the request, header included */
+  uint64_t      bytesSent;              /**< size of the response, header included */
+  unsigned char client[16];             /**< client address, an IPv4 address is IPv4-mapped */
+  uint32_t      stageTimes[StageCount]; /**< duration of each Stage, in microseconds */
+  uint16_t      status;                 /**< status_codes::Type of the response */
+  uint16_t      port;                   /**< client port */
+  uint8_t       method;                 /**< request_methods::Type of the request */
+  uint8_t       version;                /**< HTTP version, the major in the high 4 bits */
+  uint8_t       reserved;               /**< zero */
+  uint8_t       commit;                 /**< Committed when the record is valid, written last */
+
+  /**
+   * \brief Build a record with all the fields to zero.
+   */
+  AccessRecord()
+  {
+    std::memset(this, 0, sizeof(*this));
+  }
+
+  /**
+   * \brief Set the client address and port.
+   */
+  void setClient(const IpAddress & address, unsigned short clientPort)
+  {
+    if (address.isV4())
+      {
+        std::memset(client, 0, 10);
+        client[10] = 0xff;
+        client[11] = 0xff;
+        std::memcpy(client + 12, address.getV4().bytes, 4);
+      }
+    else
+      std::memcpy(client, address.getV6().bytes, 16);
+    port = clientPort;
+  }
+
+  /**
+   * \brief Set the method and the HTTP version of the request.
+   */
+  void setRequest(request_methods::Type requestMethod, const Version & requestVersion)
+  {
+    method  = static_cast<uint8_t>(requestMethod);
+    version = static_cast<uint8_t>(((requestVersion.Major & 0xf) << 4) | (requestVersion.Minor & 0xf));
+  }
+
+  /**
+   * \brief Name of a request_methods::Type, \c "-" if unknown.
+   */
+  static const char *methodName(unsigned requestMethod)
+  {
+    static const char *const names[] =
+      { "-", "OPTIONS", "GET", "HEAD", "POST", "PUT", "DELETE", "TRACE", "CONNECT" };
+
+    return requestMethod < sizeof(names) / sizeof(*names) ? names[requestMethod] : names[0];
+  }
+
+  /**
+   * \brief Write the record as a line of text, without the time and
+   *        without a terminating null character.
+   *
+   * Example:
+\verbatim
+192.168.0.1:51234 "GET HTTP/1.1" 200 rx=412 tx=5127 receive=38us process=112us send=20us total=170us
+\endverbatim
+   *
+   * \param[out] out
+   *            Should have room for MaxStringSize characters.
+   *
+   * \return The number of characters written.
+   */
+  std::size_t toChars(char *out) const
+  {
+    static const char *const stageNames[StageCount] =
+      { " receive=", " process=", " send=", " total=" };
+    char *pos = out;
+
+    if (util::isV4Mapped(client))
+      pos += util::formatIPv4(client + 12, pos);
+    else
+      {
+        *pos++ = '[';
+        pos += util::formatIPv6(client, pos);
+        *pos++ = ']';
+      }
+    *pos++ = ':';
+    pos += util::formatUnsigned(port, pos);
+    pos  = append(pos, " \"");
+    pos  = append(pos, methodName(method));
+    pos  = append(pos, " HTTP/");
+    pos += util::formatUnsigned(version >> 4, pos);
+    *pos++ = '.';
+    pos += util::formatUnsigned(version & 0xf, pos);
+    pos  = append(pos, "\" ");
+    pos += util::formatUnsigned(status, pos);
+    pos  = append(pos, " rx=");
+    pos  = appendUnsigned(pos, bytesReceived);
+    pos  = append(pos, " tx=");
+    pos  = appendUnsigned(pos, bytesSent);
+    for (int i = 0; i < StageCount; ++i)
+      {
+        pos  = append(pos, stageNames[i]);
+        pos += util::formatUnsigned(stageTimes[i], pos);
+        pos  = append(pos, "us");
+      }
+    return pos - out;
+  }
+
+private:
+  static char *append(char *pos, const char *str)
+  {
+    while (*str)
+      *pos++ = *str++;
+    return pos;
+  }
+
+  /**
+   * \brief Write a 64 bits value, \c unsigned \c long may be 32 bits.
+   */
+  static char *appendUnsigned(char *pos, uint64_t value)
+  {
+    static const uint64_t billion = 1000000000;
+
+    if (value / billion > 0)
+      {
+        pos = appendUnsigned(pos, value / billion);
+        value %= billion;
+
+        // zero padded to 9 digits
+        const std::size_t digits = util::decimalDigits(static_cast<unsigned long>(value));
+
+        for (std::size_t i = digits; i < 9; ++i)
+          *pos++ = '0';
+      }
+    return pos + util::formatUnsigned(static_cast<unsigned long>(value), pos);
+  }
+};
+
+/**
+ * \brief The header at the beginning of an access log file, followed
+ *        by the AccessRecord.
+ *
+ * The records with a \c commit different of AccessRecord::Committed
+ * were not completely written (the server stopped while writing them)
+ * and should be skipped.
+ *
+ * \sa MappedAccessLog
+ */
+struct AccessLogHeader
+{
+  /**
+   * \brief Current version of the file format.
+   */
+  static const uint16_t CurrentVersion = 1;
+
+  /**
+   * \brief Value of \c byteOrder, it reads differently when the file
+   *        comes from a host with another byte order.
+   */
+  static const uint32_t ByteOrderMark = 0x01020304;
+
+  char      magic[8];         /**< \c "BREFALOG", not null terminated */
+  uint32_t  byteOrder;        /**< ByteOrderMark */
+  uint16_t  version;          /**< CurrentVersion */
+  uint16_t  recordSize;       /**< \c sizeof(AccessRecord) */
+  uint64_t  created;          /**< creation time of the file, in microseconds since the Epoch */
+  char      reserved[40];     /**< zeros */
+
+  /**
+   * \brief Build the header of a new file.
+   */
+  explicit AccessLogHeader(uint64_t creationTime = 0)
+  {
+    std::memset(this, 0, sizeof(*this));
+    std::memcpy(magic, "BREFALOG", sizeof(magic));
+    byteOrder  = ByteOrderMark;
+    version    = CurrentVersion;
+    recordSize = sizeof(AccessRecord);
+    created    = creationTime;
+  }
+
+  /**
+   * \brief Check the header read from a file.
+   */
+  bool isValid() const
+  {
+    return std::memcmp(magic, "BREFALOG", sizeof(magic)) == 0
+      && byteOrder == ByteOrderMark
+      && version == CurrentVersion
+      && recordSize == sizeof(AccessRecord);
+  }
+};
+
+namespace detail {
+typedef char AccessRecordSizeCheck[sizeof(AccessRecord) == 64 ? 1 : -1];
+typedef char AccessLogHeaderSizeCheck[sizeof(AccessLogHeader) == 64 ? 1 : -1];
+} // ! detail
+
+} // ! bref
+
+#endif /* !BREF_API_ACCESSRECORD_H_ */
@@ -0,0 +1,317 @@
+/**
+ * \file   Arena.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun May  6 11:02:37 2012
+ *
+ * \brief  Arena and ArenaAllocator definitions.
+ *
+ */
+
+#ifndef BREF_API_ARENA_H_
+#define BREF_API_ARENA_H_
+
+#include "detail/Config.h"
+#include "detail/mp/AlignmentOf.hpp"
+#include "detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace bref {
+
+namespace detail {
+
+/**
+ * Type with the strictest alignment for the fundamental types.
+ */
+union MaxAlign
+{
+  long         l;
+  double       d;
+  long double  ld;
+  void        *p;
+  void       (*f)();
+};
+
+} // ! detail
+
+/**
+ * \brief A bump allocator for the memory of a request.
+ *
+ * The memory is taken from blocks allocated on demand and is released
+ * all at once by reset(). The blocks are kept for the next request,
+ * when more than one block was used they are merged in a single
+ * block, large enough for the next requests of the same size. A
+ * keep-alive connection does not allocate anymore after its first
+ * requests.
+ *
+ * The destructors of the objects created in an arena are not called,
+ * only trivially destructible objects or objects with an arena
+ * allocator (see ArenaAllocator) should be created, and destroyed
+ * before reset().
+ *
+ * Example:
+\code
+bref::Arena arena;
+
+char *copy = static_cast<char *>(arena.allocate(uri.size()));
+
+std::memcpy(copy, uri.data(), uri.size());
+// ...
+arena.reset();
+\endcode
+ *
+ * \sa ArenaAllocator, Environment::arena
+ */
+class Arena : util::NonCopyable
+{
+private:
+  struct Block
+  {
+    Block       *next;
+    std::size_t  size;
+  };
+
+  /// the blocks, the most recent first
+  Block       *blocks_;
+  std::size_t  used_;
+  std::size_t  blockSize_;
+
+  static char *dataOf(Block *block)
+  {
+    return reinterpret_cast<char *>(block) + HeaderSize;
+  }
+
+  static void releaseBlocks(Block *block)
+  {
+    while (block)
+      {
+        Block *next = block->next;
+
+        ::operator delete(block);
+        block = next;
+      }
+  }
+
+  static std::size_t alignedOffset(const char *data, std::size_t offset, std::size_t alignment)
+  {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(data + offset);
+
+    return offset + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+  }
+
+  void addBlock(std::size_t minimumSize)
+  {
+    const std::size_t size  = minimumSize > blockSize_ ? minimumSize : blockSize_;
+    Block            *block = static_cast<Block *>(::operator new(HeaderSize + size));
+
+    block->next = blocks_;
+    block->size = size;
+    blocks_     = block;
+    used_       = 0;
+  }
+
+public:
+  /// Alignment used by default, suitable for any fundamental type.
+  static const std::size_t DefaultAlignment = mp::AlignmentOf<detail::MaxAlign>::value;
+
+  /// Size reserved at the beginning of each block.
+  static const std::size_t HeaderSize =
+    (sizeof(Block) + DefaultAlignment - 1) / DefaultAlignment * DefaultAlignment;
+
+  /**
+   * \param blockSize
+   *            The minimum size of the blocks, the first block is
+   *            allocated on the first call to allocate().
+   */
+  explicit Arena(std::size_t blockSize = 4096)
+    : blocks_(0), used_(0), blockSize_(blockSize)
+  { }
+
+  ~Arena()
+  {
+    releaseBlocks(blocks_);
+  }
+
+  /**
+   * \brief Allocate \p size bytes aligned on \p alignment.
+   *
+   * \param alignment
+   *            Should be a power of 2.
+   *
+   * \throw std::bad_alloc
+   */
+  void *allocate(std::size_t size, std::size_t alignment = DefaultAlignment)
+  {
+    if (blocks_)
+      {
+        const std::size_t offset = alignedOffset(dataOf(blocks_), used_, alignment);
+
+        if (offset + size <= blocks_->size)
+          {
+            used_ = offset + size;
+            return dataOf(blocks_) + offset;
+          }
+      }
+
+    addBlock(size + alignment);
+
+    const std::size_t offset = alignedOffset(dataOf(blocks_), 0, alignment);
+
+    used_ = offset + size;
+    return dataOf(blocks_) + offset;
+  }
+
+  /**
+   * \brief Release all the memory allocated in the arena.
+   *
+   * The blocks are kept for the next allocations, when several blocks
+   * were used they are replaced by a single one of the same total
+   * size.
+   */
+  void reset()
+  {
+    if (blocks_ && blocks_->next)
+      {
+        std::size_t total = 0;
+
+        for (Block *block = blocks_; block; block = block->next)
+          total += block->size;
+        releaseBlocks(blocks_);
+        blocks_ = 0;
+        addBlock(total);
+      }
+    used_ = 0;
+  }
+
+  /**
+   * \brief Release all the memory allocated in the arena and give the
+   *        blocks back to the system.
+   */
+  void release()
+  {
+    releaseBlocks(blocks_);
+    blocks_ = 0;
+    used_   = 0;
+  }
+
+  /**
+   * \brief Number of bytes reserved by the arena.
+   */
+  std::size_t capacity() const
+  {
+    std::size_t total = 0;
+
+    for (const Block *block = blocks_; block; block = block->next)
+      total += block->size;
+    return total;
+  }
+};
+
+/**
+ * \brief A standard allocator taking its memory from an Arena.
+ *
+ * The deallocation does nothing, the memory is given back by
+ * Arena::reset(). The containers using this allocator should be
+ * destroyed before the arena is reset.
+ *
+ * Example:
+\code
+typedef std::vector<bref::HttpRequest *,
+                    bref::ArenaAllocator<bref::HttpRequest *> > RequestList;
+
+RequestList pending((bref::ArenaAllocator<bref::HttpRequest *>(arena)));
+\endcode
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+  typedef T                 value_type;
+  typedef T *               pointer;
+  typedef const T *         const_pointer;
+  typedef T &               reference;
+  typedef const T &         const_reference;
+  typedef std::size_t       size_type;
+  typedef std::ptrdiff_t    difference_type;
+
+  template <typename U>
+  struct rebind
+  {
+    typedef ArenaAllocator<U> other;
+  };
+
+private:
+  template <typename U> friend class ArenaAllocator;
+
+  Arena *arena_;
+
+public:
+  explicit ArenaAllocator(Arena & arena)
+    : arena_(&arena)
+  { }
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> & other)
+    : arena_(other.arena_)
+  { }
+
+  Arena & arena() const
+  {
+    return *arena_;
+  }
+
+  pointer address(reference x) const
+  {
+    return &x;
+  }
+
+  const_pointer address(const_reference x) const
+  {
+    return &x;
+  }
+
+  pointer allocate(size_type n, const void * /* hint */ = 0)
+  {
+    if (n > max_size())
+      throw std::bad_alloc();
+    return static_cast<pointer>(arena_->allocate(n * sizeof(T), mp::AlignmentOf<T>::value));
+  }
+
+  void deallocate(pointer, size_type)
+  { }
+
+  size_type max_size() const
+  {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  void construct(pointer p, const_reference value)
+  {
+    new (static_cast<void *>(p)) T(value);
+  }
+
+  void destroy(pointer p)
+  {
+    p->~T();
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> & other) const
+  {
+    return arena_ == other.arena_;
+  }
+
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> & other) const
+  {
+    return arena_ != other.arena_;
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_ARENA_H_ */
@@ -0,0 +1,610 @@
+/**
+ * \file   AsyncLogger.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May  9 20:14:51 2012
+ *
+ * \brief  AsyncLogger class definition.
+ *
+ * \note This logger requires C++11 (threads and atomics).
+ */
+
+#ifndef BREF_API_ASYNCLOGGER_H_
+#define BREF_API_ASYNCLOGGER_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/AsyncLogger.h requires C++11"
+#endif
+
+#include "Function.hpp"
+#include "ILogger.h"
+#include "detail/util/IntFormat.hpp"
+#include "detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32)
+# include <errno.h>
+# include <unistd.h>
+#endif
+
+namespace bref {
+
+/**
+ * \brief An ILogger writing the messages from a background thread.
+ *
+ * Each thread logging a message gets its own ring buffer, a
+ * single-producer single-consumer queue without lock. A writer thread
+ * drains the rings, formats the records and gives them to the output
+ * in large batches, the logging thread never waits for the output.
+ *
+ * The messages of one thread are written in order, the messages of
+ * different threads are not sorted.
+ *
+ * Example:
+\code
+bref::AsyncLogger logger(bref::AsyncLogger::FdWriter(STDERR_FILENO));
+
+LOG_INFO(&logger) << "server started";
+\endcode
+ *
+ * A line is written for each message:
+\verbatim
+2012-05-09 20:14:51.123456 INFO server started
+\endverbatim
+ * The time is in UTC.
+ *
+ * \sa ILogger, ScopedLogger
+ */
+class AsyncLogger : public ILogger, util::NonCopyable
+{
+public:
+  /**
+   * \brief The output of the logger, called from the writer thread
+   *        with a batch of lines.
+   */
+  typedef Function<void (const char *data, std::size_t size)> Writer;
+
+  /**
+   * \brief What to do when the ring of a thread is full.
+   */
+  enum OverflowPolicy
+    {
+      DropNewest,      /**< the message is dropped and counted, see dropped() */
+      Block            /**< the logging thread waits for the writer */
+    };
+
+  /**
+   * \brief Tuning of the logger.
+   */
+  struct Options
+  {
+    Options()
+      : ringSize(64 * 1024)
+      , batchSize(64 * 1024)
+      , flushInterval(10)
+      , overflow(DropNewest)
+    { }
+
+    std::size_t     ringSize;      /**< size of the ring of each thread, rounded to a power of 2 */
+    std::size_t     batchSize;     /**< size from which a batch is given to the Writer */
+    unsigned        flushInterval; /**< maximum delay before a message is written, in milliseconds */
+    OverflowPolicy  overflow;      /**< behavior when the ring of a thread is full */
+  };
+
+#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32)
+  /**
+   * \brief A Writer for a file descriptor.
+   *
+   * The file descriptor is not closed.
+   */
+  struct FdWriter
+  {
+    int fd;
+
+    explicit FdWriter(int theFd)
+      : fd(theFd)
+    { }
+
+    void operator()(const char *data, std::size_t size) const
+    {
+      while (size)
+        {
+          const ssize_t written = ::write(fd, data, size);
+
+          if (written < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              return;
+            }
+          data += written;
+          size -= written;
+        }
+    }
+  };
+#endif
+
+private:
+  /**
+   * Header of a message in a ring.
+   */
+  struct Record
+  {
+    uint32_t  size;
+    uint32_t  severity;
+    int64_t   time;             // microseconds since the epoch
+  };
+
+  /**
+   * Single-producer single-consumer ring of records, the positions
+   * only grow and are wrapped with mask_.
+   */
+  class Ring : util::NonCopyable
+  {
+  private:
+    std::unique_ptr<char[]>  data_;
+    const std::size_t        mask_;
+    alignas(64) std::atomic<std::size_t> head_; // consumer position
+    alignas(64) std::atomic<std::size_t> tail_; // producer position
+    std::atomic<bool>        abandoned_;
+
+    void copyIn(std::size_t pos, const void *src, std::size_t size)
+    {
+      const std::size_t offset = pos & mask_;
+      const std::size_t first  = std::min(size, mask_ + 1 - offset);
+
+      std::memcpy(&data_[offset], src, first);
+      std::memcpy(&data_[0], static_cast<const char *>(src) + first, size - first);
+    }
+
+    void copyOut(std::size_t pos, void *dest, std::size_t size) const
+    {
+      const std::size_t offset = pos & mask_;
+      const std::size_t first  = std::min(size, mask_ + 1 - offset);
+
+      std::memcpy(dest, &data_[offset], first);
+      std::memcpy(static_cast<char *>(dest) + first, &data_[0], size - first);
+    }
+
+  public:
+    explicit Ring(std::size_t size)
+      : data_(new char[size]), mask_(size - 1), head_(0), tail_(0), abandoned_(false)
+    { }
+
+    std::size_t capacity() const
+    {
+      return mask_ + 1;
+    }
+
+    /**
+     * Called by the producer, false if there is not enough room.
+     */
+    bool push(const Record & record, const char *message)
+    {
+      const std::size_t size = sizeof record + record.size;
+      const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+      if (size > capacity() - (tail - head_.load(std::memory_order_acquire)))
+        return false;
+      copyIn(tail, &record, sizeof record);
+      copyIn(tail + sizeof record, message, record.size);
+      tail_.store(tail + size, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Called by the consumer, \p consume is called with each record
+     * and its message.
+     */
+    template <typename Consumer>
+    void drain(Consumer & consume, std::string & message)
+    {
+      std::size_t       head = head_.load(std::memory_order_relaxed);
+      const std::size_t tail = tail_.load(std::memory_order_acquire);
+
+      while (head != tail)
+        {
+          Record record;
+
+          copyOut(head, &record, sizeof record);
+          message.resize(record.size);
+          copyOut(head + sizeof record, &message[0], record.size);
+          head += sizeof record + record.size;
+          head_.store(head, std::memory_order_release);
+          consume(record, message);
+        }
+    }
+
+    bool empty() const
+    {
+      return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    void abandon()
+    {
+      abandoned_.store(true, std::memory_order_release);
+    }
+
+    bool abandoned() const
+    {
+      return abandoned_.load(std::memory_order_acquire);
+    }
+  };
+
+  typedef std::shared_ptr<Ring> RingPtr;
+
+  /**
+   * The rings of the current thread, by logger identifier. The rings
+   * are abandoned when the thread exits, the writer releases them once
+   * they are drained.
+   */
+  struct ThreadRings
+  {
+    std::vector<std::pair<uint64_t, RingPtr> > rings;
+
+    ~ThreadRings()
+    {
+      for (std::size_t i = 0; i < rings.size(); ++i)
+        rings[i].second->abandon();
+    }
+  };
+
+  static ThreadRings & threadRings()
+  {
+    thread_local ThreadRings rings;
+
+    return rings;
+  }
+
+  static uint64_t nextId()
+  {
+    static std::atomic<uint64_t> counter(0);
+
+    return ++counter;
+  }
+
+  /**
+   * Formats the records of the rings into the batch.
+   */
+  struct Formatter
+  {
+    AsyncLogger & logger;
+
+    void operator()(const Record & record, const std::string & message)
+    {
+      logger.format(record, message);
+    }
+  };
+
+  const uint64_t            id_;
+  const Options             options_;
+  Writer                    writer_;
+  std::atomic<int>          severity_;
+  std::atomic<uint64_t>     dropped_;
+  std::atomic<bool>         wakeup_;
+
+  std::mutex                mutex_;
+  std::condition_variable   wakeupCondition_;
+  std::condition_variable   flushedCondition_;
+  std::vector<RingPtr>      rings_;
+  uint64_t                  flushRequests_;
+  uint64_t                  flushed_;
+  bool                      stop_;
+
+  // writer thread only
+  std::string               batch_;
+  std::string               message_;
+  int64_t                   prefixSecond_;
+  char                      prefix_[20];
+  uint64_t                  reportedDrops_;
+
+  std::thread               thread_;
+
+  static std::size_t roundRingSize(std::size_t size)
+  {
+    std::size_t rounded = 4096;
+
+    while (rounded < size)
+      rounded *= 2;
+    return rounded;
+  }
+
+  static const char *severityName(uint32_t severity)
+  {
+    static const char *const names[] = { "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+
+    return severity < sizeof names / sizeof *names ? names[severity] : "?";
+  }
+
+  Ring & threadRing()
+  {
+    std::vector<std::pair<uint64_t, RingPtr> > & rings = threadRings().rings;
+
+    for (std::size_t i = 0; i < rings.size(); ++i)
+      if (rings[i].first == id_)
+        return *rings[i].second;
+
+    // forget the rings of the destroyed loggers
+    for (std::size_t i = 0; i < rings.size(); )
+      if (rings[i].second.use_count() == 1)
+        {
+          rings[i].swap(rings.back());
+          rings.pop_back();
+        }
+      else
+        ++i;
+
+    RingPtr ring = std::make_shared<Ring>(roundRingSize(options_.ringSize));
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      rings_.push_back(ring);
+    }
+    rings.push_back(std::make_pair(id_, ring));
+    return *ring;
+  }
+
+  void wakeup()
+  {
+    if (! wakeup_.exchange(true, std::memory_order_acq_rel))
+      wakeupCondition_.notify_one();
+  }
+
+  /**
+   * "YYYY-MM-DD HH:MM:SS" of \p second, computed once per second.
+   */
+  const char *formatSecond(int64_t second)
+  {
+    if (second != prefixSecond_)
+      {
+        const std::time_t time = static_cast<std::time_t>(second);
+        std::tm           tm;
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+        gmtime_s(&tm, &time);
+#else
+        gmtime_r(&time, &tm);
+#endif
+        std::strftime(prefix_, sizeof prefix_, "%Y-%m-%d %H:%M:%S", &tm);
+        prefixSecond_ = second;
+      }
+    return prefix_;
+  }
+
+  void format(const Record & record, const std::string & message)
+  {
+    const int64_t second = record.time / 1000000;
+    const long    micros = static_cast<long>(record.time % 1000000);
+    char          digits[util::MaxDecimalSize];
+    const char   *name   = severityName(record.severity);
+
+    batch_.append(formatSecond(second), sizeof prefix_ - 1);
+    batch_.push_back('.');
+    // zero padded microseconds
+    const std::size_t size = util::formatDecimal(micros, digits);
+    batch_.append(6 - size, '0');
+    batch_.append(digits, size);
+    batch_.push_back(' ');
+    batch_.append(name);
+    batch_.push_back(' ');
+    batch_.append(message);
+    batch_.push_back('\n');
+    if (batch_.size() >= options_.batchSize)
+      writeBatch();
+  }
+
+  void writeBatch()
+  {
+    if (! batch_.empty())
+      {
+        writer_(batch_.data(), batch_.size());
+        batch_.clear();
+      }
+  }
+
+  void reportDrops()
+  {
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+
+    if (dropped == reportedDrops_)
+      return;
+
+    Record      record;
+    std::string message("messages dropped: ");
+    char        digits[util::MaxDecimalSize];
+
+    message.append(digits, util::formatUnsigned(static_cast<unsigned long>(dropped - reportedDrops_), digits));
+    record.size     = static_cast<uint32_t>(message.size());
+    record.severity = Warning;
+    record.time     = now();
+    format(record, message);
+    reportedDrops_ = dropped;
+  }
+
+  static int64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<RingPtr>         rings;
+    Formatter                    formatter = { *this };
+
+    for (;;)
+      {
+        const bool     stopping  = stop_;
+        const uint64_t requested = flushRequests_;
+
+        rings = rings_;
+        lock.unlock();
+
+        wakeup_.store(false, std::memory_order_release);
+        for (std::size_t i = 0; i < rings.size(); ++i)
+          rings[i]->drain(formatter, message_);
+        reportDrops();
+        writeBatch();
+
+        lock.lock();
+        // the rings of the finished threads are released once drained
+        for (std::size_t i = 0; i < rings_.size(); )
+          if (rings_[i]->abandoned() && rings_[i]->empty())
+            {
+              rings_[i].swap(rings_.back());
+              rings_.pop_back();
+            }
+          else
+            ++i;
+        rings.clear();
+        flushed_ = requested;
+        flushedCondition_.notify_all();
+        if (stopping)
+          return;
+        wakeupCondition_.wait_for(lock, std::chrono::milliseconds(options_.flushInterval),
+                                  [this] {
+                                    return stop_ || flushRequests_ != flushed_ ||
+                                      wakeup_.load(std::memory_order_acquire);
+                                  });
+      }
+  }
+
+public:
+  /**
+   * \brief Create the logger and start its writer thread.
+   *
+   * \param writer
+   *            The output of the logger.
+   * \param options
+   *            The tuning of the logger.
+   * \param severity
+   *            The initial severity.
+   */
+  explicit AsyncLogger(const Writer & writer,
+                       const Options & options = Options(),
+                       Severity severity = Info)
+    : id_(nextId())
+    , options_(options)
+    , writer_(writer)
+    , severity_(severity)
+    , dropped_(0)
+    , wakeup_(false)
+    , flushRequests_(0)
+    , flushed_(0)
+    , stop_(false)
+    , prefixSecond_(-1)
+    , reportedDrops_(0)
+  {
+    batch_.reserve(options_.batchSize + 4096);
+    thread_ = std::thread(&AsyncLogger::run, this);
+  }
+
+  /**
+   * \brief Write the pending messages and stop the writer thread.
+   */
+  virtual ~AsyncLogger()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      stop_ = true;
+    }
+    wakeupCondition_.notify_one();
+    thread_.join();
+  }
+
+  virtual Severity severity() const
+  {
+    return static_cast<Severity>(severity_.load(std::memory_order_relaxed));
+  }
+
+  virtual void setSeverity(Severity newSeverity)
+  {
+    severity_.store(newSeverity, std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Queue a message, it's written later by the writer thread.
+   *
+   * The messages larger than a quarter of the ring size are truncated.
+   * When the ring of the thread is full the message is dropped or the
+   * call waits, depending on Options::overflow.
+   */
+  virtual void log(Severity messageSeverity, const std::string & message)
+  {
+    logBuffer(messageSeverity, message.data(), message.size());
+  }
+
+  /**
+   * \brief Queue a message without building a \c std::string.
+   *
+   * \sa log()
+   */
+  virtual void logBuffer(Severity messageSeverity, const char *message, std::size_t size)
+  {
+    if (messageSeverity < severity())
+      return;
+
+    Ring & ring = threadRing();
+    Record record;
+
+    record.size     = static_cast<uint32_t>(std::min(size, ring.capacity() / 4));
+    record.severity = messageSeverity;
+    record.time     = now();
+
+    while (! ring.push(record, message))
+      {
+        wakeup();
+        if (options_.overflow == DropNewest)
+          {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+          }
+        std::this_thread::yield();
+      }
+    if (messageSeverity >= Error)
+      wakeup();
+  }
+
+  /**
+   * \brief Wait until the messages logged before the call are given to
+   *        the Writer.
+   */
+  void flush()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t               request = ++flushRequests_;
+
+    wakeup();
+    flushedCondition_.wait(lock, [this, request] { return flushed_ >= request; });
+  }
+
+  /**
+   * \brief Number of messages dropped because a ring was full.
+   */
+  uint64_t dropped() const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_ASYNCLOGGER_H_ */
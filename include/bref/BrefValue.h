@@ -13,28 +13,52 @@
 #pragma once
 
 #include "detail/BrefDLL.h"
-#include <list>
-#include <map>
+#include "detail/Config.h"
+#include "detail/mp/AlignmentOf.hpp"
+#include "detail/util/FlatMap.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <new>
 #include <string>
+#include <utility>
+#include <vector>
+
+#ifdef BREF_VALUE_NODE_CONTAINERS
+# include <list>
+# include <map>
+#endif
 
 namespace bref {
 
 // Forward declaration of the BrefValue class
 class BREF_DLL BrefValue;
 
+#ifndef BREF_VALUE_NODE_CONTAINERS
 /**
  * \brief Describe a list of BrefValue.
  *
+ * The elements are contiguous in memory. Define
+ * \c BREF_VALUE_NODE_CONTAINERS to get the previous \c std::list and
+ * \c std::map, if some code relies on the stability of their
+ * iterators.
+ *
  * \note This is also a bref value in itself.
  */
-typedef std::list<BrefValue>             BrefValueList;
+typedef std::vector<BrefValue>                   BrefValueList;
 
 /**
  * \brief Describe an associative array of \c std::string - \c BrefValue.
  *
+ * The elements are sorted by key in a contiguous array (see
+ * util::FlatMap), the interface is the one of \c std::map.
+ *
  * \note This is also a bref value in itself.
  */
-typedef std::map<std::string, BrefValue> BrefValueArray;
+typedef util::FlatMap<std::string, BrefValue>    BrefValueArray;
+#else
+typedef std::list<BrefValue>                     BrefValueList;
+typedef std::map<std::string, BrefValue>         BrefValueArray;
+#endif  // ! BREF_VALUE_NODE_CONTAINERS
 
 /**
  * \brief Contains a generic value
@@ -77,192 +101,524 @@ class BREF_DLL BrefValue
   /**
    * \brief Default constructor, build a Null BrefValue.
    */
-  BrefValue();
+  BrefValue()
+    : type_(nullType)
+  { }
 
   /**
    * \brief Build a BrefValue with a bool.
    */
-  BrefValue(bool);
+  BrefValue(bool value)
+    : type_(boolType)
+  {
+    value_.boolValue = value;
+  }
 
   /**
    * \brief Build a BrefValue with a string.
    */
-  BrefValue(const std::string &);
+  BrefValue(const std::string & value)
+    : type_(stringType)
+  {
+    new (value_.stringValue) std::string(value);
+  }
+
+  /**
+   * \brief Build a BrefValue with a C string.
+   *
+   * Without this constructor a string literal would be converted to a
+   * boolean.
+   */
+  BrefValue(const char *value)
+    : type_(stringType)
+  {
+    new (value_.stringValue) std::string(value);
+  }
 
   /**
    * \brief Build a BrefValue with an integer.
    */
-  BrefValue(int);
+  BrefValue(int value)
+    : type_(intType)
+  {
+    value_.intValue = value;
+  }
 
   /**
    * \brief Build a BrefValue with a double.
    */
-  BrefValue(double);
+  BrefValue(double value)
+    : type_(doubleType)
+  {
+    value_.doubleValue = value;
+  }
 
   /**
    * \brief Build a BrefValue with a BrefValueArray
    */
-  BrefValue(const BrefValueArray &);
+  BrefValue(const BrefValueArray & value)
+    : type_(arrayType)
+  {
+    value_.arrayValue = new BrefValueArray(value);
+  }
+
+#ifdef BREF_CXX11
+  /**
+   * \brief Build a BrefValue with a BrefValueArray, its elements are
+   *        moved.
+   */
+  BrefValue(BrefValueArray && value)
+    : type_(arrayType)
+  {
+    value_.arrayValue = new BrefValueArray(std::move(value));
+  }
+#endif  // BREF_CXX11
 
   /**
    * \brief Build a BrefValue with a BrefValueList
    */
-  BrefValue(const BrefValueList &);
+  BrefValue(const BrefValueList & value)
+    : type_(listType)
+  {
+    value_.listValue = new BrefValueList(value);
+  }
+
+  BrefValue(const BrefValue & other)
+    : type_(nullType)
+  {
+    copyFrom(other);
+  }
+
+#ifdef BREF_CXX11
+  BrefValue(BrefValue && other) noexcept
+    : type_(nullType)
+  {
+    moveFrom(other);
+  }
+
+  BrefValue & operator=(BrefValue && other) noexcept
+  {
+    if (&other != this)
+      {
+        destroy();
+        moveFrom(other);
+      }
+    return *this;
+  }
+#endif  // BREF_CXX11
+
+  /**
+   * \brief Copy a value, the memory of a string is reused when both
+   *        values are strings.
+   */
+  BrefValue & operator=(const BrefValue & other)
+  {
+    if (type_ == stringType && other.type_ == stringType)
+      string().assign(other.string());
+    else if (&other != this)
+      BrefValue(other).swap(*this);
+    return *this;
+  }
+
+  ~BrefValue()
+  {
+    destroy();
+  }
+
+  /**
+   * \brief Exchange the content of two values.
+   */
+  void swap(BrefValue & other) BREF_NOEXCEPT
+  {
+    if (type_ == stringType && other.type_ == stringType)
+      string().swap(other.string());
+    else if (&other != this)
+      {
+        BrefValue tmp;
+
+        tmp.moveFrom(*this);
+        moveFrom(other);
+        other.moveFrom(tmp);
+      }
+  }
 
   /**
    * \brief Gets the type of the value
    */
 
-  confType getType() const;
+  confType getType() const
+  {
+    return type_;
+  }
 
   /**
    * \brief Clear Node content
    */
-  void clear();
+  void clear()
+  {
+    setNull();
+  }
 
   /**
    * \brief Test if value is null
    */
-  bool isNull() const;
+  bool isNull() const
+  {
+    return type_ == nullType;
+  }
 
   /**
    * \brief Test if value is a string
    */
-  bool isString() const;
+  bool isString() const
+  {
+    return type_ == stringType;
+  }
 
   /**
    * \brief Test if value is a boolean
    */
-  bool isBool() const;
+  bool isBool() const
+  {
+    return type_ == boolType;
+  }
 
   /**
    * \brief Test if value is an integer
    */
-  bool isInt() const;
+  bool isInt() const
+  {
+    return type_ == intType;
+  }
 
   /**
    * \brief test if valuer is a double
    */
-  bool isDouble() const;
+  bool isDouble() const
+  {
+    return type_ == doubleType;
+  }
 
   /**
    * \brief Test if value is a list
    */
-  bool isList() const;
+  bool isList() const
+  {
+    return type_ == listType;
+  }
 
   /**
    * \brief Test if value is an array
    */
-  bool isArray() const;
+  bool isArray() const
+  {
+    return type_ == arrayType;
+  }
 
   /**
    * \brief If it's a string, get the value
    */
-  const std::string & asString() const;
+  const std::string & asString() const
+  {
+    static const std::string empty;
+
+    return type_ == stringType ? string() : empty;
+  }
 
   /**
    * \brief If it's a boolean, get the value
    */
-  bool asBool() const;
+  bool asBool() const
+  {
+    return type_ == boolType ? value_.boolValue : false;
+  }
 
   /**
    * \brief If it's an integer, get the value
    */
-  int asInt() const;
+  int asInt() const
+  {
+    return type_ == intType ? value_.intValue : 0;
+  }
 
   /**
    * \brief If it's a double, get the value
    */
-  double asDouble() const;
+  double asDouble() const
+  {
+    return type_ == doubleType ? value_.doubleValue : 0.;
+  }
 
   /**
    * \brief If it's a list, get the value
    */
-  const BrefValueList & asList() const;
+  const BrefValueList & asList() const
+  {
+    static const BrefValueList empty;
+
+    return type_ == listType ? *value_.listValue : empty;
+  }
 
   /**
    * \brief If it's an array, get the value
    */
-  const BrefValueArray & asArray() const;
+  const BrefValueArray & asArray() const
+  {
+    static const BrefValueArray empty;
+
+    return type_ == arrayType ? *value_.arrayValue : empty;
+  }
 
   /**
    * \brief Check if key exists in array
    * \param key checked array key
    */
-  bool hasKey(std::string const & key) const;
+  bool hasKey(std::string const & key) const
+  {
+    return type_ == arrayType && value_.arrayValue->count(key) != 0;
+  }
+
+  /**
+   * \brief Access to array element. Proxy method to BrefValueArray::operator[].
+   *
+   * If the value is not an array, it's replaced by an empty array
+   * first.
+   */
+  BrefValue & operator[](std::string const & key)
+  {
+    if (type_ != arrayType)
+      BrefValue(BrefValueArray()).swap(*this);
+    return (*value_.arrayValue)[key];
+  }
+
+  /**
+   * \brief Push element in list. Proxy method to BrefValueList::push_back.
+   *
+   * If the value is not a list, it's replaced by an empty list first.
+   */
+  void push(const bref::BrefValue &node)
+  {
+    if (type_ != listType)
+      BrefValue(BrefValueList()).swap(*this);
+#if !defined(BREF_CXX11) && !defined(BREF_VALUE_NODE_CONTAINERS)
+    // without move semantic, the growth of the vector would copy
+    // every element (and their subtrees), they are exchanged instead
+    BrefValueList & list = *value_.listValue;
+
+    if (list.size() == list.capacity())
+      {
+        BrefValueList bigger;
+
+        bigger.reserve(list.empty() ? 8 : 2 * list.capacity());
+        bigger.resize(list.size());
+        // node can be an element of the list, copied before the swaps
+        bigger.push_back(node);
+        for (BrefValueList::size_type i = 0; i < list.size(); ++i)
+          bigger[i].swap(list[i]);
+        list.swap(bigger);
+        return;
+      }
+#endif
+    value_.listValue->push_back(node);
+  }
 
   /**
-   * \brief Access to array element. Proxy method to arrayValue_.
+   * \brief Set the content as null
    */
-  BrefValue & operator[](std::string const & key);
+  void setNull()
+  {
+    destroy();
+  }
 
   /**
-   * \brief Push element in list. Proxy method to listValue_.push_back.
+   * \brief Set a string as content
    */
-  void push(const bref::BrefValue &node);
+  void setString(std::string const & value)
+  {
+    if (type_ == stringType)
+      string().assign(value);
+    else
+      BrefValue(value).swap(*this);
+  }
 
   /**
-   * \brief Set the content as null
+   * \brief Set the \p size characters at \p value as content, the
+   *        storage of a string content is reused.
    */
-  void setNull();
+  void setString(const char *value, std::size_t size)
+  {
+    if (type_ != stringType)
+      {
+        destroy();
+        new (value_.stringValue) std::string();
+        type_ = stringType;
+      }
+    string().assign(value, size);
+  }
 
   /**
-   * \brief Set a string as content
+   * \brief Append the \p size characters at \p value to the content,
+   *        a content which is not a string is replaced.
    */
-  void setString(std::string const &);
+  void appendString(const char *value, std::size_t size)
+  {
+    if (type_ == stringType)
+      string().append(value, size);
+    else
+      setString(value, size);
+  }
 
   /**
    * \brief Set a boolean as content
    */
-  void setBool(bool);
+  void setBool(bool value)
+  {
+    destroy();
+    type_ = boolType;
+    value_.boolValue = value;
+  }
 
   /**
    * \brief Set integer as content
    */
-  void setInt(int);
+  void setInt(int value)
+  {
+    destroy();
+    type_ = intType;
+    value_.intValue = value;
+  }
 
   /**
    * \brief Set a double as content
    */
-   void setDouble(double);
+   void setDouble(double value)
+   {
+     destroy();
+     type_ = doubleType;
+     value_.doubleValue = value;
+   }
 
 private:
   /**
-   * \brief Contains type of Node
-   */
-  confType type_;
-
-  /**
-   * \brief Contains node string
-   */
-  std::string stringValue_;
-
-  /**
-   * \brief Contains node boolean
+   * \brief Contains the value, only the member matching the type is
+   *        constructed.
+   *
+   * The lists and arrays are stored out of line, they are mostly used
+   * by the configuration and would make every value larger.
    */
-  bool boolValue_;
+  union Storage
+  {
+    bool            boolValue;
+    int             intValue;
+    double          doubleValue;
+    BrefValueArray *arrayValue;
+    BrefValueList  *listValue;
+    char            stringValue[sizeof(std::string)];
+    void           *alignment_;
+  };
 
   /**
-   * \brief Contains node double
-   */
-  double doubleValue_;
-
-  /**
-   * \brief Contains node integer
-   */
-  int intValue_;
-
-  /**
-   * \brief Contains node array
+   * \brief Contains type of Node
    */
-  BrefValueArray arrayValue_;
+  confType type_;
 
   /**
-   * \brief Contains node list
-   */
-  BrefValueList listValue_;
+   * \brief Contains node value
+   */
+  Storage  value_;
+
+  typedef char StringFitsInStorage[static_cast<int>(mp::AlignmentOf<std::string>::value) <=
+                                   static_cast<int>(mp::AlignmentOf<Storage>::value) ? 1 : -1];
+
+  std::string & string()
+  {
+    return *reinterpret_cast<std::string *>(value_.stringValue);
+  }
+
+  const std::string & string() const
+  {
+    return *reinterpret_cast<const std::string *>(value_.stringValue);
+  }
+
+  /**
+   * \brief Destroy the content, the value is null afterwards.
+   */
+  void destroy()
+  {
+    switch (type_)
+      {
+      case stringType:
+        {
+          typedef std::string StringType;
+
+          string().~StringType();
+          break;
+        }
+      case arrayType:
+        delete value_.arrayValue;
+        break;
+      case listType:
+        delete value_.listValue;
+        break;
+      default:
+        break;
+      }
+    type_ = nullType;
+  }
+
+  /**
+   * \brief Copy the content of \p other, the value should be null.
+   */
+  void copyFrom(const BrefValue & other)
+  {
+    switch (other.type_)
+      {
+      case stringType:
+        new (value_.stringValue) std::string(other.string());
+        break;
+      case arrayType:
+        value_.arrayValue = new BrefValueArray(*other.value_.arrayValue);
+        break;
+      case listType:
+        value_.listValue = new BrefValueList(*other.value_.listValue);
+        break;
+      default:
+        value_ = other.value_;
+        break;
+      }
+    type_ = other.type_;
+  }
+
+  /**
+   * \brief Take the content of \p other, the value should be null and
+   *        \p other is null afterwards.
+   */
+  void moveFrom(BrefValue & other) BREF_NOEXCEPT
+  {
+    if (other.type_ == stringType)
+      {
+        new (value_.stringValue) std::string();
+        string().swap(other.string());
+        other.destroy();
+        type_ = stringType;
+      }
+    else
+      {
+        value_ = other.value_;
+        type_ = other.type_;
+        other.type_ = nullType;
+      }
+  }
 };
 
+/**
+ * \brief Exchange the content of two values.
+ */
+inline void swap(BrefValue & a, BrefValue & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
+
 } // ! bref
 
 #endif /* ! _BREF_API_BREFVALUE_H_ */
@@ -0,0 +1,703 @@
+/**
+ * \file   BrefValueView.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 14 19:22:03 2012
+ *
+ * \brief  BrefValueImage, BrefValueView and MappedBrefValue
+ *         definitions.
+ *
+ */
+
+#ifndef BREF_API_BREFVALUEVIEW_H_
+#define BREF_API_BREFVALUEVIEW_H_
+
+#include "BrefValue.h"
+#include "Buffer.h"
+#include "detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace bref {
+
+/**
+ * \brief A read-only BrefValue stored in a binary image (see
+ *        BrefValueImage).
+ *
+ * A view is a pointer on the image and an offset, it's cheap to copy.
+ * Nothing is parsed nor allocated to read a value, except by
+ * asString() and toBrefValue() which return copies.
+ *
+ * The lists and arrays are the view itself, there is no asList() nor
+ * asArray():
+\code
+bref::BrefValueView hosts = config["VirtualHosts"];
+
+for (std::size_t i = 0; i < hosts.size(); ++i)
+  std::cout << hosts.keyAt(i) << ": " << hosts.at(i)["DocumentRoot"].asCString() << std::endl;
+\endcode
+ *
+ * A missing key, an index out of range or a view on something that
+ * is not a list or an array give a null view.
+ *
+ * \warning The image should outlive the views.
+ *
+ * \sa BrefValueImage, MappedBrefValue
+ */
+class BrefValueView
+{
+private:
+  friend class BrefValueImage;
+
+  const char *image_;
+  uint32_t    offset_;
+
+  BrefValueView(const char *image, uint32_t offset)
+    : image_(image), offset_(offset)
+  { }
+
+#ifdef BREF_CXX11
+  /**
+   * The elements of an array converted to BrefValueArray::value_type,
+   * an input iterator for BrefValueArray::insert(first, last).
+   */
+  class ArrayInput
+  {
+  private:
+    const BrefValueView *array_;
+    std::size_t          index_;
+
+  public:
+    typedef std::input_iterator_tag    iterator_category;
+    typedef BrefValueArray::value_type value_type;
+    typedef std::ptrdiff_t             difference_type;
+    typedef const value_type          *pointer;
+    typedef value_type                 reference;
+
+    ArrayInput(const BrefValueView & array, std::size_t index)
+      : array_(&array), index_(index)
+    { }
+
+    value_type operator*() const
+    {
+      return value_type(array_->keyAt(index_), array_->at(index_).toBrefValue());
+    }
+
+    ArrayInput & operator++()
+    {
+      ++index_;
+      return *this;
+    }
+
+    bool operator==(const ArrayInput & other) const
+    {
+      return index_ == other.index_;
+    }
+
+    bool operator!=(const ArrayInput & other) const
+    {
+      return index_ != other.index_;
+    }
+  };
+#endif  // BREF_CXX11
+
+  uint32_t word(std::size_t index) const
+  {
+    uint32_t value;
+
+    std::memcpy(&value, image_ + offset_ + index * sizeof(value), sizeof(value));
+    return value;
+  }
+
+  static int compareKey(const char *key, std::size_t keySize, const char *other, std::size_t otherSize)
+  {
+    const int result = std::memcmp(key, other, keySize < otherSize ? keySize : otherSize);
+
+    if (result != 0)
+      return result;
+    return keySize < otherSize ? -1 : keySize > otherSize ? 1 : 0;
+  }
+
+  /**
+   * The index of \p key in an array, size() if not found. The keys
+   * are sorted, this is a binary search.
+   */
+  std::size_t indexOf(const char *key, std::size_t keySize) const
+  {
+    if (! isArray())
+      return size();
+
+    std::size_t       low   = 0;
+    const std::size_t count = word(1);
+    std::size_t       high  = count;
+
+    while (low < high)
+      {
+        const std::size_t   middle = low + (high - low) / 2;
+        const BrefValueView name(image_, word(2 + middle * 2));
+        const int           result = compareKey(key, keySize, name.asCString(), name.stringSize());
+
+        if (result == 0)
+          return middle;
+        if (result < 0)
+          high = middle;
+        else
+          low = middle + 1;
+      }
+    return count;
+  }
+
+public:
+  /**
+   * \brief Build a null view.
+   */
+  BrefValueView()
+    : image_(0), offset_(0)
+  { }
+
+  /**
+   * \brief Gets the type of the value.
+   */
+  BrefValue::confType getType() const
+  {
+    return image_ ? static_cast<BrefValue::confType>(word(0)) : BrefValue::nullType;
+  }
+
+  bool isNull() const   { return getType() == BrefValue::nullType; }
+  bool isString() const { return getType() == BrefValue::stringType; }
+  bool isBool() const   { return getType() == BrefValue::boolType; }
+  bool isInt() const    { return getType() == BrefValue::intType; }
+  bool isDouble() const { return getType() == BrefValue::doubleType; }
+  bool isList() const   { return getType() == BrefValue::listType; }
+  bool isArray() const  { return getType() == BrefValue::arrayType; }
+
+  /**
+   * \brief If it's a string, the characters in the image, null
+   *        terminated. An empty string otherwise.
+   */
+  const char *asCString() const
+  {
+    return isString() ? image_ + offset_ + 2 * sizeof(uint32_t) : "";
+  }
+
+  /**
+   * \brief If it's a string, its size. 0 otherwise.
+   */
+  std::size_t stringSize() const
+  {
+    return isString() ? word(1) : 0;
+  }
+
+  /**
+   * \brief If it's a string, a copy of the value.
+   */
+  std::string asString() const
+  {
+    return std::string(asCString(), stringSize());
+  }
+
+  /**
+   * \brief If it's a boolean, get the value.
+   */
+  bool asBool() const
+  {
+    return isBool() ? word(1) != 0 : false;
+  }
+
+  /**
+   * \brief If it's an integer, get the value.
+   */
+  int asInt() const
+  {
+    return isInt() ? static_cast<int>(word(1)) : 0;
+  }
+
+  /**
+   * \brief If it's a double, get the value.
+   */
+  double asDouble() const
+  {
+    double value = 0.;
+
+    if (isDouble())
+      std::memcpy(&value, image_ + offset_ + 2 * sizeof(uint32_t), sizeof(value));
+    return value;
+  }
+
+  /**
+   * \brief Number of elements of a list or an array, 0 otherwise.
+   */
+  std::size_t size() const
+  {
+    return isList() || isArray() ? word(1) : 0;
+  }
+
+  /**
+   * \brief The element \p index of a list, or the value of the key
+   *        \p index of an array.
+   */
+  BrefValueView at(std::size_t index) const
+  {
+    if (index >= size())
+      return BrefValueView();
+    return BrefValueView(image_, isList() ? word(2 + index) : word(3 + index * 2));
+  }
+
+  /**
+   * \brief The key \p index of an array, in ascending order. An empty
+   *        string otherwise.
+   */
+  const char *keyAt(std::size_t index) const
+  {
+    if (! isArray() || index >= size())
+      return "";
+    return BrefValueView(image_, word(2 + index * 2)).asCString();
+  }
+
+  /**
+   * \brief Check if key exists in array.
+   */
+  bool hasKey(const std::string & key) const
+  {
+    return indexOf(key.data(), key.size()) < size();
+  }
+
+  /**
+   * \brief Access to an array element, a null view if missing.
+   */
+  BrefValueView operator[](const std::string & key) const
+  {
+    return at(indexOf(key.data(), key.size()));
+  }
+
+  BrefValueView operator[](const char *key) const
+  {
+    return at(indexOf(key, std::strlen(key)));
+  }
+
+  /**
+   * \brief Copy the value in a BrefValue.
+   */
+  BrefValue toBrefValue() const
+  {
+    switch (getType())
+      {
+      case BrefValue::stringType:
+        return BrefValue(asString());
+      case BrefValue::boolType:
+        return BrefValue(asBool());
+      case BrefValue::intType:
+        return BrefValue(asInt());
+      case BrefValue::doubleType:
+        return BrefValue(asDouble());
+      case BrefValue::listType:
+        {
+          BrefValue list((BrefValueList()));
+
+          for (std::size_t i = 0; i < size(); ++i)
+            list.push(at(i).toBrefValue());
+          return list;
+        }
+      case BrefValue::arrayType:
+        {
+#ifdef BREF_CXX11
+          // one insert(first, last), whatever the order of the keys,
+          // the elements are converted and moved one by one
+          BrefValueArray array;
+
+#ifndef BREF_VALUE_NODE_CONTAINERS
+          array.reserve(size());
+#endif
+          array.insert(ArrayInput(*this, 0), ArrayInput(*this, size()));
+          return BrefValue(std::move(array));
+#else
+          // the keys of an image are in ascending order (see
+          // validate()), each insertion appends
+          BrefValue array((BrefValueArray()));
+
+          for (std::size_t i = 0; i < size(); ++i)
+            {
+              BrefValue value = at(i).toBrefValue();
+
+              array[keyAt(i)].swap(value);
+            }
+          return array;
+#endif  // BREF_CXX11
+        }
+      default:
+        return BrefValue();
+      }
+  }
+};
+
+/**
+ * \brief The binary format of a BrefValue tree, with offsets instead of
+ *        pointers.
+ *
+ * An image can be written to a file once and mapped by every process
+ * (see MappedBrefValue), reading it needs no parsing and its pages are
+ * shared. The identical strings, like the keys repeated in each
+ * virtual host, are stored once.
+ *
+ * Layout, all the integers are 32 bits in the byte order of the host
+ * and each node is aligned on 8 bytes:
+ * - the header: \c "BREFVIMG", the byte order mark, the version, the
+ *   size of the image and the offset of the root node;
+ * - a node: its BrefValue::confType then:
+ *   - null: 0;
+ *   - boolean and integer: the value;
+ *   - double: 0, the 8 bytes of the value;
+ *   - string: the size, the characters and a null character;
+ *   - list: the number of elements, their offsets;
+ *   - array: the number of keys, the offsets of the key (a string
+ *     node) and the value of each one, sorted by key.
+ *
+ * Example:
+\code
+bref::Buffer image;
+
+bref::BrefValueImage::serialize(config, image);
+// write image in "bref.conf.bin"
+
+bref::MappedBrefValue mapped;
+
+if (mapped.open("bref.conf.bin"))
+  mapped.root()["DocumentRoot"].asCString();
+\endcode
+ *
+ * \sa BrefValueView
+ */
+class BrefValueImage
+{
+public:
+  /// Version of the format.
+  static const uint32_t CurrentVersion = 1;
+  /// Byte order mark.
+  static const uint32_t ByteOrderMark = 0x01020304;
+  /// Size of the header.
+  static const std::size_t HeaderSize = 24;
+  /// Maximum depth of the lists and arrays accepted by validate().
+  static const unsigned MaxDepth = 256;
+
+private:
+  struct Writer
+  {
+    Buffer &                          out;
+    std::size_t                       begin;
+    std::map<std::string, uint32_t>   strings;
+
+    Writer(Buffer & buffer)
+      : out(buffer), begin(buffer.size()), strings()
+    { }
+
+    uint32_t reserve(std::size_t size)
+    {
+      const std::size_t offset = (out.size() - begin + 7) & ~static_cast<std::size_t>(7);
+
+      out.resize(begin + offset + size);
+      return static_cast<uint32_t>(offset);
+    }
+
+    void put(uint32_t offset, std::size_t index, uint32_t value)
+    {
+      std::memcpy(&out[begin + offset + index * sizeof(value)], &value, sizeof(value));
+    }
+
+    uint32_t writeString(const std::string & value)
+    {
+      std::map<std::string, uint32_t>::const_iterator it = strings.find(value);
+
+      if (it != strings.end())
+        return it->second;
+
+      const uint32_t offset = reserve(2 * sizeof(uint32_t) + value.size() + 1);
+
+      put(offset, 0, BrefValue::stringType);
+      put(offset, 1, static_cast<uint32_t>(value.size()));
+      if (! value.empty())
+        std::memcpy(&out[begin + offset + 2 * sizeof(uint32_t)], value.data(), value.size());
+      out[begin + offset + 2 * sizeof(uint32_t) + value.size()] = '\0';
+      strings[value] = offset;
+      return offset;
+    }
+
+    uint32_t write(const BrefValue & value)
+    {
+      switch (value.getType())
+        {
+        case BrefValue::stringType:
+          return writeString(value.asString());
+        case BrefValue::doubleType:
+          {
+            const uint32_t offset = reserve(2 * sizeof(uint32_t) + sizeof(double));
+            const double   number = value.asDouble();
+
+            put(offset, 0, BrefValue::doubleType);
+            put(offset, 1, 0);
+            std::memcpy(&out[begin + offset + 2 * sizeof(uint32_t)], &number, sizeof(number));
+            return offset;
+          }
+        case BrefValue::listType:
+          {
+            const BrefValueList & list   = value.asList();
+            const uint32_t         offset = reserve((2 + list.size()) * sizeof(uint32_t));
+            std::size_t            i      = 0;
+
+            put(offset, 0, BrefValue::listType);
+            put(offset, 1, static_cast<uint32_t>(list.size()));
+            for (BrefValueList::const_iterator it = list.begin(); it != list.end(); ++it, ++i)
+              put(offset, 2 + i, write(*it));
+            return offset;
+          }
+        case BrefValue::arrayType:
+          {
+            const BrefValueArray & array  = value.asArray();
+            const uint32_t         offset = reserve((2 + 2 * array.size()) * sizeof(uint32_t));
+            std::size_t            i      = 0;
+
+            // BrefValueArray (a FlatMap) iterates in std::string order,
+            // the order compareKey() and validate() expect
+            put(offset, 0, BrefValue::arrayType);
+            put(offset, 1, static_cast<uint32_t>(array.size()));
+            for (BrefValueArray::const_iterator it = array.begin(); it != array.end(); ++it, ++i)
+              {
+                put(offset, 2 + i * 2, writeString(it->first));
+                put(offset, 3 + i * 2, write(it->second));
+              }
+            return offset;
+          }
+        default:
+          {
+            const uint32_t offset = reserve(2 * sizeof(uint32_t));
+
+            put(offset, 0, value.getType());
+            put(offset, 1, value.isBool() ? value.asBool() : static_cast<uint32_t>(value.asInt()));
+            return offset;
+          }
+        }
+    }
+  };
+
+  static uint32_t word(const char *data, std::size_t offset)
+  {
+    uint32_t value;
+
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+  }
+
+  /**
+   * Check that the node at \p offset and its children are inside the
+   * image. A list or an array is referenced only once, this prevents
+   * cycles.
+   */
+  static bool validateNode(const char *data, std::size_t size, uint32_t offset,
+                           std::vector<bool> & seen, unsigned depth)
+  {
+    if (offset % 8 || offset < HeaderSize || offset + 2 * sizeof(uint32_t) > size)
+      return false;
+
+    const uint32_t type  = word(data, offset);
+    const uint32_t count = word(data, offset + sizeof(uint32_t));
+    const uint64_t end   = offset + 2 * sizeof(uint32_t);
+
+    switch (type)
+      {
+      case BrefValue::nullType:
+      case BrefValue::boolType:
+      case BrefValue::intType:
+        return true;
+      case BrefValue::doubleType:
+        return end + sizeof(double) <= size;
+      case BrefValue::stringType:
+        return end + count + 1 <= size && data[end + count] == '\0';
+      case BrefValue::listType:
+      case BrefValue::arrayType:
+        {
+          const uint64_t words = type == BrefValue::listType ? count : 2 * uint64_t(count);
+
+          if (depth >= MaxDepth || seen[offset / 8] || end + words * sizeof(uint32_t) > size)
+            return false;
+          seen[offset / 8] = true;
+          for (uint64_t i = 0; i < words; ++i)
+            {
+              const uint32_t child = word(data, end + i * sizeof(uint32_t));
+
+              if (! validateNode(data, size, child, seen, depth + 1))
+                return false;
+              if (type == BrefValue::arrayType && i % 2 == 0)
+                {
+                  if (word(data, child) != BrefValue::stringType)
+                    return false;
+                  // keys in ascending order
+                  if (i > 0)
+                    {
+                      const uint32_t previous = word(data, end + (i - 2) * sizeof(uint32_t));
+
+                      if (BrefValueView::compareKey(data + previous + 8, word(data, previous + 4),
+                                                    data + child + 8, word(data, child + 4)) >= 0)
+                        return false;
+                    }
+                }
+            }
+          return true;
+        }
+      default:
+        return false;
+      }
+  }
+
+public:
+  /**
+   * \brief Append the image of \p value at the end of \p out.
+   *
+   * \note The image should be smaller than 4 GiB, the offsets are 32
+   *       bits.
+   */
+  static void serialize(const BrefValue & value, Buffer & out)
+  {
+    Writer         writer(out);
+    const uint32_t header = writer.reserve(HeaderSize);
+    const uint32_t root   = writer.write(value);
+
+    std::memcpy(&out[writer.begin + header], "BREFVIMG", 8);
+    writer.put(header, 2, ByteOrderMark);
+    writer.put(header, 3, CurrentVersion);
+    writer.put(header, 4, static_cast<uint32_t>(out.size() - writer.begin));
+    writer.put(header, 5, root);
+  }
+
+  /**
+   * \brief Check an image read from a file: the header and the bounds
+   *        of every node.
+   *
+   * \param data
+   *            The image, aligned on 8 bytes.
+   */
+  static bool validate(const char *data, std::size_t size)
+  {
+    if (size < HeaderSize || std::memcmp(data, "BREFVIMG", 8) != 0
+        || word(data, 8) != ByteOrderMark || word(data, 12) != CurrentVersion
+        || word(data, 16) != size)
+      return false;
+
+    std::vector<bool> seen(size / 8 + 1);
+
+    return validateNode(data, size, word(data, 20), seen, 0);
+  }
+
+  /**
+   * \brief The root value of an image.
+   *
+   * \param data
+   *            A valid image, aligned on 8 bytes.
+   */
+  static BrefValueView root(const char *data)
+  {
+    return BrefValueView(data, word(data, 20));
+  }
+};
+
+#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32)
+/**
+ * \brief A BrefValueImage file mapped in memory, read-only.
+ *
+ * The pages of the file are shared by all the processes mapping it.
+ */
+class MappedBrefValue : util::NonCopyable
+{
+private:
+  const char  *data_;
+  std::size_t  size_;
+
+public:
+  MappedBrefValue()
+    : data_(0), size_(0)
+  { }
+
+  ~MappedBrefValue()
+  {
+    close();
+  }
+
+  /**
+   * \brief Map the file \p path and validate it.
+   *
+   * \return false if the file can't be mapped or is not a valid image.
+   */
+  bool open(const std::string & path)
+  {
+    close();
+
+    const int   fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+
+    if (fd < 0)
+      return false;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(BrefValueImage::HeaderSize))
+      {
+        ::close(fd);
+        return false;
+      }
+
+    void *data = ::mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+    if (data == MAP_FAILED)
+      return false;
+    data_ = static_cast<const char *>(data);
+    size_ = info.st_size;
+    if (! BrefValueImage::validate(data_, size_))
+      {
+        close();
+        return false;
+      }
+    return true;
+  }
+
+  /**
+   * \brief Unmap the file, the views become invalid.
+   */
+  void close()
+  {
+    if (data_)
+      ::munmap(const_cast<char *>(data_), size_);
+    data_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * \brief Test if a file is mapped.
+   */
+  bool isOpen() const
+  {
+    return data_ != 0;
+  }
+
+  /**
+   * \brief The root value, a null view if no file is mapped.
+   */
+  BrefValueView root() const
+  {
+    return data_ ? BrefValueImage::root(data_) : BrefValueView();
+  }
+};
+#endif
+
+} // ! bref
+
+#endif /* !BREF_API_BREFVALUEVIEW_H_ */
@@ -0,0 +1,493 @@
+/**
+ * \file   BufferChain.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun Apr 22 18:47:02 2012
+ *
+ * \brief  SharedBuffer, BufferSlice and BufferChain definitions.
+ *
+ */
+
+#ifndef BREF_API_BUFFERCHAIN_H_
+#define BREF_API_BUFFERCHAIN_H_
+
+#include "Buffer.h"
+#include "detail/Config.h"
+#include "detail/util/AtomicCounter.hpp"
+#include "detail/util/NonCopyable.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32)
+# include <sys/uio.h>
+#endif
+
+namespace bref {
+
+/**
+ * \brief A reference counted and immutable block of memory.
+ *
+ * The data is adopted from a Buffer (by swapping, without copy) or
+ * copied once, and it's never modified afterwards. A SharedBuffer is
+ * shared between several BufferSlice.
+ *
+ * \sa BufferSlice, BufferChain
+ */
+class SharedBuffer : util::NonCopyable
+{
+private:
+  util::AtomicCounter refs_;
+  Buffer              data_;
+
+  SharedBuffer()
+    : refs_(1)
+  { }
+
+  ~SharedBuffer()
+  { }
+
+public:
+  /**
+   * \brief Create a shared buffer with the content of \p buffer.
+   *
+   * \param[in,out] buffer
+   *            The buffer is swapped with the content of the shared
+   *            buffer, it's empty on return.
+   *
+   * \return A shared buffer with a reference count of 1.
+   */
+  static SharedBuffer *adopt(Buffer & buffer)
+  {
+    SharedBuffer *shared = new SharedBuffer();
+
+    shared->data_.swap(buffer);
+    return shared;
+  }
+
+  /**
+   * \brief Create a shared buffer containing a copy of \p data.
+   *
+   * \return A shared buffer with a reference count of 1.
+   */
+  static SharedBuffer *copy(const char *data, std::size_t size)
+  {
+    SharedBuffer *shared = new SharedBuffer();
+
+    shared->data_.assign(data, data + size);
+    return shared;
+  }
+
+  /**
+   * \brief Increment the reference count.
+   */
+  void acquire()
+  {
+    refs_.increment();
+  }
+
+  /**
+   * \brief Decrement the reference count, the buffer is deleted when
+   *        it reaches 0.
+   */
+  void release()
+  {
+    if (refs_.decrement() == 0)
+      delete this;
+  }
+
+  const char *data() const
+  {
+    return data_.empty() ? 0 : &data_[0];
+  }
+
+  std::size_t size() const
+  {
+    return data_.size();
+  }
+};
+
+/**
+ * \brief A view on a contiguous part of a SharedBuffer.
+ *
+ * Copying a slice only increments the reference count of the
+ * underlying buffer. A slice can also point to static data (string
+ * literals, precomputed headers, ...) that outlive it, in this case no
+ * reference counting is done.
+ *
+ * \sa SharedBuffer, BufferChain
+ */
+class BufferSlice
+{
+private:
+  SharedBuffer *owner_;
+  const char   *data_;
+  std::size_t   size_;
+
+public:
+  /**
+   * \brief Build an empty slice.
+   */
+  BufferSlice()
+    : owner_(0), data_(0), size_(0)
+  { }
+
+  /**
+   * \brief Build a slice of the whole \p owner.
+   *
+   * \note The slice takes one reference on \p owner, the caller keeps
+   *       its own reference.
+   */
+  explicit BufferSlice(SharedBuffer *owner)
+    : owner_(owner), data_(owner->data()), size_(owner->size())
+  {
+    owner_->acquire();
+  }
+
+  /**
+   * \brief Build a slice of \p size bytes starting at \p offset in
+   *        \p owner.
+   */
+  BufferSlice(SharedBuffer *owner, std::size_t offset, std::size_t size)
+    : owner_(owner), data_(owner->data() + offset), size_(size)
+  {
+    owner_->acquire();
+  }
+
+  BufferSlice(const BufferSlice & other)
+    : owner_(other.owner_), data_(other.data_), size_(other.size_)
+  {
+    if (owner_)
+      owner_->acquire();
+  }
+
+#ifdef BREF_CXX11
+  BufferSlice(BufferSlice && other) noexcept
+    : owner_(other.owner_), data_(other.data_), size_(other.size_)
+  {
+    other.owner_ = 0;
+    other.data_  = 0;
+    other.size_  = 0;
+  }
+#endif  // BREF_CXX11
+
+  ~BufferSlice()
+  {
+    if (owner_)
+      owner_->release();
+  }
+
+  BufferSlice & operator=(BufferSlice other)
+  {
+    swap(other);
+    return *this;
+  }
+
+  /**
+   * \brief Build a slice on data not owned by the slice.
+   *
+   * \warning \p data should outlive the slice and its copies.
+   */
+  static BufferSlice fromStatic(const char *data, std::size_t size)
+  {
+    BufferSlice slice;
+
+    slice.data_ = data;
+    slice.size_ = size;
+    return slice;
+  }
+
+  void swap(BufferSlice & other) BREF_NOEXCEPT
+  {
+    std::swap(owner_, other.owner_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+  const char *data() const
+  {
+    return data_;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * \brief Get a sub-slice sharing the same buffer.
+   */
+  BufferSlice slice(std::size_t offset, std::size_t size) const
+  {
+    BufferSlice sub(*this);
+
+    sub.data_ += offset;
+    sub.size_  = size;
+    return sub;
+  }
+
+  /**
+   * \brief Remove \p count bytes at the beginning of the slice.
+   */
+  void trimFront(std::size_t count)
+  {
+    data_ += count;
+    size_ -= count;
+  }
+
+  /**
+   * \brief Remove \p count bytes at the end of the slice.
+   */
+  void trimBack(std::size_t count)
+  {
+    size_ -= count;
+  }
+};
+
+/**
+ * \brief A rope of BufferSlice, used to forward, prepend or trim data
+ *        without copying it.
+ *
+ * Example, for a module adding a prefix to a chunk:
+\code
+static const char prefix[] = "<!-- generated -->";
+
+void addPrefix(bref::HttpResponse &, bref::BufferChain & chunk)
+{
+  chunk.prepend(bref::BufferSlice::fromStatic(prefix, sizeof prefix - 1));
+}
+\endcode
+ *
+ * The chain can then be given to \c writev() (see fillIoVec()).
+ *
+ * \sa BufferSlice, SharedBuffer
+ */
+class BufferChain
+{
+private:
+  std::vector<BufferSlice> slices_;
+  std::size_t              size_;
+
+public:
+  typedef std::vector<BufferSlice>::const_iterator const_iterator;
+
+  BufferChain()
+    : slices_(), size_(0)
+  { }
+
+  /**
+   * \brief Total number of bytes in the chain.
+   */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * \brief Number of slices in the chain.
+   */
+  std::size_t segmentCount() const
+  {
+    return slices_.size();
+  }
+
+  const BufferSlice & segment(std::size_t i) const
+  {
+    return slices_[i];
+  }
+
+  const_iterator begin() const
+  {
+    return slices_.begin();
+  }
+
+  const_iterator end() const
+  {
+    return slices_.end();
+  }
+
+  /**
+   * \brief Remove all the slices, the memory used to store the slices
+   *        is kept.
+   */
+  void clear()
+  {
+    slices_.clear();
+    size_ = 0;
+  }
+
+  void swap(BufferChain & other) BREF_NOEXCEPT
+  {
+    slices_.swap(other.slices_);
+    std::swap(size_, other.size_);
+  }
+
+  /**
+   * \brief Add \p slice at the end of the chain.
+   */
+  void append(const BufferSlice & slice)
+  {
+    if (slice.empty())
+      return;
+    slices_.push_back(slice);
+    size_ += slice.size();
+  }
+
+  /**
+   * \brief Add the content of \p buffer at the end of the chain.
+   *
+   * \param[in,out] buffer
+   *            The buffer is adopted (see SharedBuffer::adopt()), it's
+   *            empty on return.
+   */
+  void append(Buffer & buffer)
+  {
+    if (buffer.empty())
+      return;
+
+    SharedBuffer *shared = SharedBuffer::adopt(buffer);
+
+    append(BufferSlice(shared));
+    shared->release();
+  }
+
+  /**
+   * \brief Add the slices of \p other at the end of the chain.
+   */
+  void append(const BufferChain & other)
+  {
+    slices_.insert(slices_.end(), other.slices_.begin(), other.slices_.end());
+    size_ += other.size_;
+  }
+
+  /**
+   * \brief Add \p slice at the beginning of the chain.
+   */
+  void prepend(const BufferSlice & slice)
+  {
+    if (slice.empty())
+      return;
+    slices_.insert(slices_.begin(), slice);
+    size_ += slice.size();
+  }
+
+  /**
+   * \brief Add the content of \p buffer at the beginning of the
+   *        chain.
+   *
+   * \sa append(Buffer &)
+   */
+  void prepend(Buffer & buffer)
+  {
+    if (buffer.empty())
+      return;
+
+    SharedBuffer *shared = SharedBuffer::adopt(buffer);
+
+    prepend(BufferSlice(shared));
+    shared->release();
+  }
+
+  /**
+   * \brief Remove \p count bytes at the beginning of the chain.
+   */
+  void trimFront(std::size_t count)
+  {
+    std::vector<BufferSlice>::iterator it = slices_.begin();
+
+    count = std::min(count, size_);
+    size_ -= count;
+    while (count && count >= it->size())
+      {
+        count -= it->size();
+        ++it;
+      }
+    slices_.erase(slices_.begin(), it);
+    if (count)
+      slices_.front().trimFront(count);
+  }
+
+  /**
+   * \brief Remove \p count bytes at the end of the chain.
+   */
+  void trimBack(std::size_t count)
+  {
+    count = std::min(count, size_);
+    size_ -= count;
+    while (count && count >= slices_.back().size())
+      {
+        count -= slices_.back().size();
+        slices_.pop_back();
+      }
+    if (count)
+      slices_.back().trimBack(count);
+  }
+
+  /**
+   * \brief Append a copy of the content of the chain to \p buffer.
+   *
+   * To be used when a contiguous buffer is needed.
+   */
+  void copyTo(Buffer & buffer) const
+  {
+    buffer.reserve(buffer.size() + size_);
+    for (const_iterator it = slices_.begin(); it != slices_.end(); ++it)
+      buffer.insert(buffer.end(), it->data(), it->data() + it->size());
+  }
+
+#if !defined(_WIN32) && !defined(__WIN32__) && !defined(WIN32)
+  /**
+   * \brief Fill an array of \c iovec with the slices of the chain.
+   *
+   * \param[out] iov
+   *            The array to fill.
+   * \param count
+   *            The number of elements in \p iov.
+   * \param first
+   *            Index of the first slice to use.
+   *
+   * \return The number of \c iovec filled.
+   */
+  std::size_t fillIoVec(struct iovec *iov, std::size_t count, std::size_t first = 0) const
+  {
+    std::size_t n = 0;
+
+    for (std::size_t i = first; i < slices_.size() && n < count; ++i, ++n)
+      {
+        iov[n].iov_base = const_cast<char *>(slices_[i].data());
+        iov[n].iov_len  = slices_[i].size();
+      }
+    return n;
+  }
+#endif
+};
+
+/**
+ * \brief Exchange the content of two slices.
+ */
+inline void swap(BufferSlice & a, BufferSlice & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
+
+/**
+ * \brief Exchange the content of two chains.
+ */
+inline void swap(BufferChain & a, BufferChain & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
+
+} // ! bref
+
+#endif /* !BREF_API_BUFFERCHAIN_H_ */
@@ -0,0 +1,400 @@
+/**
+ * \file   CompiledConfHelper.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun May 13 11:36:52 2012
+ *
+ * \brief  CompiledConfHelper class definition.
+ *
+ * \note This helper requires C++11 (thread_local and unordered_map).
+ */
+
+#ifndef BREF_API_COMPILEDCONFHELPER_H_
+#define BREF_API_COMPILEDCONFHELPER_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/CompiledConfHelper.h requires C++11"
+#endif
+
+#include "BrefValue.h"
+#include "HttpRequest.h"
+#include "IConfHelper.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bref {
+
+/**
+ * \brief An IConfHelper resolving the configuration of each virtual
+ *        host once, when it's built.
+ *
+ * The configuration is an array, the keys at the root are the global
+ * values. The \c "VirtualHosts" key contains an array of virtual
+ * hosts, by name, each one overrides some keys. The \c "Aliases" key
+ * of a virtual host lists the other names it's reached by, a name can
+ * begin with \c "*." to match the subdomains:
+\verbatim
+DocumentRoot = "/var/www"
+Timeout      = 30
+
+VirtualHosts = {
+  "example.com" = {
+    DocumentRoot = "/srv/example"
+    Aliases      = [ "www.example.com", "*.example.org" ]
+  }
+}
+\endverbatim
+ *
+ * Each virtual host gets a flat table with a slot per key, the global
+ * values merged with its own. A KeyHandle from internKey() is the
+ * index of the slot, findValue() with a handle is an array access.
+ *
+ * The Host header of a request is matched to a virtual host once, the
+ * result is kept by the thread for the next lookups of the same
+ * request. The requests without a Host header, or with an unknown
+ * one, use the global values.
+ *
+ * \sa IConfHelper, KeyHandle
+ */
+class CompiledConfHelper : public IConfHelper
+{
+public:
+  /**
+   * \brief The interned keys, can be shared by the helpers built from
+   *        the successive versions of a configuration so the handles
+   *        stay valid.
+   */
+  class KeyRegistry : util::NonCopyable
+  {
+  private:
+    mutable std::mutex                             mutex_;
+    std::unordered_map<std::string, std::size_t>   indexes_;
+
+  public:
+    /**
+     * \brief Get the index of \p key, a new one if needed.
+     */
+    std::size_t intern(const std::string & key)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      return indexes_.insert(std::make_pair(key, indexes_.size())).first->second;
+    }
+
+    /**
+     * \brief Number of interned keys.
+     */
+    std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      return indexes_.size();
+    }
+  };
+
+  /**
+   * \brief The flat table of the values of a virtual host.
+   */
+  class VirtualHost
+  {
+  private:
+    friend class CompiledConfHelper;
+
+    std::string                    name_;
+    const BrefValue               *config_;
+    const BrefValue               *globalConfig_;
+    const KeyRegistry             *keys_;
+    std::vector<const BrefValue *> values_;
+
+  public:
+    VirtualHost()
+      : name_(), config_(0), globalConfig_(0), keys_(0), values_()
+    { }
+
+    /**
+     * \brief Name of the virtual host, empty for the global values.
+     */
+    const std::string & name() const
+    {
+      return name_;
+    }
+
+    /**
+     * \brief Find a value by handle, in constant time.
+     *
+     * A handle interned by a helper with another KeyRegistry is looked
+     * up by name, its index would be the slot of another key.
+     */
+    const BrefValue & find(const KeyHandle & key) const
+    {
+      if (key.registry() == keys_ && key.index() < values_.size())
+        return *values_[key.index()];
+      return find(key.key());
+    }
+
+    /**
+     * \brief Find a value by name, in the virtual host then in the
+     *        global values.
+     */
+    const BrefValue & find(const std::string & key) const
+    {
+      const BrefValue & value = lookup(config_, key);
+
+      return value.isNull() ? lookup(globalConfig_, key) : value;
+    }
+  };
+
+private:
+  /**
+   * The virtual host matched by the last lookup of the thread.
+   */
+  struct Match
+  {
+    unsigned long       helper;
+    const HttpRequest  *request;
+    std::string         host;
+    const VirtualHost  *virtualHost;
+  };
+
+  const unsigned long                           id_;
+  const BrefValue                               config_;
+  std::shared_ptr<KeyRegistry>                  keys_;
+  VirtualHost                                   global_;
+  std::vector<VirtualHost>                      virtualHosts_;
+  std::unordered_map<std::string, std::size_t>  names_;  // host name or alias -> virtualHosts_
+
+  static const BrefValue & null()
+  {
+    static const BrefValue value;
+
+    return value;
+  }
+
+  static unsigned long nextId()
+  {
+    static std::atomic<unsigned long> id(0);
+
+    return ++id;
+  }
+
+  static const BrefValue & lookup(const BrefValue *config, const std::string & key)
+  {
+    if (config)
+      {
+        const BrefValueArray &          values = config->asArray();
+        BrefValueArray::const_iterator  it     = values.find(key);
+
+        if (it != values.end())
+          return it->second;
+      }
+    return null();
+  }
+
+  static std::string normalizeHost(const std::string & host)
+  {
+    std::string::size_type begin = 0;
+    std::string::size_type end   = host.size();
+
+    if (! host.empty() && host[0] == '[')
+      {
+        // IPv6 literal: "[::1]:8080"
+        begin = 1;
+        end   = host.find(']');
+        if (end == std::string::npos)
+          end = host.size();
+      }
+    else
+      {
+        const std::string::size_type colon = host.rfind(':');
+
+        if (colon != std::string::npos)
+          end = colon;
+      }
+    if (end > begin && host[end - 1] == '.')
+      --end;
+
+    std::string result(host, begin, end - begin);
+
+    for (std::string::iterator it = result.begin(); it != result.end(); ++it)
+      *it = static_cast<char>(std::tolower(static_cast<unsigned char>(*it)));
+    return result;
+  }
+
+  void fill(VirtualHost & virtualHost, const BrefValue & config)
+  {
+    const BrefValueArray & values = config.asArray();
+
+    for (BrefValueArray::const_iterator it = values.begin(); it != values.end(); ++it)
+      {
+        const std::size_t index = keys_->intern(it->first);
+
+        if (index >= virtualHost.values_.size())
+          virtualHost.values_.resize(index + 1, &null());
+        virtualHost.values_[index] = &it->second;
+      }
+  }
+
+  void compile()
+  {
+    const BrefValueArray & hosts = lookup(&config_, "VirtualHosts").asArray();
+
+    global_.keys_ = keys_.get();
+    fill(global_, config_);
+    virtualHosts_.resize(hosts.size());
+
+    std::size_t i = 0;
+
+    for (BrefValueArray::const_iterator it = hosts.begin(); it != hosts.end(); ++it, ++i)
+      {
+        VirtualHost & virtualHost = virtualHosts_[i];
+
+        virtualHost.name_         = it->first;
+        virtualHost.config_       = &it->second;
+        virtualHost.globalConfig_ = &config_;
+        virtualHost.keys_         = keys_.get();
+        virtualHost.values_       = global_.values_;
+        fill(virtualHost, it->second);
+        names_.insert(std::make_pair(normalizeHost(it->first), i));
+
+        const BrefValueList & aliases = lookup(&it->second, "Aliases").asList();
+
+        for (BrefValueList::const_iterator alias = aliases.begin(); alias != aliases.end(); ++alias)
+          names_.insert(std::make_pair(normalizeHost(alias->asString()), i));
+      }
+
+    // every table has a slot for every key of the configuration
+    const std::size_t size = keys_->size();
+
+    global_.values_.resize(size, &null());
+    for (std::vector<VirtualHost>::iterator it = virtualHosts_.begin(); it != virtualHosts_.end(); ++it)
+      it->values_.resize(size, &null());
+  }
+
+  const VirtualHost & match(const std::string & host) const
+  {
+    const std::string name = normalizeHost(host);
+
+    std::unordered_map<std::string, std::size_t>::const_iterator it = names_.find(name);
+
+    if (it != names_.end())
+      return virtualHosts_[it->second];
+    // "*.example.org" for "www.example.org" and "a.b.example.org"
+    for (std::string::size_type dot = name.find('.'); dot != std::string::npos; dot = name.find('.', dot + 1))
+      {
+        it = names_.find("*" + name.substr(dot));
+        if (it != names_.end())
+          return virtualHosts_[it->second];
+      }
+    return global_;
+  }
+
+public:
+  /**
+   * \brief Compile \p config.
+   *
+   * \param config
+   *            The server configuration, copied.
+   * \param keys
+   *            The interned keys, to share the handles with the
+   *            helpers of the previous configurations.
+   */
+  explicit CompiledConfHelper(const BrefValue &                    config,
+                              const std::shared_ptr<KeyRegistry> & keys = std::make_shared<KeyRegistry>())
+    : id_(nextId())
+    , config_(config)
+    , keys_(keys)
+  {
+    global_.config_ = &config_;
+    compile();
+  }
+
+  /**
+   * \brief The configuration given to the constructor.
+   */
+  const BrefValue & config() const
+  {
+    return config_;
+  }
+
+  /**
+   * \brief The interned keys of the helper.
+   */
+  const std::shared_ptr<KeyRegistry> & keys() const
+  {
+    return keys_;
+  }
+
+  /**
+   * \brief The configuration of the virtual host of \p request.
+   *
+   * The result of the last call is kept by the thread, it's reused
+   * while the request and its Host header are the same.
+   */
+  const VirtualHost & virtualHost(const HttpRequest & request) const
+  {
+    static thread_local Match last = { 0, 0, std::string(), 0 };
+
+    const HttpRequest::const_iterator field = request.find(header_fields::Host);
+
+    if (field == request.end())
+      return global_;
+
+    const std::string & host = field->second.asString();
+
+    if (last.helper != id_ || last.request != &request || last.host != host)
+      {
+        last.helper      = id_;
+        last.request     = &request;
+        last.host        = host;
+        last.virtualHost = &match(host);
+      }
+    return *last.virtualHost;
+  }
+
+  /**
+   * \brief The global configuration.
+   */
+  const VirtualHost & globalValues() const
+  {
+    return global_;
+  }
+
+  using IConfHelper::findValue;
+
+  virtual KeyHandle internKey(const std::string & key) const
+  {
+    return KeyHandle(key, keys_->intern(key), keys_.get());
+  }
+
+  virtual const BrefValue & findValue(const std::string & key) const
+  {
+    return global_.find(key);
+  }
+
+  virtual const BrefValue & findValue(const std::string & key, const HttpRequest & request) const
+  {
+    return virtualHost(request).find(key);
+  }
+
+  virtual const BrefValue & findValue(const KeyHandle & key) const
+  {
+    return global_.find(key);
+  }
+
+  virtual const BrefValue & findValue(const KeyHandle & key, const HttpRequest & request) const
+  {
+    return virtualHost(request).find(key);
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_COMPILEDCONFHELPER_H_ */
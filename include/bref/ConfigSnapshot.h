@@ -0,0 +1,91 @@
+/**
+ * \file   ConfigSnapshot.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun May 13 18:05:17 2012
+ *
+ * \brief  ConfigSnapshot and ConfigHolder definitions.
+ *
+ * \note Requires C++11 (see SnapshotHolder).
+ */
+
+#ifndef BREF_API_CONFIGSNAPSHOT_H_
+#define BREF_API_CONFIGSNAPSHOT_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/ConfigSnapshot.h requires C++11"
+#endif
+
+#include "CompiledConfHelper.h"
+#include "Pipeline.h"
+#include "SnapshotHolder.h"
+#include "detail/util/NonCopyable.hpp"
+
+#include <memory>
+
+namespace bref {
+
+/**
+ * \brief An immutable server configuration and its helper.
+ *
+ * The Environment of a request references the configuration and the
+ * helper, a server keeps the snapshot pinned for the lifetime of the
+ * request so they can be reloaded at any time:
+\code
+bref::ConfigHolder configs(bref::ConfigSnapshot::create(parse("bref.conf")));
+
+// for each request
+bref::ConfigHolder::Pin config = configs.load();
+bref::Environment       environment(config->config, config->helper,
+                                    logger, client, arena);
+
+// on SIGHUP, from any thread
+configs.publish(bref::ConfigSnapshot::create(parse("bref.conf"), *configs.load()));
+\endcode
+ *
+ * \sa ConfigHolder, SnapshotHolder
+ */
+struct ConfigSnapshot : util::NonCopyable
+{
+  const CompiledConfHelper helper;  /**< the helper on config */
+  const ServerConfig &     config;  /**< the server configuration */
+
+  /**
+   * \brief Build the snapshot of \p theConfig, with the interned keys
+   *        of \p keys.
+   */
+  ConfigSnapshot(const ServerConfig &                                     theConfig,
+                 const std::shared_ptr<CompiledConfHelper::KeyRegistry> & keys)
+    : helper(theConfig, keys)
+    , config(helper.config())
+  { }
+
+  /**
+   * \brief Build the first snapshot.
+   */
+  static std::shared_ptr<const ConfigSnapshot> create(const ServerConfig & config)
+  {
+    return std::shared_ptr<const ConfigSnapshot>(
+      new ConfigSnapshot(config, std::make_shared<CompiledConfHelper::KeyRegistry>()));
+  }
+
+  /**
+   * \brief Build the snapshot replacing \p previous, the KeyHandle
+   *        given by the previous helpers stay valid.
+   */
+  static std::shared_ptr<const ConfigSnapshot> create(const ServerConfig &   config,
+                                                      const ConfigSnapshot & previous)
+  {
+    return std::shared_ptr<const ConfigSnapshot>(new ConfigSnapshot(config, previous.helper.keys()));
+  }
+};
+
+/**
+ * \brief The holder of the current ConfigSnapshot.
+ */
+typedef SnapshotHolder<ConfigSnapshot> ConfigHolder;
+
+} // ! bref
+
+#endif /* !BREF_API_CONFIGSNAPSHOT_H_ */
@@ -0,0 +1,840 @@
+/**
+ * \file   HookProfiler.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 12 15:47:21 2012
+ *
+ * \brief  HookProfiler class definition.
+ *
+ * \note The profiler requires C++11 (atomics, thread_local and
+ *       variadic templates).
+ */
+
+#ifndef BREF_API_HOOKPROFILER_H_
+#define BREF_API_HOOKPROFILER_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/HookProfiler.h requires C++11"
+#endif
+
+#include "AModule.h"
+#include "Function.hpp"
+#include "Pipeline.h"
+#include "detail/util/IntFormat.hpp"
+#include "detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bref {
+
+/**
+ * \ingroup Pipeline
+ *
+ * \brief Count and time the hooks of the modules.
+ *
+ * The profiler wraps the hooks registered by a module: for each
+ * module and each hook point it counts the calls of the hooks, the
+ * empty handlers returned (the module doesn't handle the request) and
+ * records the latency of the hooks and of their handlers in
+ * histograms.
+ *
+ * The server registers the hooks through the profiler instead of
+ * calling AModule::registerHooks() itself, the modules and the
+ * PipelineExecutor see no difference:
+\code
+bref::HookProfiler profiler;
+bref::Pipeline     pipeline;
+
+for (std::vector<bref::AModule *>::iterator it = modules.begin(); it != modules.end(); ++it)
+  profiler.registerHooks(**it, pipeline);
+
+bref::PipelineExecutor executor(pipeline);
+
+// later, from an administration command
+std::fputs(profiler.report().c_str(), stderr);
+\endcode
+ *
+ * Each thread records in its own shard of the counters, with relaxed
+ * atomic operations and without lock. When the profiler is disabled
+ * (see setEnabled()) a wrapped hook costs a test and an indirect call
+ * more, its handler is not wrapped; a server that doesn't register
+ * the hooks through the profiler pays nothing.
+ *
+ * \note While the profiler is enabled, the handlers returned by the
+ *       hooks are wrapped in objects taken from a free list of the
+ *       thread: once a thread has seen its largest number of live
+ *       handlers, the profiler doesn't allocate.
+ *
+ * \sa PipelineExecutor
+ */
+class HookProfiler : util::NonCopyable
+{
+public:
+  /**
+   * \brief The hook points, the Buffer and BufferChain flavors of a
+   *        hook point are counted together.
+   */
+  enum HookPoint
+    {
+      ConnectionPoint,
+      OnReceivePoint,
+      OnSendPoint,
+      PostReceivePoint,
+      ParsingPoint,
+      PostParsingPoint,
+      ContentPoint,
+      PostContentPoint,
+      TransformPoint,
+      PreSendPoint,
+      HookPointCount            /**< Number of values in the enumeration */
+    };
+
+  /**
+   * \brief Name of a hook point, e.g: \c "content".
+   */
+  static const char *hookPointName(HookPoint point)
+  {
+    static const char *const names[HookPointCount] =
+      {
+        "connection", "receive", "send", "post-receive", "parsing",
+        "post-parsing", "content", "post-content", "transform", "pre-send"
+      };
+
+    return names[point];
+  }
+
+  /**
+   * \brief A latency histogram, in nanoseconds.
+   *
+   * The buckets are log-linear (like HdrHistogram): the values below
+   * 32 have their own bucket, then each power of two is divided in 16
+   * buckets, the relative error is below 7%. The values are capped to
+   * about 68 seconds.
+   */
+  class Histogram
+  {
+  public:
+    /// Number of bits of the value kept in the bucket index.
+    static const unsigned SubBucketBits = 5;
+    /// Highest bit of a recorded value.
+    static const unsigned MaxValueBits  = 36;
+    /// Number of buckets.
+    static const std::size_t BucketCount = (1u << SubBucketBits)
+      + (MaxValueBits - SubBucketBits) * (1u << (SubBucketBits - 1));
+
+    /**
+     * \brief The bucket of \p value.
+     */
+    static std::size_t bucketIndex(uint64_t value)
+    {
+      const uint64_t maxValue = (uint64_t(1) << MaxValueBits) - 1;
+      const unsigned half     = 1u << (SubBucketBits - 1);
+
+      if (value < (1u << SubBucketBits))
+        return static_cast<std::size_t>(value);
+      if (value > maxValue)
+        value = maxValue;
+
+      const unsigned shift = highestBit(value) - (SubBucketBits - 1);
+
+      return (1u << SubBucketBits) + (shift - 1) * half
+        + static_cast<std::size_t>((value >> shift) - half);
+    }
+
+    /**
+     * \brief The highest value of the bucket \p index.
+     */
+    static uint64_t bucketUpperBound(std::size_t index)
+    {
+      const unsigned half = 1u << (SubBucketBits - 1);
+
+      if (index < (1u << SubBucketBits))
+        return index;
+      index -= 1u << SubBucketBits;
+
+      const unsigned shift = static_cast<unsigned>(index / half) + 1;
+      const uint64_t sub   = index % half + half;
+
+      return ((sub + 1) << shift) - 1;
+    }
+
+    Histogram()
+      : counts_(BucketCount), count_(0), sum_(0), max_(0)
+    { }
+
+    /**
+     * \brief Number of recorded values.
+     */
+    uint64_t count() const
+    {
+      return count_;
+    }
+
+    /**
+     * \brief Highest recorded value.
+     */
+    uint64_t max() const
+    {
+      return max_;
+    }
+
+    /**
+     * \brief Mean of the recorded values, 0 if empty.
+     */
+    double mean() const
+    {
+      return count_ ? static_cast<double>(sum_) / count_ : 0.;
+    }
+
+    /**
+     * \brief The value below which \p percentile percent of the
+     *        values fall, e.g: valueAt(99.9).
+     *
+     * \return The upper bound of the bucket, 0 if empty.
+     */
+    uint64_t valueAt(double percentile) const
+    {
+      const double rank  = percentile / 100. * count_;
+      uint64_t     total = 0;
+
+      if (count_ == 0)
+        return 0;
+      for (std::size_t i = 0; i < BucketCount; ++i)
+        {
+          total += counts_[i];
+          if (total && total >= rank)
+            return std::min(bucketUpperBound(i), max_);
+        }
+      return max_;
+    }
+
+    /**
+     * \brief The count of each bucket.
+     */
+    const std::vector<uint64_t> & counts() const
+    {
+      return counts_;
+    }
+
+  private:
+    friend class HookProfiler;
+
+    std::vector<uint64_t> counts_;
+    uint64_t              count_;
+    uint64_t              sum_;
+    uint64_t              max_;
+
+    static unsigned highestBit(uint64_t value)
+    {
+#if defined(__GNUC__)
+      return 63 - __builtin_clzll(value);
+#else
+      unsigned bit = 0;
+
+      while (value >>= 1)
+        ++bit;
+      return bit;
+#endif
+    }
+  };
+
+  /**
+   * \brief The statistics of the hooks of a module on a hook point.
+   */
+  struct HookStats
+  {
+    std::string module;         /**< name of the module */
+    HookPoint   point;          /**< the hook point */
+    uint64_t    calls;          /**< calls of the hooks */
+    uint64_t    nulls;          /**< empty handlers returned by the hooks */
+    Histogram   hookLatency;    /**< latency of the hooks (handler creation) */
+    Histogram   handlerLatency; /**< latency of each call of the handlers */
+
+    /**
+     * \brief Fraction of the calls returning an empty handler.
+     */
+    double nullRate() const
+    {
+      return calls ? static_cast<double>(nulls) / calls : 0.;
+    }
+  };
+
+private:
+  /// Number of shards of the counters, the threads are spread on them.
+  static const unsigned ShardCount = 8;
+
+  /**
+   * The counters of a thread (or a few threads if there are more
+   * threads than shards), on its own cache lines.
+   */
+  struct alignas(64) Shard
+  {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> nulls;
+    std::atomic<uint64_t> count[2];
+    std::atomic<uint64_t> sum[2];
+    std::atomic<uint64_t> max[2];
+    std::atomic<uint64_t> buckets[2][Histogram::BucketCount];
+
+    Shard()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      calls.store(0, std::memory_order_relaxed);
+      nulls.store(0, std::memory_order_relaxed);
+      for (int i = 0; i < 2; ++i)
+        {
+          count[i].store(0, std::memory_order_relaxed);
+          sum[i].store(0, std::memory_order_relaxed);
+          max[i].store(0, std::memory_order_relaxed);
+          for (std::size_t j = 0; j < Histogram::BucketCount; ++j)
+            buckets[i][j].store(0, std::memory_order_relaxed);
+        }
+    }
+  };
+
+  /// Index of the histograms in a Shard.
+  enum Latency { HookLatency, HandlerLatency };
+
+  /**
+   * The counters of a module on a hook point.
+   */
+  struct Site
+  {
+    HookProfiler *profiler;
+    std::string   module;
+    HookPoint     point;
+    Shard         shards[ShardCount];
+
+    Site(HookProfiler *theProfiler, const std::string & theModule, HookPoint thePoint)
+      : profiler(theProfiler), module(theModule), point(thePoint)
+    { }
+
+    Shard & shard()
+    {
+      return shards[threadShard()];
+    }
+
+    void record(Latency latency, uint64_t elapsed)
+    {
+      Shard &  s   = shard();
+      uint64_t max = s.max[latency].load(std::memory_order_relaxed);
+
+      s.count[latency].fetch_add(1, std::memory_order_relaxed);
+      s.sum[latency].fetch_add(elapsed, std::memory_order_relaxed);
+      s.buckets[latency][Histogram::bucketIndex(elapsed)].fetch_add(1, std::memory_order_relaxed);
+      while (elapsed > max
+             && ! s.max[latency].compare_exchange_weak(max, elapsed, std::memory_order_relaxed))
+        { }
+    }
+  };
+
+  static unsigned threadShard()
+  {
+    static std::atomic<unsigned> nextShard(0);
+    static thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+
+    return shard;
+  }
+
+  static uint64_t now()
+  {
+    using namespace std::chrono;
+
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * A per-thread free list of the objects wrapping the handlers. A
+   * thread allocates until it has seen its largest number of live
+   * handlers, then the wrapping of a handler only moves a pointer.
+   *
+   * \tparam T Default constructible, with a \c T \c *nextFree member.
+   */
+  template <typename T>
+  struct FreeList
+  {
+    T *head;
+
+    FreeList()
+      : head(0)
+    { }
+
+    ~FreeList()
+    {
+      while (head)
+        {
+          T *next = head->nextFree;
+
+          delete head;
+          head = next;
+        }
+    }
+
+    static FreeList & local()
+    {
+      static thread_local FreeList list;
+
+      return list;
+    }
+
+    static T *acquire()
+    {
+      FreeList & list = local();
+      T         *item = list.head;
+
+      if (! item)
+        return new T();
+      list.head = item->nextFree;
+      return item;
+    }
+
+    static void release(T *item)
+    {
+      FreeList & list = local();
+
+      item->nextFree = list.head;
+      list.head      = item;
+    }
+  };
+
+  /**
+   * A handler returned by a hook and its site, shared by the copies
+   * of the TimedHandler wrapping it.
+   */
+  template <typename Signature>
+  struct HandlerSlot
+  {
+    Function<Signature> handler;
+    Site               *site;
+    unsigned            references;
+    HandlerSlot        *nextFree;
+  };
+
+  /**
+   * Wrap a handler, the latency of each call is recorded.
+   *
+   * Only a pointer to a pooled HandlerSlot is stored, the wrapper fits
+   * in the inline storage of a Function. The reference count is not
+   * atomic: the handlers of a request are used by one thread at a
+   * time.
+   */
+  template <typename Signature>
+  class TimedHandler;
+
+  template <typename R, typename... Args>
+  class TimedHandler<R (Args...)>
+  {
+  private:
+    typedef HandlerSlot<R (Args...)> Slot;
+
+    Slot *slot_;
+
+    TimedHandler & operator=(const TimedHandler &);
+
+  public:
+    /**
+     * Take the target of \p handler, which becomes empty.
+     */
+    TimedHandler(Function<R (Args...)> & handler, Site *site)
+      : slot_(FreeList<Slot>::acquire())
+    {
+      slot_->handler.swap(handler);
+      slot_->site       = site;
+      slot_->references = 1;
+    }
+
+    TimedHandler(const TimedHandler & other) BREF_NOEXCEPT
+      : slot_(other.slot_)
+    {
+      ++slot_->references;
+    }
+
+    ~TimedHandler()
+    {
+      if (--slot_->references == 0)
+        {
+          slot_->handler.clear();
+          FreeList<Slot>::release(slot_);
+        }
+    }
+
+    R operator()(Args... args) const
+    {
+      Site *site = slot_->site;
+
+      if (! site->profiler->enabled())
+        return slot_->handler(args...);
+
+      struct Timer
+      {
+        Site     *site;
+        uint64_t  start;
+
+        ~Timer()
+        {
+          site->record(HandlerLatency, now() - start);
+        }
+      } timer = { site, now() };
+
+      return slot_->handler(args...);
+    }
+  };
+
+  /**
+   * Wrap the handler of a content hook, dispose() gives the wrapper
+   * back to the free list of the thread.
+   */
+  class TimedContentHandler : public Pipeline::IContentRequestHandler
+  {
+  private:
+    Pipeline::IContentRequestHandler *handler_;
+    Site                             *site_;
+
+  public:
+    TimedContentHandler              *nextFree;
+
+    TimedContentHandler()
+      : handler_(0), site_(0), nextFree(0)
+    { }
+
+    virtual ~TimedContentHandler()
+    { }
+
+    void wrap(Pipeline::IContentRequestHandler *handler, Site *site)
+    {
+      handler_ = handler;
+      site_    = site;
+    }
+
+    virtual bool inContent(HttpResponse & response, const Buffer & inBuffer)
+    {
+      const uint64_t start  = now();
+      const bool     result = handler_->inContent(response, inBuffer);
+
+      site_->record(HandlerLatency, now() - start);
+      return result;
+    }
+
+    virtual bool outContent(HttpResponse & response, Buffer & outBuffer)
+    {
+      const uint64_t start  = now();
+      const bool     result = handler_->outContent(response, outBuffer);
+
+      site_->record(HandlerLatency, now() - start);
+      return result;
+    }
+
+    virtual bool outFile(HttpResponse & response, FileRange & range)
+    {
+      const uint64_t start  = now();
+      const bool     result = handler_->outFile(response, range);
+
+      site_->record(HandlerLatency, now() - start);
+      return result;
+    }
+
+    virtual void dispose()
+    {
+      handler_->dispose();
+      handler_ = 0;
+      FreeList<TimedContentHandler>::release(this);
+    }
+  };
+
+  template <typename Signature>
+  static Function<Signature> wrapHandler(Function<Signature> & handler, Site *site)
+  {
+    return Function<Signature>(TimedHandler<Signature>(handler, site));
+  }
+
+  static Pipeline::IContentRequestHandler *wrapHandler(Pipeline::IContentRequestHandler *handler, Site *site)
+  {
+    TimedContentHandler *timed = FreeList<TimedContentHandler>::acquire();
+
+    timed->wrap(handler, site);
+    return timed;
+  }
+
+  /**
+   * Wrap a hook, the calls, the empty handlers and the latency are
+   * recorded, the handlers are wrapped.
+   */
+  template <typename Handler, typename... Args>
+  struct TimedHook
+  {
+    Function<Handler (Args...)> hook;
+    Site                       *site;
+
+    Handler operator()(Args... args) const
+    {
+      if (! site->profiler->enabled())
+        return hook(args...);
+
+      const uint64_t start   = now();
+      Handler        handler = hook(args...);
+      Shard &        shard   = site->shard();
+
+      site->record(HookLatency, now() - start);
+      shard.calls.fetch_add(1, std::memory_order_relaxed);
+      if (! handler)
+        {
+          shard.nulls.fetch_add(1, std::memory_order_relaxed);
+          return handler;
+        }
+      return wrapHandler(handler, site);
+    }
+  };
+
+  std::atomic<bool>  enabled_;
+  mutable std::mutex mutex_;
+  std::list<Site>    sites_;
+
+  Site *site(const std::string & module, HookPoint point)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (std::list<Site>::iterator it = sites_.begin(); it != sites_.end(); ++it)
+      if (it->point == point && it->module == module)
+        return &*it;
+    sites_.emplace_back(this, module, point);
+    return &sites_.back();
+  }
+
+  /**
+   * Wrap the hooks of \p hooks from the position \p first.
+   */
+  template <typename Handler, typename... Args>
+  void wrapHooks(std::list<std::pair<Function<Handler (Args...)>, float> > & hooks,
+                 std::size_t                                               first,
+                 const std::string &                                       module,
+                 HookPoint                                                 point)
+  {
+    typedef Function<Handler (Args...)> Hook;
+
+    typename std::list<std::pair<Hook, float> >::iterator it = hooks.begin();
+
+    std::advance(it, first);
+    if (it == hooks.end())
+      return;
+
+    Site *s = site(module, point);
+
+    for (; it != hooks.end(); ++it)
+      {
+        TimedHook<Handler, Args...> timed = { it->first, s };
+
+        it->first = Hook(timed);
+      }
+  }
+
+  /**
+   * The size of the hook lists of a pipeline, the hooks after these
+   * positions are the ones of the module being registered.
+   */
+  struct Sizes
+  {
+    std::size_t values[14];
+
+    explicit Sizes(const Pipeline & pipeline)
+    {
+      values[0]  = pipeline.connectionHooks.size();
+      values[1]  = pipeline.onReceiveHooks.size();
+      values[2]  = pipeline.onSendHooks.size();
+      values[3]  = pipeline.postReceiveHooks.size();
+      values[4]  = pipeline.postReceiveChainHooks.size();
+      values[5]  = pipeline.parsingHooks.size();
+      values[6]  = pipeline.postParsingHooks.size();
+      values[7]  = pipeline.contentHooks.size();
+      values[8]  = pipeline.postContentHooks.size();
+      values[9]  = pipeline.postContentChainHooks.size();
+      values[10] = pipeline.transformHooks.size();
+      values[11] = pipeline.transformChainHooks.size();
+      values[12] = pipeline.preSendHooks.size();
+      values[13] = pipeline.preSendChainHooks.size();
+    }
+  };
+
+  void wrapNewHooks(const std::string & module, Pipeline & pipeline, const Sizes & sizes)
+  {
+    wrapHooks(pipeline.connectionHooks,       sizes.values[0],  module, ConnectionPoint);
+    wrapHooks(pipeline.onReceiveHooks,        sizes.values[1],  module, OnReceivePoint);
+    wrapHooks(pipeline.onSendHooks,           sizes.values[2],  module, OnSendPoint);
+    wrapHooks(pipeline.postReceiveHooks,      sizes.values[3],  module, PostReceivePoint);
+    wrapHooks(pipeline.postReceiveChainHooks, sizes.values[4],  module, PostReceivePoint);
+    wrapHooks(pipeline.parsingHooks,          sizes.values[5],  module, ParsingPoint);
+    wrapHooks(pipeline.postParsingHooks,      sizes.values[6],  module, PostParsingPoint);
+    wrapHooks(pipeline.contentHooks,          sizes.values[7],  module, ContentPoint);
+    wrapHooks(pipeline.postContentHooks,      sizes.values[8],  module, PostContentPoint);
+    wrapHooks(pipeline.postContentChainHooks, sizes.values[9],  module, PostContentPoint);
+    wrapHooks(pipeline.transformHooks,        sizes.values[10], module, TransformPoint);
+    wrapHooks(pipeline.transformChainHooks,   sizes.values[11], module, TransformPoint);
+    wrapHooks(pipeline.preSendHooks,          sizes.values[12], module, PreSendPoint);
+    wrapHooks(pipeline.preSendChainHooks,     sizes.values[13], module, PreSendPoint);
+  }
+
+  static void collect(const Shard & shard, Latency latency, Histogram & histogram)
+  {
+    histogram.count_ += shard.count[latency].load(std::memory_order_relaxed);
+    histogram.sum_   += shard.sum[latency].load(std::memory_order_relaxed);
+    histogram.max_    = std::max(histogram.max_, shard.max[latency].load(std::memory_order_relaxed));
+    for (std::size_t i = 0; i < Histogram::BucketCount; ++i)
+      histogram.counts_[i] += shard.buckets[latency][i].load(std::memory_order_relaxed);
+  }
+
+  static void appendLatency(std::string & out, const Histogram & histogram)
+  {
+    char buffer[128];
+
+    std::snprintf(buffer, sizeof(buffer), " %10.0f %10lu %10lu %10lu",
+                 histogram.mean(),
+                 static_cast<unsigned long>(histogram.valueAt(50.)),
+                 static_cast<unsigned long>(histogram.valueAt(99.)),
+                 static_cast<unsigned long>(histogram.max()));
+    out += buffer;
+  }
+
+public:
+  /**
+   * \brief Build an enabled profiler.
+   */
+  HookProfiler()
+    : enabled_(true)
+  { }
+
+  /**
+   * \brief Test if the calls are recorded.
+   */
+  bool enabled() const
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Start or stop the recording, the hooks stay wrapped.
+   */
+  void setEnabled(bool enabled)
+  {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Call AModule::registerHooks() and wrap the hooks added by
+   *        the module.
+   */
+  void registerHooks(AModule & module, Pipeline & pipeline)
+  {
+    const Sizes sizes(pipeline);
+
+    module.registerHooks(pipeline);
+    wrapNewHooks(module.name(), pipeline, sizes);
+  }
+
+  /**
+   * \brief Call AModule::registerSessionHooks() and wrap the hooks
+   *        added by the module.
+   *
+   * \return The value returned by the module.
+   */
+  IDisposable *registerSessionHooks(AModule & module, Pipeline & pipeline)
+  {
+    const Sizes  sizes(pipeline);
+    IDisposable *session = module.registerSessionHooks(pipeline);
+
+    wrapNewHooks(module.name(), pipeline, sizes);
+    return session;
+  }
+
+  /**
+   * \brief Get the statistics of each module on each hook point where
+   *        it registered a hook.
+   *
+   * Can be called while the hooks are running, the values of the
+   * different counters are not taken at the exact same time.
+   */
+  std::vector<HookStats> stats() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<HookStats>      result(sites_.size());
+    std::size_t                 i = 0;
+
+    for (std::list<Site>::const_iterator it = sites_.begin(); it != sites_.end(); ++it, ++i)
+      {
+        HookStats & stats = result[i];
+
+        stats.module = it->module;
+        stats.point  = it->point;
+        stats.calls  = 0;
+        stats.nulls  = 0;
+        for (unsigned s = 0; s < ShardCount; ++s)
+          {
+            stats.calls += it->shards[s].calls.load(std::memory_order_relaxed);
+            stats.nulls += it->shards[s].nulls.load(std::memory_order_relaxed);
+            collect(it->shards[s], HookLatency, stats.hookLatency);
+            collect(it->shards[s], HandlerLatency, stats.handlerLatency);
+          }
+      }
+    return result;
+  }
+
+  /**
+   * \brief Reset all the counters.
+   *
+   * The calls running during the reset may be partially counted.
+   */
+  void reset()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (std::list<Site>::iterator it = sites_.begin(); it != sites_.end(); ++it)
+      for (unsigned s = 0; s < ShardCount; ++s)
+        it->shards[s].reset();
+  }
+
+  /**
+   * \brief The statistics as a table, a line per module and hook
+   *        point, the latencies are in nanoseconds.
+   */
+  std::string report() const
+  {
+    const std::vector<HookStats> all = stats();
+    std::string                  out;
+    char                         buffer[256];
+
+    std::snprintf(buffer, sizeof(buffer), "%-20s %-12s %10s %6s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                 "module", "hook point", "calls", "null%",
+                 "hook mean", "p50", "p99", "max",
+                 "call mean", "p50", "p99", "max");
+    out += buffer;
+    for (std::vector<HookStats>::const_iterator it = all.begin(); it != all.end(); ++it)
+      {
+        std::snprintf(buffer, sizeof(buffer), "%-20s %-12s %10lu %6.2f",
+                     it->module.c_str(), hookPointName(it->point),
+                     static_cast<unsigned long>(it->calls), it->nullRate() * 100.);
+        out += buffer;
+        appendLatency(out, it->hookLatency);
+        appendLatency(out, it->handlerLatency);
+        out += '\n';
+      }
+    return out;
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_HOOKPROFILER_H_ */
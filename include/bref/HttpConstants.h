@@ -11,6 +11,8 @@
 #ifndef BREF_API_HTTPCONSTANTS_H
 #define BREF_API_HTTPCONSTANTS_H
 
+#include <cstddef>
+
 namespace bref {
 
 /**
@@ -111,8 +113,175 @@ enum Category {
   ServerError           = 500
 };
 
+/**
+ * \brief A precomputed HTTP/1.1 status line, e.g:
+ *        \code "HTTP/1.1 404 Not Found\r\n" \endcode
+ */
+struct StatusLine
+{
+  const char  *line;            /**< the status line, CRLF included */
+  std::size_t  size;            /**< the size of the line */
+};
+
+/**
+ * \brief Get the HTTP/1.1 status line of \p status, with the reason
+ *        phrase of RFC2616.
+ *
+ * \return A null line for an unknown status code.
+ */
+inline StatusLine statusLine(Type status)
+{
+#define BREF_STATUS_LINE(code, reason)                                  \
+  case code:                                                            \
+    {                                                                   \
+      const StatusLine line = {                                         \
+        "HTTP/1.1 " #code " " reason "\r\n",                            \
+        sizeof "HTTP/1.1 " #code " " reason "\r\n" - 1                  \
+      };                                                                \
+      return line;                                                      \
+    }
+
+  switch (static_cast<int>(status))
+    {
+    BREF_STATUS_LINE(100, "Continue");
+    BREF_STATUS_LINE(101, "Switching Protocols");
+    BREF_STATUS_LINE(200, "OK");
+    BREF_STATUS_LINE(201, "Created");
+    BREF_STATUS_LINE(202, "Accepted");
+    BREF_STATUS_LINE(203, "Non-Authoritative Information");
+    BREF_STATUS_LINE(204, "No Content");
+    BREF_STATUS_LINE(205, "Reset Content");
+    BREF_STATUS_LINE(206, "Partial Content");
+    BREF_STATUS_LINE(300, "Multiple Choices");
+    BREF_STATUS_LINE(301, "Moved Permanently");
+    BREF_STATUS_LINE(302, "Found");
+    BREF_STATUS_LINE(303, "See Other");
+    BREF_STATUS_LINE(304, "Not Modified");
+    BREF_STATUS_LINE(305, "Use Proxy");
+    BREF_STATUS_LINE(307, "Temporary Redirect");
+    BREF_STATUS_LINE(400, "Bad Request");
+    BREF_STATUS_LINE(401, "Unauthorized");
+    BREF_STATUS_LINE(402, "Payment Required");
+    BREF_STATUS_LINE(403, "Forbidden");
+    BREF_STATUS_LINE(404, "Not Found");
+    BREF_STATUS_LINE(405, "Method Not Allowed");
+    BREF_STATUS_LINE(406, "Not Acceptable");
+    BREF_STATUS_LINE(407, "Proxy Authentication Required");
+    BREF_STATUS_LINE(408, "Request Time-out");
+    BREF_STATUS_LINE(409, "Conflict");
+    BREF_STATUS_LINE(410, "Gone");
+    BREF_STATUS_LINE(411, "Length Required");
+    BREF_STATUS_LINE(412, "Precondition Failed");
+    BREF_STATUS_LINE(413, "Request Entity Too Large");
+    BREF_STATUS_LINE(414, "Request-URI Too Large");
+    BREF_STATUS_LINE(415, "Unsupported Media Type");
+    BREF_STATUS_LINE(416, "Requested range not satisfiable");
+    BREF_STATUS_LINE(417, "Expectation Failed");
+    BREF_STATUS_LINE(500, "Internal Server Error");
+    BREF_STATUS_LINE(501, "Not Implemented");
+    BREF_STATUS_LINE(502, "Bad Gateway");
+    BREF_STATUS_LINE(503, "Service Unavailable");
+    BREF_STATUS_LINE(504, "Gateway Time-out");
+    BREF_STATUS_LINE(505, "HTTP Version not supported");
+    default:
+      break;
+    }
+#undef BREF_STATUS_LINE
+
+  const StatusLine unknown = { 0, 0 };
+
+  return unknown;
+}
+
+/**
+ * \brief Get the reason phrase of RFC2616 for \p status.
+ *
+ * \param[out] size
+ *            The size of the reason phrase.
+ *
+ * \return A null pointer for an unknown status code.
+ */
+inline const char *reasonPhrase(Type status, std::size_t & size)
+{
+  // "HTTP/1.1 200 " ... "\r\n"
+  const std::size_t prefixSize = 13;
+  const StatusLine  line       = statusLine(status);
+
+  if (! line.line)
+    {
+      size = 0;
+      return 0;
+    }
+  size = line.size - prefixSize - 2;
+  return line.line + prefixSize;
+}
+
 } // ! status_codes
 
+/**
+ * \brief Namespace containing the well-known HTTP header fields.
+ * \sa header_fields::Type
+ */
+namespace header_fields {
+
+/**
+ * \brief Enumeration containing the well-known HTTP header fields.
+ *
+ * These fields are identified by an integer in the HttpHeader, so
+ * that a lookup doesn't need a string comparison.
+ *
+ * \sa HttpHeader, header_fields::name()
+ */
+enum Type {
+  UnknownHeaderField = 0,
+  Accept,
+  AcceptCharset,
+  AcceptEncoding,
+  AcceptLanguage,
+  AcceptRanges,
+  Age,
+  Allow,
+  Authorization,
+  CacheControl,
+  Connection,
+  ContentEncoding,
+  ContentLanguage,
+  ContentLength,
+  ContentLocation,
+  ContentRange,
+  ContentType,
+  Cookie,
+  Date,
+  ETag,
+  Expect,
+  Expires,
+  Host,
+  IfMatch,
+  IfModifiedSince,
+  IfNoneMatch,
+  IfRange,
+  IfUnmodifiedSince,
+  KeepAlive,
+  LastModified,
+  Location,
+  Pragma,
+  Range,
+  Referer,
+  Server,
+  SetCookie,
+  TransferEncoding,
+  Upgrade,
+  UserAgent,
+  Vary,
+  Via,
+  WWWAuthenticate,
+  XForwardedFor,
+
+  HeaderFieldCount              /**< Number of values in the enumeration */
+};
+
+} // ! header_fields
+
 } // ! bref
 
 #endif  // ! BREF_API_HTTPCONSTANTS_H
@@ -10,24 +10,538 @@
 #ifndef BREF_API_HTTPHEADER_H_
 #define BREF_API_HTTPHEADER_H_
 
-#include <map>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
+
 #include "BrefValue.h"
+#include "HttpConstants.h"
+#include "detail/Config.h"
 #include "detail/util/ICaseStringCmp.hpp"
 
 namespace bref {
 
+namespace header_fields {
+
+/**
+ * \brief Name and length of a well-known header field.
+ */
+struct FieldName
+{
+  const char  *name;
+  std::size_t  size;
+};
+
+/**
+ * \brief Get the name of a well-known header field.
+ *
+ * \return The canonical name and its length, a null name for
+ *         header_fields::UnknownHeaderField.
+ */
+inline const FieldName & name(Type field)
+{
+#define BREF_HEADER_FIELD(str) { str, sizeof str - 1 }
+  static const FieldName names[HeaderFieldCount] = {
+    { 0, 0 },
+    BREF_HEADER_FIELD("Accept"),
+    BREF_HEADER_FIELD("Accept-Charset"),
+    BREF_HEADER_FIELD("Accept-Encoding"),
+    BREF_HEADER_FIELD("Accept-Language"),
+    BREF_HEADER_FIELD("Accept-Ranges"),
+    BREF_HEADER_FIELD("Age"),
+    BREF_HEADER_FIELD("Allow"),
+    BREF_HEADER_FIELD("Authorization"),
+    BREF_HEADER_FIELD("Cache-Control"),
+    BREF_HEADER_FIELD("Connection"),
+    BREF_HEADER_FIELD("Content-Encoding"),
+    BREF_HEADER_FIELD("Content-Language"),
+    BREF_HEADER_FIELD("Content-Length"),
+    BREF_HEADER_FIELD("Content-Location"),
+    BREF_HEADER_FIELD("Content-Range"),
+    BREF_HEADER_FIELD("Content-Type"),
+    BREF_HEADER_FIELD("Cookie"),
+    BREF_HEADER_FIELD("Date"),
+    BREF_HEADER_FIELD("ETag"),
+    BREF_HEADER_FIELD("Expect"),
+    BREF_HEADER_FIELD("Expires"),
+    BREF_HEADER_FIELD("Host"),
+    BREF_HEADER_FIELD("If-Match"),
+    BREF_HEADER_FIELD("If-Modified-Since"),
+    BREF_HEADER_FIELD("If-None-Match"),
+    BREF_HEADER_FIELD("If-Range"),
+    BREF_HEADER_FIELD("If-Unmodified-Since"),
+    BREF_HEADER_FIELD("Keep-Alive"),
+    BREF_HEADER_FIELD("Last-Modified"),
+    BREF_HEADER_FIELD("Location"),
+    BREF_HEADER_FIELD("Pragma"),
+    BREF_HEADER_FIELD("Range"),
+    BREF_HEADER_FIELD("Referer"),
+    BREF_HEADER_FIELD("Server"),
+    BREF_HEADER_FIELD("Set-Cookie"),
+    BREF_HEADER_FIELD("Transfer-Encoding"),
+    BREF_HEADER_FIELD("Upgrade"),
+    BREF_HEADER_FIELD("User-Agent"),
+    BREF_HEADER_FIELD("Vary"),
+    BREF_HEADER_FIELD("Via"),
+    BREF_HEADER_FIELD("WWW-Authenticate"),
+    BREF_HEADER_FIELD("X-Forwarded-For")
+  };
+#undef BREF_HEADER_FIELD
+
+  return (field > UnknownHeaderField && field < HeaderFieldCount) ? names[field] : names[0];
+}
+
+/**
+ * \brief Find the well-known header field matching a name (case
+ *        insensitive).
+ *
+ * \return header_fields::UnknownHeaderField if the name is not a
+ *         well-known header field.
+ */
+inline Type fromName(const char *fieldName, std::size_t size)
+{
+  for (int i = UnknownHeaderField + 1; i < HeaderFieldCount; ++i)
+    {
+      const FieldName & candidate = name(static_cast<Type>(i));
+
+      if (candidate.size == size && util::icaseEqual(candidate.name, fieldName, size))
+        return static_cast<Type>(i);
+    }
+  return UnknownHeaderField;
+}
+
+} // ! header_fields
+
 /**
- * \brief A map seems to be sufficient to represent HTTP Header fields.
+ * \brief The HTTP header fields, with a \c std::map like interface.
+ *
+ * The fields are stored in a contiguous array, in order of insertion,
+ * a header usually contains a few dozens of fields at most and a
+ * linear scan of an array is faster than a tree for this size.
+ *
+ * Each field name is hashed once, when inserted, and the well-known
+ * header fields (see header_fields::Type) are identified by an
+ * integer. Looking for a field by its header_fields::Type doesn't
+ * compare any string.
+ *
+ * Example:
+\code
+bref::HttpHeader header;
+
+header["content-length"] = bref::BrefValue(42);
+
+// both are the same field
+header.find("Content-Length");
+header.find(bref::header_fields::ContentLength);
+\endcode
  *
  * \note RFC2616, section 4.2 says: "Field names are
- *       case-insensitive.". The third parameter util::ICaseStringCmp
- *       allows the map to consider the keys "KEY", "key", "Key", etc,
- *       to be equivalent.
+ *       case-insensitive.". The keys "KEY", "key", "Key", etc, are
+ *       equivalent.
+ *
+ * The fields removed by clear() or erase() are kept aside and reused by
+ * the next insertions, their strings keep their memory. A header
+ * reused for the requests of a keep-alive connection stops allocating
+ * once it has seen its largest request.
+ *
+ * \warning As with \c std::vector, an insertion (operator[](), insert(),
+ *          add()) may invalidate all the iterators, pointers and
+ *          references to the fields, and erase() invalidates those to
+ *          the removed field and the following ones.
+ *
+ * \warning value_type is a \c std::pair<std::string, BrefValue>: the
+ *          name of a field is writable through an iterator, but the
+ *          hash and the well-known identifier used by the lookups are
+ *          not updated. Renaming a field this way makes find(),
+ *          count() and field() give wrong results, erase the field and
+ *          insert it again instead.
  *
  * \sa BrefValue
  */
-typedef std::map<std::string, BrefValue, util::ICaseStringCmp> HttpHeader;
+class HttpHeader
+{
+public:
+  typedef std::string                             key_type;
+  typedef BrefValue                               mapped_type;
+  typedef std::pair<std::string, BrefValue>       value_type;
+  typedef std::vector<value_type>::iterator       iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+  typedef std::vector<value_type>::size_type      size_type;
+
+private:
+  /**
+   * Case insensitive hash of the field name and well-known field
+   * identifier, stored in parallel of fields_.
+   */
+  struct Key
+  {
+    uint32_t            hash;
+    header_fields::Type field;
+  };
+
+  /**
+   * The first size_ elements are the fields of the header, the others
+   * are kept to be reused.
+   */
+  std::vector<value_type> fields_;
+  std::vector<Key>        keys_;
+  size_type               size_;
+
+  static uint32_t hash(const char *name, std::size_t size)
+  {
+    return static_cast<uint32_t>(util::icaseHash(name, size));
+  }
+
+  size_type indexOf(const char *name, std::size_t size, uint32_t h) const
+  {
+    for (size_type i = 0; i < size_; ++i)
+      if (keys_[i].hash == h &&
+          fields_[i].first.size() == size &&
+          util::icaseEqual(fields_[i].first.data(), name, size))
+        return i;
+    return size_;
+  }
+
+  size_type indexOf(const std::string & name) const
+  {
+    return indexOf(name.data(), name.size(), hash(name.data(), name.size()));
+  }
+
+  size_type indexOf(header_fields::Type field) const
+  {
+    if (field == header_fields::UnknownHeaderField)
+      return size_;
+    for (size_type i = 0; i < size_; ++i)
+      if (keys_[i].field == field)
+        return i;
+    return size_;
+  }
+
+  /**
+   * \brief Append a field named \p name, a field kept by clear() is
+   *        reused and its value is left as is.
+   */
+  iterator append(const char *name, size_type size, uint32_t h)
+  {
+    Key key;
+
+    key.hash  = h;
+    key.field = header_fields::fromName(name, size);
+    if (size_ < fields_.size())
+      keys_[size_] = key;
+    else
+      {
+        fields_.push_back(value_type());
+        keys_.push_back(key);
+      }
+    fields_[size_].first.assign(name, size);
+    return fields_.begin() + size_++;
+  }
+
+  iterator append(const std::string & name, uint32_t h, const BrefValue & value)
+  {
+    iterator it = append(name.data(), name.size(), h);
+
+    it->second = value;
+    return it;
+  }
+
+public:
+  HttpHeader()
+    : fields_(), keys_(), size_(0)
+  { }
+
+  HttpHeader(const HttpHeader & other)
+    : fields_(other.begin(), other.end()),
+      keys_(other.keys_.begin(), other.keys_.begin() + other.size_),
+      size_(other.size_)
+  { }
+
+#ifdef BREF_CXX11
+  HttpHeader(HttpHeader && other) noexcept
+    : fields_(std::move(other.fields_)),
+      keys_(std::move(other.keys_)),
+      size_(other.size_)
+  {
+    other.size_ = 0;
+  }
+
+  HttpHeader & operator=(HttpHeader && other) noexcept
+  {
+    HttpHeader(std::move(other)).swap(*this);
+    return *this;
+  }
+#endif  // BREF_CXX11
+
+  HttpHeader & operator=(const HttpHeader & other)
+  {
+    HttpHeader(other).swap(*this);
+    return *this;
+  }
+
+  iterator begin()
+  {
+    return fields_.begin();
+  }
+
+  const_iterator begin() const
+  {
+    return fields_.begin();
+  }
+
+  iterator end()
+  {
+    return fields_.begin() + size_;
+  }
+
+  const_iterator end() const
+  {
+    return fields_.begin() + size_;
+  }
+
+  size_type size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * \brief Remove all the fields, the memory already allocated is
+   *        kept.
+   *
+   * The fields are not destroyed, their names and values are reused
+   * by the next insertions.
+   */
+  void clear()
+  {
+    size_ = 0;
+  }
+
+  /**
+   * \brief Destroy the fields kept for reuse by clear() and erase().
+   */
+  void shrink()
+  {
+    fields_.erase(fields_.begin() + size_, fields_.end());
+    keys_.erase(keys_.begin() + size_, keys_.end());
+  }
+
+  /**
+   * \brief Reserve the storage for \p count fields.
+   */
+  void reserve(size_type count)
+  {
+    fields_.reserve(count);
+    keys_.reserve(count);
+  }
+
+  void swap(HttpHeader & other) BREF_NOEXCEPT
+  {
+    fields_.swap(other.fields_);
+    keys_.swap(other.keys_);
+    std::swap(size_, other.size_);
+  }
+
+  /**
+   * \brief Find a field by name.
+   *
+   * \return end() if there is no such field.
+   */
+  iterator find(const std::string & name)
+  {
+    return fields_.begin() + indexOf(name);
+  }
+
+  const_iterator find(const std::string & name) const
+  {
+    return fields_.begin() + indexOf(name);
+  }
+
+  /**
+   * \brief Find a well-known field.
+   *
+   * \return end() if there is no such field.
+   */
+  iterator find(header_fields::Type field)
+  {
+    return fields_.begin() + indexOf(field);
+  }
+
+  const_iterator find(header_fields::Type field) const
+  {
+    return fields_.begin() + indexOf(field);
+  }
+
+  /**
+   * \return 1 if the field exists, 0 otherwise.
+   */
+  size_type count(const std::string & name) const
+  {
+    return indexOf(name) != size_;
+  }
+
+  /**
+   * \return 1 if the field exists, 0 otherwise.
+   */
+  size_type count(header_fields::Type field) const
+  {
+    return indexOf(field) != size_;
+  }
+
+  /**
+   * \brief Access a field, a null value is inserted if the field
+   *        doesn't exist.
+   */
+  BrefValue & operator[](const std::string & name)
+  {
+    uint32_t  h = hash(name.data(), name.size());
+    size_type i = indexOf(name.data(), name.size(), h);
+
+    if (i != size_)
+      return fields_[i].second;
+    return append(name, h, BrefValue())->second;
+  }
+
+  /**
+   * \brief Access a well-known field, a null value is inserted with the
+   *        canonical name of the field if it doesn't exist.
+   *
+   * \throw std::invalid_argument if \p field is not a well-known field
+   *        (header_fields::UnknownHeaderField, HeaderFieldCount), it has
+   *        no name to insert.
+   */
+  BrefValue & operator[](header_fields::Type field)
+  {
+    if (field <= header_fields::UnknownHeaderField || field >= header_fields::HeaderFieldCount)
+      throw std::invalid_argument("bref::HttpHeader: not a well-known header field");
+
+    size_type i = indexOf(field);
+
+    if (i != size_)
+      return fields_[i].second;
+
+    const header_fields::FieldName & fieldName = header_fields::name(field);
+
+    return append(std::string(fieldName.name, fieldName.size), hash(fieldName.name, fieldName.size),
+                  BrefValue())->second;
+  }
+
+  /**
+   * \brief Insert a field if it doesn't exist.
+   *
+   * \return An iterator to the field with the name \p value.first, and
+   *         true if it was inserted.
+   */
+  std::pair<iterator, bool> insert(const value_type & value)
+  {
+    uint32_t  h = hash(value.first.data(), value.first.size());
+    size_type i = indexOf(value.first.data(), value.first.size(), h);
+
+    if (i != size_)
+      return std::make_pair(fields_.begin() + i, false);
+    return std::make_pair(append(value.first, h, value.second), true);
+  }
+
+  /**
+   * \brief Add a value to the field \p name, inserted if it doesn't
+   *        exist.
+   *
+   * A field present several times is equivalent to one field whose
+   * values are separated by commas (RFC2616, section 4.2), except
+   * Cookie whose values are separated by "; " (RFC6265, section
+   * 5.4). The name and the value are copied in the storage of the
+   * fields kept by clear(), a parser can fill the header without
+   * temporary strings.
+   */
+  iterator add(const char *name, size_type nameSize, const char *value, size_type valueSize)
+  {
+    uint32_t  h = hash(name, nameSize);
+    size_type i = indexOf(name, nameSize, h);
+
+    if (i != size_)
+      {
+        BrefValue & current = fields_[i].second;
+
+        if (current.isString())
+          {
+            if (keys_[i].field == header_fields::Cookie)
+              current.appendString("; ", 2);
+            else
+              current.appendString(", ", 2);
+            current.appendString(value, valueSize);
+          }
+        else
+          current.setString(value, valueSize);
+        return fields_.begin() + i;
+      }
+
+    iterator it = append(name, nameSize, h);
+
+    it->second.setString(value, valueSize);
+    return it;
+  }
+
+  /**
+   * \brief Remove the field at \p position.
+   *
+   * The following fields are moved back by one position, the removed
+   * field is kept for reuse.
+   */
+  void erase(iterator position)
+  {
+    for (size_type i = position - fields_.begin(); i + 1 < size_; ++i)
+      {
+        fields_[i].first.swap(fields_[i + 1].first);
+        fields_[i].second.swap(fields_[i + 1].second);
+        std::swap(keys_[i], keys_[i + 1]);
+      }
+    --size_;
+  }
+
+  /**
+   * \brief Remove a field by name.
+   *
+   * \return The number of fields removed (0 or 1).
+   */
+  size_type erase(const std::string & name)
+  {
+    size_type i = indexOf(name);
+
+    if (i == size_)
+      return 0;
+    erase(fields_.begin() + i);
+    return 1;
+  }
+
+  /**
+   * \brief Get the well-known field identifier of the field at
+   *        \p position.
+   *
+   * \return header_fields::UnknownHeaderField if the field is not a
+   *         well-known one.
+   */
+  header_fields::Type field(const_iterator position) const
+  {
+    return keys_[position - fields_.begin()].field;
+  }
+};
+
+/**
+ * \brief Exchange the content of two headers.
+ */
+inline void swap(HttpHeader & a, HttpHeader & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
 
 } // ! bref
 
@@ -12,7 +12,9 @@
 #define BREF_API_HTTPREQUEST_H
 
 #include <deque>
+#include <algorithm>
 
+#include "detail/Config.h"
 #include "HttpConstants.h"
 #include "HttpHeader.h"
 #include "Version.h"
@@ -58,6 +60,38 @@ public:
    */
   ~HttpRequest();
 
+#ifdef BREF_CXX11
+  HttpRequest(const HttpRequest &) = default;
+  HttpRequest(HttpRequest &&) = default;
+  HttpRequest & operator=(const HttpRequest &) = default;
+  HttpRequest & operator=(HttpRequest &&) = default;
+#endif  // BREF_CXX11
+
+  /**
+   * \brief Exchange the content of two requests.
+   */
+  void swap(HttpRequest & other) BREF_NOEXCEPT
+  {
+    HttpHeader::swap(other);
+    std::swap(method_, other.method_);
+    uri_.swap(other.uri_);
+    std::swap(version_, other.version_);
+  }
+
+  /**
+   * \brief Reset the request for the next request of a connection.
+   *
+   * The memory already allocated for the URI and the header fields is
+   * kept (see HttpHeader::clear()).
+   */
+  void clear()
+  {
+    HttpHeader::clear();
+    method_ = request_methods::UndefinedRequestMethod;
+    uri_.clear();
+    version_ = Version();
+  }
+
   /**
    * \brief Get HTTP method
    *
@@ -95,6 +129,14 @@ public:
   void setVersion(const Version &);
 };
 
+/**
+ * \brief Exchange the content of two requests.
+ */
+inline void swap(HttpRequest & a, HttpRequest & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
+
 }
 
 #endif  // ! BREF_API_HTTPREQUEST_H
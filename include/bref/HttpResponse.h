@@ -15,8 +15,14 @@
 #include "Version.h"
 #include "Buffer.h"
 #include "detail/BrefDLL.h"
+#include "detail/Config.h"
+#include "detail/util/FloatFormat.hpp"
+#include "detail/util/IntFormat.hpp"
 
 #include <deque>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 
 namespace bref {
 
@@ -46,6 +52,112 @@ private:
    */
   std::string        reason_;
 
+  /**
+   * \brief Copy \p size bytes of \p data at \p pos in \p out, if not
+   *        null.
+   *
+   * \return The position after the data.
+   */
+  static std::size_t put(char *out, std::size_t pos, const char *data, std::size_t size)
+  {
+    if (out && size)
+      std::memcpy(out + pos, data, size);
+    return pos + size;
+  }
+
+  /**
+   * \brief Write \p value in \p out, if not null.
+   *
+   * \return The position after the value.
+   */
+  static std::size_t putDecimal(char *out, std::size_t pos, long value)
+  {
+    if (out)
+      return pos + util::formatDecimal(value, out + pos);
+    return pos + util::decimalSize(value);
+  }
+
+  /**
+   * \brief Write a header field value, the lists are written as a
+   *        field per element.
+   *
+   * \return The position after the value.
+   */
+  static std::size_t putField(char *out, std::size_t pos, const std::string & name, const BrefValue & value)
+  {
+    if (value.isList())
+      {
+        const BrefValueList & list = value.asList();
+
+        for (BrefValueList::const_iterator it = list.begin(); it != list.end(); ++it)
+          pos = putField(out, pos, name, *it);
+        return pos;
+      }
+
+    pos = put(out, pos, name.data(), name.size());
+    pos = put(out, pos, ": ", 2);
+    switch (value.getType())
+      {
+      case BrefValue::stringType:
+        pos = put(out, pos, value.asString().data(), value.asString().size());
+        break;
+      case BrefValue::intType:
+        pos = putDecimal(out, pos, value.asInt());
+        break;
+      case BrefValue::boolType:
+        pos = value.asBool() ? put(out, pos, "true", 4) : put(out, pos, "false", 5);
+        break;
+      case BrefValue::doubleType:
+        {
+          char buffer[util::MaxDoubleSize];
+
+          pos = put(out, pos, buffer, util::formatDouble(value.asDouble(), 15, buffer));
+          break;
+        }
+      default:
+        break;
+      }
+    return put(out, pos, "\r\n", 2);
+  }
+
+  /**
+   * \brief Write the response header in \p out, if not null.
+   *
+   * \return The size of the header.
+   */
+  std::size_t writeRawData(char *out) const
+  {
+    const status_codes::StatusLine statusLine = status_codes::statusLine(statusCode_);
+    std::size_t                    pos        = 0;
+    std::size_t                    reasonSize;
+    const char                    *reason     = status_codes::reasonPhrase(statusCode_, reasonSize);
+
+    if (statusLine.line && version_.Major == 1 && version_.Minor == 1 &&
+        (reason_.empty() || reason_.compare(0, reason_.size(), reason, reasonSize) == 0))
+      pos = put(out, pos, statusLine.line, statusLine.size);
+    else
+      {
+        if (! reason_.empty())
+          {
+            reason     = reason_.data();
+            reasonSize = reason_.size();
+          }
+        pos = put(out, pos, "HTTP/", 5);
+        pos = putDecimal(out, pos, version_.Major);
+        pos = put(out, pos, ".", 1);
+        pos = putDecimal(out, pos, version_.Minor);
+        pos = put(out, pos, " ", 1);
+        pos = putDecimal(out, pos, statusCode_);
+        pos = put(out, pos, " ", 1);
+        pos = put(out, pos, reason, reasonSize);
+        pos = put(out, pos, "\r\n", 2);
+      }
+
+    for (const_iterator it = begin(); it != end(); ++it)
+      pos = putField(out, pos, it->first, it->second);
+    return put(out, pos, "\r\n", 2);
+  }
+
 public:
   /**
    * \brief Construct an empty HTTP response.
@@ -57,6 +169,38 @@ public:
    */
   ~HttpResponse();
 
+#ifdef BREF_CXX11
+  HttpResponse(const HttpResponse &) = default;
+  HttpResponse(HttpResponse &&) = default;
+  HttpResponse & operator=(const HttpResponse &) = default;
+  HttpResponse & operator=(HttpResponse &&) = default;
+#endif  // BREF_CXX11
+
+  /**
+   * \brief Exchange the content of two responses.
+   */
+  void swap(HttpResponse & other) BREF_NOEXCEPT
+  {
+    HttpHeader::swap(other);
+    std::swap(version_, other.version_);
+    std::swap(statusCode_, other.statusCode_);
+    reason_.swap(other.reason_);
+  }
+
+  /**
+   * \brief Reset the response for the next request of a connection.
+   *
+   * The memory already allocated for the reason and the header fields
+   * is kept (see HttpHeader::clear()).
+   */
+  void clear()
+  {
+    HttpHeader::clear();
+    version_ = Version();
+    statusCode_ = status_codes::UndefinedStatusCode;
+    reason_.clear();
+  }
+
   /**
    * \brief Get the current HTTP version
    *
@@ -91,9 +235,72 @@ public:
    * \code  "HTTP/1.1 200 OK\r\n" \endcode
    *
    * \return The response header as raw data.
+   *
+   * \sa appendRawData(), serializeTo() which don't allocate a new
+   *     buffer.
    */
   Buffer getRawData() const;
 
+  /**
+   * \brief Size of the response header as raw data, the empty line
+   *        ending the header included.
+   *
+   * \sa serializeTo()
+   */
+  std::size_t rawDataSize() const
+  {
+    return writeRawData(0);
+  }
+
+  /**
+   * \brief Write the response header as raw data in \p out, the empty
+   *        line ending the header included.
+   *
+   * The status line of the common status codes is precomputed when
+   * the reason is empty or the default one (see
+   * status_codes::statusLine()).
+   *
+   * Example, sending the header and the first chunk of the body with
+   * a single system call:
+\code
+char         header[4096];
+std::size_t  size = response.serializeTo(header, sizeof header);
+struct iovec iov[16];
+
+if (size <= sizeof header)
+  {
+    iov[0].iov_base = header;
+    iov[0].iov_len  = size;
+    writev(socket, iov, 1 + body.fillIoVec(iov + 1, 15));
+  }
+\endcode
+   *
+   * \return The size of the raw header. Nothing is written if it's
+   *         greater than \p size.
+   */
+  std::size_t serializeTo(char *out, std::size_t size) const
+  {
+    const std::size_t rawSize = rawDataSize();
+
+    if (rawSize <= size)
+      writeRawData(out);
+    return rawSize;
+  }
+
+  /**
+   * \brief Append the response header as raw data at the end of
+   *        \p buffer, the empty line ending the header included.
+   *
+   * The buffer is resized once, to the exact size of the header.
+   */
+  void appendRawData(Buffer & buffer) const
+  {
+    const std::size_t offset = buffer.size();
+
+    buffer.resize(offset + rawDataSize());
+    writeRawData(&buffer[0] + offset);
+  }
+
   /**
    * \brief Set HTTP version
    *
@@ -122,6 +329,14 @@ public:
   void setReason(const std::string & reason);
 };
 
+/**
+ * \brief Exchange the content of two responses.
+ */
+inline void swap(HttpResponse & a, HttpResponse & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
+
 } // ! bref
 
 #endif /* !BREF_API_HTTPRESPONSE_H_ */
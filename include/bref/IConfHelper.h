@@ -11,6 +11,7 @@
 #define BREF_API_ICONFHELPER_H_
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include "detail/util/NonCopyable.hpp"
@@ -19,12 +20,85 @@
 
 namespace bref {
 
+/**
+ * \brief A configuration key interned by IConfHelper::internKey().
+ *
+ * The handle keeps the name of the key, a helper that didn't intern
+ * it can still look it up by name. The index is only meaningful for
+ * the key table which gave it, identified by registry().
+ */
+class KeyHandle
+{
+public:
+  /**
+   * \brief Index of a key not interned.
+   */
+  static const std::size_t NoIndex = static_cast<std::size_t>(-1);
+
+  KeyHandle()
+    : key_(), index_(NoIndex), registry_(0)
+  { }
+
+  explicit KeyHandle(const std::string & key, std::size_t index = NoIndex, const void *registry = 0)
+    : key_(key), index_(index), registry_(registry)
+  { }
+
+  /**
+   * \brief Name of the key.
+   */
+  const std::string & key() const
+  {
+    return key_;
+  }
+
+  /**
+   * \brief Index given by the helper, NoIndex if the key isn't
+   *        interned.
+   */
+  std::size_t index() const
+  {
+    return index_;
+  }
+
+  /**
+   * \brief Identity of the key table of the helper which gave the
+   *        index, null if the key isn't interned.
+   *
+   * A helper compares it with its own table before using index(), a
+   * handle interned by another helper is looked up by name.
+   */
+  const void *registry() const
+  {
+    return registry_;
+  }
+
+private:
+  std::string  key_;
+  std::size_t  index_;
+  const void  *registry_;
+};
+
 /**
  * \brief Helper class for BrefValue and the server configuration.
  *
  * This class aimed to give an easier access to the server
  * configuration.
  *
+ * The keys used for each request should be interned once, when the
+ * module is loaded, and looked up with the KeyHandle overloads of
+ * findValue():
+\code
+bref::KeyHandle documentRoot = confHelper.internKey("DocumentRoot");
+
+// for each request
+environment.serverConfigHelper.findValue(documentRoot, request).asString();
+\endcode
+ *
+ * \note A helper overriding only the \c std::string overloads of
+ *       findValue() should add a <tt>using IConfHelper::findValue;</tt>
+ *       declaration.
+ *
+ * \sa CompiledConfHelper
  */
 class IConfHelper : public util::NonCopyable
 {
@@ -50,6 +124,36 @@ public:
    */
   virtual const BrefValue & findValue(std::string const & key,
                                       HttpRequest const & request) const = 0;
+
+  /**
+   * \brief Intern a key for the KeyHandle overloads of findValue().
+   *
+   * The default implementation returns a handle without index, the
+   * lookups are done by name.
+   */
+  virtual KeyHandle internKey(std::string const & key) const
+  {
+    return KeyHandle(key);
+  }
+
+  /**
+   * \brief Same as findValue(std::string const &), with an interned
+   *        key.
+   */
+  virtual const BrefValue & findValue(KeyHandle const & key) const
+  {
+    return findValue(key.key());
+  }
+
+  /**
+   * \brief Same as findValue(std::string const &, HttpRequest const &),
+   *        with an interned key.
+   */
+  virtual const BrefValue & findValue(KeyHandle const & key,
+                                      HttpRequest const & request) const
+  {
+    return findValue(key.key(), request);
+  }
 };
 
 } // ! bref
@@ -11,6 +11,9 @@
 #ifndef BREF_API_ILOGGER_H
 #define BREF_API_ILOGGER_H
 
+#include "AccessRecord.h"
+
+#include <cstddef>
 #include <string>
 
 namespace bref {
@@ -74,6 +77,45 @@ public:
    *    The message (string) to log.
    */
   virtual void log(Severity messageSeverity, const std::string & message) = 0;
+
+  /**
+   * \brief Log a message given as a buffer of characters.
+   *
+   * This is what the LOG() macros use. The default implementation
+   * builds a \c std::string and calls log(), a logger can override it
+   * to avoid this copy.
+   *
+   * \param messageSeverity
+   *    The severity of the message.
+   * \param message
+   *    The message, not null terminated.
+   * \param size
+   *    The size of the message.
+   */
+  virtual void logBuffer(Severity messageSeverity, const char *message, std::size_t size)
+  {
+    log(messageSeverity, std::string(message, size));
+  }
+
+  /**
+   * \brief Log the access record of a request.
+   *
+   * The default implementation logs the record as text with the
+   * \c Info severity (see AccessRecord::toChars()), a logger can
+   * override it to store the binary record (see MappedAccessLog).
+   *
+   * \param record
+   *    The record of the request.
+   */
+  virtual void logAccess(const AccessRecord & record)
+  {
+    if (Info < severity())
+      return;
+
+    char buffer[AccessRecord::MaxStringSize];
+
+    logBuffer(Info, buffer, record.toChars(buffer));
+  }
 };
 
 } // ! bref
@@ -12,8 +12,18 @@
 
 #include <stdint.h>
 
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "detail/util/IpFormat.hpp"
+
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+# include <winsock2.h>
+# include <ws2tcpip.h>
 # include <windows.h>
+#else
+# include <netinet/in.h>
 #endif
 
 namespace bref {
@@ -58,10 +68,85 @@ public:
   IpAddress();
   /**
    * \param get an IpAddress from a hostname, an IPv4 or IPv6 address
+   *
+   * \warning A host name is resolved by the server, the call can block.
+   *          Use parse() for the numeric addresses and a Resolver for
+   *          the host names.
    */
   IpAddress(const char * host);
   ~IpAddress();
 
+  /**
+   * \brief Build an IPv4 address.
+   */
+  explicit IpAddress(const IPv4Address & address)
+    : ipAddressStatus_(IPv4)
+  {
+    std::memset(&ipAddress_, 0, sizeof ipAddress_);
+    ipAddress_.v4_[0] = address;
+  }
+
+  /**
+   * \brief Build an IPv6 address.
+   */
+  explicit IpAddress(const IPv6Address & address)
+    : ipAddressStatus_(IPv6)
+  {
+    ipAddress_.v6_ = address;
+  }
+
+  /**
+   * \brief Build the address of a socket address, as given by \c
+   *        accept() or \c getpeername().
+   */
+  explicit IpAddress(const sockaddr_in & address)
+    : ipAddressStatus_(IPv4)
+  {
+    std::memset(&ipAddress_, 0, sizeof ipAddress_);
+    std::memcpy(ipAddress_.v4_[0].bytes, &address.sin_addr, 4);
+  }
+
+  explicit IpAddress(const sockaddr_in6 & address)
+    : ipAddressStatus_(IPv6)
+  {
+    std::memcpy(ipAddress_.v6_.bytes, &address.sin6_addr, 16);
+  }
+
+  /**
+   * \brief Parse a numeric IPv4 or IPv6 address, without any call to a
+   *        resolver nor allocation.
+   *
+   * See util::parseIPv4() and util::parseIPv6() for the accepted
+   * formats.
+   *
+   * \param[out] address
+   *            The address, unchanged on failure.
+   *
+   * \return false if \p text is not a numeric address.
+   */
+  static bool parse(const char *text, std::size_t size, IpAddress & address)
+  {
+    IPv4Address v4;
+    IPv6Address v6;
+
+    if (util::parseIPv4(text, size, v4.bytes))
+      {
+        address = IpAddress(v4);
+        return true;
+      }
+    if (util::parseIPv6(text, size, v6.bytes))
+      {
+        address = IpAddress(v6);
+        return true;
+      }
+    return false;
+  }
+
+  static bool parse(const std::string & text, IpAddress & address)
+  {
+    return parse(text.data(), text.size(), address);
+  }
+
   /**
    * \brief checks if an address is an IPv4 address
    */
@@ -84,6 +169,31 @@ public:
    */
   const IPv6Address & getV6() const;
 
+  /**
+   * \brief Maximum size of an address formatted by toChars().
+   */
+  static const std::size_t MaxStringSize = util::MaxIpAddressSize;
+
+  /**
+   * \brief Write the address in its textual form, without a terminating
+   *        null character.
+   *
+   * The IPv4 addresses are written in dotted-decimal notation, the
+   * IPv6 addresses as recommended by RFC5952 (lower case, longest run
+   * of zeros compressed).
+   *
+   * \param[out] out
+   *            Should have room for MaxStringSize characters.
+   *
+   * \return The number of characters written.
+   */
+  std::size_t toChars(char *out) const
+  {
+    if (isV4())
+      return util::formatIPv4(getV4().bytes, out);
+    return util::formatIPv6(getV6().bytes, out);
+  }
+
 protected:
   enum { IPv4, IPv6, IPerror } ipAddressStatus_;
   union {
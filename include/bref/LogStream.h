@@ -0,0 +1,300 @@
+/**
+ * \file   LogStream.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 10 19:05:27 2012
+ *
+ * \brief  LogStream class definition.
+ *
+ */
+
+#ifndef BREF_API_LOGSTREAM_H_
+#define BREF_API_LOGSTREAM_H_
+
+#include "IpAddress.h"
+#include "detail/Config.h"
+#include "detail/util/FloatFormat.hpp"
+#include "detail/util/IntFormat.hpp"
+#include "detail/util/NonCopyable.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <locale>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace bref {
+
+/**
+ * \brief A light output stream used to format the log messages.
+ *
+ * The message is written in a fixed buffer, on the stack, and moved to
+ * the heap only when it doesn't fit. The numbers are formatted without
+ * locale (the decimal point is always '.'), the other types are
+ * formatted through a \c std::ostream created on first use and kept
+ * for the message.
+ *
+ * The manipulators (\c std::hex, \c std::setw(), \c std::fixed, ...)
+ * are applied to this \c std::ostream and keep their effect on the
+ * values written after them, as with any stream. Once the format
+ * differs from the default one, all the values go through the
+ * \c std::ostream.
+ *
+ * \sa ScopedLogger, LOG(logger, severity)
+ */
+class LogStream : util::NonCopyable
+{
+public:
+  /// Size of the fixed buffer.
+  static const std::size_t InlineSize = 512;
+
+private:
+  char                 buffer_[InlineSize];
+  std::size_t          size_;
+  std::string          overflow_;       // the message once larger than buffer_
+  std::ostringstream  *stream_;         // format state and non-numeric types
+
+  void spill(const char *data, std::size_t size)
+  {
+    if (overflow_.empty())
+      {
+        overflow_.reserve(2 * InlineSize + size);
+        overflow_.assign(buffer_, size_);
+      }
+    overflow_.append(data, size);
+  }
+
+  template <typename T>
+  LogStream & format(const char *spec, T value)
+  {
+    char      buffer[64];
+    const int size = std::sprintf(buffer, spec, value);
+
+    return write(buffer, size);
+  }
+
+  template <typename T>
+  LogStream & formatFloat(const char *spec, T value)
+  {
+    char      buffer[64];
+    const int size = std::sprintf(buffer, spec, value);
+
+    return write(buffer, util::fixDecimalPoint(buffer, size));
+  }
+
+  /*
+    The stream keeps the flags, width and precision set by the
+    manipulators.
+  */
+  std::ostream & stream()
+  {
+    if (! stream_)
+      {
+        stream_ = new std::ostringstream();
+        stream_->imbue(std::locale::classic());
+      }
+    return *stream_;
+  }
+
+  bool defaultFormat() const
+  {
+    return ! stream_
+      || (stream_->flags() == (std::ios_base::dec | std::ios_base::skipws)
+          && stream_->width() == 0 && stream_->precision() == 6);
+  }
+
+  /*
+    Write \p value through the stream, the characters are moved to the
+    message.
+  */
+  template <typename T>
+  LogStream & put(const T & value)
+  {
+    stream() << value;
+    return flushStream();
+  }
+
+  LogStream & flushStream()
+  {
+    const std::string & formatted = stream_->str();
+
+    if (! formatted.empty())
+      {
+        write(formatted.data(), formatted.size());
+        stream_->str(std::string());
+      }
+    return *this;
+  }
+
+  LogStream & writeSigned(long value)
+  {
+    char buffer[util::MaxDecimalSize];
+
+    return write(buffer, util::formatDecimal(value, buffer));
+  }
+
+  LogStream & writeUnsigned(unsigned long value)
+  {
+    char buffer[util::MaxDecimalSize];
+
+    return write(buffer, util::formatUnsigned(value, buffer));
+  }
+
+public:
+  LogStream()
+    : size_(0)
+    , overflow_()
+    , stream_(0)
+  { }
+
+  ~LogStream()
+  {
+    delete stream_;
+  }
+
+  /**
+   * \brief The formatted message, not null terminated.
+   */
+  const char *data() const
+  {
+    return overflow_.empty() ? buffer_ : overflow_.data();
+  }
+
+  /**
+   * \brief Size of the formatted message.
+   */
+  std::size_t size() const
+  {
+    return overflow_.empty() ? size_ : overflow_.size();
+  }
+
+  /**
+   * \brief Append \p size characters at the end of the message.
+   */
+  LogStream & write(const char *data, std::size_t size)
+  {
+    if (overflow_.empty() && size_ + size <= InlineSize)
+      {
+        std::memcpy(buffer_ + size_, data, size);
+        size_ += size;
+      }
+    else
+      spill(data, size);
+    return *this;
+  }
+
+  LogStream & operator<<(const char *str)
+  {
+    if (! str)
+      str = "(null)";
+    return defaultFormat() ? write(str, std::strlen(str)) : put(str);
+  }
+
+  LogStream & operator<<(char *str)
+  {
+    return *this << static_cast<const char *>(str);
+  }
+
+  LogStream & operator<<(const std::string & str)
+  {
+    return defaultFormat() ? write(str.data(), str.size()) : put(str);
+  }
+
+  LogStream & operator<<(char c)
+  {
+    return defaultFormat() ? write(&c, 1) : put(c);
+  }
+
+  /**
+   * \brief Written as \c 1 or \c 0, like \c std::ostream does.
+   */
+  LogStream & operator<<(bool value)
+  {
+    return defaultFormat() ? write(value ? "1" : "0", 1) : put(value);
+  }
+
+  LogStream & operator<<(short value)          { return defaultFormat() ? writeSigned(value) : put(value); }
+  LogStream & operator<<(unsigned short value) { return defaultFormat() ? writeUnsigned(value) : put(value); }
+  LogStream & operator<<(int value)            { return defaultFormat() ? writeSigned(value) : put(value); }
+  LogStream & operator<<(unsigned int value)   { return defaultFormat() ? writeUnsigned(value) : put(value); }
+  LogStream & operator<<(long value)           { return defaultFormat() ? writeSigned(value) : put(value); }
+  LogStream & operator<<(unsigned long value)  { return defaultFormat() ? writeUnsigned(value) : put(value); }
+
+#ifdef BREF_CXX11
+  LogStream & operator<<(long long value)
+  {
+    return defaultFormat() ? format("%lld", value) : put(value);
+  }
+
+  LogStream & operator<<(unsigned long long value)
+  {
+    return defaultFormat() ? format("%llu", value) : put(value);
+  }
+#endif  // BREF_CXX11
+
+  /**
+   * \brief Written with 6 significant digits, like \c std::ostream does.
+   */
+  LogStream & operator<<(double value)
+  {
+    return defaultFormat() ? formatFloat("%g", value) : put(value);
+  }
+
+  LogStream & operator<<(float value)
+  {
+    return *this << static_cast<double>(value);
+  }
+
+  LogStream & operator<<(long double value)
+  {
+    return defaultFormat() ? formatFloat("%Lg", value) : put(value);
+  }
+
+  LogStream & operator<<(const void *ptr)
+  {
+    return defaultFormat() ? format("%p", ptr) : put(ptr);
+  }
+
+  LogStream & operator<<(const IpAddress & address)
+  {
+    char buffer[IpAddress::MaxStringSize];
+
+    return write(buffer, address.toChars(buffer));
+  }
+
+  /**
+   * \brief Apply a \c std::ostream manipulator, e.g: \c std::endl.
+   */
+  LogStream & operator<<(std::ostream & (*manipulator)(std::ostream &))
+  {
+    manipulator(stream());
+    return flushStream();
+  }
+
+  /**
+   * \brief Apply a format manipulator, e.g: \c std::hex or
+   *        \c std::fixed. It applies to the values written after it.
+   */
+  LogStream & operator<<(std::ios_base & (*manipulator)(std::ios_base &))
+  {
+    manipulator(stream());
+    return *this;
+  }
+
+  /**
+   * \brief Format the other types with their \c std::ostream output
+   *        operator, manipulators with arguments (\c std::setw(),
+   *        \c std::setprecision(), ...) included.
+   */
+  template <typename T>
+  LogStream & operator<<(const T & value)
+  {
+    return put(value);
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_LOGSTREAM_H_ */
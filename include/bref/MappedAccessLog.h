@@ -0,0 +1,417 @@
+/**
+ * \file   MappedAccessLog.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 11 21:03:48 2012
+ *
+ * \brief  MappedAccessLog class definition.
+ *
+ * \note This logger requires C++11 (atomics) and a POSIX system
+ *       (mmap).
+ */
+
+#ifndef BREF_API_MAPPEDACCESSLOG_H_
+#define BREF_API_MAPPEDACCESSLOG_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/MappedAccessLog.h requires C++11"
+#endif
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+# error "bref/MappedAccessLog.h requires a POSIX system"
+#endif
+
+#include "AccessRecord.h"
+#include "ILogger.h"
+#include "ScopedLogger.h"
+#include "detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bref {
+
+/**
+ * \brief An ILogger writing the access records in a memory-mapped
+ *        file.
+ *
+ * logAccess() reserves the room of the record with an atomic
+ * increment and copies it in the mapping, there is no lock, no system
+ * call and no formatting on the worker threads. The kernel writes the
+ * pages to the file.
+ *
+ * When the file is full it's renamed \c path.1 (the previous ones are
+ * shifted, up to \c path.N with N the Options::maxFiles) and a new one
+ * is created. The file is truncated to its content when it's closed.
+ * The files are read with tools/AccessLogDecoder.
+ *
+ * The text messages are given to another logger.
+ *
+ * Example:
+\code
+bref::AsyncLogger     text(bref::AsyncLogger::FdWriter(STDERR_FILENO));
+bref::MappedAccessLog logger(&text, "/var/log/bref/access.bin");
+
+// in the Environment of the requests
+environment.logger->logAccess(record);
+\endcode
+ *
+ * \sa AccessRecord, ILogger::logAccess()
+ */
+class MappedAccessLog : public ILogger, util::NonCopyable
+{
+public:
+  /**
+   * \brief Tuning of the logger.
+   */
+  struct Options
+  {
+    Options()
+      : fileSize(64 * 1024 * 1024)
+      , maxFiles(8)
+      , retryDelay(1000)
+    { }
+
+    std::size_t fileSize;   /**< size of a file before the rotation */
+    unsigned    maxFiles;   /**< number of rotated files kept */
+    unsigned    retryDelay; /**< milliseconds between two attempts to
+                                 create a file after a failure */
+  };
+
+private:
+  /**
+   * \brief A mapped file.
+   *
+   * The writers counter tells the rotation when the last record of a
+   * full file is written. The segments are released by the destructor
+   * of the logger only, a thread may still read the counter of a
+   * retired segment, it's a few bytes for each rotated file.
+   */
+  struct Segment
+  {
+    int                    fd;
+    char                  *base;
+    uint64_t               capacity;
+    std::atomic<uint64_t>  offset;
+    std::atomic<unsigned>  writers;
+
+    Segment()
+      : fd(-1)
+      , base(0)
+      , capacity(0)
+      , offset(sizeof(AccessLogHeader))
+      , writers(0)
+    { }
+  };
+
+  ILogger                                *logger_;
+  const std::string                       path_;
+  const Options                           options_;
+  std::atomic<Segment *>                  current_;
+  std::atomic<uint64_t>                   dropped_;
+  std::atomic<uint64_t>                   retryAt_;     // steady clock, microseconds
+  std::mutex                              rotateMutex_;
+  std::vector<std::unique_ptr<Segment> >  segments_;
+
+  static uint64_t now()
+  {
+    using namespace std::chrono;
+
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+  }
+
+  static uint64_t steadyNow()
+  {
+    using namespace std::chrono;
+
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  void retryLater()
+  {
+    retryAt_.store(steadyNow() + static_cast<uint64_t>(options_.retryDelay) * 1000);
+  }
+
+  std::string rotatedPath(unsigned index) const
+  {
+    char suffix[16];
+
+    std::sprintf(suffix, ".%u", index);
+    return path_ + suffix;
+  }
+
+  /**
+   * \brief Shift the existing files: \c path.N-1 to \c path.N, ...,
+   *        \c path to \c path.1.
+   */
+  void shiftFiles()
+  {
+    if (options_.maxFiles == 0)
+      {
+        ::unlink(path_.c_str());
+        return;
+      }
+    ::unlink(rotatedPath(options_.maxFiles).c_str());
+    for (unsigned i = options_.maxFiles - 1; i > 0; --i)
+      ::rename(rotatedPath(i).c_str(), rotatedPath(i + 1).c_str());
+    ::rename(path_.c_str(), rotatedPath(1).c_str());
+  }
+
+  /**
+   * \brief Create and map a new file at \c path.
+   *
+   * \return The segment, null on error.
+   */
+  Segment *openSegment()
+  {
+    std::unique_ptr<Segment> segment(new Segment);
+    const uint64_t           records = (options_.fileSize - sizeof(AccessLogHeader)) / sizeof(AccessRecord);
+
+    segment->capacity = sizeof(AccessLogHeader) + records * sizeof(AccessRecord);
+    segment->fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment->fd < 0)
+      {
+        LOG_ERROR(logger_) << "access log: can't open " << path_ << ": " << std::strerror(errno);
+        return 0;
+      }
+    if (::ftruncate(segment->fd, segment->capacity) != 0)
+      {
+        LOG_ERROR(logger_) << "access log: can't resize " << path_ << ": " << std::strerror(errno);
+        ::close(segment->fd);
+        return 0;
+      }
+
+    void *base = ::mmap(0, segment->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+
+    if (base == MAP_FAILED)
+      {
+        LOG_ERROR(logger_) << "access log: can't map " << path_ << ": " << std::strerror(errno);
+        ::close(segment->fd);
+        return 0;
+      }
+    segment->base = static_cast<char *>(base);
+
+    const AccessLogHeader header(now());
+
+    std::memcpy(segment->base, &header, sizeof(header));
+    segments_.push_back(std::move(segment));
+    return segments_.back().get();
+  }
+
+  /**
+   * \brief Unmap a segment and truncate its file to the written
+   *        records, once the last writer is done.
+   */
+  static void closeSegment(Segment *segment)
+  {
+    while (segment->writers.load() != 0)
+      std::this_thread::yield();
+
+    const uint64_t size = std::min(segment->offset.load(), segment->capacity);
+
+    ::munmap(segment->base, segment->capacity);
+    segment->base = 0;
+    if (::ftruncate(segment->fd, size) != 0)
+      { }                       // the end of the file is only zeros
+    ::close(segment->fd);
+    segment->fd = -1;
+  }
+
+  /**
+   * \brief Replace the \p full segment by a new file.
+   *
+   * If the new file can't be created there is no current file
+   * anymore, the next records are dropped until retry() creates it.
+   *
+   * \return false if the new file can't be created.
+   */
+  bool rotate(Segment *full)
+  {
+    std::lock_guard<std::mutex> lock(rotateMutex_);
+
+    if (current_.load() != full)
+      return true;              // already done by another thread
+
+    shiftFiles();
+
+    Segment *segment = openSegment();
+
+    current_.store(segment);
+    closeSegment(full);
+    if (! segment)
+      retryLater();
+    return segment != 0;
+  }
+
+  /**
+   * \brief Create the file again after a failure, at most once per
+   *        Options::retryDelay (the disk may have been full).
+   *
+   * \return The current segment, null if the delay is not elapsed or
+   *         if the file still can't be created.
+   */
+  Segment *retry()
+  {
+    if (steadyNow() < retryAt_.load(std::memory_order_relaxed))
+      return 0;
+
+    std::lock_guard<std::mutex> lock(rotateMutex_);
+    Segment                    *segment = current_.load();
+
+    if (segment || steadyNow() < retryAt_.load())
+      return segment;           // created by another thread, or too early
+    segment = openSegment();
+    if (segment)
+      current_.store(segment);
+    else
+      retryLater();
+    return segment;
+  }
+
+public:
+  /**
+   * \brief Create the file, the existing one is rotated.
+   *
+   * If the file can't be created the error is logged on \p logger and
+   * the records are dropped (see dropped()) until a later attempt
+   * succeeds, see Options::retryDelay.
+   *
+   * \param logger
+   *            The logger of the text messages, not null.
+   * \param path
+   *            The path of the current file.
+   * \param options
+   *            The tuning of the logger.
+   */
+  MappedAccessLog(ILogger *logger, const std::string & path, const Options & options = Options())
+    : logger_(logger)
+    , path_(path)
+    , options_(options)
+    , current_(0)
+    , dropped_(0)
+    , retryAt_(0)
+  {
+    std::lock_guard<std::mutex> lock(rotateMutex_);
+
+    if (options_.fileSize >= sizeof(AccessLogHeader) + sizeof(AccessRecord))
+      {
+        shiftFiles();
+        current_.store(openSegment());
+        if (! current_.load())
+          retryLater();
+      }
+    else
+      {
+        LOG_ERROR(logger_) << "access log: file size too small: " << options_.fileSize;
+        retryAt_.store(std::numeric_limits<uint64_t>::max());   // never
+      }
+  }
+
+  /**
+   * \brief Close the current file.
+   *
+   * \note No thread should log a record during or after the
+   *       destruction.
+   */
+  virtual ~MappedAccessLog()
+  {
+    if (Segment *segment = current_.load())
+      closeSegment(segment);
+  }
+
+  virtual Severity severity() const
+  {
+    return logger_->severity();
+  }
+
+  virtual void setSeverity(Severity newSeverity)
+  {
+    logger_->setSeverity(newSeverity);
+  }
+
+  virtual void log(Severity messageSeverity, const std::string & message)
+  {
+    logger_->log(messageSeverity, message);
+  }
+
+  virtual void logBuffer(Severity messageSeverity, const char *message, std::size_t size)
+  {
+    logger_->logBuffer(messageSeverity, message, size);
+  }
+
+  /**
+   * \brief Copy the record at the end of the current file.
+   *
+   * The \c commit field of the record is set last, after the rest of
+   * the record is written.
+   */
+  virtual void logAccess(const AccessRecord & record)
+  {
+    for (;;)
+      {
+        Segment *segment = current_.load();
+
+        if (! segment && ! (segment = retry()))
+          break;
+
+        // a segment seen as current after the increment of its writers
+        // is not unmapped before the decrement (see closeSegment())
+        segment->writers.fetch_add(1);
+        if (current_.load() != segment)
+          {
+            segment->writers.fetch_sub(1, std::memory_order_release);
+            continue;
+          }
+
+        const uint64_t offset = segment->offset.fetch_add(sizeof(AccessRecord), std::memory_order_relaxed);
+
+        if (offset + sizeof(AccessRecord) <= segment->capacity)
+          {
+            AccessRecord *slot = reinterpret_cast<AccessRecord *>(segment->base + offset);
+
+            std::memcpy(static_cast<void *>(slot), &record, offsetof(AccessRecord, commit));
+            std::atomic_thread_fence(std::memory_order_release);
+            *reinterpret_cast<volatile uint8_t *>(&slot->commit) = AccessRecord::Committed;
+            segment->writers.fetch_sub(1, std::memory_order_release);
+            return;
+          }
+
+        segment->writers.fetch_sub(1, std::memory_order_release);
+        if (! rotate(segment))
+          break;
+      }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Number of records dropped because a file couldn't be
+   *        created.
+   */
+  uint64_t dropped() const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_MAPPEDACCESSLOG_H_ */
@@ -13,6 +13,7 @@
 #if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
 # include <windows.h>
 #endif
+#include "Arena.h"
 #include "Function.hpp"
 #include "IConfHelper.h"
 #include "BrefValue.h"
@@ -21,8 +22,11 @@
 #include "HttpResponse.h"
 #include "IpAddress.h"
 #include "Buffer.h"
+#include "BufferChain.h"
 #include "IDisposable.h"
 
+#include <stdint.h>
+
 #include <list>
 #include <vector>
 #include <utility>
@@ -84,6 +88,16 @@ namespace bref {
  *   - Normal Priority: 0.5
  *   - High Priority:   1.0
  *
+ * - \e Chain handlers
+ *
+ *   The hook points that transform the body (post-receive,
+ *   post-content, transform and pre-send) have two flavors of
+ *   handlers: the ones taking an input Buffer and filling an output
+ *   Buffer, and the \e chain handlers working in place on a
+ *   BufferChain. A chain handler can forward, prepend or trim data
+ *   without copying it. Both flavors are ordered together by priority
+ *   on a given hook point.
+ *
  * Example for a CGI module:
  *
  * 1. Register a Pipeline::ContentHook with a high priority (1.0)
@@ -119,15 +133,33 @@ typedef BrefValue ServerConfig;
   typedef int FdType;
 #endif
 
+/**
+ * \brief A range of a regular file, that the server can send without
+ *        copying it in user space (sendfile(), TransmitFile(), ...).
+ *
+ * \sa Pipeline::IContentRequestHandler::outFile()
+ */
+struct FileRange
+{
+  FdType   fd;                  /**< the file, owned by the content handler */
+  uint64_t offset;              /**< offset of the first byte to send */
+  uint64_t length;              /**< number of bytes to send */
+};
+
 /**
  * \brief This structure defines the environment of a request.
  *
- * The environment of a request contains a logger and the server
- * configuration.
+ * The environment of a request contains a logger, the server
+ * configuration and the memory arena of the request.
  *
  * We choose to do this because an implementation is free to handle
  * different ILogger (with different output file) for each virtual
  * host for example.
+ *
+ * The configuration and its helper are references, they should stay
+ * valid until the end of the request. A server reloading its
+ * configuration keeps the one of the request pinned, see
+ * ConfigSnapshot.
  */
 struct Environment
 {
@@ -145,14 +177,25 @@ struct Environment
     SocketType Socket;
   }                     client; /**< The client description */
 
+  /**
+   * \brief Memory for the data living as long as the request, may be
+   *        null.
+   *
+   * The server resets the arena once the response is sent, usually
+   * one arena is kept per connection.
+   */
+  Arena                *arena;
+
   Environment(const ServerConfig &  theServerConfig,
               const IConfHelper &   theServerConfigHelper,
               ILogger              *theLogger,
-              Client                theClient)
+              Client                theClient,
+              Arena                *theArena = 0)
     : serverConfig(theServerConfig)
     , serverConfigHelper(theServerConfigHelper)
     , logger(theLogger)
     , client(theClient)
+    , arena(theArena)
   { }
 };
 
@@ -291,6 +334,12 @@ struct Pipeline
    *    If everything went fine.
    * \retval false
    *    If an error occured. The server should close the socket.
+   *    Only if the server set Pipeline::deferredSend: with \c errno
+   *    set to \c EAGAIN (or \c EWOULDBLOCK) the handler took the whole
+   *    buffer but could not send all of it without waiting. The server
+   *    should wait until the socket is writable and call the handler
+   *    again with an empty buffer, until it returns true, before giving
+   *    it more data or closing the socket.
    *
    * \sa onSendHooks, OnSendHook
    */
@@ -380,6 +429,30 @@ struct Pipeline
    */
   std::list<std::pair<PostReceiveHook, float> > postReceiveHooks;
 
+  /**
+   * \brief Same as Pipeline::PostReceiveRequestHandler, working in
+   *        place on a BufferChain.
+   *
+   * \param[out] response
+   *            Can be filled with the header of the response and a
+   *            status code.
+   * \param[in,out] chunk
+   *            The data received on the socket, to transform for the
+   *            parser.
+   *
+   * \sa postReceiveChainHooks, PostReceiveChainHook
+   */
+  typedef Function<void (HttpResponse & response,
+                         BufferChain &  chunk)> PostReceiveChainRequestHandler;
+
+  /**
+   * \brief Generate a Pipeline::PostReceiveChainRequestHandler.
+   *
+   * \sa postReceiveChainHooks, PostReceiveChainRequestHandler
+   */
+  typedef Function<PostReceiveChainRequestHandler (const Environment & environment)> PostReceiveChainHook;
+
+
   /**
    * \brief The handler called to generate an HttpRequest.
    *
@@ -527,6 +600,39 @@ struct Pipeline
      */
     virtual bool outContent(HttpResponse & response, Buffer & outBuffer) = 0;
 
+    /**
+     * \brief Give the response body as a file range
+     *
+     * A server able to send a file by itself (sendfile(), ...) calls
+     * this method once the request body is received, before the first
+     * call to outContent(), when no hook needs the bytes of the
+     * response body (postContent, transform and preSend hooks, or an
+     * OnSendRequestHandler).
+     *
+     * When it returns true the server sends \p range as the whole
+     * body and does not call outContent(). The file stays open until
+     * dispose().
+     *
+     * Other servers only call outContent(): a handler that overrides
+     * this method still has to produce its content there.
+     *
+     * \param [out] response
+     *              Where the status code is filled.
+     * \param [out] range
+     *              The file range to send.
+     *
+     * \retval true
+     *    If \p range contains the response body.
+     * \retval false
+     *    If the body is produced by outContent() (the default).
+     *
+     * \sa outContent()
+     */
+    virtual bool outFile(HttpResponse & /* response */, FileRange & /* range */)
+    {
+      return false;
+    }
+
   protected:
     /**
      * \brief Virtual destructor
@@ -629,6 +735,29 @@ struct Pipeline
    */
   std::list<std::pair<PostContentHook, float> > postContentHooks;
 
+  /**
+   * \brief Same as Pipeline::PostContentRequestHandler, working in
+   *        place on a BufferChain.
+   *
+   * \param[out] response
+   *            Where the status code is filled.
+   * \param[in,out] chunk
+   *            A chunk of the response body.
+   *
+   * \sa postContentChainHooks, PostContentChainHook
+   */
+  typedef Function<void (HttpResponse & response,
+                         BufferChain &  chunk)> PostContentChainRequestHandler;
+
+  /**
+   * \brief Generate a Pipeline::PostContentChainRequestHandler.
+   *
+   * \sa postContentChainHooks, PostContentChainRequestHandler
+   */
+  typedef Function<PostContentChainRequestHandler (const Environment & environment,
+                                                   const HttpRequest & request,
+                                                   HttpResponse &      response)> PostContentChainHook;
+
 
   /**
    * \brief Handler to call after the postContentHooks are executed.
@@ -670,6 +799,30 @@ struct Pipeline
    */
   std::list<std::pair<TransformHook, float> > transformHooks;
 
+  /**
+   * \brief Same as Pipeline::TransformRequestHandler, working in place
+   *        on a BufferChain.
+   *
+   * \param[out] response
+   *            Where the status code is filled.
+   * \param[in,out] chunk
+   *            A chunk of the response body.
+   *
+   * \sa transformChainHooks, TransformChainHook
+   */
+  typedef Function<void (HttpResponse & response,
+                         BufferChain &  chunk)> TransformChainRequestHandler;
+
+  /**
+   * \brief Generate a Pipeline::TransformChainRequestHandler.
+   *
+   * \sa transformChainHooks, TransformChainRequestHandler
+   */
+  typedef Function<TransformChainRequestHandler (const Environment & environment,
+                                                 const HttpRequest & request,
+                                                 HttpResponse &      response)> TransformChainHook;
+
+
   /**
    * \brief Handler called before sending data back to the client.
    *
@@ -708,8 +861,102 @@ struct Pipeline
    */
   std::list<std::pair<PreSendHook, float> > preSendHooks;
 
+  /**
+   * \brief Same as Pipeline::PreSendRequestHandler, working in place on
+   *        a BufferChain.
+   *
+   * \param[out] response
+   *            Where the status code is filled.
+   * \param[in,out] chunk
+   *            A chunk of the response body.
+   *
+   * \sa preSendChainHooks, PreSendChainHook
+   */
+  typedef Function<void (HttpResponse & response,
+                         BufferChain &  chunk)> PreSendChainRequestHandler;
+
+  /**
+   * \brief Generate a Pipeline::PreSendChainRequestHandler.
+   *
+   * \sa preSendChainHooks, PreSendChainRequestHandler
+   */
+  typedef Function<PreSendChainRequestHandler (const Environment & environment,
+                                               const HttpRequest & request,
+                                               HttpResponse &      response)> PreSendChainHook;
+
+
   /** @} */
 
+  /*
+   * The chain lists, then deferredSend, come after the lists above, in
+   * the order they were added, so that the offsets of the members of a
+   * Pipeline are the ones of the previous versions.
+   */
+
+  /**
+   * \brief List of post-read chain hooks.
+   *
+   * Called with the Pipeline::postReceiveHooks, in order of priority.
+   *
+   * \sa PostReceiveChainHook, PostReceiveChainRequestHandler
+   *
+   * \ingroup Upstream
+   */
+  std::list<std::pair<PostReceiveChainHook, float> > postReceiveChainHooks;
+
+  /**
+   * \brief A list of post-content chain hooks.
+   *
+   * Called with the Pipeline::postContentHooks, in order of priority.
+   *
+   * \sa PostContentChainRequestHandler, PostContentChainHook
+   *
+   * \ingroup Downstream
+   */
+  std::list<std::pair<PostContentChainHook, float> > postContentChainHooks;
+
+  /**
+   * \brief List of transformation chain hooks.
+   *
+   * Called with the Pipeline::transformHooks, in order of priority.
+   *
+   * \sa TransformChainRequestHandler, TransformChainHook
+   *
+   * \ingroup Downstream
+   */
+  std::list<std::pair<TransformChainHook, float> > transformChainHooks;
+
+  /**
+   * \brief A list of pre-send chain hooks.
+   *
+   * Only one handler is called between the Pipeline::preSendHooks and
+   * the Pipeline::preSendChainHooks, the one with the highest
+   * priority.
+   *
+   * \sa PreSendChainRequestHandler, PreSendChainHook
+   *
+   * \ingroup Downstream
+   */
+  std::list<std::pair<PreSendChainHook, float> > preSendChainHooks;
+
+  /**
+   * \brief Set by the server before the hooks are registered when it
+   *        handles the deferred sends of an OnSendRequestHandler (false
+   *        with \c errno set to \c EAGAIN).
+   *
+   * A module whose send handler may defer a part of the data should
+   * not register it when this flag is false: for such a server a send
+   * handler returning false always closes the connection.
+   *
+   * \sa OnSendRequestHandler
+   *
+   * \ingroup Gate
+   */
+  bool deferredSend;
+
+  Pipeline()
+    : deferredSend(false)
+  { }
 };
 
 /** @} */
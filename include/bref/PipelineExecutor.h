@@ -0,0 +1,743 @@
+/**
+ * \file   PipelineExecutor.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon Apr 16 21:03:12 2012
+ *
+ * \brief  PipelineExecutor and HandlerChain definitions.
+ *
+ */
+
+#ifndef BREF_API_PIPELINEEXECUTOR_H_
+#define BREF_API_PIPELINEEXECUTOR_H_
+
+#include "Pipeline.h"
+#include "BufferChain.h"
+
+#include <algorithm>
+#include <list>
+#include <vector>
+#include <utility>
+
+namespace bref {
+
+/**
+ * \ingroup Pipeline
+ *
+ * \brief A sequence of buffer handlers applied one after the other on
+ *        the same chunk of data.
+ *
+ * Used for the hook points transforming the body (post-receive,
+ * post-content, transform and pre-send). The output of a handler is
+ * the input of the next one. The chain can contain both flavors of
+ * handlers, the ones working on a Buffer and the ones working on a
+ * BufferChain; the data is converted from one representation to the
+ * other only when needed.
+ *
+ * A server should keep one chain per connection (or per request) and
+ * reuse it, clear() keeps the memory already allocated.
+ *
+ * When the chain runs on a Buffer, a chain handler is given slices of
+ * that buffer: they are only valid during the call, a handler keeping
+ * data for a later chunk copies it (SharedBuffer::copy()).
+ *
+ * \tparam Handler
+ *      One of Pipeline::PostReceiveRequestHandler,
+ *      Pipeline::PostContentRequestHandler,
+ *      Pipeline::TransformRequestHandler or
+ *      Pipeline::PreSendRequestHandler.
+ * \tparam ChainHandler
+ *      The BufferChain version of \p Handler
+ *      (e.g: Pipeline::PostContentChainRequestHandler).
+ *
+ * \sa PipelineExecutor
+ */
+template <typename Handler, typename ChainHandler>
+class HandlerChain
+{
+private:
+  /**
+   * Only one of the two handlers is set.
+   */
+  struct Entry
+  {
+    Handler      handler;
+    ChainHandler chainHandler;
+  };
+
+  std::vector<Entry> entries_;
+  BufferChain        chain_;
+  Buffer             input_;
+  Buffer             output_;
+
+public:
+  HandlerChain()
+    : entries_(), chain_(), input_(), output_()
+  { }
+
+  /**
+   * \brief Remove all the handlers of the chain.
+   */
+  void clear()
+  {
+    entries_.clear();
+  }
+
+  /**
+   * \brief Reserve the storage for \p count handlers.
+   */
+  void reserve(std::size_t count)
+  {
+    entries_.reserve(count);
+  }
+
+  /**
+   * \brief Append a handler at the end of the chain.
+   */
+  void push(const Handler & handler)
+  {
+    entries_.push_back(Entry());
+    entries_.back().handler = handler;
+  }
+
+  /**
+   * \brief Append a chain handler at the end of the chain.
+   */
+  void push(const ChainHandler & handler)
+  {
+    entries_.push_back(Entry());
+    entries_.back().chainHandler = handler;
+  }
+
+#ifdef BREF_CXX11
+  /**
+   * \brief Move a handler at the end of the chain.
+   */
+  void push(Handler && handler)
+  {
+    entries_.push_back(Entry());
+    entries_.back().handler = std::move(handler);
+  }
+
+  /**
+   * \brief Move a chain handler at the end of the chain.
+   */
+  void push(ChainHandler && handler)
+  {
+    entries_.push_back(Entry());
+    entries_.back().chainHandler = std::move(handler);
+  }
+#endif  // BREF_CXX11
+
+  /**
+   * \brief Test if the chain contains no handlers.
+   */
+  bool empty() const
+  {
+    return entries_.empty();
+  }
+
+  /**
+   * \brief Number of handlers in the chain.
+   */
+  std::size_t size() const
+  {
+    return entries_.size();
+  }
+
+  /**
+   * \brief Run the chunk \p data through all the handlers.
+   *
+   * \param[out] response
+   *            Given to each handler.
+   * \param[in,out] data
+   *            The chunk to process, contains the output of the last
+   *            handler on return.
+   * \param scratch
+   *            A buffer used as output for the handlers, its content
+   *            is unspecified on return. Reusing the same scratch
+   *            buffer avoids memory allocations.
+   *
+   * A chain handler works on a slice of \p data, its output is copied
+   * back to a contiguous buffer.
+   */
+  void operator()(HttpResponse & response, Buffer & data, Buffer & scratch)
+  {
+    for (typename std::vector<Entry>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it)
+      {
+        if (it->handler)
+          {
+            scratch.clear();
+            it->handler(response, data, scratch);
+            data.swap(scratch);
+          }
+        else
+          {
+            if (! data.empty())
+              chain_.append(BufferSlice::fromStatic(&data[0], data.size()));
+            it->chainHandler(response, chain_);
+            scratch.clear();
+            chain_.copyTo(scratch);
+            chain_.clear();
+            data.swap(scratch);
+          }
+      }
+  }
+
+  /**
+   * \brief Run the chunk \p data through all the handlers.
+   *
+   * The chain handlers work directly on \p data, the content is
+   * copied to a contiguous buffer only for the other handlers, and
+   * their output copied back to a new SharedBuffer: the buffers of
+   * the chain keep their memory from one chunk to the next.
+   *
+   * \param[out] response
+   *            Given to each handler.
+   * \param[in,out] data
+   *            The chunk to process, contains the output of the last
+   *            handler on return.
+   */
+  void operator()(HttpResponse & response, BufferChain & data)
+  {
+    for (typename std::vector<Entry>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it)
+      {
+        if (it->chainHandler)
+          it->chainHandler(response, data);
+        else
+          {
+            input_.clear();
+            output_.clear();
+            data.copyTo(input_);
+            it->handler(response, input_, output_);
+            data.clear();
+            if (! output_.empty())
+              {
+                SharedBuffer *shared = SharedBuffer::copy(&output_[0], output_.size());
+
+                data.append(BufferSlice(shared));
+                shared->release();
+              }
+          }
+      }
+  }
+};
+
+/**
+ * \ingroup Pipeline
+ *
+ * \brief A frozen, priority-ordered version of a Pipeline.
+ *
+ * The hooks lists of the Pipeline are sorted by descending priority
+ * when the executor is compiled (once all the modules have called
+ * \c AModule::registerHooks()), and stored in contiguous arrays. The
+ * dispatch of a request is then a linear scan of the hooks, without
+ * sorting and without allocation from the executor.
+ *
+ * Hooks with the same priority keep their order of registration.
+ *
+ * The executor follows the semantic of each hook point:
+ * - all the handlers are called for the connection, post-receive,
+ *   post-parsing, post-content and transform hook points;
+ * - only the handler with the highest priority is used for the
+ *   parsing, content and pre-send hook points (for the pre-send hook
+ *   point, a HandlerChain containing this handler is filled). The
+ *   same rule is applied for the receive and send hook points since
+ *   only one handler can read or write a given socket.
+ *
+ * An empty handler returned by a hook is skipped, as if the hook was
+ * not registered.
+ *
+ * Example:
+\code
+bref::Pipeline         pipeline;
+
+module->registerHooks(pipeline);
+
+bref::PipelineExecutor executor(pipeline);
+
+// for each connection
+if (! executor.connection(response, environment))
+  closeSocket(environment.client.Socket);
+\endcode
+ *
+ * \note The executor does not keep any reference on the Pipeline, the
+ *       hooks are copied.
+ *
+ * \sa Pipeline, HandlerChain, HookProfiler
+ */
+class PipelineExecutor
+{
+public:
+  typedef HandlerChain<Pipeline::PostReceiveRequestHandler,
+                       Pipeline::PostReceiveChainRequestHandler> PostReceiveChain;
+  typedef HandlerChain<Pipeline::PostContentRequestHandler,
+                       Pipeline::PostContentChainRequestHandler> PostContentChain;
+  typedef HandlerChain<Pipeline::TransformRequestHandler,
+                       Pipeline::TransformChainRequestHandler>   TransformChain;
+  typedef HandlerChain<Pipeline::PreSendRequestHandler,
+                       Pipeline::PreSendChainRequestHandler>     PreSendChain;
+
+private:
+  /**
+   * Order the hooks by descending priority.
+   */
+  template <typename Hook>
+  struct PriorityGreater
+  {
+    bool operator()(const std::pair<Hook, float> & a,
+                    const std::pair<Hook, float> & b) const
+    {
+      return a.second > b.second;
+    }
+  };
+
+  template <typename Hook>
+  static void compileHooks(const std::list<std::pair<Hook, float> > & hooks,
+                           std::vector<Hook> &                         compiled)
+  {
+    std::vector<std::pair<Hook, float> > sorted(hooks.begin(), hooks.end());
+
+    std::stable_sort(sorted.begin(), sorted.end(), PriorityGreater<Hook>());
+    compiled.clear();
+    compiled.reserve(sorted.size());
+    for (typename std::vector<std::pair<Hook, float> >::const_iterator it = sorted.begin();
+         it != sorted.end(); ++it)
+      compiled.push_back(it->first);
+  }
+
+  /**
+   * A hook of a body hook point, only one of the two hooks is set.
+   */
+  template <typename Hook, typename ChainHook>
+  struct StageHook
+  {
+    Hook      hook;
+    ChainHook chainHook;
+  };
+
+  /**
+   * Merge the Buffer and BufferChain hooks of a hook point. At equal
+   * priority the Buffer hooks come first.
+   */
+  template <typename Hook, typename ChainHook>
+  static void compileStage(const std::list<std::pair<Hook, float> > &      hooks,
+                           const std::list<std::pair<ChainHook, float> > & chainHooks,
+                           std::vector<StageHook<Hook, ChainHook> > &      compiled)
+  {
+    typedef StageHook<Hook, ChainHook> Stage;
+
+    std::vector<std::pair<Stage, float> > sorted(hooks.size() + chainHooks.size());
+    std::size_t                           i = 0;
+
+    for (typename std::list<std::pair<Hook, float> >::const_iterator it = hooks.begin();
+         it != hooks.end(); ++it, ++i)
+      {
+        sorted[i].first.hook = it->first;
+        sorted[i].second     = it->second;
+      }
+    for (typename std::list<std::pair<ChainHook, float> >::const_iterator it = chainHooks.begin();
+         it != chainHooks.end(); ++it, ++i)
+      {
+        sorted[i].first.chainHook = it->first;
+        sorted[i].second          = it->second;
+      }
+    std::stable_sort(sorted.begin(), sorted.end(), PriorityGreater<Stage>());
+    compiled.clear();
+    compiled.reserve(sorted.size());
+    for (typename std::vector<std::pair<Stage, float> >::const_iterator it = sorted.begin();
+         it != sorted.end(); ++it)
+      compiled.push_back(it->first);
+  }
+
+  /**
+   * A pre-send chain handler called as a Buffer handler, returned by
+   * preSendHandler().
+   */
+  struct PreSendChainAdapter
+  {
+    Pipeline::PreSendChainRequestHandler handler;
+
+    void operator()(HttpResponse & response, const Buffer & inBuffer, Buffer & outBuffer) const
+    {
+      BufferChain chunk;
+
+      if (! inBuffer.empty())
+        chunk.append(BufferSlice::fromStatic(&inBuffer[0], inBuffer.size()));
+      handler(response, chunk);
+      chunk.copyTo(outBuffer);
+    }
+  };
+
+  typedef StageHook<Pipeline::PostReceiveHook,
+                    Pipeline::PostReceiveChainHook> PostReceiveStage;
+  typedef StageHook<Pipeline::PostContentHook,
+                    Pipeline::PostContentChainHook> PostContentStage;
+  typedef StageHook<Pipeline::TransformHook,
+                    Pipeline::TransformChainHook>   TransformStage;
+  typedef StageHook<Pipeline::PreSendHook,
+                    Pipeline::PreSendChainHook>     PreSendStage;
+
+  std::vector<Pipeline::ConnectionHook>  connectionHooks_;
+  std::vector<Pipeline::OnReceiveHook>   onReceiveHooks_;
+  std::vector<Pipeline::OnSendHook>      onSendHooks_;
+  std::vector<PostReceiveStage>          postReceiveHooks_;
+  std::vector<Pipeline::ParsingHook>     parsingHooks_;
+  std::vector<Pipeline::PostParsingHook> postParsingHooks_;
+  std::vector<Pipeline::ContentHook>     contentHooks_;
+  std::vector<PostContentStage>          postContentHooks_;
+  std::vector<TransformStage>            transformHooks_;
+  std::vector<PreSendStage>              preSendHooks_;
+
+public:
+  /**
+   * \brief Build an executor without hooks.
+   */
+  PipelineExecutor()
+  { }
+
+  /**
+   * \brief Build an executor from the hooks of \p pipeline.
+   *
+   * \sa compile()
+   */
+  explicit PipelineExecutor(const Pipeline & pipeline)
+  {
+    compile(pipeline);
+  }
+
+  /**
+   * \brief Replace the hooks of the executor by the ones of
+   *        \p pipeline.
+   */
+  void compile(const Pipeline & pipeline)
+  {
+    compileHooks(pipeline.connectionHooks,  connectionHooks_);
+    compileHooks(pipeline.onReceiveHooks,   onReceiveHooks_);
+    compileHooks(pipeline.onSendHooks,      onSendHooks_);
+    compileStage(pipeline.postReceiveHooks,
+                 pipeline.postReceiveChainHooks, postReceiveHooks_);
+    compileHooks(pipeline.parsingHooks,     parsingHooks_);
+    compileHooks(pipeline.postParsingHooks, postParsingHooks_);
+    compileHooks(pipeline.contentHooks,     contentHooks_);
+    compileStage(pipeline.postContentHooks,
+                 pipeline.postContentChainHooks, postContentHooks_);
+    compileStage(pipeline.transformHooks,
+                 pipeline.transformChainHooks, transformHooks_);
+    compileStage(pipeline.preSendHooks,
+                 pipeline.preSendChainHooks, preSendHooks_);
+  }
+
+  /**
+   * \name Gate
+   * @{
+   */
+
+  /**
+   * \brief Call the connection handlers.
+   *
+   * \retval true
+   *    If the connection is accepted by all the handlers.
+   * \retval false
+   *    As soon as a handler refuses the connection, the remaining
+   *    handlers are not called.
+   */
+  bool connection(HttpResponse & response, const Environment & environment) const
+  {
+    for (std::vector<Pipeline::ConnectionHook>::const_iterator it = connectionHooks_.begin();
+         it != connectionHooks_.end(); ++it)
+      {
+        Pipeline::ConnectionRequestHandler handler = (*it)(environment);
+
+        if (handler && ! handler(response, environment))
+          return false;
+      }
+    return true;
+  }
+
+  /**
+   * \brief Get the receive handler with the highest priority.
+   *
+   * \return An empty handler if no hook handles the connection, the
+   *         server should read the socket itself in this case.
+   */
+  Pipeline::OnReceiveRequestHandler receiveHandler(const Environment & environment) const
+  {
+    for (std::vector<Pipeline::OnReceiveHook>::const_iterator it = onReceiveHooks_.begin();
+         it != onReceiveHooks_.end(); ++it)
+      {
+        Pipeline::OnReceiveRequestHandler handler = (*it)(environment);
+
+        if (handler)
+          return handler;
+      }
+    return Pipeline::OnReceiveRequestHandler();
+  }
+
+  /**
+   * \brief Get the send handler with the highest priority.
+   *
+   * \return An empty handler if no hook handles the connection, the
+   *         server should write on the socket itself in this case.
+   */
+  Pipeline::OnSendRequestHandler sendHandler(const Environment & environment) const
+  {
+    for (std::vector<Pipeline::OnSendHook>::const_iterator it = onSendHooks_.begin();
+         it != onSendHooks_.end(); ++it)
+      {
+        Pipeline::OnSendRequestHandler handler = (*it)(environment);
+
+        if (handler)
+          return handler;
+      }
+    return Pipeline::OnSendRequestHandler();
+  }
+
+  /** @} */
+
+  /**
+   * \name Upstream
+   * @{
+   */
+
+  /**
+   * \brief Fill \p chain with the post-receive handlers, in
+   *        descending order of priority.
+   */
+  void postReceiveHandlers(const Environment & environment,
+                           PostReceiveChain &  chain) const
+  {
+    chain.clear();
+    for (std::vector<PostReceiveStage>::const_iterator it = postReceiveHooks_.begin();
+         it != postReceiveHooks_.end(); ++it)
+      {
+        if (it->hook)
+          {
+            Pipeline::PostReceiveRequestHandler handler = it->hook(environment);
+
+            if (handler)
+              chain.push(BREF_MOVE(handler));
+          }
+        else
+          {
+            Pipeline::PostReceiveChainRequestHandler handler = it->chainHook(environment);
+
+            if (handler)
+              chain.push(BREF_MOVE(handler));
+          }
+      }
+  }
+
+  /**
+   * \brief Get the parsing handler with the highest priority.
+   *
+   * \return An empty handler if no parser handles the request.
+   */
+  Pipeline::ParsingRequestHandler parsingHandler(const Environment & environment) const
+  {
+    for (std::vector<Pipeline::ParsingHook>::const_iterator it = parsingHooks_.begin();
+         it != parsingHooks_.end(); ++it)
+      {
+        Pipeline::ParsingRequestHandler handler = (*it)(environment);
+
+        if (handler)
+          return handler;
+      }
+    return Pipeline::ParsingRequestHandler();
+  }
+
+  /**
+   * \brief Call all the post-parsing handlers.
+   */
+  void postParsing(const Environment & environment,
+                   HttpRequest &       request,
+                   HttpResponse &      response) const
+  {
+    for (std::vector<Pipeline::PostParsingHook>::const_iterator it = postParsingHooks_.begin();
+         it != postParsingHooks_.end(); ++it)
+      {
+        Pipeline::PostParsingRequestHandler handler = (*it)(environment, request, response);
+
+        if (handler)
+          handler(response);
+      }
+  }
+
+  /** @} */
+
+  /**
+   * \name Bridge
+   * @{
+   */
+
+  /**
+   * \brief Get the content handler with the highest priority.
+   *
+   * \param[out] fd
+   *            Set by the hook that handles the request, if any. It
+   *            should be initialized by the server with the default
+   *            value (see Pipeline::ContentHook).
+   *
+   * \return 0 if no content hook handles the request.
+   */
+  Pipeline::IContentRequestHandler *contentHandler(const Environment & environment,
+                                                   const HttpRequest & request,
+                                                   HttpResponse &      response,
+                                                   FdType &            fd) const
+  {
+    for (std::vector<Pipeline::ContentHook>::const_iterator it = contentHooks_.begin();
+         it != contentHooks_.end(); ++it)
+      {
+        Pipeline::IContentRequestHandler *handler = (*it)(environment, request, response, fd);
+
+        if (handler)
+          return handler;
+      }
+    return 0;
+  }
+
+  /** @} */
+
+  /**
+   * \name Downstream
+   * @{
+   */
+
+  /**
+   * \brief Fill \p chain with the post-content handlers, in
+   *        descending order of priority.
+   */
+  void postContentHandlers(const Environment & environment,
+                           const HttpRequest & request,
+                           HttpResponse &      response,
+                           PostContentChain &  chain) const
+  {
+    chain.clear();
+    for (std::vector<PostContentStage>::const_iterator it = postContentHooks_.begin();
+         it != postContentHooks_.end(); ++it)
+      {
+        if (it->hook)
+          {
+            Pipeline::PostContentRequestHandler handler = it->hook(environment, request, response);
+
+            if (handler)
+              chain.push(BREF_MOVE(handler));
+          }
+        else
+          {
+            Pipeline::PostContentChainRequestHandler handler = it->chainHook(environment, request, response);
+
+            if (handler)
+              chain.push(BREF_MOVE(handler));
+          }
+      }
+  }
+
+  /**
+   * \brief Fill \p chain with the transform handlers, in descending
+   *        order of priority.
+   */
+  void transformHandlers(const Environment & environment,
+                         const HttpRequest & request,
+                         HttpResponse &      response,
+                         TransformChain &    chain) const
+  {
+    chain.clear();
+    for (std::vector<TransformStage>::const_iterator it = transformHooks_.begin();
+         it != transformHooks_.end(); ++it)
+      {
+        if (it->hook)
+          {
+            Pipeline::TransformRequestHandler handler = it->hook(environment, request, response);
+
+            if (handler)
+              chain.push(BREF_MOVE(handler));
+          }
+        else
+          {
+            Pipeline::TransformChainRequestHandler handler = it->chainHook(environment, request, response);
+
+            if (handler)
+              chain.push(BREF_MOVE(handler));
+          }
+      }
+  }
+
+  /**
+   * \brief Fill \p chain with the pre-send handler with the highest
+   *        priority, if any.
+   */
+  void preSendHandlers(const Environment & environment,
+                       const HttpRequest & request,
+                       HttpResponse &      response,
+                       PreSendChain &      chain) const
+  {
+    chain.clear();
+    for (std::vector<PreSendStage>::const_iterator it = preSendHooks_.begin();
+         it != preSendHooks_.end(); ++it)
+      {
+        if (it->hook)
+          {
+            Pipeline::PreSendRequestHandler handler = it->hook(environment, request, response);
+
+            if (handler)
+              {
+                chain.push(BREF_MOVE(handler));
+                return;
+              }
+          }
+        else
+          {
+            Pipeline::PreSendChainRequestHandler handler = it->chainHook(environment, request, response);
+
+            if (handler)
+              {
+                chain.push(BREF_MOVE(handler));
+                return;
+              }
+          }
+      }
+  }
+
+  /**
+   * \brief Get the pre-send handler with the highest priority.
+   *
+   * \deprecated Kept for the servers written before the chain hooks,
+   *             use preSendHandlers(). A chain handler is returned
+   *             wrapped in a Buffer handler, its output is copied.
+   *
+   * \return An empty handler if no hook handles the request.
+   */
+  Pipeline::PreSendRequestHandler preSendHandler(const Environment & environment,
+                                                 const HttpRequest & request,
+                                                 HttpResponse &      response) const
+  {
+    for (std::vector<PreSendStage>::const_iterator it = preSendHooks_.begin();
+         it != preSendHooks_.end(); ++it)
+      {
+        if (it->hook)
+          {
+            Pipeline::PreSendRequestHandler handler = it->hook(environment, request, response);
+
+            if (handler)
+              return handler;
+          }
+        else
+          {
+            PreSendChainAdapter adapter;
+
+            adapter.handler = it->chainHook(environment, request, response);
+            if (adapter.handler)
+              return Pipeline::PreSendRequestHandler(adapter);
+          }
+      }
+    return Pipeline::PreSendRequestHandler();
+  }
+
+  /** @} */
+};
+
+} // ! bref
+
+#endif /* !BREF_API_PIPELINEEXECUTOR_H_ */
@@ -0,0 +1,211 @@
+/**
+ * \file   Resolver.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 17 10:12:36 2012
+ *
+ * \brief  Resolver class definition.
+ *
+ * \note This resolver requires C++11 (threads) and a POSIX system.
+ */
+
+#ifndef BREF_API_RESOLVER_H_
+#define BREF_API_RESOLVER_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/Resolver.h requires C++11"
+#endif
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+# error "bref/Resolver.h is not available on Windows"
+#endif
+
+#include "Function.hpp"
+#include "IpAddress.h"
+#include "detail/util/NonCopyable.hpp"
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bref {
+
+/**
+ * \brief Resolve host names without blocking the caller.
+ *
+ * The host names are resolved by \c getaddrinfo() in a few background
+ * threads, the result is given to a callback. A numeric address is
+ * parsed by IpAddress::parse() and given to the callback at once,
+ * before resolve() returns.
+ *
+ * Example:
+\code
+bref::Resolver resolver;
+
+resolver.resolve("example.com", callback);
+
+void callback(int error, const std::vector<bref::IpAddress> & addresses)
+{
+  if (error)
+    std::cerr << bref::Resolver::errorString(error) << std::endl;
+  // called from a resolver thread, the event loop of the server
+  // should be notified from here
+}
+\endcode
+ *
+ * \sa IpAddress::parse()
+ */
+class Resolver : util::NonCopyable
+{
+public:
+  /**
+   * \brief Called with 0 and the addresses of the host, or an error
+   *        code of \c getaddrinfo() (see errorString()) and no
+   *        address.
+   */
+  typedef Function<void (int error, const std::vector<IpAddress> & addresses)> Callback;
+
+  /**
+   * \brief The error given to the callbacks of the requests still
+   *        pending when the resolver is destroyed.
+   */
+  static const int Cancelled = -100000;
+
+private:
+  typedef std::pair<std::string, Callback> Request;
+
+  std::mutex                mutex_;
+  std::condition_variable   wakeUp_;
+  std::deque<Request>       requests_;
+  bool                      stopping_;
+  std::vector<std::thread>  threads_;
+
+  static int lookup(const std::string & host, std::vector<IpAddress> & addresses)
+  {
+    struct addrinfo  hints;
+    struct addrinfo *result = 0;
+
+    std::memset(&hints, 0, sizeof hints);
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    const int error = ::getaddrinfo(host.c_str(), 0, &hints, &result);
+
+    if (error)
+      return error;
+    for (struct addrinfo *it = result; it; it = it->ai_next)
+      {
+        if (it->ai_family == AF_INET)
+          addresses.push_back(IpAddress(*reinterpret_cast<const sockaddr_in *>(it->ai_addr)));
+        else if (it->ai_family == AF_INET6)
+          addresses.push_back(IpAddress(*reinterpret_cast<const sockaddr_in6 *>(it->ai_addr)));
+      }
+    ::freeaddrinfo(result);
+    return 0;
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;)
+      {
+        wakeUp_.wait(lock, [this] { return stopping_ || ! requests_.empty(); });
+        if (stopping_)
+          return;
+
+        Request request(BREF_MOVE(requests_.front()));
+
+        requests_.pop_front();
+        lock.unlock();
+
+        std::vector<IpAddress> addresses;
+        const int              error = lookup(request.first, addresses);
+
+        request.second(error, addresses);
+        lock.lock();
+      }
+  }
+
+public:
+  /**
+   * \brief Start the resolver threads.
+   *
+   * \param threads
+   *            Number of host names resolved at the same time.
+   */
+  explicit Resolver(std::size_t threads = 2)
+    : stopping_(false)
+  {
+    for (std::size_t i = 0; i < threads || i == 0; ++i)
+      threads_.push_back(std::thread(&Resolver::run, this));
+  }
+
+  /**
+   * \brief Wait for the resolutions in progress, the callbacks of the
+   *        pending requests are called with Cancelled.
+   */
+  ~Resolver()
+  {
+    std::deque<Request> pending;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      stopping_ = true;
+      pending.swap(requests_);
+    }
+    wakeUp_.notify_all();
+    for (std::size_t i = 0; i < threads_.size(); ++i)
+      threads_[i].join();
+
+    const std::vector<IpAddress> none;
+
+    for (std::deque<Request>::iterator it = pending.begin(); it != pending.end(); ++it)
+      it->second(Cancelled, none);
+  }
+
+  /**
+   * \brief Resolve \p host, \p callback is called from a resolver
+   *        thread, or before the call returns if \p host is a numeric
+   *        address.
+   */
+  void resolve(const std::string & host, const Callback & callback)
+  {
+    IpAddress address;
+
+    if (IpAddress::parse(host, address))
+      {
+        callback(0, std::vector<IpAddress>(1, address));
+        return;
+      }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      requests_.push_back(Request(host, callback));
+    }
+    wakeUp_.notify_one();
+  }
+
+  /**
+   * \brief Description of an error given to a callback.
+   */
+  static const char *errorString(int error)
+  {
+    return error == Cancelled ? "resolution cancelled" : ::gai_strerror(error);
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_RESOLVER_H_ */
@@ -11,9 +11,8 @@
 #ifndef BREF_API_SCOPEDLOGGER_H
 #define BREF_API_SCOPEDLOGGER_H
 
-#include <sstream>
-
 #include "ILogger.h"
+#include "LogStream.h"
 #include "detail/util/NonCopyable.hpp"
 
 /**
@@ -23,6 +22,9 @@
  * used only in this case. This is useful to limit the cost of the
  * stream operations, by creating the stream only when needed.
  *
+ * The stream is a LogStream, the message is formatted in a buffer on
+ * the stack and given to ILogger::logBuffer().
+ *
  * Example:
 \code
 LOG(logger, bref::ILogger::Debug) << "new connection from " << host;
@@ -32,10 +34,10 @@ LOG(logger, bref::ILogger::Debug) << "new connection from " << host;
  *
  */
 #define LOG(logger, sev)                                                \
-  if (sev < logger->severity())                                         \
+  if ((sev) < (logger)->severity())                                     \
     { }                                                                 \
   else                                                                  \
-    bref::ScopedLogger(logger, sev).log()
+    bref::ScopedLogger((logger), (sev)).log()
 
 /**
  * \brief Get the debug stream.
@@ -82,7 +84,7 @@ namespace bref {
 class ScopedLogger : util::NonCopyable
 {
 private:
-  std::stringstream  ss_;
+  LogStream          stream_;
   ILogger           *logger_;
   ILogger::Severity  severity_;
 
@@ -112,17 +114,20 @@ public:
    */
   inline ~ScopedLogger()
   {
-    logger_->log(severity_, ss_.str());
+    logger_->logBuffer(severity_, stream_.data(), stream_.size());
   }
 
   /**
    * \brief Retrieve the output stream of the scoped logger.
    *
    * \return A reference to the internal stream of the scoped logger.
+   *
+   * \note The stream is a LogStream, not a \c std::ostream: it can't
+   *       be given to a function taking a \c std::ostream &.
    */
-  inline std::ostream & log()
+  inline LogStream & log()
   {
-    return ss_;
+    return stream_;
   }
 };
 
@@ -0,0 +1,195 @@
+/**
+ * \file   SnapshotHolder.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun May 13 17:12:40 2012
+ *
+ * \brief  SnapshotHolder class definition.
+ *
+ * \note This class requires C++11 (atomics, shared_ptr and
+ *       thread_local).
+ */
+
+#ifndef BREF_API_SNAPSHOTHOLDER_H_
+#define BREF_API_SNAPSHOTHOLDER_H_
+
+#include "detail/Config.h"
+
+#if !defined(BREF_CXX11)
+# error "bref/SnapshotHolder.h requires C++11"
+#endif
+
+#include "detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bref {
+
+/**
+ * \brief Publish immutable snapshots of a value to many reader
+ *        threads, in the spirit of RCU.
+ *
+ * A reader pins the current snapshot with load(), the snapshot stays
+ * valid as long as the Pin exists, even if a new one is published in
+ * the meantime. A writer builds the new value aside and publishes it
+ * with publish(), the previous snapshot is destroyed when its last pin
+ * is released.
+ *
+ * The readers don't take a lock: each thread keeps a weak reference
+ * on the last snapshot it loaded, load() checks the version of the
+ * holder and promotes the weak reference. The lock protecting the
+ * current snapshot is only taken by a thread on its first load() after
+ * a publish(), it's held by the writer for the time of a pointer swap.
+ *
+ * load() is lock-free, not wait-free: promoting the weak reference is
+ * a compare-and-swap loop on the use count of the snapshot, and
+ * releasing a Pin decrements it. The use count lives in the control
+ * block shared by all the threads, each load() / release pair is two
+ * atomic read-modify-writes on a shared cache line. Keep a Pin for a
+ * whole request rather than calling load() for each access.
+ *
+ * Example:
+\code
+bref::SnapshotHolder<Table> tables(std::make_shared<Table>(initial));
+
+// worker thread, for each request
+bref::SnapshotHolder<Table>::Pin table = tables.load();
+table->lookup(key);
+
+// reload thread
+tables.publish(std::make_shared<Table>(parse(file)));
+\endcode
+ *
+ * \tparam T
+ *      The type of the snapshots, a snapshot is never modified once
+ *      published.
+ *
+ * \sa ConfigSnapshot
+ */
+template <typename T>
+class SnapshotHolder : util::NonCopyable
+{
+public:
+  /**
+   * \brief A pinned snapshot.
+   */
+  typedef std::shared_ptr<const T> Pin;
+
+private:
+  /**
+   * The snapshot last loaded by a thread from a holder.
+   */
+  struct CacheEntry
+  {
+    unsigned long          holder;
+    uint64_t               version;
+    std::weak_ptr<const T> snapshot;
+  };
+
+  const unsigned long    id_;
+  mutable std::mutex     mutex_;
+  Pin                    current_;
+  std::atomic<uint64_t>  version_;
+
+  static unsigned long nextId()
+  {
+    static std::atomic<unsigned long> id(0);
+
+    return ++id;
+  }
+
+  CacheEntry & cacheEntry() const
+  {
+    static thread_local std::vector<CacheEntry> cache;
+
+    for (typename std::vector<CacheEntry>::iterator it = cache.begin(); it != cache.end(); ++it)
+      if (it->holder == id_)
+        return *it;
+
+    // forget the holders destroyed since the last time
+    for (std::size_t i = 0; i < cache.size(); )
+      if (cache[i].snapshot.expired())
+        {
+          cache[i] = cache.back();
+          cache.pop_back();
+        }
+      else
+        ++i;
+
+    CacheEntry entry = { id_, 0, std::weak_ptr<const T>() };
+
+    cache.push_back(entry);
+    return cache.back();
+  }
+
+public:
+  /**
+   * \brief Build a holder with an initial snapshot.
+   */
+  explicit SnapshotHolder(const Pin & initial)
+    : id_(nextId()), current_(initial), version_(1)
+  { }
+
+  /**
+   * \brief Pin the current snapshot.
+   *
+   * Lock-free, unless a snapshot was published since the last call of
+   * the thread: the mutex is then taken to read the new snapshot.
+   */
+  Pin load() const
+  {
+    CacheEntry &   entry   = cacheEntry();
+    const uint64_t version = version_.load(std::memory_order_acquire);
+
+    if (entry.version == version)
+      {
+        Pin pin = entry.snapshot.lock();
+
+        if (pin)
+          return pin;
+      }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    entry.version  = version_.load(std::memory_order_relaxed);
+    entry.snapshot = current_;
+    return current_;
+  }
+
+  /**
+   * \brief Replace the current snapshot.
+   *
+   * The readers loading after the call get \p snapshot, the previous
+   * snapshot is destroyed when the last reader releases it, possibly
+   * by this call.
+   */
+  void publish(const Pin & snapshot)
+  {
+    Pin previous;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      previous.swap(current_);
+      current_ = snapshot;
+      version_.fetch_add(1, std::memory_order_release);
+    }
+    // the previous snapshot may be destroyed here, out of the lock
+  }
+
+  /**
+   * \brief Number of snapshots published, the initial one included.
+   */
+  uint64_t version() const
+  {
+    return version_.load(std::memory_order_relaxed);
+  }
+};
+
+} // ! bref
+
+#endif /* !BREF_API_SNAPSHOTHOLDER_H_ */
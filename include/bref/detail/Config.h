@@ -0,0 +1,30 @@
+/**
+ * \file   Config.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat Apr 21 16:12:45 2012
+ *
+ * \brief  Compiler features detection.
+ *
+ * The API is written in C++03, some additions (move constructors,
+ * noexcept, ...) are enabled when the compiler supports C++11. Define
+ * \c BREF_NO_CXX11 to disable them.
+ */
+
+#ifndef BREF_API_DETAIL_CONFIG_H_
+#define BREF_API_DETAIL_CONFIG_H_
+
+#if !defined(BREF_NO_CXX11) &&                                          \
+  (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+# define BREF_CXX11 1
+#endif
+
+#ifdef BREF_CXX11
+# include <utility>
+# define BREF_NOEXCEPT noexcept
+# define BREF_MOVE(x)  std::move(x)
+#else
+# define BREF_NOEXCEPT
+# define BREF_MOVE(x)  (x)
+#endif
+
+#endif /* !BREF_API_DETAIL_CONFIG_H_ */
@@ -16,12 +16,19 @@
 #ifndef BREF_API_DETAIL_FUNCTION_HPP_
 #define BREF_API_DETAIL_FUNCTION_HPP_
 
+#include "Config.h"
 #include "FunctionFwd.hpp"
+#include "mp/AlignmentOf.hpp"
 #include "mp/IsClassPtr.hpp"
 #include "mp/RemovePointer.hpp"
 
+#include <new>
 #include <stdexcept>
 
+#ifdef BREF_CXX11
+# include <type_traits>
+#endif
+
 namespace bref {
 
 /**
@@ -120,8 +127,11 @@ public:
 #include "Function.def"
 
 // 20.3.10.5 specialized algorithms
-// template<typename Function1, typename Function2>
-// void swap(function<Function1>&, function<Function2>&);
+template<typename F>
+void swap(Function<F> & f1, Function<F> & f2) BREF_NOEXCEPT
+{
+  f1.swap(f2);
+}
 
 // // 20.3.10.6 undefined operators
 // template<typename Function1, typename Function2>
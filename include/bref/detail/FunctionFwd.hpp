@@ -11,6 +11,8 @@
 #ifndef BREF_API_FUNCTIONFWD_HPP_
 #define BREF_API_FUNCTIONFWD_HPP_
 
+#include "Config.h"
+
 namespace bref {
 
 template<typename T> class ReferenceWrapper;
@@ -24,7 +26,7 @@ template<typename T, typename SfinaeHelper = void>
 class Function;
 
 template<typename F>
-void swap(Function<F> &, Function<F> &);
+void swap(Function<F> &, Function<F> &) BREF_NOEXCEPT;
 
 // template<typename F1, typename F2>
 // void operator==(const Function<F1> &, const Function<F2> &);
@@ -0,0 +1,37 @@
+/**
+ * \file   AlignmentOf.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed Apr 18 22:41:07 2012
+ *
+ * \brief  AlignmentOf definition.
+ *
+ */
+
+#ifndef BREF_API_DETAIL_MP_ALIGNMENTOF_HPP
+#define BREF_API_DETAIL_MP_ALIGNMENTOF_HPP
+
+namespace bref {
+namespace mp {
+
+/**
+ * \brief Type trait that gives the alignment requirement of a type.
+ *
+ * The padding inserted between a \c char and a \c T is the alignment
+ * of \c T.
+ */
+template <typename T>
+struct AlignmentOf
+{
+  struct Helper
+  {
+    char c;
+    T    t;
+  };
+
+  enum { value = sizeof(Helper) - sizeof(T) };
+};
+
+} // ! mp
+} // ! bref
+
+#endif /* !BREF_API_DETAIL_MP_ALIGNMENTOF_HPP */
@@ -0,0 +1,95 @@
+/**
+ * \file   AtomicCounter.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sun Apr 22 18:20:31 2012
+ *
+ * \brief  AtomicCounter class definition.
+ *
+ */
+
+#ifndef BREF_DETAIL_UTIL_ATOMICCOUNTER_HPP_
+#define BREF_DETAIL_UTIL_ATOMICCOUNTER_HPP_
+
+#pragma once
+
+#include "../Config.h"
+#include "NonCopyable.hpp"
+
+#if defined(BREF_CXX11)
+# include <atomic>
+#elif defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+# include <windows.h>
+#endif
+
+namespace bref {
+namespace util {
+
+/**
+ * \brief Thread-safe counter, used for reference counting.
+ *
+ * Relies on std::atomic in C++11, on the compiler intrinsics
+ * otherwise.
+ */
+class AtomicCounter : NonCopyable
+{
+private:
+#if defined(BREF_CXX11)
+  std::atomic<long> value_;
+#else
+  volatile long     value_;
+#endif
+
+public:
+  explicit AtomicCounter(long value = 0)
+    : value_(value)
+  { }
+
+  /**
+   * \brief Increment the counter.
+   *
+   * \return The new value.
+   */
+  long increment()
+  {
+#if defined(BREF_CXX11)
+    return value_.fetch_add(1, std::memory_order_relaxed) + 1;
+#elif defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    return InterlockedIncrement(&value_);
+#else
+    return __sync_add_and_fetch(&value_, 1);
+#endif
+  }
+
+  /**
+   * \brief Decrement the counter.
+   *
+   * \return The new value.
+   */
+  long decrement()
+  {
+#if defined(BREF_CXX11)
+    return value_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+#elif defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+    return InterlockedDecrement(&value_);
+#else
+    return __sync_sub_and_fetch(&value_, 1);
+#endif
+  }
+
+  /**
+   * \brief Current value of the counter.
+   */
+  long value() const
+  {
+#if defined(BREF_CXX11)
+    return value_.load(std::memory_order_acquire);
+#else
+    return value_;
+#endif
+  }
+};
+
+} // ! util
+} // ! bref
+
+#endif /* !BREF_DETAIL_UTIL_ATOMICCOUNTER_HPP_ */
@@ -0,0 +1,48 @@
+/**
+ * \file   ContentLength.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 24 10:41:05 2012
+ *
+ * \brief  Content-Length field value.
+ *
+ * A BrefValue integer is an \c int, a length beyond INT_MAX is given
+ * as a decimal string.
+ */
+
+#ifndef BREF_DETAIL_UTIL_CONTENTLENGTH_HPP_
+#define BREF_DETAIL_UTIL_CONTENTLENGTH_HPP_
+
+#pragma once
+
+#include "../../BrefValue.h"
+
+#include <climits>
+#include <stdint.h>
+
+#include <string>
+
+namespace bref {
+namespace util {
+
+/**
+ * \brief The value of a Content-Length field of \p length bytes.
+ */
+inline BrefValue lengthValue(uint64_t length)
+{
+  if (length <= INT_MAX)
+    return BrefValue(static_cast<int>(length));
+
+  // unsigned long may be 32 bits, formatUnsigned() is not used
+  char  buffer[20];
+  char *digits = buffer + sizeof buffer;
+
+  do
+    *--digits = static_cast<char>('0' + length % 10);
+  while (length /= 10);
+  return BrefValue(std::string(digits, buffer + sizeof buffer));
+}
+
+} // ! util
+} // ! bref
+
+#endif /* !BREF_DETAIL_UTIL_CONTENTLENGTH_HPP_ */
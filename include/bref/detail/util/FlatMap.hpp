@@ -0,0 +1,432 @@
+/**
+ * \file   FlatMap.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 15 10:27:41 2012
+ *
+ * \brief  FlatMap, an associative container in a sorted array.
+ *
+ */
+
+#ifndef BREF_DETAIL_UTIL_FLATMAP_HPP_
+#define BREF_DETAIL_UTIL_FLATMAP_HPP_
+
+#pragma once
+
+#include "../Config.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace bref {
+namespace util {
+
+/**
+ * \brief An associative container with the interface of \c std::map,
+ *        its elements are stored sorted by key in a contiguous array.
+ *
+ * A lookup is a binary search in an array instead of a walk through
+ * tree nodes allocated separately, the elements are next to each
+ * other in memory. An insertion moves the elements after it, inserting
+ * the keys in ascending order (a configuration written sorted, a copy
+ * of another container) only appends.
+ *
+ * Differences with \c std::map:
+ * - the insertions and the erasures invalidate the iterators and the
+ *   references to the elements;
+ * - \c value_type is \c std::pair<Key, T>, the key can be modified
+ *   through an iterator but it must not be.
+ *
+ * Inserting many keys one by one in random order costs a move of half
+ * the elements for each one, the build is quadratic: a large container
+ * should be built with the range constructor or insert(first, last)
+ * which sort once (given \c std::move_iterator, the elements are
+ * moved). BrefValueView::toBrefValue() builds the configuration arrays
+ * this way.
+ *
+ * \tparam T
+ *      The mapped type, default constructible.
+ */
+template <typename Key, typename T, typename Compare = std::less<Key> >
+class FlatMap
+{
+public:
+  typedef Key                                               key_type;
+  typedef T                                                 mapped_type;
+  typedef std::pair<Key, T>                                 value_type;
+  typedef Compare                                           key_compare;
+  typedef typename std::vector<value_type>::iterator        iterator;
+  typedef typename std::vector<value_type>::const_iterator  const_iterator;
+  typedef typename std::vector<value_type>::size_type       size_type;
+
+private:
+  std::vector<value_type> values_;
+  Compare                 compare_;
+
+  size_type lowerIndex(const Key & key) const
+  {
+    // appending in order is the common case
+    if (values_.empty() || compare_(values_.back().first, key))
+      return values_.size();
+
+    size_type low  = 0;
+    size_type high = values_.size();
+
+    while (low < high)
+      {
+        const size_type middle = low + (high - low) / 2;
+
+        if (compare_(values_[middle].first, key))
+          low = middle + 1;
+        else
+          high = middle;
+      }
+    return low;
+  }
+
+  size_type indexOf(const Key & key) const
+  {
+    const size_type i = lowerIndex(key);
+
+    if (i != values_.size() && ! compare_(key, values_[i].first))
+      return i;
+    return values_.size();
+  }
+
+  /**
+   * Without move semantic, the elements are exchanged instead of
+   * copied, a copy of a value can be a copy of a whole tree.
+   */
+  static void swapValues(value_type & a, value_type & b)
+  {
+    using std::swap;
+
+    swap(a.first, b.first);
+    swap(a.second, b.second);
+  }
+
+  /**
+   * Compare the elements of values_ by index, for insert(first, last).
+   */
+  struct IndexLess
+  {
+    const std::vector<value_type> & values;
+    const Compare &                 compare;
+
+    IndexLess(const std::vector<value_type> & theValues, const Compare & theCompare)
+      : values(theValues), compare(theCompare)
+    { }
+
+    bool operator()(size_type a, size_type b) const
+    {
+      return compare(values[a].first, values[b].first);
+    }
+  };
+
+#ifndef BREF_CXX11
+  void grow()
+  {
+    std::vector<value_type> bigger;
+
+    bigger.reserve(values_.empty() ? 8 : 2 * values_.capacity());
+    bigger.resize(values_.size());
+    for (size_type i = 0; i < values_.size(); ++i)
+      swapValues(bigger[i], values_[i]);
+    values_.swap(bigger);
+  }
+#endif  // ! BREF_CXX11
+
+#ifdef BREF_CXX11
+  /**
+   * An element given as an rvalue (through a \c std::move_iterator)
+   * is moved.
+   */
+  template <typename V>
+  void append(V && value)
+  {
+    values_.push_back(std::forward<V>(value));
+  }
+#else
+  void append(const value_type & value)
+  {
+    if (values_.size() == values_.capacity())
+      grow();
+    values_.push_back(value);
+  }
+#endif  // BREF_CXX11
+
+  iterator insertAt(size_type index, const value_type & value)
+  {
+#ifdef BREF_CXX11
+    return values_.insert(values_.begin() + index, value);
+#else
+    append(value_type());
+    for (size_type i = values_.size() - 1; i > index; --i)
+      swapValues(values_[i], values_[i - 1]);
+    values_[index] = value;
+    return values_.begin() + index;
+#endif
+  }
+
+public:
+  FlatMap()
+    : values_(), compare_()
+  { }
+
+  /**
+   * \brief Build the container with the elements of [first, last), the
+   *        first element of each key is kept.
+   */
+  template <typename InputIterator>
+  FlatMap(InputIterator first, InputIterator last)
+    : values_(), compare_()
+  {
+    insert(first, last);
+  }
+
+  iterator begin()
+  {
+    return values_.begin();
+  }
+
+  const_iterator begin() const
+  {
+    return values_.begin();
+  }
+
+  iterator end()
+  {
+    return values_.end();
+  }
+
+  const_iterator end() const
+  {
+    return values_.end();
+  }
+
+  size_type size() const
+  {
+    return values_.size();
+  }
+
+  bool empty() const
+  {
+    return values_.empty();
+  }
+
+  void clear()
+  {
+    values_.clear();
+  }
+
+  /**
+   * \brief Reserve the storage for \p count elements.
+   */
+  void reserve(size_type count)
+  {
+    values_.reserve(count);
+  }
+
+  void swap(FlatMap & other) BREF_NOEXCEPT
+  {
+    values_.swap(other.values_);
+    std::swap(compare_, other.compare_);
+  }
+
+  key_compare key_comp() const
+  {
+    return compare_;
+  }
+
+  /**
+   * \brief Find an element by key, in logarithmic time.
+   *
+   * \return end() if there is no such element.
+   */
+  iterator find(const Key & key)
+  {
+    return values_.begin() + indexOf(key);
+  }
+
+  const_iterator find(const Key & key) const
+  {
+    return values_.begin() + indexOf(key);
+  }
+
+  /**
+   * \return 1 if the key exists, 0 otherwise.
+   */
+  size_type count(const Key & key) const
+  {
+    return indexOf(key) != values_.size();
+  }
+
+  /**
+   * \brief The first element whose key is not less than \p key.
+   */
+  iterator lower_bound(const Key & key)
+  {
+    return values_.begin() + lowerIndex(key);
+  }
+
+  const_iterator lower_bound(const Key & key) const
+  {
+    return values_.begin() + lowerIndex(key);
+  }
+
+  /**
+   * \brief The first element whose key is greater than \p key.
+   */
+  iterator upper_bound(const Key & key)
+  {
+    iterator it = lower_bound(key);
+
+    return it != end() && ! compare_(key, it->first) ? it + 1 : it;
+  }
+
+  const_iterator upper_bound(const Key & key) const
+  {
+    const_iterator it = lower_bound(key);
+
+    return it != end() && ! compare_(key, it->first) ? it + 1 : it;
+  }
+
+  /**
+   * \brief Access an element, a default constructed value is inserted
+   *        if the key doesn't exist.
+   */
+  T & operator[](const Key & key)
+  {
+    const size_type i = lowerIndex(key);
+
+    if (i != values_.size() && ! compare_(key, values_[i].first))
+      return values_[i].second;
+    return insertAt(i, value_type(key, T()))->second;
+  }
+
+  /**
+   * \brief Insert an element if its key doesn't exist.
+   *
+   * \return An iterator to the element with the key \p value.first, and
+   *         true if it was inserted.
+   */
+  std::pair<iterator, bool> insert(const value_type & value)
+  {
+    const size_type i = lowerIndex(value.first);
+
+    if (i != values_.size() && ! compare_(value.first, values_[i].first))
+      return std::make_pair(values_.begin() + i, false);
+    return std::make_pair(insertAt(i, value), true);
+  }
+
+  /**
+   * \brief Insert an element, the position is ignored.
+   */
+  iterator insert(iterator, const value_type & value)
+  {
+    return insert(value).first;
+  }
+
+  /**
+   * \brief Insert the elements of [first, last) whose key doesn't
+   *        exist, the first element of each key is kept.
+   *
+   * The elements are appended then sorted once, this is the fast way
+   * to fill a large container in any order: O(n log n) instead of the
+   * O(n^2) of n insert(value) in random order.
+   */
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last)
+  {
+    const size_type previous = values_.size();
+    bool            ascending = true;
+
+    for (; first != last; ++first)
+      {
+        append(*first);
+        if (ascending && values_.size() > 1)
+          ascending = compare_(values_[values_.size() - 2].first, values_.back().first);
+      }
+    // keys given in ascending order (a configuration image, a copy of
+    // another container): nothing to sort
+    if (values_.size() == previous || ascending)
+      return;
+
+    std::vector<size_type> order(values_.size());
+
+    for (size_type i = 0; i < order.size(); ++i)
+      order[i] = i;
+    // stable: the existing elements come first, then in order of insertion
+    std::stable_sort(order.begin(), order.end(), IndexLess(values_, compare_));
+
+    std::vector<value_type> sorted;
+
+    sorted.reserve(values_.size());
+    for (size_type i = 0; i < order.size(); ++i)
+      {
+        value_type & value = values_[order[i]];
+
+        if (! sorted.empty() && ! compare_(sorted.back().first, value.first))
+          continue;
+        sorted.push_back(value_type());
+        swapValues(sorted.back(), value);
+      }
+    values_.swap(sorted);
+  }
+
+  /**
+   * \brief Remove an element.
+   *
+   * \return The iterator following the removed element.
+   */
+  iterator erase(iterator position)
+  {
+    return values_.erase(position);
+  }
+
+  iterator erase(iterator first, iterator last)
+  {
+    return values_.erase(first, last);
+  }
+
+  /**
+   * \brief Remove the element of \p key.
+   *
+   * \return 1 if the element existed, 0 otherwise.
+   */
+  size_type erase(const Key & key)
+  {
+    const size_type i = indexOf(key);
+
+    if (i == values_.size())
+      return 0;
+    values_.erase(values_.begin() + i);
+    return 1;
+  }
+
+  friend bool operator==(const FlatMap & a, const FlatMap & b)
+  {
+    return a.values_ == b.values_;
+  }
+
+  friend bool operator!=(const FlatMap & a, const FlatMap & b)
+  {
+    return !(a == b);
+  }
+};
+
+/**
+ * \brief Exchange the content of two containers.
+ */
+template <typename Key, typename T, typename Compare>
+inline void swap(FlatMap<Key, T, Compare> & a, FlatMap<Key, T, Compare> & b) BREF_NOEXCEPT
+{
+  a.swap(b);
+}
+
+} // ! util
+} // ! bref
+
+#endif /* !BREF_DETAIL_UTIL_FLATMAP_HPP_ */
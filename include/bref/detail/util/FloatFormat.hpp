@@ -0,0 +1,79 @@
+/**
+ * \file   FloatFormat.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 11 10:12:38 2012
+ *
+ * \brief  Floating point to decimal string conversion, independent of
+ *         the locale.
+ *
+ * printf() writes the decimal point of LC_NUMERIC ("3,14" in a french
+ * locale), it is replaced by '.' after formatting.
+ */
+
+#ifndef BREF_DETAIL_UTIL_FLOATFORMAT_HPP_
+#define BREF_DETAIL_UTIL_FLOATFORMAT_HPP_
+
+#pragma once
+
+#include <algorithm>
+#include <clocale>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace bref {
+namespace util {
+
+/**
+ * \brief Maximum size of a \c double formatted by formatDouble().
+ */
+const std::size_t MaxDoubleSize = 32;
+
+/**
+ * \brief Replace the decimal point of LC_NUMERIC by '.' in a number
+ *        formatted by printf().
+ *
+ * \return The new size of \p number.
+ */
+inline std::size_t fixDecimalPoint(char *number, std::size_t size)
+{
+  const char       *point  = std::localeconv()->decimal_point;
+  const std::size_t length = std::strlen(point);
+
+  if (length == 1 && *point == '.')
+    return size;
+
+  char *found = std::search(number, number + size, point, point + length);
+
+  if (length == 0 || found == number + size)
+    return size;
+  *found = '.';
+  std::memmove(found + 1, found + length, number + size - found - length);
+  return size - length + 1;
+}
+
+/**
+ * \brief Format \p value like \c printf("%.*g"), with a '.' as decimal
+ *        point whatever the locale.
+ *
+ * \param precision
+ *            The number of significant digits, at most 17.
+ * \param[out] out
+ *            At least MaxDoubleSize characters, not null terminated
+ *            on return.
+ *
+ * \return The number of characters written.
+ */
+inline std::size_t formatDouble(double value, int precision, char *out)
+{
+  char              buffer[2 * MaxDoubleSize];
+  const std::size_t size = fixDecimalPoint(buffer, std::sprintf(buffer, "%.*g", precision, value));
+
+  std::memcpy(out, buffer, size);
+  return size;
+}
+
+} // ! util
+} // ! bref
+
+#endif /* !BREF_DETAIL_UTIL_FLOATFORMAT_HPP_ */
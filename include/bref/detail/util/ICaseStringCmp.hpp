@@ -5,6 +5,10 @@
  *
  * \brief  ICaseStringCmp class definition.
  *
+ * The case folding is limited to ASCII, this is what is expected for
+ * the HTTP tokens (header field names, methods, ...). It's done 16
+ * bytes (SSE2) or 32 bytes (AVX2) at a time when the instruction sets
+ * are available at compile time, with a scalar fallback.
  */
 
 #ifndef BREF_DETAIL_UTIL_ICASESTRINGCMP_HPP_
@@ -12,31 +16,253 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include <string>
-#include <functional>
-#include <cctype>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define BREF_ICASE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+# define BREF_ICASE_AVX2 1
+# include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
 
 namespace bref {
 namespace util {
 
+/**
+ * \brief Lower case conversion of an ASCII character.
+ *
+ * Unlike \c std::tolower() it doesn't depend on the locale, which is
+ * what is expected for the HTTP tokens (header field names, methods,
+ * ...).
+ */
+inline char asciiToLower(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
 /**
  * \brief Case insensitive char comparision function.
  */
 inline bool icaseCharCmp(char a, char b)
 {
-  return std::tolower(a) < std::tolower(b);
+  return static_cast<unsigned char>(asciiToLower(a)) < static_cast<unsigned char>(asciiToLower(b));
+}
+
+namespace detail {
+
+/**
+ * Index of the first bit set, \p mask should not be 0.
+ */
+inline unsigned firstBitSet(uint32_t mask)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+#ifdef BREF_ICASE_SSE2
+/**
+ * Lower case the ASCII letters of 16 bytes.
+ */
+inline __m128i foldCase(__m128i bytes)
+{
+  // signed comparisons, the non-ASCII bytes are negative and ignored
+  const __m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+                                        _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+
+  return _mm_or_si128(bytes, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+}
+#endif  // BREF_ICASE_SSE2
+
+#ifdef BREF_ICASE_AVX2
+/**
+ * Lower case the ASCII letters of 32 bytes.
+ */
+inline __m256i foldCase(__m256i bytes)
+{
+  const __m256i isUpper = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('A' - 1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), bytes));
+
+  return _mm256_or_si256(bytes, _mm256_and_si256(isUpper, _mm256_set1_epi8(0x20)));
+}
+#endif  // BREF_ICASE_AVX2
+
+/**
+ * Lower case the ASCII letters of 8 bytes packed in an integer (SWAR).
+ */
+inline uint64_t foldCase(uint64_t word)
+{
+  const uint64_t ones     = 0x0101010101010101ull;
+  const uint64_t heptets  = word & (0x7f * ones);
+  const uint64_t geA      = heptets + (0x80 - 'A') * ones;
+  const uint64_t gtZ      = heptets + (0x80 - 'Z' - 1) * ones;
+  const uint64_t isUpper  = (geA ^ gtZ) & ~word & (0x80 * ones);
+
+  return word | (isUpper >> 2);
+}
+
+/**
+ * Index of the first byte that differs (case insensitive) between
+ * \p a and \p b, \p size if they are equal.
+ */
+inline std::size_t icaseMismatch(const char *a, const char *b, std::size_t size)
+{
+  std::size_t i = 0;
+
+#ifdef BREF_ICASE_AVX2
+  for (; i + 32 <= size; i += 32)
+    {
+      const __m256i va = foldCase(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)));
+      const __m256i vb = foldCase(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+      const uint32_t diff = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+
+      if (diff)
+        return i + firstBitSet(diff);
+    }
+#endif  // BREF_ICASE_AVX2
+#ifdef BREF_ICASE_SSE2
+  for (; i + 16 <= size; i += 16)
+    {
+      const __m128i va = foldCase(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+      const __m128i vb = foldCase(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+      const uint32_t diff = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xffff;
+
+      if (diff)
+        return i + firstBitSet(diff);
+    }
+#endif  // BREF_ICASE_SSE2
+  for (; i + 8 <= size; i += 8)
+    {
+      uint64_t wa;
+      uint64_t wb;
+
+      std::memcpy(&wa, a + i, 8);
+      std::memcpy(&wb, b + i, 8);
+      if (foldCase(wa) != foldCase(wb))
+        break;
+    }
+  for (; i < size; ++i)
+    if (asciiToLower(a[i]) != asciiToLower(b[i]))
+      return i;
+  return size;
+}
+
+} // ! detail
+
+/**
+ * \brief Case insensitive (ASCII) equality of two buffers of \p size
+ *        bytes.
+ */
+inline bool icaseEqual(const char *a, const char *b, std::size_t size)
+{
+  return detail::icaseMismatch(a, b, size) == size;
+}
+
+/**
+ * \brief Case insensitive (ASCII) three-way comparison.
+ *
+ * \return A negative value if \p a is before \p b, 0 if they are
+ *         equal, a positive value otherwise.
+ */
+inline int icaseCompare(const char *a, std::size_t aSize, const char *b, std::size_t bSize)
+{
+  const std::size_t size = aSize < bSize ? aSize : bSize;
+  const std::size_t i    = detail::icaseMismatch(a, b, size);
+
+  if (i != size)
+    return static_cast<unsigned char>(asciiToLower(a[i])) - static_cast<unsigned char>(asciiToLower(b[i]));
+  return aSize < bSize ? -1 : (aSize > bSize ? 1 : 0);
+}
+
+/**
+ * \brief Case insensitive (ASCII) hash, 8 bytes are folded and mixed at
+ *        a time.
+ */
+inline std::size_t icaseHash(const char *data, std::size_t size)
+{
+  const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+  uint64_t       h          = size * multiplier;
+  std::size_t    i          = 0;
+
+  for (; i + 8 <= size; i += 8)
+    {
+      uint64_t word;
+
+      std::memcpy(&word, data + i, 8);
+      h  = (h ^ detail::foldCase(word)) * multiplier;
+      h ^= h >> 29;
+    }
+  if (i < size)
+    {
+      uint64_t word = 0;
+
+      std::memcpy(&word, data + i, size - i);
+      h  = (h ^ detail::foldCase(word)) * multiplier;
+      h ^= h >> 29;
+    }
+  return static_cast<std::size_t>(h ^ (h >> 32));
 }
 
 /**
  * \brief Case insensitive string comparison.
  */
-struct ICaseStringCmp : public std::binary_function<std::string, std::string, bool>
+struct ICaseStringCmp
 {
+  typedef std::string first_argument_type;
+  typedef std::string second_argument_type;
+  typedef bool        result_type;
+
   bool operator()(const std::string & a, const std::string & b) const
   {
-    return std::lexicographical_compare(a.begin(), a.end(),
-                                        b.begin(), b.end(),
-                                        &icaseCharCmp);
+    return icaseCompare(a.data(), a.size(), b.data(), b.size()) < 0;
+  }
+};
+
+/**
+ * \brief Case insensitive string equality.
+ */
+struct ICaseStringEqual
+{
+  typedef std::string first_argument_type;
+  typedef std::string second_argument_type;
+  typedef bool        result_type;
+
+  bool operator()(const std::string & a, const std::string & b) const
+  {
+    return a.size() == b.size() && icaseEqual(a.data(), b.data(), a.size());
+  }
+};
+
+/**
+ * \brief Case insensitive string hash, matching ICaseStringEqual.
+ *
+ * Can be used with hash tables, e.g:
+ * \code std::unordered_map<std::string, int, ICaseStringHash, ICaseStringEqual> \endcode
+ */
+struct ICaseStringHash
+{
+  typedef std::string argument_type;
+  typedef std::size_t result_type;
+
+  std::size_t operator()(const std::string & s) const
+  {
+    return icaseHash(s.data(), s.size());
   }
 };
 
@@ -0,0 +1,122 @@
+/**
+ * \file   IntFormat.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May  7 21:36:14 2012
+ *
+ * \brief  Integer to decimal string conversion.
+ *
+ * Two digits are written at a time from a lookup table, the size of
+ * the result is known before writing it (see decimalSize()).
+ */
+
+#ifndef BREF_DETAIL_UTIL_INTFORMAT_HPP_
+#define BREF_DETAIL_UTIL_INTFORMAT_HPP_
+
+#pragma once
+
+#include <cstddef>
+
+namespace bref {
+namespace util {
+
+/**
+ * \brief Maximum size of a formatted \c long, sign included.
+ */
+const std::size_t MaxDecimalSize = sizeof(unsigned long) * 3 + 1;
+
+/**
+ * \brief Number of digits of \p value in base 10.
+ */
+inline std::size_t decimalDigits(unsigned long value)
+{
+  std::size_t digits = 1;
+
+  for (;;)
+    {
+      if (value < 10)
+        return digits;
+      if (value < 100)
+        return digits + 1;
+      if (value < 1000)
+        return digits + 2;
+      if (value < 10000)
+        return digits + 3;
+      value  /= 10000;
+      digits += 4;
+    }
+}
+
+/**
+ * \brief Number of characters needed to format \p value, sign
+ *        included.
+ */
+inline std::size_t decimalSize(long value)
+{
+  if (value < 0)
+    return 1 + decimalDigits(0ul - static_cast<unsigned long>(value));
+  return decimalDigits(static_cast<unsigned long>(value));
+}
+
+/**
+ * \brief Write \p value in base 10 to \p out, without a terminating
+ *        null character.
+ *
+ * \param[out] out
+ *            Should have room for decimalDigits(value) characters.
+ *
+ * \return The number of characters written.
+ */
+inline std::size_t formatUnsigned(unsigned long value, char *out)
+{
+  static const char pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+  const std::size_t size = decimalDigits(value);
+  char             *pos  = out + size;
+
+  while (value >= 100)
+    {
+      const unsigned long pair = (value % 100) * 2;
+
+      value  /= 100;
+      *--pos  = pairs[pair + 1];
+      *--pos  = pairs[pair];
+    }
+  if (value >= 10)
+    {
+      *--pos = pairs[value * 2 + 1];
+      *--pos = pairs[value * 2];
+    }
+  else
+    *--pos = static_cast<char>('0' + value);
+  return size;
+}
+
+/**
+ * \brief Write \p value in base 10 to \p out, without a terminating
+ *        null character.
+ *
+ * \param[out] out
+ *            Should have room for decimalSize(value) characters,
+ *            MaxDecimalSize is always enough.
+ *
+ * \return The number of characters written.
+ */
+inline std::size_t formatDecimal(long value, char *out)
+{
+  if (value < 0)
+    {
+      *out = '-';
+      return 1 + formatUnsigned(0ul - static_cast<unsigned long>(value), out + 1);
+    }
+  return formatUnsigned(static_cast<unsigned long>(value), out);
+}
+
+} // ! util
+} // ! bref
+
+#endif /* !BREF_DETAIL_UTIL_INTFORMAT_HPP_ */
@@ -0,0 +1,258 @@
+/**
+ * \file   IpFormat.hpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 11 18:42:09 2012
+ *
+ * \brief  IP address to string conversions, and back.
+ *
+ * The addresses are given as bytes in network order, this is used by
+ * IpAddress and by the access log records. The parsers accept the
+ * numeric addresses only, they never call a resolver nor allocate.
+ */
+
+#ifndef BREF_DETAIL_UTIL_IPFORMAT_HPP_
+#define BREF_DETAIL_UTIL_IPFORMAT_HPP_
+
+#pragma once
+
+#include "IntFormat.hpp"
+
+#include <cstddef>
+
+namespace bref {
+namespace util {
+
+/**
+ * \brief Maximum size of a formatted IPv6 address.
+ */
+const std::size_t MaxIpAddressSize = 45;
+
+/**
+ * \brief Write the 4 bytes of an IPv4 address in dotted-decimal
+ *        notation, without a terminating null character.
+ *
+ * \return The number of characters written, at most 15.
+ */
+inline std::size_t formatIPv4(const unsigned char *bytes, char *out)
+{
+  char *pos = out;
+
+  for (int i = 0; i < 4; ++i)
+    {
+      if (i)
+        *pos++ = '.';
+      pos += formatUnsigned(bytes[i], pos);
+    }
+  return pos - out;
+}
+
+/**
+ * \brief Check if the 16 bytes of an IPv6 address are an IPv4-mapped
+ *        address (\c ::ffff:a.b.c.d).
+ */
+inline bool isV4Mapped(const unsigned char *bytes)
+{
+  for (int i = 0; i < 10; ++i)
+    if (bytes[i])
+      return false;
+  return bytes[10] == 0xff && bytes[11] == 0xff;
+}
+
+/**
+ * \brief Write the 16 bytes of an IPv6 address as recommended by
+ *        RFC5952 (lower case, longest run of zeros compressed),
+ *        without a terminating null character.
+ *
+ * \return The number of characters written, at most MaxIpAddressSize.
+ */
+inline std::size_t formatIPv6(const unsigned char *bytes, char *out)
+{
+  static const char hex[] = "0123456789abcdef";
+  char             *pos   = out;
+
+  if (isV4Mapped(bytes))
+    {
+      const char prefix[] = "::ffff:";
+
+      for (const char *c = prefix; *c; ++c)
+        *pos++ = *c;
+      return (pos - out) + formatIPv4(bytes + 12, pos);
+    }
+
+  unsigned groups[8];
+  int      zerosBegin = -1;
+  int      zerosSize  = 1;
+
+  for (int i = 0; i < 8; ++i)
+    groups[i] = (bytes[i * 2] << 8) | bytes[i * 2 + 1];
+  // longest run of at least two zero groups, the first one if equal
+  for (int i = 0; i < 8; )
+    {
+      int j = i;
+
+      while (j < 8 && groups[j] == 0)
+        ++j;
+      if (j - i > zerosSize)
+        {
+          zerosBegin = i;
+          zerosSize  = j - i;
+        }
+      i = j + 1;
+    }
+
+  for (int i = 0; i < 8; ++i)
+    {
+      if (i == zerosBegin)
+        {
+          *pos++ = ':';
+          if (i + zerosSize == 8)
+            *pos++ = ':';
+          i += zerosSize - 1;
+          continue;
+        }
+      if (i)
+        *pos++ = ':';
+
+      bool leading = true;
+
+      for (int shift = 12; shift >= 0; shift -= 4)
+        {
+          const unsigned digit = (groups[i] >> shift) & 0xf;
+
+          if (digit || ! leading || shift == 0)
+            {
+              *pos++  = hex[digit];
+              leading = false;
+            }
+        }
+    }
+  return pos - out;
+}
+
+/**
+ * \brief Parse an IPv4 address in dotted-decimal notation
+ *        (\c "192.168.0.1").
+ *
+ * Like \c inet_pton(), exactly 4 decimal numbers are accepted, without
+ * leading zeros.
+ *
+ * \param[out] bytes
+ *            The 4 bytes of the address, modified even on failure.
+ *
+ * \return false if \p text is not an IPv4 address.
+ */
+inline bool parseIPv4(const char *text, std::size_t size, unsigned char *bytes)
+{
+  const char *pos = text;
+  const char *end = text + size;
+
+  for (int i = 0; i < 4; ++i)
+    {
+      if (i && (pos == end || *pos++ != '.'))
+        return false;
+
+      const char *digits = pos;
+      unsigned    value  = 0;
+
+      while (pos != end && *pos >= '0' && *pos <= '9' && pos - digits < 3)
+        value = value * 10 + (*pos++ - '0');
+      if (pos == digits || value > 255 || (*digits == '0' && pos - digits > 1))
+        return false;
+      bytes[i] = static_cast<unsigned char>(value);
+    }
+  return pos == end;
+}
+
+/**
+ * \brief Parse an IPv6 address (\c "2001:db8::1", \c "::ffff:10.0.0.1").
+ *
+ * Like \c inet_pton(), the groups have 4 hexadecimal digits at most,
+ * \c "::" can appear once and the last 32 bits can be written as an
+ * IPv4 address. The brackets and the zone index (\c "%eth0") are not
+ * accepted.
+ *
+ * \param[out] bytes
+ *            The 16 bytes of the address, modified even on failure.
+ *
+ * \return false if \p text is not an IPv6 address.
+ */
+inline bool parseIPv6(const char *text, std::size_t size, unsigned char *bytes)
+{
+  const char *pos   = text;
+  const char *end   = text + size;
+  int         count = 0;      // bytes written
+  int         gap   = -1;     // position of "::"
+
+  if (pos != end && *pos == ':')
+    {
+      if (++pos == end || *pos != ':')
+        return false;
+    }
+  while (pos != end)
+    {
+      if (*pos == ':')
+        {
+          // "::", the previous ':' was the separator
+          if (gap != -1)
+            return false;
+          gap = count;
+          if (++pos == end)
+            break;
+        }
+      if (count == 16)
+        return false;
+
+      const char *digits = pos;
+      unsigned    value  = 0;
+
+      for (; pos != end && pos - digits < 4; ++pos)
+        {
+          const char c = *pos;
+
+          if (c >= '0' && c <= '9')
+            value = (value << 4) | (c - '0');
+          else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            value = (value << 4) | ((c | 0x20) - 'a' + 10);
+          else
+            break;
+        }
+      if (pos != end && *pos == '.')
+        {
+          // the IPv4 address of the last 32 bits
+          if (count > 12 || ! parseIPv4(digits, end - digits, bytes + count))
+            return false;
+          count += 4;
+          pos    = end;
+          break;
+        }
+      if (pos == digits)
+        return false;
+      bytes[count++] = static_cast<unsigned char>(value >> 8);
+      bytes[count++] = static_cast<unsigned char>(value);
+      if (pos == end)
+        break;
+      if (*pos != ':' || ++pos == end)
+        return false;
+    }
+
+  if (gap == -1)
+    return count == 16;
+  // "::" stands for at least one group; ">=" also tells the compiler
+  // that the moves below stay in the 16 bytes
+  if (count >= 16)
+    return false;
+
+  // move the groups after "::" to the end, zeros in between
+  const int moved = count - gap;
+
+  for (int i = 1; i <= moved; ++i)
+    bytes[16 - i] = bytes[count - i];
+  for (int i = gap; i < 16 - moved; ++i)
+    bytes[i] = 0;
+  return true;
+}
+
+} // ! util
+} // ! bref
+
+#endif /* !BREF_DETAIL_UTIL_IPFORMAT_HPP_ */
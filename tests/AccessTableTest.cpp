@@ -0,0 +1,260 @@
+/**
+ * \file   AccessTableTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 29 10:21:44 2012
+ *
+ * \brief  ModAccess: AccessRule::parse() and AccessTable lookups.
+ *
+ */
+
+/*
+  Le trie doit donner l'action de la règle du plus long préfixe, comme
+  un parcours linéaire des règles : on compare les deux sur des règles
+  et des adresses aléatoires. Les règles IPv4-mapped s'appliquent aux
+  adresses IPv4 et aux adresses IPv4-mapped.
+*/
+
+#include "Check.h"
+
+#include "AccessTable.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int RandomRules     = 2000;
+const int RandomAddresses = 200000;
+
+AccessRule rule(const std::string & text)
+{
+  AccessRule  result;
+  std::string error;
+
+  if (! AccessRule::parse(text, result, error))
+    {
+      std::fprintf(stderr, "\"%s\": %s\n", text.c_str(), error.c_str());
+      ++test::failures();
+    }
+  return result;
+}
+
+bool invalid(const std::string & text)
+{
+  AccessRule  result;
+  std::string error;
+
+  return ! AccessRule::parse(text, result, error) && ! error.empty();
+}
+
+AccessRule::Action lookup(const AccessTable & table, const std::string & address)
+{
+  unsigned char bytes[16] = { 0 };
+
+  if (bref::util::parseIPv4(address.data(), address.size(), bytes))
+    return table.lookupV4(bytes);
+  if (bref::util::parseIPv6(address.data(), address.size(), bytes))
+    return table.lookupV6(bytes);
+  std::fprintf(stderr, "invalid address \"%s\"\n", address.c_str());
+  ++test::failures();
+  return AccessRule::NoMatch;
+}
+
+/*
+  La référence : la dernière des règles les plus longues qui contiennent
+  l'adresse.
+*/
+AccessRule::Action linear(const std::vector<AccessRule> & rules, AccessRule::Action defaultAction,
+                          const unsigned char *bytes)
+{
+  AccessRule::Action action = defaultAction;
+  long               best   = -1;
+
+  for (std::vector<AccessRule>::const_iterator it = rules.begin(); it != rules.end(); ++it)
+    {
+      bool match = it->v4;
+
+      for (unsigned bit = 0; match && bit < it->length; ++bit)
+        {
+          const unsigned char mask = static_cast<unsigned char>(0x80 >> (bit % 8));
+
+          match = (bytes[bit / 8] & mask) == (it->bytes[bit / 8] & mask);
+        }
+      if (match && static_cast<long>(it->length) >= best)
+        {
+          best   = it->length;
+          action = it->action;
+        }
+    }
+  return action;
+}
+
+void checkParse()
+{
+  AccessRule r = rule("deny 10.1.2.3/8");
+
+  CHECK(r.action == AccessRule::Deny && r.v4 && r.length == 8);
+  CHECK(r.bytes[0] == 10 && r.bytes[1] == 0 && r.bytes[2] == 0 && r.bytes[3] == 0);
+
+  r = rule("allow 2001:db8::1");
+  CHECK(r.action == AccessRule::Allow && ! r.v4 && r.length == 128);
+
+  // IPv4-mapped : convertie en règle IPv4
+  r = rule("deny ::ffff:10.1.2.3/104");
+  CHECK(r.v4 && r.length == 8 && r.bytes[0] == 10 && r.bytes[1] == 0);
+  r = rule("deny ::ffff:192.168.1.12");
+  CHECK(r.v4 && r.length == 32 && r.bytes[0] == 192 && r.bytes[3] == 12);
+  r = rule("deny ::ffff:0:0/96");
+  CHECK(r.v4 && r.length == 0);
+
+  CHECK(invalid(""));
+  CHECK(invalid("deny"));
+  CHECK(invalid("deny 10.0.0.0/8 garbage"));
+  CHECK(invalid("block 10.0.0.0/8"));
+  CHECK(invalid("deny 10.0.0/8"));
+  CHECK(invalid("deny 10.0.0.0/33"));
+  CHECK(invalid("deny 10.0.0.0/"));
+  CHECK(invalid("deny 10.0.0.0/-1"));
+  CHECK(invalid("deny 10.0.0.0/8x"));
+  CHECK(invalid("deny 2001:db8::/129"));
+}
+
+void checkLookup()
+{
+  std::vector<AccessRule> rules;
+
+  rules.push_back(rule("deny 10.0.0.0/8"));
+  rules.push_back(rule("allow 10.1.0.0/16"));
+  rules.push_back(rule("deny 10.1.2.3"));
+  rules.push_back(rule("deny 2001:db8::/32"));
+  rules.push_back(rule("allow 2001:db8:1::/48"));
+  rules.push_back(rule("deny ::ffff:192.168.0.0/112"));
+
+  const AccessTable table(rules, AccessRule::Allow);
+
+  CHECK(table.ruleCount() == rules.size());
+  CHECK(lookup(table, "10.2.3.4") == AccessRule::Deny);
+  CHECK(lookup(table, "10.1.3.4") == AccessRule::Allow);
+  CHECK(lookup(table, "10.1.2.3") == AccessRule::Deny);
+  CHECK(lookup(table, "10.1.2.4") == AccessRule::Allow);
+  CHECK(lookup(table, "11.0.0.1") == AccessRule::Allow);
+  CHECK(lookup(table, "2001:db8::1") == AccessRule::Deny);
+  CHECK(lookup(table, "2001:db8:1::1") == AccessRule::Allow);
+  CHECK(lookup(table, "2001:db9::1") == AccessRule::Allow);
+
+  // une adresse IPv4-mapped suit les règles IPv4, une règle
+  // IPv4-mapped s'applique aux adresses IPv4
+  CHECK(lookup(table, "::ffff:10.2.3.4") == AccessRule::Deny);
+  CHECK(lookup(table, "::ffff:10.1.3.4") == AccessRule::Allow);
+  CHECK(lookup(table, "192.168.1.1") == AccessRule::Deny);
+  CHECK(lookup(table, "::ffff:192.168.1.1") == AccessRule::Deny);
+  CHECK(lookup(table, "192.169.1.1") == AccessRule::Allow);
+
+  // l'action par défaut
+  const AccessTable closed(rules, AccessRule::Deny);
+
+  CHECK(lookup(closed, "11.0.0.1") == AccessRule::Deny);
+  CHECK(lookup(closed, "10.1.3.4") == AccessRule::Allow);
+
+  const AccessTable empty(std::vector<AccessRule>(), AccessRule::Deny);
+
+  CHECK(lookup(empty, "127.0.0.1") == AccessRule::Deny);
+  CHECK(lookup(empty, "::1") == AccessRule::Deny);
+}
+
+/*
+  Une règle IPv6 qui contient ::ffff:0:0/96 s'applique à toutes les
+  adresses IPv4, comme une règle /0 ; à longueur égale la dernière
+  règle l'emporte.
+*/
+void checkV6Covering()
+{
+  std::vector<AccessRule> rules;
+
+  rules.push_back(rule("deny ::/0"));
+  rules.push_back(rule("allow 10.0.0.0/8"));
+
+  const AccessTable table(rules, AccessRule::Allow);
+
+  CHECK(lookup(table, "11.0.0.1") == AccessRule::Deny);
+  CHECK(lookup(table, "::ffff:11.0.0.1") == AccessRule::Deny);
+  CHECK(lookup(table, "10.0.0.1") == AccessRule::Allow);
+  CHECK(lookup(table, "2001:db8::1") == AccessRule::Deny);
+
+  rules.push_back(rule("allow 0.0.0.0/0"));
+
+  const AccessTable reopened(rules, AccessRule::Deny);
+
+  CHECK(lookup(reopened, "11.0.0.1") == AccessRule::Allow);
+  CHECK(lookup(reopened, "2001:db8::1") == AccessRule::Deny);
+
+  // ::ffff:0:0/95 contient ::ffff:0:0/96, ::ffff:0:0/97 non
+  rules.clear();
+  rules.push_back(rule("deny ::fffe:0:0/95"));
+
+  const AccessTable covering(rules, AccessRule::Allow);
+
+  CHECK(lookup(covering, "11.0.0.1") == AccessRule::Deny);
+
+  rules.clear();
+  rules.push_back(rule("deny 1::/16"));
+
+  const AccessTable other(rules, AccessRule::Allow);
+
+  CHECK(lookup(other, "11.0.0.1") == AccessRule::Allow);
+}
+
+/*
+  Des règles IPv4 aléatoires, concentrées sur quelques /8 pour qu'elles
+  s'emboîtent, contre le parcours linéaire.
+*/
+void checkRandom()
+{
+  std::vector<AccessRule> rules;
+
+  std::srand(42);
+  for (int i = 0; i < RandomRules; ++i)
+    {
+      AccessRule r;
+
+      std::memset(&r, 0, sizeof r);
+      r.action = std::rand() % 2 ? AccessRule::Allow : AccessRule::Deny;
+      r.v4     = true;
+      r.length = std::rand() % 33;
+      r.bytes[0] = static_cast<unsigned char>(std::rand() % 4);
+      for (int b = 1; b < 4; ++b)
+        r.bytes[b] = static_cast<unsigned char>(std::rand() % (b == 3 ? 256 : 3));
+      for (unsigned bit = r.length; bit < 32; ++bit)
+        r.bytes[bit / 8] &= static_cast<unsigned char>(~(0x80 >> (bit % 8)));
+      rules.push_back(r);
+    }
+
+  const AccessTable table(rules, AccessRule::NoMatch);
+  int               mismatches = 0;
+
+  for (int i = 0; i < RandomAddresses; ++i)
+    {
+      unsigned char bytes[4];
+
+      bytes[0] = static_cast<unsigned char>(std::rand() % 5);
+      bytes[1] = static_cast<unsigned char>(std::rand() % 4);
+      bytes[2] = static_cast<unsigned char>(std::rand() % 4);
+      bytes[3] = static_cast<unsigned char>(std::rand());
+      if (table.lookupV4(bytes) != linear(rules, AccessRule::NoMatch, bytes))
+        ++mismatches;
+    }
+  CHECK(mismatches == 0);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  checkParse();
+  checkLookup();
+  checkV6Covering();
+  checkRandom();
+  return test::result();
+}
@@ -0,0 +1,211 @@
+/**
+ * \file   ArenaTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 31 14:37:51 2012
+ *
+ * \brief  Arena alignment, over-sized allocations, merge of the blocks
+ *         on reset() and ArenaAllocator.
+ *
+ */
+
+/*
+  Les allocations sont comptées (operator new) : après reset() une
+  arène ne doit plus allouer pour des requêtes de même taille.
+*/
+
+#include "Check.h"
+
+#include "bref/Arena.h"
+
+#include <stdint.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <new>
+#include <vector>
+
+namespace {
+
+int allocations = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++allocations;
+  return p;
+}
+
+void operator delete(void *p) throw()
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) throw()
+{
+  std::free(p);
+}
+
+namespace {
+
+bool isAligned(const void *p, std::size_t alignment)
+{
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+void testAlignment()
+{
+  bref::Arena       arena(256);
+  const std::size_t alignments[] = { 1, 2, 4, 8, 16, 64 };
+  char             *previous     = 0;
+
+  CHECK(bref::Arena::HeaderSize % bref::Arena::DefaultAlignment == 0);
+
+  // des tailles impaires pour décaler le prochain octet libre
+  for (std::size_t i = 0; i < sizeof alignments / sizeof alignments[0]; ++i)
+    {
+      char *p = static_cast<char *>(arena.allocate(3, alignments[i]));
+
+      CHECK(isAligned(p, alignments[i]));
+      CHECK(previous == 0 || p >= previous + 3);
+      std::memset(p, 'x', 3);
+      previous = p;
+    }
+  CHECK(isAligned(arena.allocate(1), bref::Arena::DefaultAlignment));
+  CHECK(arena.capacity() == 256);
+}
+
+/*
+  Une allocation plus grande que les blocs a son propre bloc, aligné
+  lui aussi.
+*/
+void testOverSized()
+{
+  bref::Arena arena(64);
+  const int   before = allocations;
+  char       *small  = static_cast<char *>(arena.allocate(8));
+  char       *large  = static_cast<char *>(arena.allocate(1000, 64));
+
+  CHECK(allocations == before + 2);
+  CHECK(isAligned(large, 64));
+  CHECK(arena.capacity() >= 64 + 1000);
+  std::memset(large, 'y', 1000);
+  std::memset(small, 'z', 8);
+  CHECK(large[999] == 'y' && small[0] == 'z');
+
+  // plus grand qu'un bloc par défaut, dès la première allocation
+  bref::Arena fresh(16);
+
+  CHECK(isAligned(fresh.allocate(100, 32), 32));
+  CHECK(fresh.capacity() >= 100);
+}
+
+/*
+  reset() remplace les blocs par un seul de la taille totale : la
+  requête suivante de même taille n'alloue plus.
+*/
+void testResetMerge()
+{
+  bref::Arena arena(128);
+
+  CHECK(arena.capacity() == 0);
+  for (int i = 0; i < 3; ++i)
+    arena.allocate(100);
+
+  const std::size_t used = arena.capacity();
+
+  CHECK(used == 3 * 128);
+
+  int before = allocations;
+
+  arena.reset();
+  CHECK(allocations == before + 1);
+  CHECK(arena.capacity() == used);
+
+  before = allocations;
+
+  char *first = static_cast<char *>(arena.allocate(100));
+
+  for (int i = 0; i < 2; ++i)
+    arena.allocate(100);
+  CHECK(allocations == before);
+
+  // un seul bloc : reset() le garde tel quel, la mémoire est réutilisée
+  arena.reset();
+  CHECK(allocations == before);
+  CHECK(arena.allocate(100) == first);
+  CHECK(arena.capacity() == used);
+
+  arena.release();
+  CHECK(arena.capacity() == 0);
+  arena.reset();
+  CHECK(arena.capacity() == 0);
+}
+
+void testAllocator()
+{
+  typedef bref::ArenaAllocator<double>               DoubleAllocator;
+  typedef std::vector<double, DoubleAllocator>       Vector;
+  typedef std::list<int, bref::ArenaAllocator<int> > List;
+
+  bref::Arena     arena(1024);
+  DoubleAllocator allocator(arena);
+
+  CHECK(&allocator.arena() == &arena);
+  CHECK(bref::ArenaAllocator<int>(allocator) == allocator);
+
+  bref::Arena other;
+
+  CHECK(DoubleAllocator(other) != allocator);
+
+  {
+    Vector values(allocator);
+
+    for (int i = 0; i < 500; ++i)
+      values.push_back(i);
+    CHECK(isAligned(&values[0], sizeof(double) < bref::Arena::DefaultAlignment
+                                ? sizeof(double) : bref::Arena::DefaultAlignment));
+    CHECK(values[499] == 499.0);
+
+    // les noeuds sont des types différents de int (rebind)
+    List list((bref::ArenaAllocator<int>(arena)));
+
+    for (int i = 0; i < 100; ++i)
+      list.push_back(i);
+    CHECK(list.size() == 100 && list.back() == 99);
+  }
+
+  // la requête suivante tient dans le bloc fusionné
+  arena.reset();
+
+  const int before = allocations;
+
+  {
+    Vector values(allocator);
+
+    for (int i = 0; i < 500; ++i)
+      values.push_back(i);
+
+    List list((bref::ArenaAllocator<int>(arena)));
+
+    for (int i = 0; i < 100; ++i)
+      list.push_back(i);
+  }
+  CHECK(allocations == before);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testAlignment();
+  testOverSized();
+  testResetMerge();
+  testAllocator();
+  return test::result();
+}
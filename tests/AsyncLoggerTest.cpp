@@ -0,0 +1,129 @@
+/**
+ * \file   AsyncLoggerTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 26 10:21:48 2012
+ *
+ * \brief  AsyncLogger with many logging threads.
+ *
+ */
+
+/*
+  16 threads écrivent chacun Messages messages numérotés :
+
+  - Block       rien n'est perdu
+  - DropNewest  chaque message est écrit ou compté dans dropped()
+
+  et dans les deux cas les messages d'un thread sortent dans l'ordre.
+  À lancer aussi sous TSan.
+*/
+
+#include "Check.h"
+
+#include "bref/AsyncLogger.h"
+#include "bref/ScopedLogger.h"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int Threads  = 16;
+const int Messages = 5000;
+
+struct Sink
+{
+  std::string *out;
+  std::mutex  *mutex;
+
+  void operator()(const char *data, std::size_t size) const
+  {
+    std::lock_guard<std::mutex> lock(*mutex);
+
+    out->append(data, size);
+  }
+};
+
+void run(bref::AsyncLogger::OverflowPolicy policy, std::size_t ringSize)
+{
+  std::string                out;
+  std::mutex                 mutex;
+  uint64_t                   dropped;
+  bref::AsyncLogger::Options options;
+
+  options.overflow  = policy;
+  options.ringSize  = ringSize;
+  options.batchSize = 8192;
+
+  {
+    const Sink               sink = { &out, &mutex };
+    bref::AsyncLogger        logger(sink, options, bref::ILogger::Debug);
+    bref::ILogger           *log = &logger;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < Threads; ++t)
+      threads.push_back(std::thread([log, t] {
+            for (int i = 0; i < Messages; ++i)
+              LOG_INFO(log) << "t" << t << " i" << i << " " << std::string(i % 200, 'x');
+          }));
+    for (std::size_t t = 0; t < threads.size(); ++t)
+      threads[t].join();
+    LOG_DEBUG(log) << "last";
+    logger.flush();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      CHECK(out.find(" DEBUG last\n") != std::string::npos);
+    }
+    dropped = logger.dropped();
+  }
+
+  std::istringstream in(out);
+  std::string        line;
+  std::map<int, int> last;
+  unsigned long      messages = 0;
+
+  while (std::getline(in, line))
+    {
+      const std::size_t at = line.find(" INFO t");
+      int               t;
+      int               i;
+
+      // "2012-05-26T10:21:48.123Z INFO ..."
+      CHECK(line.size() > 25 && line[4] == '-' && line[19] == '.');
+      if (at == std::string::npos || std::sscanf(line.c_str() + at + 7, "%d i%d", &t, &i) != 2)
+        continue;
+      ++messages;
+      CHECK(last.find(t) == last.end() || last[t] < i);
+      last[t] = i;
+    }
+  if (policy == bref::AsyncLogger::Block)
+    CHECK(messages == Threads * Messages && dropped == 0);
+  else
+    CHECK(messages + dropped == Threads * Messages);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  run(bref::AsyncLogger::Block, 4096);
+  run(bref::AsyncLogger::DropNewest, 4096);
+  run(bref::AsyncLogger::DropNewest, 1 << 20);
+
+  // les rings des threads terminés sont libérés
+  std::string       out;
+  std::mutex        mutex;
+  const Sink        sink = { &out, &mutex };
+  bref::AsyncLogger logger(sink);
+
+  for (int i = 0; i < 50; ++i)
+    std::thread([&logger] { logger.log(bref::ILogger::Info, "x"); }).join();
+  logger.flush();
+  CHECK(out.size() > 50 * 2);
+  return test::result();
+}
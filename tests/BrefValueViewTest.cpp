@@ -0,0 +1,221 @@
+/**
+ * \file   BrefValueViewTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 14:51:23 2012
+ *
+ * \brief  BrefValueImage serialization and validation tests.
+ *
+ */
+
+#include "Check.h"
+
+#include "bref/BrefValueView.h"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace {
+
+uint32_t word(const bref::Buffer & image, std::size_t offset)
+{
+  uint32_t value;
+
+  std::memcpy(&value, &image[offset], sizeof value);
+  return value;
+}
+
+void setWord(bref::Buffer & image, std::size_t offset, uint32_t value)
+{
+  std::memcpy(&image[offset], &value, sizeof value);
+}
+
+uint32_t rootOffset(const bref::Buffer & image)
+{
+  return word(image, 20);
+}
+
+bref::Buffer serialize(const bref::BrefValue & value)
+{
+  bref::Buffer image;
+
+  bref::BrefValueImage::serialize(value, image);
+  return image;
+}
+
+bool validate(const bref::Buffer & image)
+{
+  return bref::BrefValueImage::validate(&image[0], image.size());
+}
+
+bref::BrefValue sample()
+{
+  bref::BrefValue config;
+
+  config["DocumentRoot"] = bref::BrefValue("/var/www");
+  config["Timeout"]      = bref::BrefValue(30);
+  config["Ratio"]        = bref::BrefValue(1.5);
+  config["On"]           = bref::BrefValue(true);
+  config["Nothing"]      = bref::BrefValue();
+  config["\xC3\xA9t\xC3\xA9"] = bref::BrefValue("after 'z' in the image");
+  config["VirtualHosts"]["a.com"]["DocumentRoot"] = bref::BrefValue("/srv/a");
+  config["VirtualHosts"]["b.com"]["DocumentRoot"] = bref::BrefValue("/srv/b");
+  config["VirtualHosts"]["b.com"]["Aliases"].push(bref::BrefValue("x.org"));
+  config["VirtualHosts"]["b.com"]["Aliases"].push(bref::BrefValue(-7));
+  return config;
+}
+
+void testRoundTrip()
+{
+  const bref::Buffer image = serialize(sample());
+
+  CHECK(validate(image));
+
+  const bref::BrefValueView root = bref::BrefValueImage::root(&image[0]);
+
+  CHECK(root.isArray());
+  CHECK(root["Timeout"].asInt() == 30);
+  CHECK(root["Ratio"].asDouble() == 1.5);
+  CHECK(root["On"].asBool());
+  CHECK(root.hasKey("Nothing") && ! root.hasKey("Missing"));
+  CHECK(root.hasKey("\xC3\xA9t\xC3\xA9") && root.keyAt(root.size() - 1) == std::string("\xC3\xA9t\xC3\xA9"));
+  CHECK(root["Missing"].isNull());
+  CHECK(std::string(root["VirtualHosts"]["b.com"]["DocumentRoot"].asCString()) == "/srv/b");
+  CHECK(root["VirtualHosts"]["b.com"]["Aliases"].at(0).asString() == "x.org");
+  CHECK(root["VirtualHosts"]["b.com"]["Aliases"].at(1).asInt() == -7);
+  CHECK(root["VirtualHosts"]["b.com"]["Aliases"]["x"].isNull());
+  CHECK(serialize(root.toBrefValue()) == image);
+}
+
+/*
+  Une image corrompue ou tronquée est refusée, ou bien elle se lit
+  entièrement sans sortir du buffer (à vérifier avec ASan).
+*/
+void testCorruption()
+{
+  const bref::Buffer image = serialize(sample());
+
+  for (std::size_t i = 0; i < image.size(); ++i)
+    for (int bit = 0; bit < 8; ++bit)
+      {
+        bref::Buffer corrupted = image;
+
+        corrupted[i] ^= static_cast<char>(1 << bit);
+        if (validate(corrupted))
+          bref::BrefValueImage::root(&corrupted[0]).toBrefValue();
+      }
+
+  for (std::size_t size = 0; size < image.size(); size += 4)
+    {
+      bref::Buffer truncated(image.begin(), image.begin() + size);
+
+      CHECK(truncated.empty() || ! validate(truncated));
+      if (size >= bref::BrefValueImage::HeaderSize)
+        {
+          // taille de l'en-tête corrigée : les noeuds dépassent
+          setWord(truncated, 16, static_cast<uint32_t>(size));
+          CHECK(! validate(truncated));
+        }
+    }
+}
+
+void testCrafted()
+{
+  // une liste qui se contient
+  bref::BrefValue list;
+
+  list.push(bref::BrefValue());
+
+  bref::Buffer   cycle = serialize(list);
+  const uint32_t root  = rootOffset(cycle);
+
+  CHECK(validate(cycle));
+  setWord(cycle, root + 8, root);
+  CHECK(! validate(cycle));
+
+  // offset non aligné, ou dans l'en-tête
+  bref::Buffer misaligned = serialize(list);
+
+  setWord(misaligned, rootOffset(misaligned) + 8, rootOffset(misaligned) + 4);
+  CHECK(! validate(misaligned));
+  setWord(misaligned, 20, 8);
+  CHECK(! validate(misaligned));
+
+  // clés dans le désordre
+  bref::BrefValue array;
+
+  array["a"] = bref::BrefValue(1);
+  array["b"] = bref::BrefValue(2);
+
+  bref::Buffer   unsorted = serialize(array);
+  const uint32_t node     = rootOffset(unsorted);
+  const uint32_t first    = word(unsorted, node + 8);
+
+  setWord(unsorted, node + 8, word(unsorted, node + 16));
+  setWord(unsorted, node + 16, first);
+  CHECK(! validate(unsorted));
+
+  // chaîne sans '\0' final
+  bref::Buffer   string = serialize(bref::BrefValue("abc"));
+  const uint32_t offset = rootOffset(string);
+
+  CHECK(validate(string));
+  string[offset + 8 + 3] = 'x';
+  CHECK(! validate(string));
+
+  // profondeur
+  bref::BrefValue deep;
+  bref::BrefValue *last = &deep;
+
+  for (unsigned i = 0; i <= bref::BrefValueImage::MaxDepth; ++i)
+    {
+      last->push(bref::BrefValue());
+      last = &const_cast<bref::BrefValueList &>(last->asList()).back();
+    }
+  CHECK(! validate(serialize(deep)));
+
+  // type inconnu
+  bref::Buffer unknown = serialize(bref::BrefValue(1));
+
+  setWord(unknown, rootOffset(unknown), 42);
+  CHECK(! validate(unknown));
+}
+
+void testMapped()
+{
+  const bref::Buffer image = serialize(sample());
+  char               path[] = "/tmp/bref-image-XXXXXX";
+  const int          fd     = ::mkstemp(path);
+
+  CHECK(fd != -1);
+  CHECK(::write(fd, &image[0], image.size()) == static_cast<ssize_t>(image.size()));
+  ::close(fd);
+
+  bref::MappedBrefValue mapped;
+
+  CHECK(mapped.open(path));
+  CHECK(mapped.root()["DocumentRoot"].asString() == "/var/www");
+  CHECK(! mapped.open("/nonexistent/image"));
+  CHECK(! mapped.isOpen());
+
+  // un fichier corrompu n'est pas ouvert
+  bref::Buffer corrupted = image;
+
+  setWord(corrupted, rootOffset(corrupted), 42);
+  std::ofstream(path, std::ios::binary).write(&corrupted[0], corrupted.size());
+  CHECK(! mapped.open(path));
+  ::unlink(path);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testRoundTrip();
+  testCorruption();
+  testCrafted();
+  testMapped();
+  return test::result();
+}
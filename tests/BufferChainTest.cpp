@@ -0,0 +1,320 @@
+/**
+ * \file   BufferChainTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 30 14:21:07 2012
+ *
+ * \brief  BufferSlice and BufferChain slicing, prepend / trim and
+ *         sharing, HandlerChain with both flavors of handlers.
+ *
+ */
+
+/*
+  Les blocs vivants sont comptés (operator new / delete) : copier une
+  tranche ou une chaîne ne doit pas copier les données, et le dernier
+  SharedBuffer libéré doit être détruit.
+*/
+
+#include "Check.h"
+
+#include "bref/HttpResponse.h"
+#include "bref/PipelineExecutor.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace {
+
+long liveBlocks = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++liveBlocks;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  if (p)
+    --liveBlocks;
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  if (p)
+    --liveBlocks;
+  std::free(p);
+}
+
+namespace {
+
+typedef bref::PipelineExecutor::TransformChain TransformChain;
+
+bref::Buffer makeBuffer(const char *text)
+{
+  return bref::Buffer(text, text + std::strlen(text));
+}
+
+std::string toString(const bref::BufferChain & chain)
+{
+  bref::Buffer buffer;
+
+  chain.copyTo(buffer);
+  return std::string(buffer.begin(), buffer.end());
+}
+
+std::string toString(const bref::Buffer & buffer)
+{
+  return std::string(buffer.begin(), buffer.end());
+}
+
+void testSlice()
+{
+  bref::SharedBuffer *shared = bref::SharedBuffer::copy("hello world", 11);
+  bref::BufferSlice   slice(shared);
+
+  shared->release();
+  CHECK(slice.size() == 11 && std::string(slice.data(), slice.size()) == "hello world");
+
+  // une sous-tranche pointe dans le même bloc
+  bref::BufferSlice sub = slice.slice(6, 5);
+
+  CHECK(sub.data() == slice.data() + 6);
+  CHECK(std::string(sub.data(), sub.size()) == "world");
+
+  sub.trimFront(1);
+  sub.trimBack(1);
+  CHECK(std::string(sub.data(), sub.size()) == "orl");
+
+  bref::BufferSlice middle(shared, 2, 3);
+
+  CHECK(std::string(middle.data(), middle.size()) == "llo");
+
+  const bref::BufferSlice empty;
+
+  CHECK(empty.empty() && empty.data() == 0);
+
+  static const char literal[] = "static";
+  bref::BufferSlice fixed = bref::BufferSlice::fromStatic(literal, sizeof literal - 1);
+
+  CHECK(fixed.data() == literal && fixed.size() == 6);
+}
+
+/*
+  Adopter un Buffer ne copie pas ses octets, et les copies de tranches
+  et de chaînes partagent le même SharedBuffer.
+*/
+void testSharing()
+{
+  const long before = liveBlocks;
+
+  {
+    bref::Buffer      buffer  = makeBuffer("shared data");
+    const char       *storage = &buffer[0];
+    bref::BufferChain chain;
+
+    chain.append(buffer);
+    CHECK(buffer.empty());
+    CHECK(chain.segment(0).data() == storage);
+
+    // le bloc du Buffer et le SharedBuffer, plus le tableau des tranches
+    const long adopted = liveBlocks;
+
+    {
+      bref::BufferSlice copy(chain.segment(0));
+      bref::BufferSlice sub = copy.slice(0, 6);
+      bref::BufferChain other(chain);
+
+      CHECK(other.segment(0).data() == storage);
+      CHECK(sub.data() == storage);
+      // seul le tableau des tranches de la copie est alloué
+      CHECK(liveBlocks == adopted + 1);
+
+      chain.clear();
+      CHECK(liveBlocks == adopted + 1);
+      CHECK(toString(other) == "shared data");
+    }
+    // le SharedBuffer et son bloc sont détruits avec la dernière tranche
+    CHECK(liveBlocks == adopted - 2);
+
+#ifdef BREF_CXX11
+    bref::SharedBuffer *shared = bref::SharedBuffer::copy("moved", 5);
+    bref::BufferSlice   first(shared);
+
+    shared->release();
+
+    bref::BufferSlice second(std::move(first));
+
+    CHECK(first.empty() && first.data() == 0);
+    CHECK(std::string(second.data(), second.size()) == "moved");
+#endif
+  }
+  CHECK(liveBlocks == before);
+}
+
+void testPrependTrim()
+{
+  static const char open[]  = "<";
+  static const char close[] = ">";
+  bref::BufferChain chain;
+  bref::Buffer      middle = makeBuffer("middle");
+  bref::Buffer      empty;
+
+  chain.append(middle);
+  chain.prepend(bref::BufferSlice::fromStatic(open, 1));
+  chain.append(bref::BufferSlice::fromStatic(close, 1));
+  CHECK(chain.size() == 8 && chain.segmentCount() == 3);
+  CHECK(toString(chain) == "<middle>");
+
+  // les morceaux vides ne sont pas ajoutés
+  chain.append(empty);
+  chain.prepend(bref::BufferSlice());
+  CHECK(chain.segmentCount() == 3);
+
+  struct iovec iov[2];
+
+  CHECK(chain.fillIoVec(iov, 2) == 2);
+  CHECK(iov[0].iov_base == open && iov[0].iov_len == 1 && iov[1].iov_len == 6);
+  CHECK(chain.fillIoVec(iov, 2, 2) == 1 && iov[0].iov_base == close);
+
+  // une tranche entière puis une partie de la suivante
+  chain.trimFront(3);
+  CHECK(chain.size() == 5 && chain.segmentCount() == 2);
+  CHECK(toString(chain) == "ddle>");
+
+  chain.trimBack(2);
+  CHECK(chain.segmentCount() == 1);
+  CHECK(toString(chain) == "ddl");
+
+  bref::BufferChain other;
+
+  other.append(bref::BufferSlice::fromStatic(open, 1));
+  other.append(chain);
+  CHECK(toString(other) == "<ddl" && other.size() == 4);
+
+  // au-delà de la taille, la chaîne est vidée
+  other.trimBack(100);
+  CHECK(other.empty() && other.segmentCount() == 0);
+  chain.trimFront(100);
+  CHECK(chain.empty() && chain.segmentCount() == 0);
+
+  bref::Buffer buffer = makeBuffer("abc");
+
+  chain.prepend(buffer);
+  swap(chain, other);
+  CHECK(chain.empty() && toString(other) == "abc");
+}
+
+struct Upper
+{
+  void operator()(bref::HttpResponse &, const bref::Buffer & in, bref::Buffer & out) const
+  {
+    for (std::size_t i = 0; i < in.size(); ++i)
+      out.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(in[i]))));
+  }
+};
+
+struct Brackets
+{
+  void operator()(bref::HttpResponse &, bref::BufferChain & chunk) const
+  {
+    static const char open[]  = "[";
+    static const char close[] = "]";
+
+    chunk.prepend(bref::BufferSlice::fromStatic(open, 1));
+    chunk.append(bref::BufferSlice::fromStatic(close, 1));
+  }
+};
+
+struct DropFirst
+{
+  void operator()(bref::HttpResponse &, bref::BufferChain & chunk) const
+  {
+    chunk.trimFront(1);
+  }
+};
+
+void fill(TransformChain & chain)
+{
+  chain.clear();
+  chain.push(bref::Pipeline::TransformChainRequestHandler(DropFirst()));
+  chain.push(bref::Pipeline::TransformRequestHandler(Upper()));
+  chain.push(bref::Pipeline::TransformChainRequestHandler(Brackets()));
+  chain.push(bref::Pipeline::TransformChainRequestHandler(Brackets()));
+}
+
+/*
+  Les handlers sont appelés dans l'ordre, la sortie de l'un est l'entrée
+  du suivant, que la chaîne tourne sur un Buffer ou une BufferChain.
+*/
+void testHandlerChain()
+{
+  bref::HttpResponse response;
+  TransformChain     chain;
+
+  CHECK(chain.empty());
+  fill(chain);
+  CHECK(chain.size() == 4);
+
+  bref::Buffer data    = makeBuffer("xabc");
+  bref::Buffer scratch;
+
+  chain(response, data, scratch);
+  CHECK(toString(data) == "[[ABC]]");
+
+  bref::BufferChain chunk;
+  bref::Buffer      body = makeBuffer("xdef");
+
+  chunk.append(body);
+  chain(response, chunk);
+  CHECK(toString(chunk) == "[[DEF]]");
+  // le handler Buffer produit un nouveau bloc, les crochets sont
+  // ajoutés autour sans copie
+  CHECK(chunk.segmentCount() == 5);
+
+  // chaîne vide : les données ne changent pas
+  chain.clear();
+  chain(response, chunk);
+  CHECK(toString(chunk) == "[[DEF]]");
+
+  // un seul type de handler, sans conversion
+  chain.push(bref::Pipeline::TransformRequestHandler(Upper()));
+  data = makeBuffer("low");
+  chain(response, data, scratch);
+  CHECK(toString(data) == "LOW");
+
+  // réutilisée d'un morceau à l'autre, la chaîne n'alloue plus
+  fill(chain);
+  data = makeBuffer("xwarm");
+  chain(response, data, scratch);
+  fill(chain);
+  data = makeBuffer("xwarm");
+  scratch.reserve(64);
+  data.reserve(64);
+
+  const long before = liveBlocks;
+
+  chain(response, data, scratch);
+  CHECK(toString(data) == "[[WARM]]");
+  CHECK(liveBlocks == before);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testSlice();
+  testSharing();
+  testPrependTrim();
+  testHandlerChain();
+  return test::result();
+}
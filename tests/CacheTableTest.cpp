@@ -0,0 +1,95 @@
+/**
+ * \file   CacheTableTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Mon May 28 10:12:40 2012
+ *
+ * \brief  ModCache admission: insert() and admissible().
+ *
+ */
+
+/*
+  Les entrées plus grandes que la fenêtre passent directement en
+  probation : une entrée moins demandée que la victime est refusée par
+  insert() comme par admissible(), et ModCache laisse alors le fichier
+  à ModStatic.
+*/
+
+#include "Check.h"
+
+#include "CacheTable.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::size_t ShardCapacity = 100000;       // fenêtre 1000, principale 99000
+const std::size_t BodySize      = 40000;        // deux par part
+
+/*
+  Des chemins qui tombent dans la même part (voir CacheTable::shard()).
+*/
+std::vector<std::string> sameShard(std::size_t count)
+{
+  std::vector<std::string> paths;
+  uint64_t                 wanted = 0;
+
+  for (unsigned i = 0; paths.size() < count; ++i)
+    {
+      const std::string path  = "/www/file" + std::to_string(i);
+      const uint64_t    shard = (std::hash<std::string>()(path) * 0x9e3779b97f4a7c15ull) >> 60;
+
+      if (paths.empty())
+        wanted = shard;
+      if (shard == wanted)
+        paths.push_back(path);
+    }
+  return paths;
+}
+
+CacheTable::EntryPtr entry(const std::string & path)
+{
+  std::shared_ptr<CacheEntry> result = std::make_shared<CacheEntry>();
+
+  result->path = path;
+  result->body.resize(BodySize);
+  return result;
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  CacheTable                     table(CacheTable::ShardCount * ShardCapacity);
+  const std::vector<std::string> paths = sameShard(3);
+
+  // de la place : admis
+  for (int i = 0; i < 2; ++i)
+    {
+      CHECK(table.admissible(paths[i], BodySize));
+      CHECK(table.insert(entry(paths[i]), table.generation()));
+    }
+  CHECK(table.find(paths[0]) && table.find(paths[1]));
+
+  // moins demandé que la victime : refusé, avant comme après lecture
+  CHECK(! table.admissible(paths[2], BodySize));
+  CHECK(! table.insert(entry(paths[2]), table.generation()));
+  CHECK(! table.find(paths[2]));
+  CHECK(table.find(paths[0]) && table.find(paths[1]));
+
+  // demandé plus souvent que la victime : admis à sa place
+  for (int i = 0; i < 5; ++i)
+    table.find(paths[2]);
+  CHECK(table.admissible(paths[2], BodySize));
+  CHECK(table.insert(entry(paths[2]), table.generation()));
+  CHECK(table.find(paths[2]));
+
+  // trop grand, ou lu avant une invalidation
+  const uint64_t generation = table.generation();
+
+  CHECK(! table.admissible("/www/big", ShardCapacity));
+  table.erase(paths[0]);
+  CHECK(! table.insert(entry(paths[0]), generation));
+  return test::result();
+}
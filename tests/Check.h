@@ -0,0 +1,48 @@
+/**
+ * \file   Check.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 24 14:05:37 2012
+ *
+ * \brief  Assertions of the tests.
+ *
+ */
+
+#ifndef BREF_API_TESTS_CHECK_H_
+#define BREF_API_TESTS_CHECK_H_
+
+#include <cstdio>
+
+/*
+  Une vérification qui échoue est affichée et comptée, le test continue.
+  main() retourne test::result().
+*/
+namespace test {
+
+  inline int & failures()
+  {
+    static int count = 0;
+
+    return count;
+  }
+
+  inline int result()
+  {
+    if (failures())
+      std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return failures() ? 1 : 0;
+  }
+
+} // ! namespace test
+
+#define CHECK(condition)                                                \
+  do                                                                    \
+    {                                                                   \
+      if (! (condition))                                                \
+        {                                                               \
+          std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+          ++test::failures();                                           \
+        }                                                               \
+    }                                                                   \
+  while (0)
+
+#endif /* !BREF_API_TESTS_CHECK_H_ */
@@ -0,0 +1,232 @@
+/**
+ * \file   CompiledConfHelperTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri Jun  1 17:26:44 2012
+ *
+ * \brief  CompiledConfHelper virtual host matching, cache of the last
+ *         match and KeyHandle lookups.
+ *
+ */
+
+/*
+  La configuration a deux hôtes virtuels, "example.com" (avec les alias
+  "www.example.com" et "*.example.org") et "[::1]". La clé Name donne
+  l'hôte qui a répondu, "global" pour les valeurs globales.
+*/
+
+#include "Check.h"
+
+#include "bref/CompiledConfHelper.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+bref::BrefValue makeConfig(const std::string & suffix = "")
+{
+  bref::BrefValue config;
+
+  config["Name"]         = bref::BrefValue("global" + suffix);
+  config["DocumentRoot"] = bref::BrefValue("/var/www");
+  config["Timeout"]      = bref::BrefValue(30);
+
+  bref::BrefValue & example = config["VirtualHosts"]["Example.com"];
+
+  example["Name"]         = bref::BrefValue("example" + suffix);
+  example["DocumentRoot"] = bref::BrefValue("/srv/example");
+  example["Aliases"].push(bref::BrefValue("www.example.com"));
+  example["Aliases"].push(bref::BrefValue("*.Example.org"));
+
+  config["VirtualHosts"]["[::1]"]["Name"] = bref::BrefValue("local" + suffix);
+  return config;
+}
+
+std::string nameFor(const bref::CompiledConfHelper & helper, const std::string & host)
+{
+  bref::HttpRequest request;
+
+  request["Host"] = bref::BrefValue(host);
+  return helper.findValue("Name", request).asString();
+}
+
+/*
+  Le port, les crochets d'une adresse IPv6, le point final et la casse
+  du champ Host (et des noms de la configuration) sont ignorés.
+*/
+void testNormalizeHost()
+{
+  const bref::CompiledConfHelper helper(makeConfig());
+
+  CHECK(nameFor(helper, "example.com") == "example");
+  CHECK(nameFor(helper, "EXAMPLE.Com") == "example");
+  CHECK(nameFor(helper, "example.com:8080") == "example");
+  CHECK(nameFor(helper, "example.com.") == "example");
+  CHECK(nameFor(helper, "Example.COM.:80") == "example");
+  CHECK(nameFor(helper, "[::1]") == "local");
+  CHECK(nameFor(helper, "[::1]:8080") == "local");
+  CHECK(nameFor(helper, "::1") == "global");
+  CHECK(nameFor(helper, "example.com.evil") == "global");
+  CHECK(nameFor(helper, "") == "global");
+
+  // sans champ Host : les valeurs globales
+  bref::HttpRequest request;
+
+  CHECK(helper.findValue("Name", request).asString() == "global");
+  CHECK(&helper.virtualHost(request) == &helper.globalValues());
+}
+
+void testAliases()
+{
+  const bref::CompiledConfHelper helper(makeConfig());
+
+  CHECK(nameFor(helper, "www.example.com") == "example");
+  CHECK(nameFor(helper, "WWW.example.com:443") == "example");
+  // "*.example.org" : les sous-domaines, à toute profondeur
+  CHECK(nameFor(helper, "www.example.org") == "example");
+  CHECK(nameFor(helper, "a.b.example.org") == "example");
+  CHECK(nameFor(helper, "example.org") == "global");
+  CHECK(nameFor(helper, "other.example.com") == "global");
+  CHECK(nameFor(helper, "wwwexample.org") == "global");
+
+  // les clés absentes de l'hôte viennent des valeurs globales
+  bref::HttpRequest request;
+
+  request["Host"] = bref::BrefValue("www.example.org");
+  CHECK(helper.findValue("DocumentRoot", request).asString() == "/srv/example");
+  CHECK(helper.findValue("Timeout", request).asInt() == 30);
+  CHECK(helper.findValue("Missing", request).isNull());
+  CHECK(helper.virtualHost(request).name() == "Example.com");
+}
+
+/*
+  Le dernier résultat est gardé par le thread pour une requête, un
+  champ Host et un helper : un changement de l'un des trois refait la
+  recherche.
+*/
+void testMatchCache()
+{
+  const bref::CompiledConfHelper helper(makeConfig());
+  const bref::CompiledConfHelper other(makeConfig("-other"));
+  bref::HttpRequest              first;
+  bref::HttpRequest              second;
+
+  first["Host"]  = bref::BrefValue("example.com");
+  second["Host"] = bref::BrefValue("[::1]");
+
+  const bref::CompiledConfHelper::VirtualHost & matched = helper.virtualHost(first);
+
+  CHECK(&helper.virtualHost(first) == &matched);
+  CHECK(helper.findValue("Name", first).asString() == "example");
+
+  // une autre requête, puis la première
+  CHECK(helper.findValue("Name", second).asString() == "local");
+  CHECK(helper.findValue("Name", first).asString() == "example");
+
+  // un autre helper pour la même requête
+  CHECK(other.findValue("Name", first).asString() == "example-other");
+  CHECK(helper.findValue("Name", first).asString() == "example");
+
+  // le champ Host change dans la même requête
+  first["Host"] = bref::BrefValue("unknown.net");
+  CHECK(helper.findValue("Name", first).asString() == "global");
+  first["Host"] = bref::BrefValue("[::1]:80");
+  CHECK(helper.findValue("Name", first).asString() == "local");
+  first.erase("Host");
+  CHECK(helper.findValue("Name", first).asString() == "global");
+
+  // un helper détruit puis un autre, peut-être à la même adresse
+  second["Host"] = bref::BrefValue("example.com");
+  {
+    const bref::CompiledConfHelper reloaded(makeConfig("-1"));
+
+    CHECK(reloaded.findValue("Name", second).asString() == "example-1");
+  }
+  {
+    const bref::CompiledConfHelper reloaded(makeConfig("-2"));
+
+    CHECK(reloaded.findValue("Name", second).asString() == "example-2");
+  }
+
+  // le cache d'un autre thread n'est pas partagé
+  std::string fromThread;
+
+  second["Host"] = bref::BrefValue("www.example.com");
+  CHECK(helper.findValue("Name", second).asString() == "example");
+  std::thread([&] {
+      bref::HttpRequest request;
+
+      request["Host"] = bref::BrefValue("[::1]");
+      fromThread = helper.findValue("Name", request).asString();
+    }).join();
+  CHECK(fromThread == "local");
+  CHECK(helper.findValue("Name", second).asString() == "example");
+}
+
+/*
+  Un handle donné par un helper d'un autre KeyRegistry est recherché
+  par son nom : son index est celui d'une autre clé.
+*/
+void testKeyHandles()
+{
+  const bref::CompiledConfHelper helper(makeConfig());
+  bref::HttpRequest              request;
+
+  request["Host"] = bref::BrefValue("www.example.com");
+
+  const bref::KeyHandle root = helper.internKey("DocumentRoot");
+
+  CHECK(root.registry() == helper.keys().get());
+  CHECK(helper.findValue(root).asString() == "/var/www");
+  CHECK(helper.findValue(root, request).asString() == "/srv/example");
+
+  // un KeyHandle sans index
+  CHECK(helper.findValue(bref::KeyHandle("Timeout"), request).asInt() == 30);
+
+  // le registre partagé avec la configuration suivante
+  const bref::CompiledConfHelper next(makeConfig("-next"), helper.keys());
+
+  CHECK(next.findValue(root, request).asString() == "/srv/example");
+  CHECK(next.findValue(helper.internKey("Name"), request).asString() == "example-next");
+
+  // une clé internée après la compilation : pas de slot
+  const bref::KeyHandle late = helper.internKey("Late");
+
+  CHECK(helper.findValue(late).isNull());
+  CHECK(helper.findValue(late, request).isNull());
+
+  // un autre registre, internées dans un autre ordre
+  bref::BrefValue other;
+
+  other["Timeout"]      = bref::BrefValue(5);
+  other["Name"]         = bref::BrefValue("foreign");
+  other["DocumentRoot"] = bref::BrefValue("/foreign");
+
+  const std::shared_ptr<bref::CompiledConfHelper::KeyRegistry> keys =
+    std::make_shared<bref::CompiledConfHelper::KeyRegistry>();
+
+  keys->intern("Timeout");
+  keys->intern("Name");
+  keys->intern("DocumentRoot");
+
+  const bref::CompiledConfHelper foreign(other, keys);
+  const bref::KeyHandle          timeout = foreign.internKey("Timeout");
+
+  CHECK(root.index() != foreign.internKey("DocumentRoot").index());
+  CHECK(foreign.findValue(root).asString() == "/foreign");
+  CHECK(foreign.findValue(root, request).asString() == "/foreign");
+  CHECK(helper.findValue(timeout).asInt() == 30);
+  CHECK(helper.findValue(timeout, request).asInt() == 30);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testNormalizeHost();
+  testAliases();
+  testMatchCache();
+  testKeyHandles();
+  return test::result();
+}
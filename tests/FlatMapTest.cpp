@@ -0,0 +1,175 @@
+/**
+ * \file   FlatMapTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 14:08:52 2012
+ *
+ * \brief  util::FlatMap tests, against std::map.
+ *
+ */
+
+#include "Check.h"
+
+#include "bref/BrefValue.h"
+#include "bref/detail/util/FlatMap.hpp"
+
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef bref::util::FlatMap<int, int> Map;
+typedef std::map<int, int>            Reference;
+
+bool same(const Map & map, const Reference & reference)
+{
+  if (map.size() != reference.size())
+    return false;
+
+  Reference::const_iterator expected = reference.begin();
+
+  for (Map::const_iterator it = map.begin(); it != map.end(); ++it, ++expected)
+    if (it->first != expected->first || it->second != expected->second)
+      return false;
+  return true;
+}
+
+/*
+  Opérations tirées au hasard sur une FlatMap et une std::map, les deux
+  doivent rester identiques.
+*/
+void testAgainstMap()
+{
+  Map       map;
+  Reference reference;
+
+  std::srand(42);
+  for (int i = 0; i < 20000; ++i)
+    {
+      const int key   = std::rand() % 500;
+      const int value = std::rand();
+
+      switch (std::rand() % 6)
+        {
+        case 0:
+          map[key] = value;
+          reference[key] = value;
+          break;
+        case 1:
+          CHECK(map.insert(Map::value_type(key, value)).second
+                == reference.insert(Reference::value_type(key, value)).second);
+          break;
+        case 2:
+          CHECK(map.erase(key) == reference.erase(key));
+          break;
+        case 3:
+          CHECK(map.count(key) == reference.count(key));
+          CHECK((map.find(key) == map.end()) == (reference.find(key) == reference.end()));
+          break;
+        case 4:
+          {
+            const Map::const_iterator       lower = map.lower_bound(key);
+            const Reference::const_iterator other = reference.lower_bound(key);
+
+            CHECK((lower == map.end()) == (other == reference.end()));
+            if (lower != map.end() && other != reference.end())
+              CHECK(lower->first == other->first);
+            CHECK((map.upper_bound(key) == map.end()) == (reference.upper_bound(key) == reference.end()));
+            break;
+          }
+        default:
+          {
+            // insertion d'un lot : le premier élément de chaque clé est
+            // gardé, comme std::map::insert(first, last)
+            std::vector<Map::value_type> values;
+
+            for (int n = std::rand() % 20; n > 0; --n)
+              values.push_back(Map::value_type(std::rand() % 500, std::rand()));
+            map.insert(values.begin(), values.end());
+            reference.insert(values.begin(), values.end());
+            break;
+          }
+        }
+    }
+  CHECK(same(map, reference));
+}
+
+/*
+  insert(first, last) ne trie pas un lot en ordre croissant qui suit
+  les clés existantes ; il trie sinon, doublons compris.
+*/
+void testRangeInsert()
+{
+  Map       map;
+  Reference reference;
+
+  const Map::value_type after[]    = { Map::value_type(10, 1), Map::value_type(20, 2), Map::value_type(30, 3) };
+  const Map::value_type between[]  = { Map::value_type(5, 4), Map::value_type(15, 5), Map::value_type(40, 6) };
+  const Map::value_type repeated[] = { Map::value_type(50, 7), Map::value_type(50, 8), Map::value_type(60, 9) };
+
+  map.insert(after, after + 3);
+  reference.insert(after, after + 3);
+  CHECK(same(map, reference));
+  map.insert(between, between + 3);
+  reference.insert(between, between + 3);
+  CHECK(same(map, reference));
+  map.insert(repeated, repeated + 3);
+  reference.insert(repeated, repeated + 3);
+  CHECK(same(map, reference));
+  CHECK(map.find(50)->second == 7);
+
+  // des éléments déplacés, pas copiés
+  std::vector<bref::BrefValueArray::value_type> values;
+
+  values.push_back(bref::BrefValueArray::value_type("b", bref::BrefValue(std::string(100, 'b'))));
+  values.push_back(bref::BrefValueArray::value_type("a", bref::BrefValue(std::string(100, 'a'))));
+
+  const char          *storage = values[0].second.asString().data();
+  bref::BrefValueArray array(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+
+  CHECK(array.size() == 2 && array.begin()->first == "a");
+  CHECK(array.find("b")->second.asString().data() == storage);
+}
+
+void testBrefValueArray()
+{
+  bref::BrefValueArray array;
+
+  array["b"] = bref::BrefValue(1);
+  array["a"] = bref::BrefValue(2);
+  array["c"] = bref::BrefValue(3);
+  array["b"] = bref::BrefValue(4);
+  CHECK(array.size() == 3);
+  CHECK(array.begin()->first == "a");
+  CHECK(array.find("b")->second.asInt() == 4);
+  CHECK(array.count("z") == 0);
+  CHECK(array.insert(bref::BrefValueArray::value_type("b", bref::BrefValue(9))).second == false);
+  CHECK(array.lower_bound("bb")->first == "c");
+  CHECK(array.upper_bound("b")->first == "c");
+  CHECK(array.erase("a") == 1 && array.erase("a") == 0 && array.size() == 2);
+
+  // un élément de la liste peut être ajouté à la même liste
+  bref::BrefValue value;
+
+  value["x"]["z"].push(bref::BrefValue("s"));
+  for (int i = 0; i < 100; ++i)
+    value["x"]["z"].push(value["x"]["z"].asList().front());
+  CHECK(value["x"]["z"].asList().size() == 101);
+  CHECK(value["x"]["z"].asList().back().asString() == "s");
+
+  const bref::BrefValue copy(value);
+
+  CHECK(copy.hasKey("x") && copy.asArray().find("x")->second.asArray().size() == 1);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testAgainstMap();
+  testRangeInsert();
+  testBrefValueArray();
+  return test::result();
+}
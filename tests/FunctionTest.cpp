@@ -0,0 +1,225 @@
+/**
+ * \file   FunctionTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 17:12:30 2012
+ *
+ * \brief  Function inline storage, copies and destruction.
+ *
+ */
+
+/*
+  Les allocations sont comptées en remplaçant operator new : les
+  pointeurs de membre liés et les petits foncteurs doivent être rangés
+  dans le Function, sans allocation, copies et swap compris.
+*/
+
+#include "Check.h"
+
+#include "bref/Function.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+int allocations = 0;
+int live        = 0;
+
+struct Car
+{
+  int id;
+
+  int go(int x) { return id + x; }
+  int constGo(int x) const { return id * x; }
+};
+
+struct Small
+{
+  int a;
+
+  int operator()(int x) { return a + x; }
+};
+
+struct Big
+{
+  char pad[100];
+  int  a;
+
+  int operator()(int x) { return a - x; }
+};
+
+/*
+  Compte ses instances, pour vérifier que chaque cible est détruite.
+*/
+struct Counted
+{
+  int value;
+
+  Counted(int v) : value(v) { ++live; }
+  Counted(const Counted & other) : value(other.value) { ++live; }
+  ~Counted() { --live; }
+
+  int operator()(int x) { return value * x; }
+};
+
+#ifdef BREF_CXX11
+int copies = 0;
+int moves  = 0;
+
+/*
+  Compte ses copies et déplacements.
+*/
+struct Movable
+{
+  int value;
+
+  Movable(int v) : value(v) { }
+  Movable(const Movable & other) noexcept : value(other.value) { ++copies; }
+  Movable(Movable && other) noexcept : value(other.value) { ++moves; }
+
+  int operator()(int x) { return value + x; }
+};
+#endif  // BREF_CXX11
+
+int twice(int x)
+{
+  return 2 * x;
+}
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  ++allocations;
+
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) throw()
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) throw()
+{
+  std::free(p);
+}
+
+int main()
+{
+  typedef bref::Function<int (int)> Fn;
+
+  Car car;
+
+  car.id = 10;
+
+  // cibles rangées dans le Function
+  {
+    const int before = allocations;
+    Small     small  = { 3 };
+    Fn        bound(&car, &Car::go);
+    Fn        constBound(static_cast<const Car *>(&car), &Car::constGo);
+    Fn        functor(small);
+    Fn        pointer(&twice);
+    Fn        copy(bound);
+
+    copy.swap(functor);
+    CHECK(bound(1) == 11);
+    CHECK(constBound(2) == 20);
+    CHECK(functor(5) == 15);
+    CHECK(copy(5) == 8);
+    CHECK(pointer(4) == 8);
+    functor = constBound;
+    CHECK(functor(3) == 30);
+    CHECK(allocations == before);
+  }
+
+  // un gros foncteur est alloué, une seule fois
+  {
+    Big big;
+
+    big.a = 50;
+
+    const int before = allocations;
+    Fn        onHeap(big);
+    Fn        bound(&car, &Car::go);
+
+    CHECK(allocations == before + 1);
+    onHeap.swap(bound);
+    CHECK(onHeap(1) == 11 && bound(1) == 49);
+    CHECK(allocations == before + 1);
+  }
+
+  // clear() et empty()
+  {
+    Fn bound(&car, &Car::go);
+
+    CHECK(! bound.empty());
+    bound.clear();
+    CHECK(bound.empty());
+    CHECK(Fn().empty());
+
+    bool thrown = false;
+
+    try
+      {
+        bound(1);
+      }
+    catch (const bref::BadFunctionCallException &)
+      {
+        thrown = true;
+      }
+    CHECK(thrown);
+  }
+
+  // chaque copie de la cible est détruite, en place ou sur le tas
+  {
+    Big big;
+
+    big.a = 1;
+
+    Fn onHeap(big);
+
+    {
+      Fn counted((Counted(2)));
+      Fn copy(counted);
+
+      copy.swap(onHeap);
+      counted = copy;
+      CHECK(counted(4) == -3 && onHeap(4) == 8);
+      counted.clear();
+    }
+    CHECK(live == 1);
+  }
+  CHECK(live == 0);
+
+#ifdef BREF_CXX11
+  // en C++11 une cible en place est copiée une fois à la construction
+  // (Function(const F &)), puis déplacée, sauf par la copie du Function
+  {
+    const int before = allocations;
+    Fn        first((Movable(1)));
+
+    CHECK(copies == 1);
+
+    Fn second(std::move(first));
+    Fn third(&twice);
+
+    second.swap(third);
+    CHECK(second(1) == 2 && third(1) == 2);
+    second = std::move(third);
+    CHECK(first.empty() && third.empty() && second(5) == 6);
+    CHECK(copies == 1 && moves > 0);
+
+    Fn copy(second);
+
+    CHECK(copies == 2 && copy(2) == 3);
+    CHECK(allocations == before);
+  }
+#endif  // BREF_CXX11
+  return test::result();
+}
@@ -0,0 +1,358 @@
+/**
+ * \file   HookProfilerTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 29 16:48:25 2012
+ *
+ * \brief  HookProfiler counts, null rates and allocations.
+ *
+ */
+
+/*
+  Un module de test enregistre un hook post-parsing et un hook de
+  contenu qui retournent un handler vide une fois sur quatre (resp.
+  deux). Les compteurs du profiler doivent correspondre aux appels, et
+  une fois les premiers tours passés l'emballage des handlers ne doit plus
+  allouer : operator new est compté.
+*/
+
+#include "Check.h"
+
+#include "bref/ConfigSnapshot.h"
+#include "bref/HookProfiler.h"
+#include "bref/HttpRequest.h"
+#include "bref/HttpResponse.h"
+
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+
+unsigned long allocations = 0;
+
+} // ! unnamed namespace
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+  ++allocations;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace {
+
+const int Requests = 100;
+
+struct CountCalls
+{
+  int *calls;
+
+  void operator()(bref::HttpResponse &) const
+  {
+    ++*calls;
+  }
+};
+
+class ContentHandler : public bref::Pipeline::IContentRequestHandler
+{
+public:
+  int *disposed;
+
+  virtual bool inContent(bref::HttpResponse &, const bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual bool outContent(bref::HttpResponse &, bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual void dispose()
+  {
+    ++*disposed;
+  }
+};
+
+class TestModule : public bref::AModule
+{
+private:
+  int            postParsingCalls_;
+  int            contentCalls_;
+  ContentHandler content_;
+
+public:
+  int handlerCalls;
+  int disposed;
+
+  TestModule()
+    : AModule("mod_test", "Test module.", bref::Version(0, 1), bref::Version(0, 4))
+    , postParsingCalls_(0), contentCalls_(0), content_(), handlerCalls(0), disposed(0)
+  {
+    content_.disposed = &disposed;
+  }
+
+  virtual void dispose()
+  { }
+
+  virtual void registerHooks(bref::Pipeline & pipeline)
+  {
+    bref::Pipeline::PostParsingHook postParsing(this, &TestModule::postParsingHook);
+    bref::Pipeline::ContentHook     content(this, &TestModule::contentHook);
+
+    pipeline.postParsingHooks.push_back(std::make_pair(postParsing, 1.f));
+    pipeline.contentHooks.push_back(std::make_pair(content, 1.f));
+  }
+
+  bref::Pipeline::PostParsingRequestHandler
+  postParsingHook(const bref::Environment &, bref::HttpRequest &, bref::HttpResponse &)
+  {
+    if (postParsingCalls_++ % 4 == 0)
+      return bref::Pipeline::PostParsingRequestHandler();
+
+    CountCalls handler = { &handlerCalls };
+
+    return bref::Pipeline::PostParsingRequestHandler(handler);
+  }
+
+  bref::Pipeline::IContentRequestHandler *
+  contentHook(const bref::Environment &, const bref::HttpRequest &, bref::HttpResponse &, bref::FdType &)
+  {
+    if (contentCalls_++ % 2 == 0)
+      return 0;
+    return &content_;
+  }
+};
+
+struct Fixture
+{
+  bref::ConfigHolder::Pin   snapshot;
+  bref::Environment::Client client;
+  bref::Environment         environment;
+  bref::HttpRequest         request;
+  bref::HttpResponse        response;
+  bref::Buffer              buffer;
+
+  Fixture()
+    : snapshot(bref::ConfigSnapshot::create(bref::BrefValue(bref::BrefValueArray())))
+    , client()
+    , environment(snapshot->config, snapshot->helper, 0, client)
+    , request(), response(), buffer()
+  { }
+
+  /*
+    Un appel du hook post-parsing et deux de son handler ; un appel du
+    hook de contenu, de outContent() et dispose().
+  */
+  void run(bref::Pipeline & pipeline)
+  {
+    {
+      const bref::Pipeline::PostParsingRequestHandler handler =
+        pipeline.postParsingHooks.front().first(environment, request, response);
+
+      if (handler)
+        {
+          handler(response);
+          handler(response);
+        }
+    }
+
+    bref::FdType                            fd      = -1;
+    bref::Pipeline::IContentRequestHandler *content =
+      pipeline.contentHooks.front().first(environment, request, response, fd);
+
+    if (content)
+      {
+        content->outContent(response, buffer);
+        content->dispose();
+      }
+  }
+};
+
+const bref::HookProfiler::HookStats *find(const std::vector<bref::HookProfiler::HookStats> & all,
+                                          bref::HookProfiler::HookPoint point)
+{
+  for (std::size_t i = 0; i < all.size(); ++i)
+    if (all[i].point == point)
+      return &all[i];
+  return 0;
+}
+
+void testCounts()
+{
+  bref::HookProfiler profiler;
+  bref::Pipeline     pipeline;
+  TestModule         module;
+  Fixture            fixture;
+
+  profiler.registerHooks(module, pipeline);
+  CHECK(pipeline.postParsingHooks.size() == 1 && pipeline.contentHooks.size() == 1);
+
+  // les deux premiers tours remplissent les listes libres du thread
+  fixture.run(pipeline);
+  fixture.run(pipeline);
+  profiler.reset();
+  module.handlerCalls = 0;
+  module.disposed     = 0;
+
+  const unsigned long before = allocations;
+
+  for (int i = 0; i < Requests; ++i)
+    fixture.run(pipeline);
+  CHECK(allocations == before);
+
+  std::vector<bref::HookProfiler::HookStats> all = profiler.stats();
+
+  CHECK(all.size() == 2);
+
+  const bref::HookProfiler::HookStats *postParsing = find(all, bref::HookProfiler::PostParsingPoint);
+  const bref::HookProfiler::HookStats *content     = find(all, bref::HookProfiler::ContentPoint);
+
+  CHECK(postParsing && content);
+  if (! postParsing || ! content)
+    return;
+
+  // les appels 2 à 101 de chaque hook
+  CHECK(postParsing->module == "mod_test");
+  CHECK(postParsing->calls == Requests);
+  CHECK(postParsing->nulls == Requests / 4);
+  CHECK(postParsing->nullRate() == 0.25);
+  CHECK(postParsing->hookLatency.count() == Requests);
+  CHECK(postParsing->handlerLatency.count() == 2 * (Requests - Requests / 4));
+  CHECK(module.handlerCalls == 2 * (Requests - Requests / 4));
+
+  CHECK(content->calls == Requests);
+  CHECK(content->nulls == Requests / 2);
+  CHECK(content->nullRate() == 0.5);
+  CHECK(content->handlerLatency.count() == Requests / 2);
+  CHECK(module.disposed == Requests / 2);
+
+  CHECK(profiler.report().find("mod_test") != std::string::npos);
+}
+
+/*
+  Les handlers de contenu appelés plusieurs fois, chaque appel est
+  chronométré.
+*/
+void testNullRates()
+{
+  bref::HookProfiler profiler;
+  bref::Pipeline     pipeline;
+  TestModule         module;
+  Fixture            fixture;
+
+  profiler.registerHooks(module, pipeline);
+  for (int i = 0; i < Requests; ++i)
+    {
+      const bref::Pipeline::PostParsingRequestHandler handler =
+        pipeline.postParsingHooks.front().first(fixture.environment, fixture.request, fixture.response);
+
+      if (handler)
+        handler(fixture.response);
+    }
+  for (int i = 0; i < Requests; ++i)
+    {
+      bref::FdType                            fd      = -1;
+      bref::Pipeline::IContentRequestHandler *content =
+        pipeline.contentHooks.front().first(fixture.environment, fixture.request, fixture.response, fd);
+
+      if (content)
+        {
+          content->inContent(fixture.response, fixture.buffer);
+          content->outContent(fixture.response, fixture.buffer);
+          content->dispose();
+        }
+    }
+
+  std::vector<bref::HookProfiler::HookStats> all         = profiler.stats();
+  const bref::HookProfiler::HookStats       *postParsing = find(all, bref::HookProfiler::PostParsingPoint);
+  const bref::HookProfiler::HookStats       *content     = find(all, bref::HookProfiler::ContentPoint);
+
+  CHECK(postParsing && content);
+  if (! postParsing || ! content)
+    return;
+  CHECK(postParsing->calls == Requests);
+  CHECK(postParsing->nulls == Requests / 4);
+  CHECK(postParsing->nullRate() == 0.25);
+  CHECK(postParsing->handlerLatency.count() == Requests - Requests / 4);
+  CHECK(content->calls == Requests);
+  CHECK(content->nulls == Requests / 2);
+  CHECK(content->handlerLatency.count() == Requests);
+  CHECK(module.disposed == Requests / 2);
+}
+
+/*
+  Désactivé, le profiler ne compte rien mais les hooks et les handlers
+  sont appelés.
+*/
+void testDisabled()
+{
+  bref::HookProfiler profiler;
+  bref::Pipeline     pipeline;
+  TestModule         module;
+  Fixture            fixture;
+
+  profiler.registerHooks(module, pipeline);
+  profiler.setEnabled(false);
+  CHECK(! profiler.enabled());
+  for (int i = 0; i < Requests; ++i)
+    fixture.run(pipeline);
+  CHECK(module.handlerCalls == 2 * (Requests - Requests / 4));
+
+  std::vector<bref::HookProfiler::HookStats> all = profiler.stats();
+
+  for (std::size_t i = 0; i < all.size(); ++i)
+    CHECK(all[i].calls == 0 && all[i].nulls == 0 && all[i].handlerLatency.count() == 0);
+
+  // un handler créé activé n'est plus chronométré une fois le profiler
+  // désactivé
+  profiler.setEnabled(true);
+
+  bref::Pipeline::PostParsingRequestHandler handler;
+
+  while (! handler)
+    handler = pipeline.postParsingHooks.front().first(fixture.environment, fixture.request, fixture.response);
+  profiler.setEnabled(false);
+  handler(fixture.response);
+  all = profiler.stats();
+  CHECK(find(all, bref::HookProfiler::PostParsingPoint)->handlerLatency.count() == 0);
+  CHECK(find(all, bref::HookProfiler::PostParsingPoint)->calls > 0);
+}
+
+void testHistogram()
+{
+  typedef bref::HookProfiler::Histogram Histogram;
+
+  for (uint64_t value = 0; value < 100000; value = value * 5 / 4 + 1)
+    {
+      const std::size_t index = Histogram::bucketIndex(value);
+
+      CHECK(index < Histogram::BucketCount);
+      CHECK(Histogram::bucketUpperBound(index) >= value);
+      CHECK(index == 0 || Histogram::bucketUpperBound(index - 1) < value);
+    }
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testCounts();
+  testNullRates();
+  testDisabled();
+  testHistogram();
+  return test::result();
+}
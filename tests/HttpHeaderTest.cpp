@@ -0,0 +1,256 @@
+/**
+ * \file   HttpHeaderTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Tue May 29 14:36:08 2012
+ *
+ * \brief  HttpHeader lookups, insertions, removals and reuse of the
+ *         fields.
+ *
+ */
+
+#include "Check.h"
+
+#include "bref/HttpHeader.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+namespace fields = bref::header_fields;
+
+void testLookup()
+{
+  bref::HttpHeader header;
+
+  header["content-length"] = bref::BrefValue(42);
+  header["X-Custom"]       = bref::BrefValue("a");
+
+  // les noms ne dépendent pas de la casse, les champs connus sont
+  // identifiés à l'insertion
+  CHECK(header.size() == 2);
+  CHECK(header.find("Content-Length") == header.begin());
+  CHECK(header.find("CONTENT-LENGTH") == header.begin());
+  CHECK(header.find(fields::ContentLength) == header.begin());
+  CHECK(header.field(header.begin()) == fields::ContentLength);
+  CHECK(header.find("x-custom") != header.end());
+  CHECK(header.field(header.find("x-custom")) == fields::UnknownHeaderField);
+  CHECK(header.count("X-CUSTOM") == 1);
+  CHECK(header.count("X-Other") == 0);
+  CHECK(header.count(fields::Host) == 0);
+  CHECK(header.find(fields::Host) == header.end());
+  CHECK(header.find(fields::UnknownHeaderField) == header.end());
+
+  // même taille et même début : seul le nom complet compte
+  CHECK(header.find("X-Custon") == header.end());
+  CHECK(header.find("X-Custom ") == header.end());
+
+  // le nom inséré en premier est gardé
+  header["X-CUSTOM"] = bref::BrefValue("b");
+  CHECK(header.size() == 2);
+  CHECK(header.find("x-custom")->first == "X-Custom");
+  CHECK(header.find("x-custom")->second.asString() == "b");
+}
+
+void testWellKnown()
+{
+  bref::HttpHeader header;
+
+  // inséré avec le nom canonique
+  header[fields::ContentType] = bref::BrefValue("text/plain");
+  CHECK(header.size() == 1);
+  CHECK(header.begin()->first == "Content-Type");
+  CHECK(header["content-type"].asString() == "text/plain");
+  CHECK(header.size() == 1);
+
+  // un champ inséré par son nom est trouvé par son type
+  header["host"] = bref::BrefValue("example.com");
+  CHECK(header[fields::Host].asString() == "example.com");
+  CHECK(header.size() == 2);
+
+  bool thrown = false;
+
+  try
+    {
+      header[fields::UnknownHeaderField];
+    }
+  catch (const std::invalid_argument &)
+    {
+      thrown = true;
+    }
+  CHECK(thrown);
+
+  thrown = false;
+  try
+    {
+      header[fields::HeaderFieldCount];
+    }
+  catch (const std::invalid_argument &)
+    {
+      thrown = true;
+    }
+  CHECK(thrown);
+  CHECK(header.size() == 2);
+}
+
+void testInsert()
+{
+  bref::HttpHeader header;
+
+  std::pair<bref::HttpHeader::iterator, bool> result =
+    header.insert(bref::HttpHeader::value_type("Accept", bref::BrefValue("*/*")));
+
+  CHECK(result.second && result.first->first == "Accept");
+
+  result = header.insert(bref::HttpHeader::value_type("ACCEPT", bref::BrefValue("text/html")));
+  CHECK(! result.second && result.first == header.begin());
+  CHECK(header.begin()->second.asString() == "*/*");
+}
+
+void testAdd()
+{
+  bref::HttpHeader header;
+  const char       name[] = "Accept-Encoding";
+
+  bref::HttpHeader::iterator it = header.add(name, sizeof name - 1, "gzip", 4);
+
+  CHECK(it->first == "Accept-Encoding" && it->second.asString() == "gzip");
+  CHECK(header.field(it) == fields::AcceptEncoding);
+
+  // un champ répété est joint par des virgules (RFC2616, 4.2)
+  header.add("accept-encoding", 15, "br", 2);
+  CHECK(header.size() == 1);
+  CHECK(header[fields::AcceptEncoding].asString() == "gzip, br");
+
+  // sauf Cookie, joint par "; " (RFC6265, 5.4)
+  header.add("Cookie", 6, "a=1", 3);
+  header.add("COOKIE", 6, "b=2", 3);
+  CHECK(header[fields::Cookie].asString() == "a=1; b=2");
+
+  // une valeur qui n'est pas une chaîne est remplacée
+  header["X-Int"] = bref::BrefValue(1);
+  header.add("X-Int", 5, "2", 1);
+  CHECK(header["X-Int"].asString() == "2");
+
+  // les octets après la taille sont ignorés
+  header.add("X-TruncatedGarbage", 11, "valueGarbage", 5);
+  CHECK(header.count("X-Truncated") == 1);
+  CHECK(header["X-Truncated"].asString() == "value");
+}
+
+/*
+  erase() décale les champs suivants par des swap : le champ retiré
+  passe après size() et garde sa mémoire pour la prochaine insertion.
+*/
+void testErase()
+{
+  bref::HttpHeader  header;
+  const std::string long1(100, 'a');
+
+  header["Host"]      = bref::BrefValue("example.com");
+  header["X-Long"]    = bref::BrefValue(long1);
+  header["Accept"]    = bref::BrefValue("*/*");
+  header["X-Another"] = bref::BrefValue("x");
+
+  const char *storage = header["X-Long"].asString().data();
+
+  CHECK(header.erase("x-long") == 1);
+  CHECK(header.erase("x-long") == 0);
+  CHECK(header.size() == 3);
+
+  // l'ordre des autres champs est conservé, leurs types suivent
+  bref::HttpHeader::const_iterator it = header.begin();
+
+  CHECK(it->first == "Host" && header.field(it) == fields::Host);
+  ++it;
+  CHECK(it->first == "Accept" && header.field(it) == fields::Accept);
+  ++it;
+  CHECK(it->first == "X-Another" && it->second.asString() == "x");
+  CHECK(header.find(fields::Accept)->second.asString() == "*/*");
+
+  // le champ retiré est réutilisé : sa chaîne reçoit la nouvelle valeur
+  // sans allocation
+  header.add("X-New", 5, "short", 5);
+  CHECK(header.size() == 4);
+  CHECK(header["X-New"].asString() == "short");
+  CHECK(header["X-New"].asString().data() == storage);
+  CHECK(header.field(header.find("X-New")) == fields::UnknownHeaderField);
+
+  header.erase(header.begin());
+  CHECK(header.begin()->first == "Accept");
+  CHECK(header.count(fields::Host) == 0);
+}
+
+/*
+  clear() garde les champs pour les insertions suivantes, shrink() les
+  détruit.
+*/
+void testClearShrink()
+{
+  bref::HttpHeader  header;
+  const std::string value(200, 'v');
+
+  header.add("X-First", 7, value.data(), value.size());
+  header["Host"] = bref::BrefValue("example.com");
+
+  const char *storage = header.begin()->second.asString().data();
+
+  header.clear();
+  CHECK(header.empty() && header.begin() == header.end());
+  CHECK(header.find("X-First") == header.end());
+  CHECK(header.count(fields::Host) == 0);
+
+  // le premier champ gardé est réutilisé, nom et type compris
+  header.add("Content-Type", 12, "text/html", 9);
+  CHECK(header.size() == 1);
+  CHECK(header.begin()->first == "Content-Type");
+  CHECK(header.begin()->second.asString().data() == storage);
+  CHECK(header.field(header.begin()) == fields::ContentType);
+  CHECK(header.count(fields::Host) == 0);
+
+  // operator[] sur un champ gardé : la valeur précédente ne doit pas
+  // réapparaître
+  CHECK(header["X-Next"].isNull());
+
+  header.clear();
+  header.shrink();
+  header.add("Content-Type", 12, "text/html", 9);
+  CHECK(header.begin()->second.asString().capacity() < value.size());
+}
+
+void testCopySwap()
+{
+  bref::HttpHeader header;
+
+  header["Host"] = bref::BrefValue("a");
+  header["X-Kept"] = bref::BrefValue("b");
+  header.erase("X-Kept");
+
+  bref::HttpHeader copy(header);
+
+  CHECK(copy.size() == 1 && copy[fields::Host].asString() == "a");
+
+  bref::HttpHeader other;
+
+  other["Accept"] = bref::BrefValue("*/*");
+  swap(copy, other);
+  CHECK(copy.size() == 1 && copy.count(fields::Accept) == 1);
+  CHECK(other.size() == 1 && other.count(fields::Host) == 1);
+
+  copy = header;
+  CHECK(copy.size() == 1 && copy.count(fields::Host) == 1 && copy.count(fields::Accept) == 0);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testLookup();
+  testWellKnown();
+  testInsert();
+  testAdd();
+  testErase();
+  testClearShrink();
+  testCopySwap();
+  return test::result();
+}
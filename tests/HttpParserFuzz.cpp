@@ -0,0 +1,304 @@
+/**
+ * \file   HttpParserFuzz.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 24 16:31:08 2012
+ *
+ * \brief  HttpParser fuzz test, from the corpus in corpus/http.
+ *
+ */
+
+/*
+  Chaque fichier du corpus, puis des mutations de chacun (octets
+  changés, insérés, supprimés, lignes dupliquées, troncatures), sont
+  donnés au parser :
+
+  - d'un coup puis par morceaux : le résultat, le code d'erreur,
+    consumed() et les champs remplis doivent être les mêmes ;
+  - sur une requête complète, les noms des champs sont des tokens et
+    les valeurs ne contiennent ni '\r' ni '\n'.
+
+    http-parser-fuzz <corpus> [mutations par fichier]
+
+  Les mutations sont tirées d'une graine fixe, un échec se reproduit.
+  Compilé avec -DBREF_LIBFUZZER et -fsanitize=fuzzer, le fichier donne
+  une cible libFuzzer qui vérifie les mêmes propriétés :
+
+    clang++ -DBREF_LIBFUZZER -fsanitize=fuzzer,address ... \
+      && ./a.out corpus/http
+*/
+
+#include "Check.h"
+#include "HttpParser.h"
+
+#include <dirent.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::size_t DefaultMutations = 2000;
+
+struct Outcome
+{
+  HttpParser::Result       result;
+  bref::status_codes::Type error;
+  std::size_t              consumed;
+  bref::HttpRequest        request;
+};
+
+/*
+  Donne \p input au parser par morceaux de \p chunk octets (tout si 0).
+*/
+void run(const std::string & input, std::size_t chunk, Outcome & outcome)
+{
+  HttpParser parser;
+
+  outcome.result = HttpParser::Incomplete;
+  if (chunk == 0)
+    outcome.result = parser.parse(input.data(), input.size());
+  else
+    for (std::size_t size = 0; outcome.result == HttpParser::Incomplete && size < input.size(); )
+      {
+        size = std::min(size + chunk, input.size());
+        outcome.result = parser.parse(input.data(), size);
+      }
+  outcome.error    = parser.error();
+  outcome.consumed = parser.consumed();
+  outcome.request.clear();
+  if (outcome.result == HttpParser::Complete)
+    parser.fill(input.data(), outcome.request);
+}
+
+bool isToken(const std::string & name)
+{
+  static const char *separators = "()<>@,;:\\\"/[]?={} \t";
+
+  if (name.empty())
+    return false;
+  for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+    {
+      const unsigned char c = static_cast<unsigned char>(*it);
+
+      if (c <= 32 || c >= 127 || std::strchr(separators, c))
+        return false;
+    }
+  return true;
+}
+
+bool sameFields(const bref::HttpRequest & a, const bref::HttpRequest & b)
+{
+  if (a.size() != b.size() || a.getUri() != b.getUri() || a.getMethod() != b.getMethod())
+    return false;
+  for (bref::HttpRequest::const_iterator i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j)
+    if (i->first != j->first || i->second.asString() != j->second.asString())
+      return false;
+  return true;
+}
+
+/*
+  Les propriétés vérifiées pour une entrée, retourne false au premier
+  échec.
+*/
+bool check(const std::string & input)
+{
+  static const std::size_t chunks[] = { 1, 2, 3, 7, 16, 61 };
+  Outcome                  whole;
+  Outcome                  split;
+
+  run(input, 0, whole);
+  if (whole.result == HttpParser::Complete)
+    {
+      if (whole.consumed > input.size())
+        return false;
+      for (bref::HttpRequest::const_iterator it = whole.request.begin(); it != whole.request.end(); ++it)
+        if (! isToken(it->first) || it->second.asString().find_first_of("\r\n") != std::string::npos)
+          return false;
+    }
+  else if ((whole.result == HttpParser::Error) != (whole.error != bref::status_codes::UndefinedStatusCode))
+    return false;
+
+  for (std::size_t i = 0; i < sizeof chunks / sizeof *chunks; ++i)
+    {
+      run(input, chunks[i], split);
+      if (split.result != whole.result || split.error != whole.error)
+        return false;
+      if (whole.result == HttpParser::Complete
+          && (split.consumed != whole.consumed || ! sameFields(split.request, whole.request)))
+        return false;
+    }
+  return true;
+}
+
+} // ! unnamed namespace
+
+#ifdef BREF_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, std::size_t size)
+{
+  if (! check(std::string(reinterpret_cast<const char *>(data), size)))
+    std::abort();
+  return 0;
+}
+
+#else  // ! BREF_LIBFUZZER
+
+namespace {
+
+/*
+  xorshift32, la même suite sur toutes les plateformes.
+*/
+class Random
+{
+private:
+  uint32_t state_;
+
+public:
+  explicit Random(uint32_t seed)
+    : state_(seed ? seed : 1)
+  { }
+
+  uint32_t operator()(uint32_t bound)
+  {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return bound ? state_ % bound : 0;
+  }
+};
+
+std::string mutate(const std::string & seed, Random & random)
+{
+  static const char interesting[] = { '\r', '\n', ':', ' ', '\t', '\0', '\x7f', '\xff', '/', '.', '0', 'H' };
+  std::string       input = seed;
+  const uint32_t    count = 1 + random(4);
+
+  for (uint32_t n = 0; n < count && ! input.empty(); ++n)
+    {
+      const std::size_t at = random(static_cast<uint32_t>(input.size()));
+
+      switch (random(6))
+        {
+        case 0:
+          input[at] = static_cast<char>(random(256));
+          break;
+        case 1:
+          input[at] = interesting[random(sizeof interesting)];
+          break;
+        case 2:
+          input.insert(at, 1, interesting[random(sizeof interesting)]);
+          break;
+        case 3:
+          input.erase(at, 1 + random(8));
+          break;
+        case 4:
+          {
+            // duplique la ligne qui contient at
+            const std::size_t begin = input.rfind('\n', at);
+            const std::size_t end   = input.find('\n', at);
+
+            if (begin != std::string::npos && end != std::string::npos)
+              input.insert(end + 1, input, begin + 1, end - begin);
+            break;
+          }
+        default:
+          input.resize(at);
+          break;
+        }
+    }
+  return input;
+}
+
+bool readCorpus(const std::string & directory, std::vector<std::string> & names, std::vector<std::string> & inputs)
+{
+  DIR *dir = ::opendir(directory.c_str());
+
+  if (! dir)
+    return false;
+  while (const dirent *entry = ::readdir(dir))
+    {
+      if (entry->d_name[0] == '.')
+        continue;
+
+      std::ifstream file((directory + "/" + entry->d_name).c_str(), std::ios::binary);
+
+      names.push_back(entry->d_name);
+      inputs.push_back(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+    }
+  ::closedir(dir);
+  return ! inputs.empty();
+}
+
+std::string escape(const std::string & input)
+{
+  std::string out;
+
+  for (std::string::const_iterator it = input.begin(); it != input.end(); ++it)
+    {
+      const unsigned char c = static_cast<unsigned char>(*it);
+
+      if (c >= 32 && c < 127 && c != '\\')
+        out += *it;
+      else
+        {
+          char escaped[5];
+
+          std::sprintf(escaped, "\\x%02x", c);
+          out += escaped;
+        }
+    }
+  return out;
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      std::fprintf(stderr, "usage: %s corpus [mutations]\n", argv[0]);
+      return 2;
+    }
+
+  const std::size_t        mutations = argc > 2 ? std::strtoul(argv[2], 0, 10) : DefaultMutations;
+  std::vector<std::string> names;
+  std::vector<std::string> inputs;
+
+  if (! readCorpus(argv[1], names, inputs))
+    {
+      std::fprintf(stderr, "%s: empty or unreadable corpus\n", argv[1]);
+      return 1;
+    }
+
+  Random random(0x62726566);
+
+  for (std::size_t i = 0; i < inputs.size(); ++i)
+    {
+      if (! check(inputs[i]))
+        {
+          std::fprintf(stderr, "%s: check failed\n", names[i].c_str());
+          ++test::failures();
+        }
+      for (std::size_t n = 0; n < mutations; ++n)
+        {
+          const std::string input = mutate(inputs[i], random);
+
+          if (! check(input))
+            {
+              std::fprintf(stderr, "%s, mutation %lu: check failed on \"%s\"\n", names[i].c_str(),
+                           static_cast<unsigned long>(n), escape(input).c_str());
+              ++test::failures();
+            }
+        }
+    }
+  std::printf("%lu inputs\n", static_cast<unsigned long>(inputs.size() * (1 + mutations)));
+  return test::result();
+}
+
+#endif // ! BREF_LIBFUZZER
@@ -0,0 +1,176 @@
+/**
+ * \file   HttpParserTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Thu May 24 14:12:50 2012
+ *
+ * \brief  ModParser HttpParser tests.
+ *
+ */
+
+#include "Check.h"
+#include "HttpParser.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+const std::string Request =
+  "\r\n"
+  "GET /index.html?a=b HTTP/1.1\r\n"
+  "Host: example.com\r\n"
+  "Accept:  text/html \r\n"
+  "accept: */*\r\n"
+  "X-Long: " + std::string(100, 'x') + "\r\n"
+  "\r\n"
+  "GET / HTTP/1.0\r\n"
+  "\r\n";
+
+HttpParser::Result parse(const char *data, HttpParser & parser)
+{
+  parser.reset();
+  return parser.parse(data, std::strlen(data));
+}
+
+bref::status_codes::Type error(const char *data)
+{
+  HttpParser parser;
+
+  return parse(data, parser) == HttpParser::Error ? parser.error() : bref::status_codes::UndefinedStatusCode;
+}
+
+/*
+  La même requête reçue par morceaux de toutes les tailles.
+*/
+void testIncremental()
+{
+  for (std::size_t chunk = 1; chunk < Request.size(); ++chunk)
+    {
+      HttpParser         parser;
+      std::string        buffer;
+      HttpParser::Result result = HttpParser::Incomplete;
+
+      for (std::size_t i = 0; result == HttpParser::Incomplete && i < Request.size(); i += chunk)
+        {
+          buffer.append(Request, i, chunk);
+          result = parser.parse(buffer.data(), buffer.size());
+        }
+      CHECK(result == HttpParser::Complete);
+      CHECK(parser.consumed() == Request.find("GET / "));
+
+      bref::HttpRequest request;
+
+      parser.fill(buffer.data(), request);
+      CHECK(request.getMethod() == bref::request_methods::Get);
+      CHECK(request.getUri() == "/index.html?a=b");
+      CHECK(request.getVersion().Major == 1 && request.getVersion().Minor == 1);
+      CHECK(request.size() == 3);
+      CHECK(request[bref::header_fields::Accept].asString() == "text/html, */*");
+      CHECK(request["host"].asString() == "example.com");
+      CHECK(request["X-Long"].asString() == std::string(100, 'x'));
+    }
+}
+
+/*
+  fill() dans une requête réutilisée (clear()) : les champs gardés ne
+  doivent rien laisser de la requête précédente.
+*/
+void testReuse()
+{
+  HttpParser        parser;
+  bref::HttpRequest request;
+  const char       *first  = "GET / HTTP/1.1\r\nCookie: a=1\r\nCookie: b=2\r\nX-Int: 1\r\n\r\n";
+  const char       *second = "GET / HTTP/1.1\r\nHost: b\r\nCookie: c\r\n\r\n";
+
+  CHECK(parse(first, parser) == HttpParser::Complete);
+  parser.fill(first, request);
+  CHECK(request["Cookie"].asString() == "a=1; b=2");
+
+  request.clear();
+  CHECK(parse(second, parser) == HttpParser::Complete);
+  parser.fill(second, request);
+  CHECK(request.size() == 2);
+  CHECK(request.begin()->first == "Host" && request.begin()->second.asString() == "b");
+  CHECK(request.find(bref::header_fields::Cookie) != request.end());
+  CHECK(request["Cookie"].asString() == "c");
+
+  // une valeur qui n'est pas une chaîne est remplacée
+  request.clear();
+  request["Cookie"] = bref::BrefValue(42);
+  parser.fill(second, request);
+  CHECK(request["Cookie"].asString() == "c");
+}
+
+void testErrors()
+{
+  CHECK(error("FOO / HTTP/1.1\r\n\r\n") == bref::status_codes::NotImplemented);
+  CHECK(error("get / HTTP/1.1\r\n\r\n") == bref::status_codes::NotImplemented);
+  CHECK(error("GET / HTTP/2.0\r\n\r\n") == bref::status_codes::HTTPVersionNotSupported);
+  CHECK(error("GET /\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET  HTTP/1.1\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\n folded\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nNoColon\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\n: empty\r\n\r\n") == bref::status_codes::BadRequest);
+
+  // field-name = token
+  CHECK(error("GET / HTTP/1.1\r\nA : b\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA b: c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA\tb: c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA@b: c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA(b): c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\n\"A\": c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA\x7f: c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA\xc3\xa9: c\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nX-A_b.c~!#$%&'*+^`|: ok\r\n\r\n") == bref::status_codes::UndefinedStatusCode);
+
+  // field-value sans caractère de contrôle
+  CHECK(error("GET / HTTP/1.1\r\nA: b\rc\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA: b\r\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA: b\x01\r\n\r\n") == bref::status_codes::BadRequest);
+  CHECK(error("GET / HTTP/1.1\r\nA: b\tc\xff\r\n\r\n") == bref::status_codes::UndefinedStatusCode);
+
+  std::string nul = "GET / HTTP/1.1\r\nA";
+
+  nul += '\0';
+  nul += ": b\r\n\r\n";
+
+  HttpParser parser;
+
+  CHECK(parser.parse(nul.data(), nul.size()) == HttpParser::Error);
+  CHECK(parser.error() == bref::status_codes::BadRequest);
+}
+
+void testLimits()
+{
+  HttpParser  parser;
+  std::string uri = "GET /" + std::string(HttpParser::MaxHeaderSize + 1, 'a');
+
+  CHECK(parser.parse(uri.data(), uri.size()) == HttpParser::Error);
+  CHECK(parser.error() == bref::status_codes::RequestURITooLarge);
+
+  std::string fields = "GET / HTTP/1.1\r\n";
+
+  for (std::size_t i = 0; i <= HttpParser::MaxHeaderFields; ++i)
+    fields += "X-Field: value\r\n";
+  fields += "\r\n";
+  parser.reset();
+  CHECK(parser.parse(fields.data(), fields.size()) == HttpParser::Error);
+  CHECK(parser.error() == bref::status_codes::RequestEntityTooLarge);
+
+  std::string big = "GET / HTTP/1.1\r\nX-Big: " + std::string(HttpParser::MaxHeaderSize, 'b') + "\r\n\r\n";
+
+  parser.reset();
+  CHECK(parser.parse(big.data(), big.size()) == HttpParser::Error);
+  CHECK(parser.error() == bref::status_codes::RequestEntityTooLarge);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testIncremental();
+  testReuse();
+  testErrors();
+  testLimits();
+  return test::result();
+}
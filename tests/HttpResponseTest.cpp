@@ -0,0 +1,80 @@
+/**
+ * \file   HttpResponseTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 09:48:16 2012
+ *
+ * \brief  HttpResponse serialization tests.
+ *
+ */
+
+#include "Check.h"
+
+#include "bref/HttpResponse.h"
+#include "bref/detail/util/FloatFormat.hpp"
+
+#include <clocale>
+#include <string>
+
+namespace {
+
+std::string serialize(const bref::HttpResponse & response)
+{
+  const bref::Buffer raw = response.getRawData();
+
+  return std::string(raw.begin(), raw.end());
+}
+
+void testFields()
+{
+  bref::HttpResponse response;
+
+  response.setVersion(bref::Version(1, 1));
+  response.setStatus(bref::status_codes::OK);
+  response["X-String"] = bref::BrefValue("text");
+  response["X-Int"]    = bref::BrefValue(-42);
+  response["X-Bool"]   = bref::BrefValue(true);
+  response["X-Double"] = bref::BrefValue(0.1);
+  response["X-Large"]  = bref::BrefValue(123456789012345.0);
+  response["X-Small"]  = bref::BrefValue(1.5e-7);
+  CHECK(serialize(response) ==
+        "HTTP/1.1 200 OK\r\n"
+        "X-String: text\r\n"
+        "X-Int: -42\r\n"
+        "X-Bool: true\r\n"
+        "X-Double: 0.1\r\n"
+        "X-Large: 123456789012345\r\n"
+        "X-Small: 1.5e-07\r\n"
+        "\r\n");
+  CHECK(response.rawDataSize() == serialize(response).size());
+}
+
+/*
+  Le point décimal ne dépend pas de LC_NUMERIC. Les locales installées
+  ne sont pas connues : le test passe sans rien vérifier si aucune
+  n'utilise la virgule.
+*/
+void testLocale()
+{
+  static const char *locales[] = { "fr_FR.UTF-8", "fr_FR.utf8", "de_DE.UTF-8", "de_DE.utf8", "C.UTF-8" };
+  char               buffer[bref::util::MaxDoubleSize];
+
+  for (std::size_t i = 0; i < sizeof locales / sizeof *locales; ++i)
+    if (std::setlocale(LC_NUMERIC, locales[i]))
+      {
+        bref::HttpResponse response;
+
+        response["X-Double"] = bref::BrefValue(3.25);
+        CHECK(serialize(response).find("X-Double: 3.25\r\n") != std::string::npos);
+        CHECK(std::string(buffer, bref::util::formatDouble(-0.5, 15, buffer)) == "-0.5");
+      }
+  std::setlocale(LC_NUMERIC, "C");
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testFields();
+  testLocale();
+  return test::result();
+}
@@ -0,0 +1,95 @@
+/**
+ * \file   ICaseTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 16:40:52 2012
+ *
+ * \brief  Case-insensitive comparison and hash against a scalar reference.
+ *
+ */
+
+/*
+  Chaînes aléatoires de 0 à 80 octets, pour passer par les blocs
+  vectoriels, le SWAR et la fin scalaire. La seconde chaîne est la
+  première avec des lettres changées de casse, parfois un octet changé
+  ou tronquée.
+*/
+
+#include "Check.h"
+
+#include "bref/detail/util/ICaseStringCmp.hpp"
+
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+const int Iterations = 200000;
+
+int reference(const std::string & a, const std::string & b)
+{
+  const std::size_t size = std::min(a.size(), b.size());
+
+  for (std::size_t i = 0; i < size; ++i)
+    {
+      const unsigned char x = bref::util::asciiToLower(a[i]);
+      const unsigned char y = bref::util::asciiToLower(b[i]);
+
+      if (x != y)
+        return x < y ? -1 : 1;
+    }
+  return a.size() < b.size() ? -1 : a.size() > b.size();
+}
+
+int sign(int value)
+{
+  return (value > 0) - (value < 0);
+}
+
+char randomChar()
+{
+  // les voisins des lettres dans la table ASCII
+  static const char near[] = "aAzZ@[`{-";
+
+  return std::rand() % 4 ? near[std::rand() % (sizeof near - 1)] : static_cast<char>(std::rand());
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  using namespace bref::util;
+
+  std::srand(1);
+  CHECK(asciiToLower('A') == 'a' && asciiToLower('@') == '@' && asciiToLower('[') == '[');
+  CHECK(asciiToLower('\xC9') == '\xC9');
+  CHECK(ICaseStringEqual()("Content-Length", "content-LENGTH"));
+  CHECK(ICaseStringHash()("Content-Length") == ICaseStringHash()("CONTENT-length"));
+  CHECK(ICaseStringCmp()("Accept", "accept-encoding"));
+
+  for (int i = 0; i < Iterations; ++i)
+    {
+      std::string a(std::rand() % 80, ' ');
+
+      for (std::size_t j = 0; j < a.size(); ++j)
+        a[j] = randomChar();
+
+      std::string b = a;
+
+      for (std::size_t j = 0; j < b.size(); ++j)
+        if (std::rand() % 3 == 0 && asciiToLower(b[j]) >= 'a' && asciiToLower(b[j]) <= 'z')
+          b[j] = std::rand() % 2 ? asciiToLower(b[j]) : asciiToLower(b[j]) - 'a' + 'A';
+      if (std::rand() % 4 == 0 && ! b.empty())
+        b[std::rand() % b.size()] = static_cast<char>(std::rand());
+      if (std::rand() % 8 == 0)
+        b.resize(std::rand() % (b.size() + 1));
+
+      const int expected = reference(a, b);
+
+      CHECK(sign(icaseCompare(a.data(), a.size(), b.data(), b.size())) == expected);
+      if (a.size() == b.size())
+        CHECK(icaseEqual(a.data(), b.data(), a.size()) == (expected == 0));
+      if (expected == 0)
+        CHECK(icaseHash(a.data(), a.size()) == icaseHash(b.data(), b.size()));
+    }
+  return test::result();
+}
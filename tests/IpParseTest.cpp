@@ -0,0 +1,132 @@
+/**
+ * \file   IpParseTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 16:02:11 2012
+ *
+ * \brief  util::parseIPv4() and util::parseIPv6() against inet_pton().
+ *
+ */
+
+/*
+  Les parseurs doivent accepter exactement ce qu'accepte inet_pton() et
+  donner les mêmes octets ; les formateurs doivent écrire ce qu'écrit
+  inet_ntop() (RFC 5952) et être relus à l'identique.
+*/
+
+#include "Check.h"
+
+#include "bref/detail/util/IpFormat.hpp"
+
+#include <arpa/inet.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const int RandomStrings   = 300000;
+const int RandomAddresses = 30000;
+
+void check(const std::string & text)
+{
+  unsigned char parsed[16] = { 0 };
+  unsigned char expected[16] = { 0 };
+
+  bool ok  = bref::util::parseIPv4(text.data(), text.size(), parsed);
+  bool ref = ::inet_pton(AF_INET, text.c_str(), expected) == 1;
+
+  if (ok != ref || (ok && std::memcmp(parsed, expected, 4) != 0))
+    {
+      std::fprintf(stderr, "IPv4 \"%s\": %d, inet_pton %d\n", text.c_str(), ok, ref);
+      ++test::failures();
+    }
+
+  ok  = bref::util::parseIPv6(text.data(), text.size(), parsed);
+  ref = ::inet_pton(AF_INET6, text.c_str(), expected) == 1;
+  if (ok != ref || (ok && std::memcmp(parsed, expected, 16) != 0))
+    {
+      std::fprintf(stderr, "IPv6 \"%s\": %d, inet_pton %d\n", text.c_str(), ok, ref);
+      ++test::failures();
+    }
+  if (! ok)
+    return;
+
+  char              formatted[64];
+  char              reference[64];
+  const std::size_t size = bref::util::formatIPv6(parsed, formatted);
+  unsigned char     again[16];
+
+  formatted[size] = '\0';
+  ::inet_ntop(AF_INET6, parsed, reference, sizeof reference);
+
+  // glibc écrit ::a.b.c.d pour les adresses compatibles IPv4 (obsolètes)
+  static const unsigned char zeros[12] = { 0 };
+
+  if (! bref::util::isV4Mapped(parsed) && std::memcmp(parsed, zeros, 12) != 0)
+    CHECK(std::strcmp(formatted, reference) == 0);
+  CHECK(bref::util::parseIPv6(formatted, size, again) && std::memcmp(again, parsed, 16) == 0);
+}
+
+void testCases()
+{
+  static const char *cases[] =
+    {
+      "1.2.3.4", "255.255.255.255", "256.1.1.1", "01.2.3.4", "1.2.3", "1.2.3.4.5",
+      "1..2.3", "", "::", "::1", "1::", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9",
+      "1:2:3:4:5:6:7::", "::1:2:3:4:5:6:7", "1::2::3", ":1::", "1:::2", "12345::",
+      "::ffff:1.2.3.4", "::1.2.3.4", "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4",
+      "fe80::1%eth0", "ABCD:ef::", "0:0:0:0:0:0:0:0", "::0:0", "1:2:3:4:5:6:7:8::",
+      "::1.2.3", "::1.2.3.04", ":", ":::", "1:", "g::", "1:2:3:4:5:6::1.2.3.4",
+      "::a:1.2.3.4", "0000:0000:0000:0000:0000:0000:0000:00001"
+    };
+
+  for (std::size_t i = 0; i < sizeof cases / sizeof *cases; ++i)
+    check(cases[i]);
+}
+
+void testRandomStrings()
+{
+  static const char alphabet[] = "0123456789abcdefABCDEF:.:.:::x";
+
+  for (int i = 0; i < RandomStrings; ++i)
+    {
+      std::string text(std::rand() % 24, ' ');
+
+      for (std::size_t j = 0; j < text.size(); ++j)
+        text[j] = alphabet[std::rand() % (sizeof alphabet - 1)];
+      check(text);
+    }
+}
+
+void testRandomAddresses()
+{
+  for (int i = 0; i < RandomAddresses; ++i)
+    {
+      unsigned char bytes[16];
+      char          text[64];
+
+      // des zéros en nombre pour que "::" soit choisi
+      for (int j = 0; j < 16; ++j)
+        bytes[j] = std::rand() % 3 ? 0 : std::rand();
+      check(std::string(text, bref::util::formatIPv6(bytes, text)));
+
+      const std::size_t size = bref::util::formatIPv4(bytes + 12, text);
+      char              reference[16];
+
+      ::inet_ntop(AF_INET, bytes + 12, reference, sizeof reference);
+      CHECK(std::string(text, size) == reference);
+      check(std::string(text, size));
+    }
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  std::srand(3);
+  testCases();
+  testRandomStrings();
+  testRandomAddresses();
+  return test::result();
+}
@@ -0,0 +1,250 @@
+/**
+ * \file   MappedAccessLogTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri Jun  1 15:08:31 2012
+ *
+ * \brief  MappedAccessLog rotation, creation retried after a failure and
+ *         decoding of the files by bref-access-log-decoder.
+ *
+ */
+
+/*
+  Les fichiers sont écrits dans un répertoire temporaire. Le port du
+  client numérote les enregistrements, le décodeur (chemin en premier
+  argument) doit les rendre dans l'ordre :
+
+  - rotation     4 enregistrements par fichier, 2 fichiers gardés
+  - retry        le répertoire n'existe pas à la création du logger, il
+                 est créé ensuite : les enregistrements sont perdus
+                 jusqu'à la tentative suivante (Options::retryDelay)
+
+    mapped-access-log-test <bref-access-log-decoder>
+*/
+
+#include "Check.h"
+
+#include "bref/MappedAccessLog.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *decoder = 0;
+
+/*
+  Garde les messages texte (les erreurs de création des fichiers).
+*/
+class TextLogger : public bref::ILogger
+{
+public:
+  std::vector<std::string> messages;
+
+  Severity severity() const
+  {
+    return Debug;
+  }
+
+  void setSeverity(Severity)
+  { }
+
+  void log(Severity, const std::string & message)
+  {
+    messages.push_back(message);
+  }
+};
+
+/*
+  Le 31 mai 2012 à midi (UTC).
+*/
+const uint64_t Time = 1338465600000000ull;
+
+bref::AccessRecord record(unsigned short port)
+{
+  bref::AccessRecord record;
+  bref::IpAddress    address;
+
+  bref::IpAddress::parse("192.168.0.1", address);
+  record.time          = Time + port;
+  record.status        = bref::status_codes::OK;
+  record.bytesReceived = 412;
+  record.bytesSent     = 5127;
+  record.stageTimes[bref::AccessRecord::TotalStage] = 170;
+  record.setClient(address, port);
+  record.setRequest(bref::request_methods::Get, bref::Version(1, 1));
+  return record;
+}
+
+off_t fileSize(const std::string & path)
+{
+  struct stat st;
+
+  return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+/*
+  La sortie du décodeur, une ligne par élément.
+*/
+std::vector<std::string> decode(const std::string & arguments)
+{
+  std::vector<std::string> lines;
+  const std::string        command = std::string(decoder) + " " + arguments;
+  std::FILE               *out     = ::popen(command.c_str(), "r");
+  char                     line[512];
+
+  if (! out)
+    return lines;
+  while (std::fgets(line, sizeof(line), out))
+    lines.push_back(std::string(line));
+  CHECK(::pclose(out) == 0);
+  return lines;
+}
+
+/*
+  Le port de l'enregistrement d'une ligne texte, -1 si la ligne n'est
+  pas celle attendue.
+*/
+int port(const std::string & line)
+{
+  const std::string prefix = "2012-05-31 12:00:00.0";
+  const std::string client = " 192.168.0.1:";
+  const std::string rest   =
+    " \"GET HTTP/1.1\" 200 rx=412 tx=5127 receive=0us process=0us send=0us total=170us\n";
+
+  if (line.compare(0, prefix.size(), prefix) != 0)
+    return -1;
+
+  const std::size_t begin = line.find(client);
+  const std::size_t end   = line.find(' ', begin + 1);
+
+  if (begin == std::string::npos || end == std::string::npos || line.compare(end, std::string::npos, rest) != 0)
+    return -1;
+
+  const int value = std::atoi(line.c_str() + begin + client.size());
+
+  // les microsecondes de l'heure sont le port
+  return std::atoi(line.c_str() + prefix.size() - 1) == value ? value : -1;
+}
+
+/*
+  Vérifie que \p path contient les enregistrements [first, last].
+*/
+void checkFile(const std::string & path, int first, int last)
+{
+  const std::vector<std::string> lines = decode(path);
+
+  CHECK(static_cast<int>(lines.size()) == last - first + 1);
+  for (std::size_t i = 0; i < lines.size(); ++i)
+    CHECK(port(lines[i]) == first + static_cast<int>(i));
+}
+
+void testRotation(const std::string & directory)
+{
+  const std::string               path = directory + "/access.bin";
+  TextLogger                      text;
+  bref::MappedAccessLog::Options  options;
+
+  options.fileSize = sizeof(bref::AccessLogHeader) + 4 * sizeof(bref::AccessRecord);
+  options.maxFiles = 2;
+  {
+    bref::MappedAccessLog logger(&text, path, options);
+
+    for (unsigned short i = 1; i <= 14; ++i)
+      logger.logAccess(record(i));
+    CHECK(logger.dropped() == 0);
+  }
+  CHECK(text.messages.empty());
+
+  // 1 à 4 sont supprimés, le fichier courant est tronqué à son contenu
+  CHECK(fileSize(path + ".3") == -1);
+  CHECK(fileSize(path + ".2") == static_cast<off_t>(options.fileSize));
+  CHECK(fileSize(path + ".1") == static_cast<off_t>(options.fileSize));
+  CHECK(fileSize(path) == static_cast<off_t>(sizeof(bref::AccessLogHeader) + 2 * sizeof(bref::AccessRecord)));
+  checkFile(path + ".2", 5, 8);
+  checkFile(path + ".1", 9, 12);
+  checkFile(path, 13, 14);
+
+  // le fichier existant est décalé à la création d'un logger
+  {
+    bref::MappedAccessLog logger(&text, path, options);
+
+    logger.logAccess(record(15));
+  }
+  checkFile(path + ".2", 9, 12);
+  checkFile(path + ".1", 13, 14);
+  checkFile(path, 15, 15);
+
+  const std::vector<std::string> csv = decode("--csv " + path);
+
+  CHECK(csv.size() == 2);
+  CHECK(csv.size() == 2 && csv[1] == "2012-05-31 12:00:00.000015,192.168.0.1,15,GET,1.1,200,412,5127,0,0,0,170\n");
+
+  for (int i = 0; i <= 2; ++i)
+    ::unlink((i ? path + "." + std::to_string(i) : path).c_str());
+}
+
+void testRetry(const std::string & directory)
+{
+  const std::string              missing = directory + "/missing";
+  const std::string              path    = missing + "/access.bin";
+  TextLogger                     text;
+  bref::MappedAccessLog::Options options;
+
+  options.retryDelay = 100;
+  {
+    bref::MappedAccessLog logger(&text, path, options);
+
+    CHECK(text.messages.size() == 1);
+    CHECK(! text.messages.empty() && text.messages[0].find("can't open") != std::string::npos);
+
+    logger.logAccess(record(1));
+    CHECK(logger.dropped() == 1);
+
+    // avant le délai, pas de nouvelle tentative même si c'est possible
+    CHECK(::mkdir(missing.c_str(), 0700) == 0);
+    logger.logAccess(record(2));
+    CHECK(logger.dropped() == 2);
+    CHECK(fileSize(path) == -1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.retryDelay + 50));
+    logger.logAccess(record(3));
+    logger.logAccess(record(4));
+    CHECK(logger.dropped() == 2);
+    CHECK(text.messages.size() == 1);
+  }
+  checkFile(path, 3, 4);
+  ::unlink(path.c_str());
+  ::rmdir(missing.c_str());
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      std::fprintf(stderr, "usage: %s bref-access-log-decoder\n", argv[0]);
+      return 2;
+    }
+  decoder = argv[1];
+
+  char directory[] = "/tmp/bref-access-log-XXXXXX";
+
+  if (! ::mkdtemp(directory))
+    {
+      std::perror("mkdtemp");
+      return 1;
+    }
+  testRotation(directory);
+  testRetry(directory);
+  ::rmdir(directory);
+  return test::result();
+}
@@ -0,0 +1,218 @@
+/**
+ * \file   ModUringTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat Jun  2 10:17:35 2012
+ *
+ * \brief  ModUring hooks registration and deferred sends.
+ *
+ */
+
+/*
+  - le handler d'envoi n'est enregistré que si le serveur positionne
+    Pipeline::deferredSend
+  - un envoi que la socket ne peut pas prendre retourne false avec errno
+    à EAGAIN, puis le handler est rappelé avec un buffer vide jusqu'à ce
+    qu'il retourne true : tout arrive, dans l'ordre
+  - la fermeture de la session annule l'envoi en cours : la socket est
+    libérée même si le client ne lit pas
+
+  Le test est ignoré si io_uring n'est pas disponible.
+*/
+
+#include "Check.h"
+#include "ModUring.h"
+
+#include "bref/IConfHelper.h"
+#include "bref/PipelineExecutor.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+const std::size_t SendSize = 1024 * 1024;
+
+class QuietLogger : public bref::ILogger
+{
+public:
+  Severity severity() const
+  {
+    return Error;
+  }
+
+  void setSeverity(Severity)
+  { }
+
+  void log(Severity, const std::string & message)
+  {
+    std::fprintf(stderr, "%s\n", message.c_str());
+  }
+};
+
+class NullConfHelper : public bref::IConfHelper
+{
+private:
+  bref::BrefValue null_;
+
+public:
+  virtual const bref::BrefValue & findValue(std::string const &) const
+  {
+    return null_;
+  }
+
+  virtual const bref::BrefValue & findValue(std::string const &, bref::HttpRequest const &) const
+  {
+    return null_;
+  }
+};
+
+/*
+  Lit ce qui est disponible sur \p socket, attend au plus \p timeout
+  millisecondes. Retourne false à la fin du flux.
+*/
+bool readSome(int socket, std::string & received, int timeout)
+{
+  pollfd event = { socket, POLLIN, 0 };
+
+  if (::poll(&event, 1, timeout) <= 0)
+    return true;
+
+  char          buffer[64 * 1024];
+  const ssize_t count = ::recv(socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+  if (count > 0)
+    received.append(buffer, count);
+  return count != 0;
+}
+
+std::string pattern(std::size_t size)
+{
+  std::string data(size, 0);
+
+  for (std::size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>('a' + i % 23);
+  return data;
+}
+
+void testRegistration(ModUring & module)
+{
+  bref::Pipeline     plain;
+  bref::IDisposable *session = module.registerSessionHooks(plain);
+
+  CHECK(session != 0);
+  CHECK(plain.onReceiveHooks.size() == 1);
+  CHECK(plain.onSendHooks.empty());
+  if (session)
+    session->dispose();
+
+  bref::Pipeline deferred;
+
+  deferred.deferredSend = true;
+  session = module.registerSessionHooks(deferred);
+  CHECK(deferred.onReceiveHooks.size() == 1);
+  CHECK(deferred.onSendHooks.size() == 1);
+  if (session)
+    session->dispose();
+}
+
+void testDeferredSend(ModUring & module, const bref::Environment & environment)
+{
+  int sockets[2];
+
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets) != 0)
+    {
+      std::perror("socketpair");
+      CHECK(false);
+      return;
+    }
+
+  bref::Pipeline pipeline;
+
+  pipeline.deferredSend = true;
+
+  bref::IDisposable                    *session = module.registerSessionHooks(pipeline);
+  const bref::PipelineExecutor          executor(pipeline);
+  bref::Pipeline::OnSendRequestHandler  send    = executor.sendHandler(environment);
+  const std::string                     data    = pattern(SendSize);
+  const bref::Buffer                    buffer(data.begin(), data.end());
+  const bref::Buffer                    nothing;
+  std::string                           received;
+
+  CHECK(send);
+
+  // le client ne lit pas : une partie reste au noyau
+  errno = 0;
+  CHECK(! send(sockets[0], buffer));
+  CHECK(errno == EAGAIN);
+
+  // le serveur rappelle le handler quand la socket redevient disponible
+  bool done = false;
+
+  for (int i = 0; i < 10000 && ! done; ++i)
+    {
+      readSome(sockets[1], received, 10);
+      errno = 0;
+      done = send(sockets[0], nothing);
+      if (! done)
+        CHECK(errno == EAGAIN);
+    }
+  CHECK(done);
+  for (int i = 0; i < 1000 && received.size() < data.size(); ++i)
+    readSome(sockets[1], received, 10);
+  CHECK(received == data);
+
+  // un petit envoi part pendant l'appel
+  received.clear();
+  CHECK(send(sockets[0], bref::Buffer(10, 'x')));
+  readSome(sockets[1], received, 1000);
+  CHECK(received == "xxxxxxxxxx");
+
+  // la fermeture de la session annule l'envoi en cours : la fin du flux
+  // arrive sans que le reste soit envoyé
+  received.clear();
+  errno = 0;
+  CHECK(! send(sockets[0], buffer));
+  CHECK(errno == EAGAIN);
+  session->dispose();
+  ::close(sockets[0]);
+
+  bool open = true;
+
+  for (int i = 0; i < 200 && open; ++i)
+    open = readSome(sockets[1], received, 10);
+  CHECK(! open);
+  CHECK(received.size() < data.size());
+  CHECK(data.compare(0, received.size(), received) == 0);
+  ::close(sockets[1]);
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  QuietLogger                     logger;
+  const NullConfHelper            helper;
+  const bref::ServerConfig        config;
+  const bref::Environment::Client client = bref::Environment::Client();
+  const bref::Environment         environment(config, helper, &logger, client);
+  ModUring                       *module = new ModUring(&logger);
+  bref::Pipeline                  probe;
+  bref::IDisposable              *session = module->registerSessionHooks(probe);
+
+  if (! session)
+    {
+      std::printf("io_uring is not available, skipped\n");
+      module->dispose();
+      return 0;
+    }
+  session->dispose();
+  testRegistration(*module);
+  testDeferredSend(*module, environment);
+  module->dispose();
+  return test::result();
+}
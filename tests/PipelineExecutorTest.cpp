@@ -0,0 +1,485 @@
+/**
+ * \file   PipelineExecutorTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Wed May 30 16:02:44 2012
+ *
+ * \brief  Dispatch semantic of the PipelineExecutor: priority order,
+ *         every handler or the first one, empty handlers skipped.
+ *
+ */
+
+/*
+  Chaque hook est identifié par une lettre, ses handlers l'ajoutent à
+  `trace` (ou à la sortie pour les handlers de contenu) : l'ordre des
+  lettres est l'ordre des appels. Un hook "skip" retourne un handler
+  vide.
+*/
+
+#include "Check.h"
+
+#include "bref/ConfigSnapshot.h"
+#include "bref/HttpRequest.h"
+#include "bref/HttpResponse.h"
+#include "bref/PipelineExecutor.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+std::string trace;
+
+const char Letters[] = "abcdefghijklmnopqrstuvwxyz";
+
+struct Connect
+{
+  char id;
+
+  // 'x' refuse la connexion
+  bool operator()(bref::HttpResponse &, const bref::Environment &) const
+  {
+    trace += id;
+    return id != 'x';
+  }
+};
+
+struct Receive
+{
+  char id;
+
+  bool operator()(bref::SocketType, bref::Buffer & buffer) const
+  {
+    buffer.push_back(id);
+    return true;
+  }
+};
+
+struct Send
+{
+  char id;
+
+  bool operator()(bref::SocketType, const bref::Buffer &) const
+  {
+    trace += id;
+    return true;
+  }
+};
+
+struct Parse
+{
+  char id;
+
+  bref::Buffer::const_iterator operator()(bref::HttpResponse &, const bref::Buffer & buffer,
+                                          bref::HttpRequest &) const
+  {
+    trace += id;
+    return buffer.end();
+  }
+};
+
+struct Mark
+{
+  char id;
+
+  void operator()(bref::HttpResponse &) const
+  {
+    trace += id;
+  }
+};
+
+struct Append
+{
+  char id;
+
+  void operator()(bref::HttpResponse &, const bref::Buffer & in, bref::Buffer & out) const
+  {
+    out = in;
+    out.push_back(id);
+  }
+};
+
+struct ChainAppend
+{
+  char id;
+
+  void operator()(bref::HttpResponse &, bref::BufferChain & chunk) const
+  {
+    chunk.append(bref::BufferSlice::fromStatic(std::strchr(Letters, id), 1));
+  }
+};
+
+/*
+  Un hook de n'importe quel point, Handler est le type retourné et
+  Target la cible du handler.
+*/
+template <typename Handler, typename Target>
+struct Hook
+{
+  char id;
+  bool skip;
+
+  Handler make() const
+  {
+    if (skip)
+      return Handler();
+
+    Target target = { id };
+
+    return Handler(target);
+  }
+
+  Handler operator()(const bref::Environment &) const
+  {
+    return make();
+  }
+
+  Handler operator()(const bref::Environment &, bref::HttpRequest &, bref::HttpResponse &) const
+  {
+    return make();
+  }
+
+  Handler operator()(const bref::Environment &, const bref::HttpRequest &, bref::HttpResponse &) const
+  {
+    return make();
+  }
+};
+
+template <typename HookType, typename Handler, typename Target>
+void add(std::list<std::pair<HookType, float> > & hooks, char id, float priority, bool skip = false)
+{
+  Hook<Handler, Target> hook = { id, skip };
+
+  hooks.push_back(std::make_pair(HookType(hook), priority));
+}
+
+class ContentHandler : public bref::Pipeline::IContentRequestHandler
+{
+public:
+  virtual bool inContent(bref::HttpResponse &, const bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual bool outContent(bref::HttpResponse &, bref::Buffer &)
+  {
+    return true;
+  }
+
+  virtual void dispose()
+  { }
+};
+
+struct Content
+{
+  ContentHandler *handler;
+  bref::FdType    value;
+
+  bref::Pipeline::IContentRequestHandler *
+  operator()(const bref::Environment &, const bref::HttpRequest &, bref::HttpResponse &,
+             bref::FdType & fd) const
+  {
+    if (handler)
+      fd = value;
+    return handler;
+  }
+};
+
+struct Fixture
+{
+  bref::ConfigHolder::Pin   snapshot;
+  bref::Environment::Client client;
+  bref::Environment         environment;
+  bref::HttpRequest         request;
+  bref::HttpResponse        response;
+
+  Fixture()
+    : snapshot(bref::ConfigSnapshot::create(bref::BrefValue(bref::BrefValueArray())))
+    , client()
+    , environment(snapshot->config, snapshot->helper, 0, client)
+    , request(), response()
+  {
+    trace.clear();
+  }
+};
+
+std::string toString(const bref::Buffer & buffer)
+{
+  return std::string(buffer.begin(), buffer.end());
+}
+
+/*
+  Par priorité décroissante, dans l'ordre d'enregistrement à priorité
+  égale.
+*/
+void testPriorityOrder()
+{
+  typedef bref::Pipeline::PostParsingHook           HookType;
+  typedef bref::Pipeline::PostParsingRequestHandler Handler;
+
+  Fixture        fixture;
+  bref::Pipeline pipeline;
+
+  add<HookType, Handler, Mark>(pipeline.postParsingHooks, 'a', 1.f);
+  add<HookType, Handler, Mark>(pipeline.postParsingHooks, 'b', 3.f);
+  add<HookType, Handler, Mark>(pipeline.postParsingHooks, 'c', 2.f);
+  add<HookType, Handler, Mark>(pipeline.postParsingHooks, 'd', 3.f);
+  add<HookType, Handler, Mark>(pipeline.postParsingHooks, 'e', 1.f);
+  add<HookType, Handler, Mark>(pipeline.postParsingHooks, 'f', 5.f, true);
+
+  const bref::PipelineExecutor executor(pipeline);
+
+  executor.postParsing(fixture.environment, fixture.request, fixture.response);
+  CHECK(trace == "bdcae");
+
+  // l'exécuteur a copié les hooks
+  pipeline.postParsingHooks.clear();
+  trace.clear();
+  executor.postParsing(fixture.environment, fixture.request, fixture.response);
+  CHECK(trace == "bdcae");
+}
+
+/*
+  Tous les handlers de connexion, jusqu'au premier refus.
+*/
+void testConnection()
+{
+  typedef bref::Pipeline::ConnectionHook           HookType;
+  typedef bref::Pipeline::ConnectionRequestHandler Handler;
+
+  Fixture        fixture;
+  bref::Pipeline pipeline;
+
+  add<HookType, Handler, Connect>(pipeline.connectionHooks, 'a', 1.f);
+  add<HookType, Handler, Connect>(pipeline.connectionHooks, 'b', 3.f);
+  add<HookType, Handler, Connect>(pipeline.connectionHooks, 'c', 4.f, true);
+
+  bref::PipelineExecutor executor(pipeline);
+
+  CHECK(executor.connection(fixture.response, fixture.environment));
+  CHECK(trace == "ba");
+
+  add<HookType, Handler, Connect>(pipeline.connectionHooks, 'x', 2.f);
+  executor.compile(pipeline);
+  trace.clear();
+  CHECK(! executor.connection(fixture.response, fixture.environment));
+  CHECK(trace == "bx");
+
+  // sans hook la connexion est acceptée
+  executor.compile(bref::Pipeline());
+  trace.clear();
+  CHECK(executor.connection(fixture.response, fixture.environment));
+  CHECK(trace.empty());
+}
+
+/*
+  Un seul handler pour la réception, l'envoi et le parsing : le premier
+  non vide par priorité décroissante.
+*/
+void testFirstHandler()
+{
+  Fixture        fixture;
+  bref::Pipeline pipeline;
+
+  add<bref::Pipeline::OnReceiveHook, bref::Pipeline::OnReceiveRequestHandler, Receive>
+    (pipeline.onReceiveHooks, 'a', 1.f);
+  add<bref::Pipeline::OnReceiveHook, bref::Pipeline::OnReceiveRequestHandler, Receive>
+    (pipeline.onReceiveHooks, 'b', 3.f, true);
+  add<bref::Pipeline::OnReceiveHook, bref::Pipeline::OnReceiveRequestHandler, Receive>
+    (pipeline.onReceiveHooks, 'c', 2.f);
+  add<bref::Pipeline::OnSendHook, bref::Pipeline::OnSendRequestHandler, Send>
+    (pipeline.onSendHooks, 'd', 2.f);
+  add<bref::Pipeline::OnSendHook, bref::Pipeline::OnSendRequestHandler, Send>
+    (pipeline.onSendHooks, 'e', 2.f);
+  add<bref::Pipeline::ParsingHook, bref::Pipeline::ParsingRequestHandler, Parse>
+    (pipeline.parsingHooks, 'f', 1.f);
+  add<bref::Pipeline::ParsingHook, bref::Pipeline::ParsingRequestHandler, Parse>
+    (pipeline.parsingHooks, 'g', 9.f, true);
+  add<bref::Pipeline::ParsingHook, bref::Pipeline::ParsingRequestHandler, Parse>
+    (pipeline.parsingHooks, 'h', 5.f);
+
+  const bref::PipelineExecutor executor(pipeline);
+  bref::Buffer                 buffer;
+
+  bref::Pipeline::OnReceiveRequestHandler receive = executor.receiveHandler(fixture.environment);
+
+  CHECK(receive && receive(0, buffer));
+  CHECK(toString(buffer) == "c");
+
+  bref::Pipeline::OnSendRequestHandler send = executor.sendHandler(fixture.environment);
+
+  CHECK(send && send(0, buffer));
+  CHECK(trace == "d");
+
+  bref::Pipeline::ParsingRequestHandler parse = executor.parsingHandler(fixture.environment);
+
+  trace.clear();
+  CHECK(parse && parse(fixture.response, buffer, fixture.request) == buffer.end());
+  CHECK(trace == "h");
+
+  // rien à appeler : handlers vides, le serveur fait le travail
+  const bref::PipelineExecutor empty;
+
+  CHECK(! empty.receiveHandler(fixture.environment));
+  CHECK(! empty.sendHandler(fixture.environment));
+  CHECK(! empty.parsingHandler(fixture.environment));
+
+  bref::Pipeline skipped;
+
+  add<bref::Pipeline::ParsingHook, bref::Pipeline::ParsingRequestHandler, Parse>
+    (skipped.parsingHooks, 'a', 1.f, true);
+  CHECK(! bref::PipelineExecutor(skipped).parsingHandler(fixture.environment));
+}
+
+void testContent()
+{
+  Fixture        fixture;
+  bref::Pipeline pipeline;
+  ContentHandler low;
+  ContentHandler high;
+  Content        lowHook  = { &low, 3 };
+  Content        skipHook = { 0, 4 };
+  Content        highHook = { &high, 5 };
+
+  pipeline.contentHooks.push_back(std::make_pair(bref::Pipeline::ContentHook(lowHook), 1.f));
+  pipeline.contentHooks.push_back(std::make_pair(bref::Pipeline::ContentHook(skipHook), 9.f));
+  pipeline.contentHooks.push_back(std::make_pair(bref::Pipeline::ContentHook(highHook), 2.f));
+
+  bref::FdType fd = -1;
+
+  CHECK(bref::PipelineExecutor(pipeline).contentHandler(fixture.environment, fixture.request,
+                                                        fixture.response, fd) == &high);
+  CHECK(fd == 5);
+
+  // fd garde la valeur donnée par le serveur
+  fd = -1;
+  pipeline.contentHooks.clear();
+  pipeline.contentHooks.push_back(std::make_pair(bref::Pipeline::ContentHook(skipHook), 1.f));
+  CHECK(bref::PipelineExecutor(pipeline).contentHandler(fixture.environment, fixture.request,
+                                                        fixture.response, fd) == 0);
+  CHECK(fd == -1);
+}
+
+/*
+  Tous les handlers des points de transformation du corps, Buffer et
+  BufferChain mélangés ; à priorité égale les hooks Buffer d'abord.
+*/
+void testStages()
+{
+  typedef bref::Pipeline P;
+
+  Fixture        fixture;
+  bref::Pipeline pipeline;
+
+  add<P::PostReceiveHook, P::PostReceiveRequestHandler, Append>(pipeline.postReceiveHooks, 'a', 1.f);
+  add<P::PostReceiveChainHook, P::PostReceiveChainRequestHandler, ChainAppend>
+    (pipeline.postReceiveChainHooks, 'b', 2.f);
+
+  add<P::PostContentHook, P::PostContentRequestHandler, Append>(pipeline.postContentHooks, 'a', 2.f);
+  add<P::PostContentChainHook, P::PostContentChainRequestHandler, ChainAppend>
+    (pipeline.postContentChainHooks, 'b', 2.f);
+  add<P::PostContentHook, P::PostContentRequestHandler, Append>(pipeline.postContentHooks, 'c', 5.f);
+  add<P::PostContentChainHook, P::PostContentChainRequestHandler, ChainAppend>
+    (pipeline.postContentChainHooks, 'd', 9.f, true);
+  add<P::PostContentHook, P::PostContentRequestHandler, Append>(pipeline.postContentHooks, 'e', 0.f);
+
+  add<P::TransformChainHook, P::TransformChainRequestHandler, ChainAppend>
+    (pipeline.transformChainHooks, 'f', 1.f);
+  add<P::TransformHook, P::TransformRequestHandler, Append>(pipeline.transformHooks, 'g', 1.f, true);
+  add<P::TransformHook, P::TransformRequestHandler, Append>(pipeline.transformHooks, 'h', 1.f);
+
+  const bref::PipelineExecutor executor(pipeline);
+  bref::Buffer                 data;
+  bref::Buffer                 scratch;
+
+  bref::PipelineExecutor::PostReceiveChain postReceive;
+
+  executor.postReceiveHandlers(fixture.environment, postReceive);
+  CHECK(postReceive.size() == 2);
+  postReceive(fixture.response, data, scratch);
+  CHECK(toString(data) == "ba");
+
+  bref::PipelineExecutor::PostContentChain postContent;
+
+  executor.postContentHandlers(fixture.environment, fixture.request, fixture.response, postContent);
+  CHECK(postContent.size() == 4);
+  data.clear();
+  postContent(fixture.response, data, scratch);
+  CHECK(toString(data) == "cabe");
+
+  bref::PipelineExecutor::TransformChain transform;
+
+  executor.transformHandlers(fixture.environment, fixture.request, fixture.response, transform);
+  CHECK(transform.size() == 2);
+  data.clear();
+  transform(fixture.response, data, scratch);
+  CHECK(toString(data) == "hf");
+
+  // la chaîne est vidée avant d'être remplie
+  executor.transformHandlers(fixture.environment, fixture.request, fixture.response, transform);
+  CHECK(transform.size() == 2);
+}
+
+/*
+  Un seul handler de pré-envoi entre les deux listes.
+*/
+void testPreSend()
+{
+  typedef bref::Pipeline P;
+
+  Fixture        fixture;
+  bref::Pipeline pipeline;
+
+  add<P::PreSendHook, P::PreSendRequestHandler, Append>(pipeline.preSendHooks, 'a', 1.f);
+  add<P::PreSendChainHook, P::PreSendChainRequestHandler, ChainAppend>
+    (pipeline.preSendChainHooks, 'b', 2.f);
+  add<P::PreSendHook, P::PreSendRequestHandler, Append>(pipeline.preSendHooks, 'c', 3.f, true);
+
+  const bref::PipelineExecutor         executor(pipeline);
+  bref::PipelineExecutor::PreSendChain chain;
+  bref::Buffer                         data;
+  bref::Buffer                         scratch;
+
+  executor.preSendHandlers(fixture.environment, fixture.request, fixture.response, chain);
+  CHECK(chain.size() == 1);
+  chain(fixture.response, data, scratch);
+  CHECK(toString(data) == "b");
+
+  // l'ancienne interface donne le même handler, adapté
+  const P::PreSendRequestHandler handler =
+    executor.preSendHandler(fixture.environment, fixture.request, fixture.response);
+
+  data.clear();
+  scratch.clear();
+  CHECK(handler);
+  handler(fixture.response, data, scratch);
+  CHECK(toString(scratch) == "b");
+
+  // un hook Buffer de plus haute priorité passe devant
+  add<P::PreSendHook, P::PreSendRequestHandler, Append>(pipeline.preSendHooks, 'd', 2.5f);
+
+  const bref::PipelineExecutor other(pipeline);
+
+  other.preSendHandlers(fixture.environment, fixture.request, fixture.response, chain);
+  data.clear();
+  chain(fixture.response, data, scratch);
+  CHECK(chain.size() == 1 && toString(data) == "d");
+
+  const bref::PipelineExecutor empty;
+
+  empty.preSendHandlers(fixture.environment, fixture.request, fixture.response, chain);
+  CHECK(chain.empty());
+  CHECK(! empty.preSendHandler(fixture.environment, fixture.request, fixture.response));
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testPriorityOrder();
+  testConnection();
+  testFirstHandler();
+  testContent();
+  testStages();
+  testPreSend();
+  return test::result();
+}
@@ -0,0 +1,119 @@
+/**
+ * \file   SnapshotHolderTest.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 25 11:02:37 2012
+ *
+ * \brief  SnapshotHolder and ConfigHolder stress tests.
+ *
+ */
+
+#include "Check.h"
+
+#include "bref/ConfigSnapshot.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int ReaderCount = 4;
+const int Publishes   = 20000;
+
+std::atomic<int> live(0);
+
+struct Value
+{
+  int version;
+
+  explicit Value(int theVersion)
+    : version(theVersion)
+  {
+    ++live;
+  }
+
+  ~Value()
+  {
+    --live;
+  }
+};
+
+/*
+  Des lecteurs chargent sans arrêt pendant que l'écrivain publie : une
+  version chargée ne recule jamais et toutes les versions sont
+  détruites à la fin. Les latences de load() pendant les rechargements
+  sont mesurées par bench/SnapshotHolderBench.cpp.
+*/
+void testStress()
+{
+  {
+    bref::SnapshotHolder<Value> holder(std::make_shared<Value>(0));
+    std::atomic<bool>           stop(false);
+    std::atomic<int>            regressions(0);
+    std::atomic<int>            started(0);
+    std::vector<std::thread>    readers;
+
+    for (int i = 0; i < ReaderCount; ++i)
+      readers.push_back(std::thread([&] {
+            bref::SnapshotHolder<Value>::Pin kept;
+            int                              last  = 0;
+            long                             loads = 0;
+
+            ++started;
+            while (! stop.load(std::memory_order_relaxed))
+              {
+                bref::SnapshotHolder<Value>::Pin pin = holder.load();
+
+                if (pin->version < last)
+                  ++regressions;
+                last = pin->version;
+                // un pin gardé de temps en temps retarde la destruction
+                if (++loads % 64 == 0)
+                  kept = pin;
+              }
+          }));
+    while (started < ReaderCount)
+      std::this_thread::yield();
+    for (int i = 1; i <= Publishes; ++i)
+      holder.publish(std::make_shared<Value>(i));
+    stop = true;
+    for (std::size_t i = 0; i < readers.size(); ++i)
+      readers[i].join();
+
+    CHECK(regressions == 0);
+    CHECK(holder.load()->version == Publishes);
+    CHECK(holder.version() == static_cast<uint64_t>(Publishes) + 1);
+    CHECK(live == 1);
+  }
+  CHECK(live == 0);
+}
+
+/*
+  Une requête garde sa configuration pendant un rechargement, les
+  KeyHandle restent valides d'un snapshot au suivant.
+*/
+void testConfigReload()
+{
+  bref::BrefValue config = bref::BrefValue(bref::BrefValueArray());
+
+  config["DocumentRoot"] = bref::BrefValue("/a");
+
+  bref::ConfigHolder            configs(bref::ConfigSnapshot::create(config));
+  const bref::KeyHandle         key = configs.load()->helper.internKey("DocumentRoot");
+  const bref::ConfigHolder::Pin old = configs.load();
+
+  config["DocumentRoot"] = bref::BrefValue("/b");
+  configs.publish(bref::ConfigSnapshot::create(config, *configs.load()));
+  CHECK(old->helper.findValue(key).asString() == "/a");
+  CHECK(configs.load()->helper.findValue(key).asString() == "/b");
+  CHECK(configs.load()->config.asArray().find("DocumentRoot")->second.asString() == "/b");
+}
+
+} // ! unnamed namespace
+
+int main()
+{
+  testStress();
+  testConfigReload();
+  return test::result();
+}
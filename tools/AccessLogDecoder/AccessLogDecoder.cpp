@@ -0,0 +1,173 @@
+/**
+ * \file   AccessLogDecoder.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Sat May 12 10:26:05 2012
+ *
+ * \brief  Décodeur des journaux d'accès binaires (voir
+ *         bref::MappedAccessLog).
+ *
+ */
+
+// PRIu64 et PRIu32 en C++03
+#ifndef __STDC_FORMAT_MACROS
+# define __STDC_FORMAT_MACROS
+#endif
+
+#include "bref/AccessRecord.h"
+
+#include <inttypes.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+enum OutputFormat
+  {
+    TextFormat,
+    CsvFormat
+  };
+
+/*
+  L'heure est écrite en UTC, à la microseconde, comme AsyncLogger.
+*/
+void printTime(std::FILE *out, uint64_t time)
+{
+  const std::time_t seconds = static_cast<std::time_t>(time / 1000000);
+  std::tm           tm;
+  char              buffer[32];
+
+#if defined(_WIN32) || defined(__WIN32__) || defined(WIN32)
+  gmtime_s(&tm, &seconds);
+#else
+  gmtime_r(&seconds, &tm);
+#endif
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+  std::fprintf(out, "%s.%06" PRIu64, buffer, time % 1000000);
+}
+
+void printText(std::FILE *out, const bref::AccessRecord & record)
+{
+  char buffer[bref::AccessRecord::MaxStringSize];
+
+  printTime(out, record.time);
+  std::fputc(' ', out);
+  std::fwrite(buffer, 1, record.toChars(buffer), out);
+  std::fputc('\n', out);
+}
+
+void printCsvHeader(std::FILE *out)
+{
+  std::fputs("time,client,port,method,version,status,bytes_received,bytes_sent,"
+             "receive_us,process_us,send_us,total_us\n", out);
+}
+
+void printCsv(std::FILE *out, const bref::AccessRecord & record)
+{
+  char               client[bref::util::MaxIpAddressSize];
+  const std::size_t  clientSize = bref::util::isV4Mapped(record.client)
+    ? bref::util::formatIPv4(record.client + 12, client)
+    : bref::util::formatIPv6(record.client, client);
+
+  printTime(out, record.time);
+  std::fprintf(out, ",%.*s,%u,%s,%u.%u,%u,%" PRIu64 ",%" PRIu64,
+               static_cast<int>(clientSize), client,
+               static_cast<unsigned>(record.port),
+               bref::AccessRecord::methodName(record.method),
+               static_cast<unsigned>(record.version >> 4),
+               static_cast<unsigned>(record.version & 0xf),
+               static_cast<unsigned>(record.status),
+               record.bytesReceived,
+               record.bytesSent);
+  for (int i = 0; i < bref::AccessRecord::StageCount; ++i)
+    std::fprintf(out, ",%" PRIu32, record.stageTimes[i]);
+  std::fputc('\n', out);
+}
+
+/*
+  Un enregistrement dont le champ commit n'est pas positionné n'a pas été
+  écrit entièrement. La fin d'un fichier non tronqué (serveur arrêté
+  brutalement) ne contient que des zéros, ce ne sont pas des erreurs.
+*/
+bool isUnused(const bref::AccessRecord & record)
+{
+  static const bref::AccessRecord zero;
+
+  return std::memcmp(&record, &zero, sizeof(record)) == 0;
+}
+
+int decode(const char *path, OutputFormat format)
+{
+  std::FILE *in = std::fopen(path, "rb");
+
+  if (! in)
+    {
+      std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+      return 1;
+    }
+
+  bref::AccessLogHeader header;
+
+  if (std::fread(&header, sizeof(header), 1, in) != 1 || ! header.isValid())
+    {
+      std::fprintf(stderr, "%s: not an access log, or written on another architecture\n", path);
+      std::fclose(in);
+      return 1;
+    }
+
+  bref::AccessRecord records[256];
+  uint64_t           incomplete = 0;
+  std::size_t        count;
+
+  while ((count = std::fread(records, sizeof(*records), sizeof(records) / sizeof(*records), in)) > 0)
+    for (std::size_t i = 0; i < count; ++i)
+      {
+        if (records[i].commit != bref::AccessRecord::Committed)
+          {
+            if (! isUnused(records[i]))
+              ++incomplete;
+          }
+        else if (format == CsvFormat)
+          printCsv(stdout, records[i]);
+        else
+          printText(stdout, records[i]);
+      }
+
+  const bool error = std::ferror(in) != 0;
+
+  if (error)
+    std::fprintf(stderr, "%s: read error\n", path);
+  if (incomplete)
+    std::fprintf(stderr, "%s: %" PRIu64 " incomplete records skipped\n", path, incomplete);
+  std::fclose(in);
+  return error ? 1 : 0;
+}
+
+} // ! anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  OutputFormat format = TextFormat;
+  int          first  = 1;
+
+  if (first < argc && std::strcmp(argv[first], "--csv") == 0)
+    {
+      format = CsvFormat;
+      ++first;
+    }
+  if (first == argc)
+    {
+      std::fprintf(stderr, "usage: %s [--csv] access.bin...\n", argv[0]);
+      return 2;
+    }
+
+  int status = 0;
+
+  if (format == CsvFormat)
+    printCsvHeader(stdout);
+  for (int i = first; i < argc; ++i)
+    status |= decode(argv[i], format);
+  return status;
+}
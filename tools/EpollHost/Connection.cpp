@@ -0,0 +1,978 @@
+/**
+ * \file   Connection.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 10:02:17 2012
+ *
+ * \brief  Connection definition.
+ *
+ */
+
+#include "Connection.h"
+
+#include "bref/ScopedLogger.h"
+#include "bref/detail/util/ICaseStringCmp.hpp"
+#include "bref/detail/util/ContentLength.hpp"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+namespace {
+
+const std::size_t HeaderDelay   = 64 * 1024;    // corps retenu pour calculer Content-Length
+const std::size_t HighWater     = 1024 * 1024;  // au-delà, la production attend l'envoi
+const std::size_t InputLimit    = 1024 * 1024;  // au-delà, la lecture attend le traitement
+const std::size_t MaxHeaderSize = 64 * 1024;
+const int         ChunksPerTurn = 16;           // appels à outContent() avant de passer la main
+const std::size_t FilePerTurn   = 4 * 1024 * 1024;    // octets de fichier envoyés avant de passer la main
+
+uint64_t microseconds(clockid_t clock)
+{
+  struct timespec now;
+
+  ::clock_gettime(clock, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+uint32_t elapsed(uint64_t from, uint64_t to)
+{
+  return from && to > from ? static_cast<uint32_t>(std::min<uint64_t>(to - from, UINT32_MAX)) : 0;
+}
+
+/*
+  Cherche \p token dans une liste séparée par des virgules
+  ("keep-alive, Upgrade"), sans tenir compte de la casse.
+*/
+bool hasToken(const bref::BrefValue & value, const char *token)
+{
+  if (value.isList())
+    {
+      const bref::BrefValueList & list = value.asList();
+
+      for (bref::BrefValueList::const_iterator it = list.begin(); it != list.end(); ++it)
+        if (hasToken(*it, token))
+          return true;
+      return false;
+    }
+
+  const std::string & text = value.asString();
+  const std::size_t   size = std::strlen(token);
+  std::size_t         pos  = 0;
+
+  while (pos < text.size())
+    {
+      std::size_t end = text.find(',', pos);
+
+      if (end == std::string::npos)
+        end = text.size();
+
+      std::size_t first = pos;
+      std::size_t last  = end;
+
+      while (first < last && (text[first] == ' ' || text[first] == '\t'))
+        ++first;
+      while (last > first && (text[last - 1] == ' ' || text[last - 1] == '\t'))
+        --last;
+      if (last - first == size && bref::util::icaseEqual(text.data() + first, token, size))
+        return true;
+      pos = end + 1;
+    }
+  return false;
+}
+
+bool parseLength(const bref::BrefValue & value, uint64_t & length)
+{
+  if (value.isInt())
+    {
+      length = static_cast<uint64_t>(value.asInt());
+      return value.asInt() >= 0;
+    }
+  if (! value.isString() || value.asString().empty() || value.asString().size() > 18)
+    return false;
+
+  const std::string & text = value.asString();
+
+  length = 0;
+  for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+    {
+      if (*it < '0' || *it > '9')
+        return false;
+      length = length * 10 + (*it - '0');
+    }
+  return true;
+}
+
+void eraseField(bref::HttpHeader & header, bref::header_fields::Type field)
+{
+  const bref::HttpHeader::iterator it = header.find(field);
+
+  if (it != header.end())
+    header.erase(it);
+}
+
+} // ! unnamed namespace
+
+Connection::Connection(EventLoop & loop, int socket, const bref::Environment::Client & client)
+  : loop_(loop)
+  , host_(loop.host())
+  , socket_(socket)
+  , entry_()
+  , lastActive_(0)
+  , sessionConfig_(loop.host().configs.load())
+  , config_(sessionConfig_)
+  , arena_()
+  , environment_(config_->config, config_->helper, loop.host().logger, client, &arena_)
+  , sessions_()
+  , sessionExecutor_()
+  , executor_(&loop.host().executor)
+  , state_(ReadingHeader)
+  , content_(0)
+  , contentFd_(-1)
+  , file_()
+  , contentWatched_(false)
+  , contentPaused_(false)
+  , inFinished_(false)
+  , bodyRemaining_(0)
+  , outputOffset_(0)
+  , sendPending_(false)
+  , headerSent_(false)
+  , chunked_(false)
+  , withoutBody_(false)
+  , keepAlive_(true)
+  , readBlocked_(false)
+  , closed_(false)
+  , record_()
+  , started_(0)
+  , parsed_(0)
+  , produced_(0)
+  , firstSent_(0)
+{
+  socketWatch_.kind        = Watch::Client;
+  socketWatch_.connection  = this;
+  contentWatch_.kind       = Watch::Content;
+  contentWatch_.connection = this;
+  record_.setClient(client.Ip, static_cast<unsigned short>(client.Port));
+}
+
+Connection::~Connection()
+{ }
+
+/*
+  La plupart des connexions n'ont pas de hook de session : elles
+  partagent l'executor de l'hôte. Sinon les hooks de la session sont
+  compilés avec les hooks globaux, une fois par connexion.
+*/
+void Connection::open()
+{
+  bref::Pipeline session;
+
+  // flushOutput() rappelle un handler d'envoi qui a gardé une partie
+  // des données (EAGAIN)
+  session.deferredSend = true;
+  host_.modules.registerSessionHooks(session, sessions_);
+  if (mergePipeline(session, host_.pipeline))
+    {
+      sessionExecutor_.reset(new bref::PipelineExecutor(session));
+      executor_ = sessionExecutor_.get();
+    }
+
+  if (! executor_->connection(response_, environment_))
+    {
+      // la connexion est refusée, avec une réponse si le hook en a
+      // donné une
+      if (response_.getStatus() == bref::status_codes::UndefinedStatusCode)
+        close();
+      else
+        {
+          fail(response_.getStatus());
+          process();
+        }
+      return;
+    }
+
+  receive_ = executor_->receiveHandler(environment_);
+  send_    = executor_->sendHandler(environment_);
+  parse_   = executor_->parsingHandler(environment_);
+  executor_->postReceiveHandlers(environment_, postReceive_);
+  if (! parse_)
+    {
+      LOG_ERROR(host_.logger) << "no parsing hook, a parser module (mod_parser) must be loaded";
+      fail(bref::status_codes::InternalServerError);
+      process();
+    }
+}
+
+/*
+  La socket est en edge-triggered : elle est lue jusqu'à EAGAIN. Une
+  lecture incomplète signifie que la socket est vide, la prochaine
+  réception donnera un nouvel évènement ; sauf après une fermeture du
+  client (\p hangup), qui n'en donnera plus.
+*/
+void Connection::onReadable(bool hangup)
+{
+  char *buffer = loop_.readBuffer();
+  bool  eof    = false;
+
+  readBlocked_ = false;
+  while (! eof)
+    {
+      if (input_.size() >= InputLimit)
+        {
+          readBlocked_ = true;
+          break;
+        }
+
+      std::size_t size;
+
+      if (receive_)
+        {
+          chunk_.clear();
+          if (! receive_(socket_, chunk_))
+            {
+              close();
+              return;
+            }
+          if (chunk_.empty())
+            break;
+          size = chunk_.size();
+        }
+      else
+        {
+          const ssize_t count = ::read(socket_, buffer, EventLoop::ReadSize);
+
+          if (count < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+              close();
+              return;
+            }
+          if (count == 0)
+            {
+              eof = true;
+              break;
+            }
+          size = count;
+          if (postReceive_.empty())
+            input_.insert(input_.end(), buffer, buffer + size);
+          else
+            chunk_.assign(buffer, buffer + size);
+        }
+
+      if (! postReceive_.empty())
+        postReceive_(response_, chunk_, scratch_);
+      if (receive_ || ! postReceive_.empty())
+        input_.insert(input_.end(), chunk_.begin(), chunk_.end());
+      if (! receive_ && ! hangup && size < EventLoop::ReadSize)
+        break;
+    }
+
+  process();
+  if (eof && ! closed_)
+    {
+      // le client a fermé son côté, la requête en cours est terminée si
+      // elle a été reçue entièrement
+      if (state_ == ReadingHeader || state_ == ReadingBody)
+        close();
+      else
+        keepAlive_ = false;
+    }
+}
+
+void Connection::onWritable()
+{
+  if (! flush())
+    return;
+  if (contentPaused_)
+    {
+      contentPaused_ = false;
+      loop_.modify(contentFd_, EPOLLIN, &contentWatch_);
+    }
+  resume();
+}
+
+/*
+  Le fd du module est prêt, un seul appel à outContent() par
+  évènement : le fd est en level-triggered, il sera signalé à nouveau
+  s'il reste des données.
+*/
+void Connection::onContentEvent()
+{
+  if (state_ != Producing)
+    return;
+  if (produceChunk())
+    {
+      process();
+      return;
+    }
+  if (! closed_ && ! flush() && ! closed_ && blocked())
+    {
+      contentPaused_ = true;
+      loop_.modify(contentFd_, 0, &contentWatch_);
+    }
+}
+
+void Connection::resume()
+{
+  process();
+  if (readBlocked_ && ! closed_)
+    onReadable(false);
+}
+
+void Connection::process()
+{
+  bool progress = true;
+
+  while (progress && ! closed_)
+    switch (state_)
+      {
+      case ReadingHeader:
+        progress = readHeader();
+        break;
+
+      case ReadingBody:
+        progress = readBody();
+        break;
+
+      case Producing:
+        progress = produce();
+        break;
+
+      case Sending:
+        progress = flush();
+        if (progress)
+          finishRequest();
+        break;
+      }
+  if (! closed_ && state_ != Sending)
+    flush();
+}
+
+bool Connection::readHeader()
+{
+  if (input_.empty())
+    return false;
+  if (! started_)
+    {
+      started_     = microseconds(CLOCK_MONOTONIC);
+      record_.time = microseconds(CLOCK_REALTIME);
+    }
+
+  const bref::Buffer::const_iterator end = parse_(response_, input_, request_);
+
+  if (end == input_.begin())
+    {
+      if (input_.size() > MaxHeaderSize)
+        fail(bref::status_codes::RequestEntityTooLarge);
+      return state_ == Sending;
+    }
+
+  const std::size_t consumed = end - input_.begin();
+
+  record_.bytesReceived += consumed;
+  input_.erase(input_.begin(), input_.begin() + consumed);
+  if (response_.getStatus() >= bref::status_codes::BadRequest)
+    fail(response_.getStatus());
+  else
+    beginRequest();
+  return true;
+}
+
+/*
+  La configuration est reprise à chaque requête : une connexion
+  keep-alive voit un rechargement (SIGHUP) dès sa requête suivante.
+
+  L'Environment, qui référence la configuration, est reconstruit à la
+  même adresse puisque les handlers de la connexion (réception,
+  parsing, envoi) gardent une référence dessus. sessionConfig_ garde
+  la configuration donnée à ces handlers à l'ouverture.
+*/
+void Connection::pinConfig()
+{
+  bref::ConfigHolder::Pin latest = host_.configs.load();
+
+  if (latest == config_)
+    return;
+
+  const bref::Environment::Client client = environment_.client;
+
+  environment_.~Environment();
+  config_.swap(latest);
+  new (&environment_) bref::Environment(config_->config, config_->helper, host_.logger, client, &arena_);
+}
+
+void Connection::beginRequest()
+{
+  parsed_ = microseconds(CLOCK_MONOTONIC);
+  pinConfig();
+
+  const bref::Version &                  version    = request_.getVersion();
+  const bref::HttpHeader::const_iterator connection = request_.find(bref::header_fields::Connection);
+
+  if (version.Major > 1 || (version.Major == 1 && version.Minor >= 1))
+    keepAlive_ = connection == request_.end() || ! hasToken(connection->second, "close");
+  else
+    keepAlive_ = connection != request_.end() && hasToken(connection->second, "keep-alive");
+
+  executor_->postParsing(environment_, request_, response_);
+
+  if (request_.count(bref::header_fields::TransferEncoding))
+    {
+      fail(bref::status_codes::NotImplemented);
+      return;
+    }
+
+  const bref::HttpHeader::const_iterator length = request_.find(bref::header_fields::ContentLength);
+
+  bodyRemaining_ = 0;
+  if (length != request_.end() && ! parseLength(length->second, bodyRemaining_))
+    {
+      fail(bref::status_codes::BadRequest);
+      return;
+    }
+
+  const bref::HttpHeader::const_iterator expect = request_.find(bref::header_fields::Expect);
+
+  if (bodyRemaining_ && expect != request_.end() && hasToken(expect->second, "100-continue"))
+    {
+      static const char continueLine[] = "HTTP/1.1 100 Continue\r\n\r\n";
+
+      output_.insert(output_.end(), continueLine, continueLine + sizeof continueLine - 1);
+    }
+
+  contentFd_  = -1;
+  inFinished_ = false;
+  content_    = executor_->contentHandler(environment_, request_, response_, contentFd_);
+  if (! content_ && response_.getStatus() == bref::status_codes::UndefinedStatusCode)
+    response_.setStatus(bref::status_codes::NotFound);
+  state_ = ReadingBody;
+}
+
+/*
+  Le corps est donné à inContent() au fur et à mesure de sa réception,
+  puis un buffer vide signale sa fin si le handler ne l'a pas déjà
+  refusé. Sans handler le corps est lu et ignoré.
+*/
+bool Connection::readBody()
+{
+  const std::size_t size = static_cast<std::size_t>(std::min<uint64_t>(bodyRemaining_, input_.size()));
+
+  if (size)
+    {
+      if (size == input_.size())
+        {
+          chunk_.swap(input_);
+          input_.clear();
+        }
+      else
+        {
+          chunk_.assign(input_.begin(), input_.begin() + size);
+          input_.erase(input_.begin(), input_.begin() + size);
+        }
+      if (content_ && ! inFinished_)
+        inFinished_ = content_->inContent(response_, chunk_);
+      bodyRemaining_        -= size;
+      record_.bytesReceived += size;
+    }
+  if (bodyRemaining_)
+    return false;
+  if (content_ && ! inFinished_)
+    {
+      chunk_.clear();
+      content_->inContent(response_, chunk_);
+      inFinished_ = true;
+    }
+  startContent();
+  return true;
+}
+
+void Connection::startContent()
+{
+  executor_->postContentHandlers(environment_, request_, response_, postContent_);
+  executor_->transformHandlers(environment_, request_, response_, transform_);
+  executor_->preSendHandlers(environment_, request_, response_, preSend_);
+  state_ = Producing;
+
+  if (! content_)
+    {
+      chunk_.clear();
+      emit(chunk_, true);
+      produced_ = microseconds(CLOCK_MONOTONIC);
+      state_    = Sending;
+      return;
+    }
+
+  // sans chaîne ni handler d'envoi personne n'a besoin des octets du
+  // corps : le handler peut donner un fichier, envoyé avec sendfile()
+  if (! send_ && postContent_.empty() && transform_.empty() && preSend_.empty())
+    {
+      file_.fd     = -1;
+      file_.offset = 0;
+      file_.length = 0;
+      if (content_->outFile(response_, file_))
+        {
+          startFile();
+          return;
+        }
+      file_.length = 0;
+    }
+  if (contentFd_ != -1)
+    {
+      // un fichier régulier ne peut pas être surveillé (EPERM), il est
+      // lu sans attendre
+      if (loop_.add(contentFd_, EPOLLIN, &contentWatch_))
+        contentWatched_ = true;
+      else
+        LOG_DEBUG(host_.logger) << "fd " << contentFd_ << " can't be watched (" << std::strerror(errno)
+                                << "), the content is produced without waiting";
+    }
+}
+
+/*
+  Le corps est un fichier : l'en-tête part avec sa taille, flush()
+  envoie ensuite le fichier avec sendfile().
+*/
+void Connection::startFile()
+{
+  if (response_.getStatus() == bref::status_codes::UndefinedStatusCode)
+    response_.setStatus(bref::status_codes::OK);
+
+  const int  status   = response_.getStatus();
+  const bool bodyless = status < 200 || status == bref::status_codes::NoContent
+    || status == bref::status_codes::NotModified;
+
+  eraseField(response_, bref::header_fields::TransferEncoding);
+  if (bodyless)
+    eraseField(response_, bref::header_fields::ContentLength);
+  else
+    response_[bref::header_fields::ContentLength] = bref::util::lengthValue(file_.length);
+  withoutBody_ = bodyless || request_.getMethod() == bref::request_methods::Head;
+  if (withoutBody_)
+    file_.length = 0;
+  writeHeader();
+  produced_ = microseconds(CLOCK_MONOTONIC);
+  state_    = Sending;
+}
+
+void Connection::endContent()
+{
+  if (contentWatched_)
+    {
+      loop_.remove(contentFd_);
+      contentWatched_ = false;
+      contentPaused_  = false;
+    }
+  if (content_)
+    {
+      // le fichier donné par outFile() appartient au handler
+      file_.length = 0;
+      content_->dispose();
+      content_ = 0;
+    }
+}
+
+/*
+  Sans fd, outContent() est appelé jusqu'à la fin du corps. La
+  production s'arrête lorsque trop de données attendent l'envoi
+  (reprise sur EPOLLOUT), ou après ChunksPerTurn appels pour laisser
+  passer les autres connexions de la boucle (reprise par defer()).
+*/
+bool Connection::produce()
+{
+  if (contentWatched_)
+    return false;
+  for (int i = 0; i < ChunksPerTurn; ++i)
+    {
+      if (blocked())
+        return false;
+      if (produceChunk())
+        return true;
+      if (closed_)
+        return false;
+    }
+  loop_.defer(this);
+  return false;
+}
+
+bool Connection::produceChunk()
+{
+  chunk_.clear();
+
+  const bool finished = content_->outContent(response_, chunk_);
+
+  emit(chunk_, finished);
+  if (finished)
+    {
+      endContent();
+      produced_ = microseconds(CLOCK_MONOTONIC);
+      state_    = Sending;
+    }
+  else if (output_.size() - outputOffset_ >= HeaderDelay)
+    flush();
+  return finished;
+}
+
+/*
+  Passe un morceau du corps dans les chaînes postContent, transform et
+  preSend puis le met dans output_.
+
+  L'en-tête est retardé jusqu'à HeaderDelay octets de corps : une
+  réponse produite entièrement reçoit un Content-Length exact. Au-delà
+  la taille donnée par le module est conservée si aucune chaîne ne
+  peut modifier le corps, sinon le corps est envoyé en chunked (ou
+  jusqu'à la fermeture pour un client HTTP/1.0).
+*/
+void Connection::emit(bref::Buffer & data, bool last)
+{
+  if (! postContent_.empty())
+    postContent_(response_, data, scratch_);
+  if (! transform_.empty())
+    transform_(response_, data, scratch_);
+  if (! preSend_.empty())
+    preSend_(response_, data, scratch_);
+
+  if (! headerSent_)
+    {
+      if (! last && pendingBody_.size() + data.size() < HeaderDelay)
+        {
+          pendingBody_.insert(pendingBody_.end(), data.begin(), data.end());
+          return;
+        }
+      if (response_.getStatus() == bref::status_codes::UndefinedStatusCode)
+        response_.setStatus(bref::status_codes::OK);
+
+      const int  status   = response_.getStatus();
+      const bool bodyless = status < 200 || status == bref::status_codes::NoContent
+        || status == bref::status_codes::NotModified;
+      const bool filtered = ! postContent_.empty() || ! transform_.empty() || ! preSend_.empty();
+
+      if (bodyless)
+        eraseField(response_, bref::header_fields::ContentLength);
+      else if (last)
+        response_[bref::header_fields::ContentLength] = bref::util::lengthValue(pendingBody_.size() + data.size());
+      else if (filtered || ! response_.count(bref::header_fields::ContentLength))
+        {
+          const bref::Version & version = request_.getVersion();
+
+          eraseField(response_, bref::header_fields::ContentLength);
+          if (version.Major > 1 || (version.Major == 1 && version.Minor >= 1))
+            {
+              chunked_ = true;
+              response_[bref::header_fields::TransferEncoding] = bref::BrefValue("chunked");
+            }
+          else
+            keepAlive_ = false;
+        }
+      withoutBody_ = bodyless || request_.getMethod() == bref::request_methods::Head;
+      writeHeader();
+      appendBody(pendingBody_);
+      pendingBody_.clear();
+    }
+  appendBody(data);
+  if (last && chunked_ && ! withoutBody_)
+    {
+      static const char lastChunk[] = "0\r\n\r\n";
+
+      output_.insert(output_.end(), lastChunk, lastChunk + sizeof lastChunk - 1);
+    }
+}
+
+void Connection::writeHeader()
+{
+  const bref::HttpHeader::const_iterator connection = response_.find(bref::header_fields::Connection);
+
+  if (connection != response_.end() && hasToken(connection->second, "close"))
+    keepAlive_ = false;
+  if (! keepAlive_)
+    response_[bref::header_fields::Connection] = bref::BrefValue("close");
+  else if (request_.getVersion().Major == 1 && request_.getVersion().Minor == 0)
+    response_[bref::header_fields::Connection] = bref::BrefValue("keep-alive");
+  if (response_.getVersion().Major == 0)
+    response_.setVersion(bref::Version(1, 1));
+  response_.appendRawData(output_);
+  headerSent_ = true;
+}
+
+void Connection::appendBody(const bref::Buffer & data)
+{
+  if (withoutBody_ || data.empty())
+    return;
+  if (chunked_)
+    {
+      static const char hex[] = "0123456789abcdef";
+      char              size[24];
+      char             *pos = size + sizeof size;
+
+      *--pos = '\n';
+      *--pos = '\r';
+      for (std::size_t value = data.size(); value; value >>= 4)
+        *--pos = hex[value & 0xf];
+      output_.insert(output_.end(), pos, size + sizeof size);
+      output_.insert(output_.end(), data.begin(), data.end());
+      output_.push_back('\r');
+      output_.push_back('\n');
+    }
+  else
+    output_.insert(output_.end(), data.begin(), data.end());
+}
+
+/*
+  La réponse est envoyée, la connexion attend la requête suivante (ou
+  la traite si elle a déjà été reçue).
+*/
+void Connection::finishRequest()
+{
+  const uint64_t now = microseconds(CLOCK_MONOTONIC);
+
+  record_.status = static_cast<uint16_t>(response_.getStatus());
+  record_.setRequest(request_.getMethod(), request_.getVersion());
+  record_.stageTimes[bref::AccessRecord::ReceiveStage] = elapsed(started_, parsed_);
+  record_.stageTimes[bref::AccessRecord::ProcessStage] = elapsed(parsed_, produced_);
+  record_.stageTimes[bref::AccessRecord::SendStage]    = elapsed(firstSent_, now);
+  record_.stageTimes[bref::AccessRecord::TotalStage]   = elapsed(started_, now);
+  host_.logger->logAccess(record_);
+
+  endContent();
+  request_.clear();
+  response_.clear();
+  arena_.reset();
+  postContent_.clear();
+  transform_.clear();
+  preSend_.clear();
+  if (output_.capacity() > HighWater)
+    bref::Buffer().swap(output_);
+
+  state_       = ReadingHeader;
+  headerSent_  = false;
+  chunked_     = false;
+  withoutBody_ = false;
+  started_     = 0;
+  parsed_      = 0;
+  produced_    = 0;
+  firstSent_   = 0;
+  record_      = bref::AccessRecord();
+  record_.setClient(environment_.client.Ip, static_cast<unsigned short>(environment_.client.Port));
+
+  if (! keepAlive_)
+    close();
+}
+
+/*
+  Répond \p status sans corps et ferme la connexion : la suite de
+  l'entrée ne peut plus être interprétée.
+*/
+void Connection::fail(bref::status_codes::Type status)
+{
+  const uint64_t now = microseconds(CLOCK_MONOTONIC);
+
+  endContent();
+  if (! started_)
+    {
+      started_     = now;
+      record_.time = microseconds(CLOCK_REALTIME);
+    }
+  if (! parsed_)
+    parsed_ = now;
+  produced_ = now;
+
+  response_.clear();
+  response_.setVersion(bref::Version(1, 1));
+  response_.setStatus(status);
+  response_[bref::header_fields::ContentLength] = bref::BrefValue(0);
+  keepAlive_   = false;
+  withoutBody_ = true;
+  input_.clear();
+  pendingBody_.clear();
+  if (! headerSent_)
+    writeHeader();
+  state_ = Sending;
+}
+
+/*
+  Envoie output_, puis le fichier donné par outFile().
+*/
+bool Connection::flush()
+{
+  std::size_t budget = FilePerTurn;
+
+  while (flushOutput())
+    {
+      if (! file_.length)
+        return true;
+      if (! sendFile(budget))
+        return false;
+    }
+  return false;
+}
+
+bool Connection::flushOutput()
+{
+  if (outputOffset_ == output_.size() && ! sendPending_)
+    return true;
+  if (! firstSent_)
+    firstSent_ = microseconds(CLOCK_MONOTONIC);
+
+  if (send_)
+    {
+      // le handler a gardé une partie de l'envoi précédent (EAGAIN) : il
+      // est rappelé avec un buffer vide jusqu'à ce qu'elle soit partie
+      if (sendPending_)
+        {
+          static const bref::Buffer nothing;
+
+          if (! send_(socket_, nothing))
+            return sendFailed();
+          sendPending_ = false;
+          if (outputOffset_ == output_.size())
+            return true;
+        }
+      if (outputOffset_)
+        output_.erase(output_.begin(), output_.begin() + outputOffset_);
+      record_.bytesSent += output_.size();
+
+      const bool sent = send_(socket_, output_);
+
+      output_.clear();
+      outputOffset_ = 0;
+      return sent || sendFailed();
+    }
+
+  while (outputOffset_ < output_.size())
+    {
+      const ssize_t sent = ::send(socket_, &output_[outputOffset_], output_.size() - outputOffset_, MSG_NOSIGNAL);
+
+      if (sent < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+              // la partie envoyée est retirée lorsqu'elle devient
+              // grande, les ajouts suivants ne la déplacent pas
+              if (outputOffset_ >= HeaderDelay && outputOffset_ * 2 >= output_.size())
+                {
+                  output_.erase(output_.begin(), output_.begin() + outputOffset_);
+                  outputOffset_ = 0;
+                }
+              return false;
+            }
+          close();
+          return false;
+        }
+      outputOffset_     += sent;
+      record_.bytesSent += sent;
+    }
+  output_.clear();
+  outputOffset_ = 0;
+  return true;
+}
+
+/*
+  Un handler d'envoi qui retourne false avec errno à EAGAIN a pris le
+  buffer mais n'a pas tout envoyé : la connexion attend EPOLLOUT, comme
+  pour un send() qui rencontre EAGAIN. Toute autre erreur ferme la
+  connexion.
+*/
+bool Connection::sendFailed()
+{
+  if (errno == EAGAIN || errno == EWOULDBLOCK)
+    sendPending_ = true;
+  else
+    close();
+  return false;
+}
+
+bool Connection::blocked() const
+{
+  return output_.size() - outputOffset_ >= HighWater;
+}
+
+void Connection::close()
+{
+  if (closed_)
+    return;
+  closed_ = true;
+  endContent();
+  for (std::vector<bref::IDisposable *>::iterator it = sessions_.begin(); it != sessions_.end(); ++it)
+    (*it)->dispose();
+  sessions_.clear();
+  // la fermeture retire aussi la socket de l'epoll
+  ::close(socket_);
+  loop_.release(this);
+}
+
+bool Connection::closed() const
+{
+  return closed_;
+}
+
+/*
+  Envoie le fichier jusqu'à EAGAIN, ou jusqu'à ce que \p budget octets
+  soient partis : un client rapide ne garde pas la boucle, l'envoi
+  reprend par defer() comme dans produce(). Un fichier que sendfile()
+  refuse est lu dans output_ par morceaux de HeaderDelay octets ;
+  retourne true lorsque output_ a été rempli ou que le fichier est
+  envoyé.
+*/
+bool Connection::sendFile(std::size_t & budget)
+{
+  while (file_.length)
+    {
+      if (! budget)
+        {
+          loop_.defer(this);
+          return false;
+        }
+
+      off_t         offset = static_cast<off_t>(file_.offset);
+      const ssize_t sent   = ::sendfile(socket_, file_.fd, &offset,
+                                        static_cast<std::size_t>(std::min<uint64_t>(file_.length, budget)));
+
+      if (sent > 0)
+        {
+          file_.offset      += sent;
+          file_.length      -= sent;
+          record_.bytesSent += sent;
+          budget            -= sent;
+          continue;
+        }
+      if (sent < 0 && errno == EINTR)
+        continue;
+      if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return false;
+      if (sent < 0 && (errno == EINVAL || errno == ENOSYS))
+        {
+          output_.resize(static_cast<std::size_t>(std::min<uint64_t>(file_.length, HeaderDelay)));
+          outputOffset_ = 0;
+
+          const ssize_t count = ::pread(file_.fd, &output_[0], output_.size(), offset);
+
+          if (count > 0)
+            {
+              output_.resize(count);
+              file_.offset += count;
+              file_.length -= count;
+              budget       -= std::min<std::size_t>(budget, count);
+              return true;
+            }
+          output_.clear();
+        }
+
+      // le fichier a raccourci ou ne peut pas être lu : le Content-Length
+      // envoyé ne peut plus être respecté
+      LOG_ERROR(host_.logger) << "can't send the file of fd " << file_.fd << ": "
+                              << (sent < 0 ? std::strerror(errno) : "end of file");
+      close();
+      return false;
+    }
+  return true;
+}
@@ -0,0 +1,150 @@
+/**
+ * \file   Connection.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 10:02:17 2012
+ *
+ * \brief  Connection class declaration.
+ *
+ */
+
+#ifndef BREF_API_TOOLS_EPOLLHOST_CONNECTION_H_
+#define BREF_API_TOOLS_EPOLLHOST_CONNECTION_H_
+
+#include "EventLoop.h"
+
+#include "bref/AccessRecord.h"
+#include "bref/Arena.h"
+#include "bref/ConfigSnapshot.h"
+#include "bref/Pipeline.h"
+#include "bref/PipelineExecutor.h"
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <ctime>
+#include <list>
+#include <memory>
+#include <vector>
+
+/*
+  Une connexion cliente et la requête en cours.
+
+  Les étapes de la Pipeline sont appelées dans l'ordre : connexion,
+  réception, parsing, postParsing, contenu, postContent, transform et
+  preSend, puis envoi. Les requêtes d'une même connexion sont traitées
+  l'une après l'autre, les requêtes pipelinées attendent dans input_.
+*/
+class Connection : bref::util::NonCopyable
+{
+  friend class EventLoop;
+
+private:
+  enum State
+    {
+      ReadingHeader,
+      ReadingBody,
+      Producing,
+      Sending
+    };
+
+  EventLoop &                                   loop_;
+  const Host &                                  host_;
+  int                                           socket_;
+  Watch                                         socketWatch_;
+  Watch                                         contentWatch_;
+  std::list<Connection *>::iterator             entry_;         // dans la liste de la boucle
+  std::time_t                                   lastActive_;
+
+  bref::ConfigHolder::Pin                       sessionConfig_; // vue par les handlers de la connexion
+  bref::ConfigHolder::Pin                       config_;        // celle de la requête en cours
+  bref::Arena                                   arena_;
+  bref::Environment                             environment_;
+  std::vector<bref::IDisposable *>              sessions_;
+  std::unique_ptr<bref::PipelineExecutor>       sessionExecutor_;
+  const bref::PipelineExecutor *                executor_;
+  bref::Pipeline::OnReceiveRequestHandler       receive_;
+  bref::Pipeline::OnSendRequestHandler          send_;
+  bref::Pipeline::ParsingRequestHandler         parse_;
+  bref::PipelineExecutor::PostReceiveChain      postReceive_;
+  bref::PipelineExecutor::PostContentChain      postContent_;
+  bref::PipelineExecutor::TransformChain        transform_;
+  bref::PipelineExecutor::PreSendChain          preSend_;
+
+  State                                         state_;
+  bref::HttpRequest                             request_;
+  bref::HttpResponse                            response_;
+  bref::Pipeline::IContentRequestHandler       *content_;
+  bref::FdType                                  contentFd_;
+  bref::FileRange                               file_;          // reste du corps donné par outFile()
+  bool                                          contentWatched_;
+  bool                                          contentPaused_;
+  bool                                          inFinished_;
+  uint64_t                                      bodyRemaining_;
+
+  bref::Buffer                                  input_;
+  bref::Buffer                                  chunk_;
+  bref::Buffer                                  scratch_;
+  bref::Buffer                                  pendingBody_;   // corps retenu avant l'en-tête
+  bref::Buffer                                  output_;
+  std::size_t                                   outputOffset_;
+  bool                                          sendPending_;   // le handler d'envoi a gardé des données
+
+  bool                                          headerSent_;
+  bool                                          chunked_;
+  bool                                          withoutBody_;
+  bool                                          keepAlive_;
+  bool                                          readBlocked_;
+  bool                                          closed_;
+
+  bref::AccessRecord                            record_;
+  uint64_t                                      started_;       // microsecondes, horloge monotone
+  uint64_t                                      parsed_;
+  uint64_t                                      produced_;
+  uint64_t                                      firstSent_;
+
+  void process();
+  bool readHeader();
+  bool readBody();
+  bool produce();
+  bool produceChunk();
+  void pinConfig();
+  void beginRequest();
+  void startContent();
+  void startFile();
+  void endContent();
+  void emit(bref::Buffer & data, bool last);
+  void writeHeader();
+  void appendBody(const bref::Buffer & data);
+  void finishRequest();
+  void fail(bref::status_codes::Type status);
+  bool flush();
+  bool flushOutput();
+  bool sendFailed();
+  bool sendFile(std::size_t & budget);
+  bool blocked() const;
+
+public:
+  Connection(EventLoop & loop, int socket, const bref::Environment::Client & client);
+  ~Connection();
+
+  /*
+    Appelle les sessionHooks des modules puis les connectionHooks.
+  */
+  void open();
+
+  /*
+    \p hangup indique que le client a fermé son côté de la connexion.
+  */
+  void onReadable(bool hangup);
+  void onWritable();
+  void onContentEvent();
+  void resume();
+
+  /*
+    Ferme la socket et libère les handlers et les sessions.
+  */
+  void close();
+  bool closed() const;
+};
+
+#endif /* !BREF_API_TOOLS_EPOLLHOST_CONNECTION_H_ */
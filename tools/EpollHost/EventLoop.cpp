@@ -0,0 +1,369 @@
+/**
+ * \file   EventLoop.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 09:40:03 2012
+ *
+ * \brief  EventLoop definition.
+ *
+ */
+
+#include "EventLoop.h"
+#include "Connection.h"
+
+#include "bref/ScopedLogger.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int MaxEvents = 256;
+
+std::time_t monotonicSeconds()
+{
+  struct timespec now;
+
+  ::clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return now.tv_sec;
+}
+
+/*
+  Un client IPv4 accepté sur une socket IPv6 a une adresse
+  IPv4-mapped, les modules le voient comme un client IPv4.
+*/
+bref::Environment::Client clientOf(const sockaddr_storage & address, int socket)
+{
+  bref::Environment::Client client;
+
+  client.Socket = socket;
+  if (address.ss_family == AF_INET6)
+    {
+      const sockaddr_in6 & v6 = reinterpret_cast<const sockaddr_in6 &>(address);
+
+      if (bref::util::isV4Mapped(v6.sin6_addr.s6_addr))
+        {
+          bref::IPv4Address v4;
+
+          std::memcpy(v4.bytes, v6.sin6_addr.s6_addr + 12, 4);
+          client.Ip = bref::IpAddress(v4);
+        }
+      else
+        client.Ip = bref::IpAddress(v6);
+      client.Port = static_cast<short>(ntohs(v6.sin6_port));
+    }
+  else
+    {
+      const sockaddr_in & v4 = reinterpret_cast<const sockaddr_in &>(address);
+
+      client.Ip   = bref::IpAddress(v4);
+      client.Port = static_cast<short>(ntohs(v4.sin_port));
+    }
+  return client;
+}
+
+} // ! unnamed namespace
+
+EventLoop::EventLoop(const Host & host)
+  : host_(host)
+  , epoll_(::epoll_create1(EPOLL_CLOEXEC))
+  , listen_(-1)
+  , stop_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  , stopping_(false)
+  , now_(monotonicSeconds())
+  , acceptPausedUntil_(0)
+  , connections_()
+  , deferred_()
+  , closed_()
+{
+  listenWatch_.kind       = Watch::Listen;
+  listenWatch_.connection = 0;
+  stopWatch_.kind         = Watch::Stop;
+  stopWatch_.connection   = 0;
+  add(stop_, EPOLLIN, &stopWatch_);
+}
+
+EventLoop::~EventLoop()
+{
+  while (! connections_.empty())
+    connections_.front()->close();
+  for (std::vector<Connection *>::iterator it = closed_.begin(); it != closed_.end(); ++it)
+    delete *it;
+  if (listen_ != -1)
+    ::close(listen_);
+  ::close(stop_);
+  ::close(epoll_);
+}
+
+bool EventLoop::listen(const std::string & address, int port, std::string & error)
+{
+  sockaddr_storage storage;
+  socklen_t        size;
+  bref::IpAddress  ip;
+
+  std::memset(&storage, 0, sizeof storage);
+  if (! bref::IpAddress::parse(address, ip))
+    {
+      error = "invalid address \"" + address + "\"";
+      return false;
+    }
+  if (ip.isV4())
+    {
+      sockaddr_in & v4 = reinterpret_cast<sockaddr_in &>(storage);
+
+      v4.sin_family = AF_INET;
+      v4.sin_port   = htons(static_cast<uint16_t>(port));
+      std::memcpy(&v4.sin_addr, ip.getV4().bytes, 4);
+      size = sizeof v4;
+    }
+  else
+    {
+      sockaddr_in6 & v6 = reinterpret_cast<sockaddr_in6 &>(storage);
+
+      v6.sin6_family = AF_INET6;
+      v6.sin6_port   = htons(static_cast<uint16_t>(port));
+      std::memcpy(&v6.sin6_addr, ip.getV6().bytes, 16);
+      size = sizeof v6;
+    }
+
+  const int fd  = ::socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  const int on  = 1;
+  const int off = 0;
+
+  if (fd < 0
+      || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) != 0
+      || ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) != 0
+      || (storage.ss_family == AF_INET6 && ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof off) != 0)
+      || ::bind(fd, reinterpret_cast<const sockaddr *>(&storage), size) != 0
+      || ::listen(fd, SOMAXCONN) != 0)
+    {
+      error = std::strerror(errno);
+      if (fd >= 0)
+        ::close(fd);
+      return false;
+    }
+  listen_ = fd;
+  return add(listen_, EPOLLIN, &listenWatch_);
+}
+
+void EventLoop::run()
+{
+  struct epoll_event events[MaxEvents];
+
+  while (! stopping_)
+    {
+      const int timeout = deferred_.empty() ? 1000 : 0;
+      const int count   = ::epoll_wait(epoll_, events, MaxEvents, timeout);
+
+      if (count < 0 && errno != EINTR)
+        {
+          LOG_FATAL(host_.logger) << "epoll_wait: " << std::strerror(errno);
+          return;
+        }
+
+      const std::time_t now = monotonicSeconds();
+      const bool        tick = now != now_;
+
+      now_ = now;
+      for (int i = 0; i < count; ++i)
+        {
+          const Watch   *watch = static_cast<const Watch *>(events[i].data.ptr);
+          const uint32_t ready = events[i].events;
+
+          switch (watch->kind)
+            {
+            case Watch::Listen:
+              accept();
+              break;
+
+            case Watch::Stop:
+              stopping_ = true;
+              break;
+
+            case Watch::Client:
+              if (watch->connection->closed())
+                break;
+              touch(watch->connection);
+              if (ready & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                watch->connection->onReadable((ready & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0);
+              if ((ready & EPOLLOUT) && ! watch->connection->closed())
+                watch->connection->onWritable();
+              break;
+
+            case Watch::Content:
+              if (watch->connection->closed())
+                break;
+              touch(watch->connection);
+              watch->connection->onContentEvent();
+              break;
+            }
+        }
+      runDeferred();
+      if (tick)
+        sweep();
+      for (std::vector<Connection *>::iterator it = closed_.begin(); it != closed_.end(); ++it)
+        delete *it;
+      closed_.clear();
+    }
+}
+
+void EventLoop::stop()
+{
+  const uint64_t one = 1;
+
+  if (::write(stop_, &one, sizeof one) < 0)
+    {
+      LOG_ERROR(host_.logger) << "eventfd: " << std::strerror(errno);
+    }
+}
+
+/*
+  Les connexions sont acceptées jusqu'à EAGAIN. Lorsque le processus
+  n'a plus de fd, l'écoute est suspendue une seconde plutôt que de
+  boucler sur la socket d'écoute (level-triggered).
+*/
+void EventLoop::accept()
+{
+  for (;;)
+    {
+      sockaddr_storage address;
+      socklen_t        size   = sizeof address;
+      const int        socket = ::accept4(listen_, reinterpret_cast<sockaddr *>(&address), &size,
+                                          SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+      if (socket < 0)
+        {
+          if (errno == EINTR || errno == ECONNABORTED)
+            continue;
+          if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+              LOG_ERROR(host_.logger) << "accept: " << std::strerror(errno) << ", pausing for 1 second";
+              modify(listen_, 0, &listenWatch_);
+              acceptPausedUntil_ = now_ + 1;
+            }
+          else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+              LOG_ERROR(host_.logger) << "accept: " << std::strerror(errno);
+            }
+          return;
+        }
+
+      const int on = 1;
+
+      // les réponses sont écrites en une fois, Nagle ne ferait que
+      // retarder la dernière partie
+      ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+
+      Connection *connection = new Connection(*this, socket, clientOf(address, socket));
+
+      connection->entry_      = connections_.insert(connections_.end(), connection);
+      connection->lastActive_ = now_;
+      if (! add(socket, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, &connection->socketWatch_))
+        {
+          connection->close();
+          continue;
+        }
+      connection->open();
+    }
+}
+
+/*
+  Ferme les connexions inactives, les plus anciennes sont en tête de
+  liste.
+*/
+void EventLoop::sweep()
+{
+  if (acceptPausedUntil_ && acceptPausedUntil_ <= now_)
+    {
+      acceptPausedUntil_ = 0;
+      modify(listen_, EPOLLIN, &listenWatch_);
+    }
+  while (! connections_.empty())
+    {
+      Connection *connection = connections_.front();
+
+      if (connection->lastActive_ + static_cast<std::time_t>(host_.timeout) > now_)
+        break;
+      LOG_DEBUG(host_.logger) << "connection from " << connection->environment_.client.Ip << " timed out";
+      connection->close();
+    }
+}
+
+void EventLoop::runDeferred()
+{
+  if (deferred_.empty())
+    return;
+
+  std::vector<Connection *> deferred;
+
+  deferred.swap(deferred_);
+  for (std::vector<Connection *>::iterator it = deferred.begin(); it != deferred.end(); ++it)
+    if (! (*it)->closed())
+      (*it)->resume();
+}
+
+const Host & EventLoop::host() const
+{
+  return host_;
+}
+
+std::time_t EventLoop::now() const
+{
+  return now_;
+}
+
+char *EventLoop::readBuffer()
+{
+  return readBuffer_;
+}
+
+bool EventLoop::add(int fd, uint32_t events, Watch *watch)
+{
+  struct epoll_event event;
+
+  event.events   = events;
+  event.data.ptr = watch;
+  return ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+bool EventLoop::modify(int fd, uint32_t events, Watch *watch)
+{
+  struct epoll_event event;
+
+  event.events   = events;
+  event.data.ptr = watch;
+  return ::epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void EventLoop::remove(int fd)
+{
+  struct epoll_event event;
+
+  ::epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, &event);
+}
+
+void EventLoop::defer(Connection *connection)
+{
+  deferred_.push_back(connection);
+}
+
+void EventLoop::touch(Connection *connection)
+{
+  connection->lastActive_ = now_;
+  connections_.splice(connections_.end(), connections_, connection->entry_);
+}
+
+void EventLoop::release(Connection *connection)
+{
+  connections_.erase(connection->entry_);
+  deferred_.erase(std::remove(deferred_.begin(), deferred_.end(), connection), deferred_.end());
+  closed_.push_back(connection);
+}
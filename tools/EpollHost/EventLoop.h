@@ -0,0 +1,125 @@
+/**
+ * \file   EventLoop.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 09:40:03 2012
+ *
+ * \brief  EventLoop class declaration.
+ *
+ */
+
+#ifndef BREF_API_TOOLS_EPOLLHOST_EVENTLOOP_H_
+#define BREF_API_TOOLS_EPOLLHOST_EVENTLOOP_H_
+
+#include "Host.h"
+
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <stdint.h>
+
+#include <ctime>
+#include <list>
+#include <string>
+#include <vector>
+
+class Connection;
+
+/*
+  Ce qui est enregistré dans l'epoll : la socket d'écoute, l'eventfd
+  d'arrêt, la socket d'un client ou le fd donné par un ContentHook.
+*/
+struct Watch
+{
+  enum Kind
+    {
+      Listen,
+      Stop,
+      Client,
+      Content
+    };
+
+  Kind        kind;
+  Connection *connection;
+};
+
+/*
+  Une boucle epoll, une par thread.
+
+  Chaque boucle a sa propre socket d'écoute (SO_REUSEPORT), le noyau
+  répartit les connexions entre les boucles ; une connexion reste sur
+  la boucle qui l'a acceptée. Les sockets clientes sont en
+  edge-triggered, les fd des modules en level-triggered : l'API ne
+  demande pas aux handlers de les vider.
+*/
+class EventLoop : bref::util::NonCopyable
+{
+public:
+  static const std::size_t ReadSize = 64 * 1024;
+
+private:
+  typedef std::list<Connection *> ConnectionList;
+
+  const Host &                  host_;
+  int                           epoll_;
+  int                           listen_;
+  int                           stop_;
+  Watch                         listenWatch_;
+  Watch                         stopWatch_;
+  bool                          stopping_;
+  std::time_t                   now_;
+  std::time_t                   acceptPausedUntil_;
+  ConnectionList                connections_;   // de la moins à la plus récemment active
+  std::vector<Connection *>     deferred_;
+  std::vector<Connection *>     closed_;
+  char                          readBuffer_[ReadSize];
+
+  void accept();
+  void sweep();
+  void runDeferred();
+
+public:
+  explicit EventLoop(const Host & host);
+  ~EventLoop();
+
+  /*
+    Ouvre la socket d'écoute de la boucle sur \p address (IPv4 ou
+    IPv6, "::" accepte aussi les clients IPv4).
+  */
+  bool listen(const std::string & address, int port, std::string & error);
+
+  /*
+    Traite les évènements jusqu'à l'appel de stop().
+  */
+  void run();
+
+  /*
+    Arrête la boucle, peut être appelée depuis n'importe quel thread.
+  */
+  void stop();
+
+  const Host & host() const;
+  std::time_t now() const;
+  char *readBuffer();
+
+  bool add(int fd, uint32_t events, Watch *watch);
+  bool modify(int fd, uint32_t events, Watch *watch);
+  void remove(int fd);
+
+  /*
+    La connexion est rappelée (Connection::resume()) après les
+    évènements en cours, sans attendre de nouvel évènement.
+  */
+  void defer(Connection *connection);
+
+  /*
+    Marque la connexion comme active, pour le délai d'inactivité.
+  */
+  void touch(Connection *connection);
+
+  /*
+    Appelée par une connexion fermée, elle est détruite à la fin de
+    l'itération.
+  */
+  void release(Connection *connection);
+};
+
+#endif /* !BREF_API_TOOLS_EPOLLHOST_EVENTLOOP_H_ */
@@ -0,0 +1,102 @@
+/**
+ * \file   Host.h
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 09:12:44 2012
+ *
+ * \brief  Host et ModuleSet, l'état partagé par les boucles
+ *         d'évènements.
+ *
+ */
+
+#ifndef BREF_API_TOOLS_EPOLLHOST_HOST_H_
+#define BREF_API_TOOLS_EPOLLHOST_HOST_H_
+
+#include "bref/AModule.h"
+#include "bref/ConfigSnapshot.h"
+#include "bref/ILogger.h"
+#include "bref/Pipeline.h"
+#include "bref/PipelineExecutor.h"
+#include "bref/detail/util/NonCopyable.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+  Les modules chargés avec dlopen(), dans l'ordre de la ligne de
+  commande. Les modules sont libérés (dispose()) avant la fermeture de
+  leur librairie.
+*/
+class ModuleSet : bref::util::NonCopyable
+{
+private:
+  struct Module
+  {
+    void          *library;
+    bref::AModule *module;
+  };
+
+  std::vector<Module> modules_;
+
+public:
+  static const bref::Version ApiVersion;
+
+  ModuleSet();
+  ~ModuleSet();
+
+  /*
+    Charge le module \p path et vérifie sa version minimale de l'API :
+    un numéro majeur différent écarte le module, un numéro mineur
+    différent donne un avertissement.
+  */
+  bool load(const std::string &         path,
+            bref::ILogger              *logger,
+            const bref::ServerConfig &  config,
+            const bref::IConfHelper &   helper);
+
+  void registerHooks(bref::Pipeline & pipeline) const;
+
+  /*
+    Appelle registerSessionHooks() sur chaque module, les sessions
+    retournées sont ajoutées à \p sessions.
+  */
+  void registerSessionHooks(bref::Pipeline & pipeline, std::vector<bref::IDisposable *> & sessions) const;
+
+  std::size_t size() const;
+};
+
+/*
+  Ajoute les hooks de \p global à ceux enregistrés par les sessions
+  d'une connexion.
+
+  Retourne false, sans modifier \p session, si les sessions n'ont
+  enregistré aucun hook : la connexion utilise alors Host::executor.
+*/
+bool mergePipeline(bref::Pipeline & session, const bref::Pipeline & global);
+
+/*
+  L'état en lecture seule partagé par toutes les boucles, les hooks
+  enregistrés une fois pour toutes par registerHooks() sont compilés
+  dans executor.
+*/
+struct Host : bref::util::NonCopyable
+{
+  bref::ConfigHolder      configs;
+  bref::ILogger          *logger;
+  const ModuleSet &       modules;
+  bref::PipelineExecutor  executor;
+  bref::Pipeline          pipeline;
+  unsigned                timeout;    // secondes d'inactivité avant fermeture
+
+  Host(const std::shared_ptr<const bref::ConfigSnapshot> & config,
+       bref::ILogger                                      *theLogger,
+       const ModuleSet &                                   theModules)
+    : configs(config)
+    , logger(theLogger)
+    , modules(theModules)
+    , executor()
+    , pipeline()
+    , timeout(30)
+  { }
+};
+
+#endif /* !BREF_API_TOOLS_EPOLLHOST_HOST_H_ */
@@ -0,0 +1,228 @@
+/**
+ * \file   Main.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 11:34:09 2012
+ *
+ * \brief  Hôte de référence : charge les modules et lance une boucle
+ *         epoll par thread.
+ *
+ */
+
+#include "EventLoop.h"
+#include "Host.h"
+
+#include "bref/AsyncLogger.h"
+#include "bref/BrefValueView.h"
+#include "bref/ConfigSnapshot.h"
+#include "bref/ScopedLogger.h"
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Options
+{
+  Options()
+    : configFile(), defines(), modules(), verbose(false)
+  { }
+
+  std::string                                       configFile;
+  std::vector<std::pair<std::string, std::string> > defines;
+  std::vector<std::string>                          modules;
+  bool                                              verbose;
+};
+
+void usage(const char *program)
+{
+  std::fprintf(stderr,
+               "usage: %s [-v] [-c config.img] [-D Key=Value ...] module.so [module.so ...]\n"
+               "  -c  configuration image written by bref::BrefValueImage\n"
+               "  -D  set a configuration key (Address, Port, Threads, Timeout, ...)\n"
+               "  -v  log the debug messages\n",
+               program);
+}
+
+bool parseArguments(int argc, char **argv, Options & options)
+{
+  for (int i = 1; i < argc; ++i)
+    {
+      const std::string argument = argv[i];
+
+      if (argument == "-v")
+        options.verbose = true;
+      else if (argument == "-c" && i + 1 < argc)
+        options.configFile = argv[++i];
+      else if (argument == "-D" && i + 1 < argc)
+        {
+          const std::string            define = argv[++i];
+          const std::string::size_type equal  = define.find('=');
+
+          if (equal == std::string::npos || equal == 0)
+            return false;
+          options.defines.push_back(std::make_pair(define.substr(0, equal), define.substr(equal + 1)));
+        }
+      else if (! argument.empty() && argument[0] == '-')
+        return false;
+      else
+        options.modules.push_back(argument);
+    }
+  return true;
+}
+
+/*
+  Une valeur donnée avec -D est un entier, un booléen ou une chaîne.
+*/
+bref::BrefValue defineValue(const std::string & text)
+{
+  if (text == "true" || text == "false")
+    return bref::BrefValue(text == "true");
+
+  char      *end   = 0;
+  const long value = std::strtol(text.c_str(), &end, 10);
+
+  if (! text.empty() && *end == '\0' && value >= -2147483647L && value <= 2147483647L)
+    return bref::BrefValue(static_cast<int>(value));
+  return bref::BrefValue(text);
+}
+
+bool loadConfig(const Options & options, bref::BrefValue & config, bref::ILogger *logger)
+{
+  if (! options.configFile.empty())
+    {
+      bref::MappedBrefValue image;
+
+      if (! image.open(options.configFile))
+        {
+          LOG_ERROR(logger) << "can't load the configuration image " << options.configFile;
+          return false;
+        }
+      config = image.root().toBrefValue();
+    }
+  for (std::size_t i = 0; i < options.defines.size(); ++i)
+    config[options.defines[i].first] = defineValue(options.defines[i].second);
+  if (! config.isArray())
+    config = bref::BrefValue(bref::BrefValueArray());
+  return true;
+}
+
+int intValue(const bref::IConfHelper & helper, const char *key, int defaultValue)
+{
+  const bref::BrefValue & value = helper.findValue(key);
+
+  return value.isInt() ? value.asInt() : defaultValue;
+}
+
+} // ! unnamed namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+
+  if (! parseArguments(argc, argv, options))
+    {
+      usage(argv[0]);
+      return 2;
+    }
+
+  // bloqués avant la création des threads, les signaux sont attendus
+  // par sigwait() dans le thread principal
+  sigset_t signals;
+
+  ::sigemptyset(&signals);
+  ::sigaddset(&signals, SIGINT);
+  ::sigaddset(&signals, SIGTERM);
+  ::sigaddset(&signals, SIGHUP);
+  ::pthread_sigmask(SIG_BLOCK, &signals, 0);
+  ::signal(SIGPIPE, SIG_IGN);
+
+  bref::AsyncLogger logger(bref::AsyncLogger::FdWriter(2), bref::AsyncLogger::Options(),
+                           options.verbose ? bref::ILogger::Debug : bref::ILogger::Info);
+  bref::BrefValue   config;
+
+  if (! loadConfig(options, config, &logger))
+    return 1;
+
+  // les modules gardent parfois la configuration donnée à
+  // loadModule(), elle reste valide jusqu'à leur destruction
+  const bref::ConfigHolder::Pin initial = bref::ConfigSnapshot::create(config);
+  ModuleSet                     modules;
+
+  for (std::size_t i = 0; i < options.modules.size(); ++i)
+    modules.load(options.modules[i], &logger, initial->config, initial->helper);
+
+  Host host(initial, &logger, modules);
+
+  // un handler d'envoi peut garder une partie des données, voir
+  // Connection::flushOutput()
+  host.pipeline.deferredSend = true;
+  modules.registerHooks(host.pipeline);
+  host.executor.compile(host.pipeline);
+  host.timeout = static_cast<unsigned>(std::max(1, intValue(initial->helper, "Timeout", 30)));
+
+  const bref::BrefValue & address     = initial->helper.findValue("Address");
+  const int               port        = intValue(initial->helper, "Port", 8080);
+  const int               threadCount = std::max(1, intValue(initial->helper, "Threads",
+                                                             std::thread::hardware_concurrency()));
+  std::string             listenAddress = address.isString() ? address.asString() : "::";
+  std::vector<std::unique_ptr<EventLoop> > loops;
+
+  for (int i = 0; i < threadCount; ++i)
+    {
+      std::unique_ptr<EventLoop> loop(new EventLoop(host));
+      std::string                error;
+
+      // sans IPv6, l'adresse par défaut est 0.0.0.0
+      if (! loop->listen(listenAddress, port, error)
+          && (i != 0 || address.isString() || ! loop->listen(listenAddress = "0.0.0.0", port, error)))
+        {
+          LOG_FATAL(&logger) << "can't listen on " << listenAddress << " port " << port << ": " << error;
+          return 1;
+        }
+      loops.push_back(BREF_MOVE(loop));
+    }
+  LOG_INFO(&logger) << "listening on " << listenAddress << " port " << port << ", " << threadCount
+                    << " threads, " << modules.size() << " modules";
+
+  std::vector<std::thread> threads;
+
+  for (std::size_t i = 0; i < loops.size(); ++i)
+    threads.push_back(std::thread(&EventLoop::run, loops[i].get()));
+
+  for (;;)
+    {
+      int signal = 0;
+
+      ::sigwait(&signals, &signal);
+      if (signal != SIGHUP)
+        break;
+
+      // les connexions ouvertes gardent leur configuration, les
+      // suivantes utilisent la nouvelle ; l'adresse, le port et le
+      // nombre de threads ne changent pas
+      bref::BrefValue reloaded;
+
+      if (loadConfig(options, reloaded, &logger))
+        {
+          host.configs.publish(bref::ConfigSnapshot::create(reloaded, *host.configs.load()));
+          LOG_INFO(&logger) << "configuration reloaded";
+        }
+    }
+
+  LOG_INFO(&logger) << "stopping";
+  for (std::size_t i = 0; i < loops.size(); ++i)
+    loops[i]->stop();
+  for (std::size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+  loops.clear();
+  return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * \file   ModuleSet.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 09:12:44 2012
+ *
+ * \brief  ModuleSet et mergePipeline.
+ *
+ */
+
+#include "Host.h"
+#include "bref/ScopedLogger.h"
+
+#include <dlfcn.h>
+
+const bref::Version ModuleSet::ApiVersion(0, 4);
+
+namespace {
+
+typedef bref::AModule *(*LoadModuleFunction)(bref::ILogger *,
+                                              const bref::ServerConfig &,
+                                              const bref::IConfHelper &);
+
+/*
+  Les 14 listes de hooks de deux Pipeline, deux à deux.
+*/
+template <typename Visitor>
+void visitHooks(bref::Pipeline & a, const bref::Pipeline & b, Visitor & visitor)
+{
+  visitor(a.connectionHooks,       b.connectionHooks);
+  visitor(a.onReceiveHooks,        b.onReceiveHooks);
+  visitor(a.onSendHooks,           b.onSendHooks);
+  visitor(a.postReceiveHooks,      b.postReceiveHooks);
+  visitor(a.postReceiveChainHooks, b.postReceiveChainHooks);
+  visitor(a.parsingHooks,          b.parsingHooks);
+  visitor(a.postParsingHooks,      b.postParsingHooks);
+  visitor(a.contentHooks,          b.contentHooks);
+  visitor(a.postContentHooks,      b.postContentHooks);
+  visitor(a.postContentChainHooks, b.postContentChainHooks);
+  visitor(a.transformHooks,        b.transformHooks);
+  visitor(a.transformChainHooks,   b.transformChainHooks);
+  visitor(a.preSendHooks,          b.preSendHooks);
+  visitor(a.preSendChainHooks,     b.preSendChainHooks);
+}
+
+struct CountHooks
+{
+  std::size_t count;
+
+  template <typename List>
+  void operator()(const List & hooks, const List & /* other */)
+  {
+    count += hooks.size();
+  }
+};
+
+struct PrependHooks
+{
+  template <typename List>
+  void operator()(List & hooks, const List & global)
+  {
+    hooks.insert(hooks.begin(), global.begin(), global.end());
+  }
+};
+
+} // ! unnamed namespace
+
+ModuleSet::ModuleSet()
+  : modules_()
+{ }
+
+ModuleSet::~ModuleSet()
+{
+  // dans l'ordre inverse du chargement, un module peut dépendre des
+  // symboles d'un module chargé avant lui
+  for (std::vector<Module>::reverse_iterator it = modules_.rbegin(); it != modules_.rend(); ++it)
+    {
+      it->module->dispose();
+      ::dlclose(it->library);
+    }
+}
+
+bool ModuleSet::load(const std::string &         path,
+                     bref::ILogger              *logger,
+                     const bref::ServerConfig &  config,
+                     const bref::IConfHelper &   helper)
+{
+  void *library = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+  if (! library)
+    {
+      LOG_ERROR(logger) << "can't load " << path << ": " << ::dlerror();
+      return false;
+    }
+
+  // la conversion d'un void * en pointeur de fonction passe par
+  // l'union, ISO C++ ne l'autorise pas directement
+  union
+  {
+    void               *symbol;
+    LoadModuleFunction  function;
+  } loadModule;
+
+  loadModule.symbol = ::dlsym(library, "loadModule");
+  if (! loadModule.symbol)
+    {
+      LOG_ERROR(logger) << path << ": no loadModule() function";
+      ::dlclose(library);
+      return false;
+    }
+
+  bref::AModule *module = loadModule.function(logger, config, helper);
+
+  if (! module)
+    {
+      LOG_ERROR(logger) << path << ": loadModule() failed";
+      ::dlclose(library);
+      return false;
+    }
+
+  const bref::Version & required = module->minimumApiVersion();
+
+  if (required.Major != ApiVersion.Major)
+    {
+      LOG_WARN(logger) << module->name() << " requires the API " << required.Major << "." << required.Minor
+                       << ", the module is not used";
+      module->dispose();
+      ::dlclose(library);
+      return false;
+    }
+  if (required.Minor != ApiVersion.Minor)
+    {
+      LOG_WARN(logger) << module->name() << " was written for the API " << required.Major << "." << required.Minor
+                       << ", this host implements " << ApiVersion.Major << "." << ApiVersion.Minor;
+    }
+
+  const Module loaded = { library, module };
+
+  modules_.push_back(loaded);
+  LOG_INFO(logger) << "module " << module->name() << " " << module->version().Major << "."
+                   << module->version().Minor << " loaded: " << module->description();
+  return true;
+}
+
+void ModuleSet::registerHooks(bref::Pipeline & pipeline) const
+{
+  for (std::vector<Module>::const_iterator it = modules_.begin(); it != modules_.end(); ++it)
+    it->module->registerHooks(pipeline);
+}
+
+void ModuleSet::registerSessionHooks(bref::Pipeline &                   pipeline,
+                                     std::vector<bref::IDisposable *> & sessions) const
+{
+  for (std::vector<Module>::const_iterator it = modules_.begin(); it != modules_.end(); ++it)
+    {
+      bref::IDisposable *session = it->module->registerSessionHooks(pipeline);
+
+      if (session)
+        sessions.push_back(session);
+    }
+}
+
+std::size_t ModuleSet::size() const
+{
+  return modules_.size();
+}
+
+bool mergePipeline(bref::Pipeline & session, const bref::Pipeline & global)
+{
+  CountHooks counter = { 0 };
+
+  visitHooks(session, global, counter);
+  if (! counter.count)
+    return false;
+
+  // les hooks globaux d'abord, à priorité égale ils passent avant ceux
+  // de la session
+  PrependHooks prepend;
+
+  visitHooks(session, global, prepend);
+  return true;
+}
@@ -0,0 +1,225 @@
+/**
+ * \file   ServerApi.cpp
+ * \author Guillaume Papin <guillaume.papin@epitech.eu>
+ * \date   Fri May 18 09:20:51 2012
+ *
+ * \brief  Définition des classes de l'API implémentées par le serveur
+ *         (HttpRequest, HttpResponse, IpAddress, AModule).
+ *
+ * L'exécutable est lié avec -rdynamic : les modules chargés avec
+ * dlopen() utilisent ces définitions.
+ */
+
+#include "bref/AModule.h"
+#include "bref/HttpRequest.h"
+#include "bref/HttpResponse.h"
+#include "bref/IpAddress.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <cstring>
+
+namespace bref {
+
+/*
+  HttpRequest
+*/
+HttpRequest::HttpRequest()
+  : HttpHeader()
+  , method_(request_methods::UndefinedRequestMethod)
+  , uri_()
+  , version_()
+{ }
+
+HttpRequest::~HttpRequest()
+{ }
+
+request_methods::Type HttpRequest::getMethod() const
+{
+  return method_;
+}
+
+const std::string & HttpRequest::getUri() const
+{
+  return uri_;
+}
+
+const Version & HttpRequest::getVersion() const
+{
+  return version_;
+}
+
+void HttpRequest::setMethod(request_methods::Type method)
+{
+  method_ = method;
+}
+
+void HttpRequest::setUri(const std::string & uri)
+{
+  uri_ = uri;
+}
+
+void HttpRequest::setVersion(const Version & version)
+{
+  version_ = version;
+}
+
+/*
+  HttpResponse
+*/
+HttpResponse::HttpResponse()
+  : HttpHeader()
+  , version_()
+  , statusCode_(status_codes::UndefinedStatusCode)
+  , reason_()
+{ }
+
+HttpResponse::~HttpResponse()
+{ }
+
+const Version & HttpResponse::getVersion() const
+{
+  return version_;
+}
+
+status_codes::Type HttpResponse::getStatus() const
+{
+  return statusCode_;
+}
+
+const std::string & HttpResponse::getReason() const
+{
+  return reason_;
+}
+
+Buffer HttpResponse::getRawData() const
+{
+  Buffer buffer;
+
+  appendRawData(buffer);
+  return buffer;
+}
+
+void HttpResponse::setVersion(const Version & version)
+{
+  version_ = version;
+}
+
+void HttpResponse::setStatus(status_codes::Type type)
+{
+  statusCode_ = type;
+}
+
+void HttpResponse::setReason(const std::string & reason)
+{
+  reason_ = reason;
+}
+
+/*
+  IpAddress
+
+  Une adresse IPv4 est dans v4_[0] ; une adresse IPv6 qui contient une
+  adresse IPv4 (::a.b.c.d ou ::ffff:a.b.c.d) l'a dans v4_[3].
+*/
+IpAddress::IpAddress()
+  : ipAddressStatus_(IPerror)
+{
+  std::memset(&ipAddress_, 0, sizeof ipAddress_);
+}
+
+IpAddress::IpAddress(const char *host)
+  : ipAddressStatus_(IPerror)
+{
+  std::memset(&ipAddress_, 0, sizeof ipAddress_);
+  if (! host || parse(host, std::strlen(host), *this))
+    return;
+
+  struct addrinfo  hints;
+  struct addrinfo *result = 0;
+
+  std::memset(&hints, 0, sizeof hints);
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (::getaddrinfo(host, 0, &hints, &result) != 0)
+    return;
+  if (result->ai_family == AF_INET)
+    *this = IpAddress(*reinterpret_cast<const sockaddr_in *>(result->ai_addr));
+  else if (result->ai_family == AF_INET6)
+    *this = IpAddress(*reinterpret_cast<const sockaddr_in6 *>(result->ai_addr));
+  ::freeaddrinfo(result);
+}
+
+IpAddress::~IpAddress()
+{ }
+
+bool IpAddress::isV4() const
+{
+  return ipAddressStatus_ == IPv4;
+}
+
+bool IpAddress::isV6() const
+{
+  return ipAddressStatus_ == IPv6;
+}
+
+bool IpAddress::isV4Compatible() const
+{
+  if (ipAddressStatus_ == IPv4)
+    return true;
+  if (ipAddressStatus_ != IPv6)
+    return false;
+  if (util::isV4Mapped(ipAddress_.v6_.bytes))
+    return true;
+  // ::a.b.c.d, sauf :: et ::1
+  for (int i = 0; i < 12; ++i)
+    if (ipAddress_.v6_.bytes[i])
+      return false;
+  return ipAddress_.v4_[3].bytes[0] || ipAddress_.v4_[3].bytes[1] || ipAddress_.v4_[3].bytes[2]
+    || ipAddress_.v4_[3].bytes[3] > 1;
+}
+
+const IPv4Address & IpAddress::getV4() const
+{
+  return ipAddressStatus_ == IPv4 ? ipAddress_.v4_[0] : ipAddress_.v4_[3];
+}
+
+const IPv6Address & IpAddress::getV6() const
+{
+  return ipAddress_.v6_;
+}
+
+/*
+  AModule
+*/
+AModule::AModule(const std::string & name,
+                 const std::string & description,
+                 const Version &     version,
+                 const Version &     minimumApiVersion)
+  : name_(name)
+  , description_(description)
+  , version_(version)
+  , minimumApiVersion_(minimumApiVersion)
+{ }
+
+const std::string & AModule::name() const
+{
+  return name_;
+}
+
+const std::string & AModule::description() const
+{
+  return description_;
+}
+
+const Version & AModule::version() const
+{
+  return version_;
+}
+
+const Version & AModule::minimumApiVersion() const
+{
+  return minimumApiVersion_;
+}
+
+} // ! bref